@@ -0,0 +1,87 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/transaction/transaction.hpp"
+#include "uhs/transaction/wallet.hpp"
+
+#include <benchmark/benchmark.h>
+
+using coin_selection = cbdc::transaction::wallet::coin_selection;
+
+/// Distinct UTXO values in the benchmark wallets.
+static constexpr uint64_t max_utxo_value = 1000;
+
+/// Fills the wallet with the given number of UTXOs with values in
+/// [1, max_utxo_value].
+/// @param wal wallet to fill.
+/// @param n_utxos number of UTXOs to add.
+void fill_wallet(cbdc::transaction::wallet& wal, int64_t n_utxos) {
+    static constexpr size_t batch_size = 100000;
+    auto batch = std::vector<cbdc::transaction::input>();
+    batch.reserve(batch_size);
+    for(uint64_t i = 0; i < static_cast<uint64_t>(n_utxos); i++) {
+        auto inp = cbdc::transaction::input();
+        std::memcpy(inp.m_prevout.m_tx_id.data(), &i, sizeof(i));
+        inp.m_prevout_data.m_value = i % max_utxo_value + 1;
+        batch.push_back(inp);
+        if(batch.size() == batch_size) {
+            wal.confirm_inputs(batch);
+            batch.clear();
+        }
+    }
+    wal.confirm_inputs(batch);
+}
+
+/// Time selecting the inputs of unsigned sends from a wallet holding
+/// state.range(0) UTXOs using coin selection policy state.range(1). Sends
+/// pay back to the wallet so its size stays roughly constant.
+static void wallet_send(benchmark::State& state) {
+    auto wal = cbdc::transaction::wallet();
+    fill_wallet(wal, state.range(0));
+    wal.set_coin_selection(static_cast<coin_selection>(state.range(1)));
+    const auto payee = wal.generate_key();
+
+    uint64_t amount{1};
+    for(auto _ : state) {
+        auto tx = wal.send_to(static_cast<uint32_t>(amount), payee, false);
+        state.PauseTiming();
+        wal.confirm_transaction(tx.value());
+        amount = amount % (max_utxo_value * 3) + 1;
+        state.ResumeTiming();
+    }
+}
+
+/// Time selecting the inputs of unsigned fan transactions with ten outputs
+/// from a wallet holding state.range(0) UTXOs using coin selection policy
+/// state.range(1).
+static void wallet_fan(benchmark::State& state) {
+    static constexpr size_t fan_outputs = 10;
+    auto wal = cbdc::transaction::wallet();
+    fill_wallet(wal, state.range(0));
+    wal.set_coin_selection(static_cast<coin_selection>(state.range(1)));
+    const auto payee = wal.generate_key();
+
+    uint32_t value{1};
+    for(auto _ : state) {
+        auto tx = wal.fan(fan_outputs, value, payee, false);
+        state.PauseTiming();
+        wal.confirm_transaction(tx.value());
+        value = value % static_cast<uint32_t>(max_utxo_value) + 1;
+        state.ResumeTiming();
+    }
+}
+
+BENCHMARK(wallet_send)
+    ->ArgsProduct({{1000000, 10000000},
+                   {static_cast<int64_t>(coin_selection::oldest_first),
+                    static_cast<int64_t>(coin_selection::exact_match),
+                    static_cast<int64_t>(coin_selection::fewest_inputs)}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(wallet_fan)
+    ->ArgsProduct({{1000000, 10000000},
+                   {static_cast<int64_t>(coin_selection::oldest_first),
+                    static_cast<int64_t>(coin_selection::fewest_inputs)}})
+    ->Unit(benchmark::kMicrosecond);
@@ -26,7 +26,11 @@ namespace cbdc::parsec::agent::rpc {
             = request{std::move(function), std::move(param), is_readonly_run};
         return m_client->call(std::move(req),
                               [result_callback](std::optional<response> resp) {
-                                  assert(resp.has_value());
+                                  if(!resp.has_value()) {
+                                      result_callback(
+                                          interface::error_code::retry);
+                                      return;
+                                  }
                                   result_callback(resp.value());
                               });
     }
@@ -44,6 +44,15 @@ namespace cbdc::parsec::agent::rpc {
                      req.m_function.to_hex(),
                      " and param size ",
                      req.m_param.size());
+        if(m_cfg.m_speculative_batch_size > 1 && !req.m_is_readonly_run) {
+            return speculative_exec(
+                req.m_function,
+                req.m_param,
+                [callback](interface::exec_return_type res) {
+                    callback(res);
+                },
+                &runner::factory<runner::lua_runner>::create);
+        }
         auto id = m_next_id++;
         auto a = [&]() {
             auto agent = std::make_shared<impl>(
@@ -5,7 +5,9 @@
 
 #include "server_interface.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <iterator>
 
 namespace cbdc::parsec::agent::rpc {
     server_interface::server_interface(
@@ -14,7 +16,10 @@ namespace cbdc::parsec::agent::rpc {
         const cbdc::parsec::config& cfg)
         : m_broker(std::move(broker)),
           m_log(std::move(log)),
-          m_cfg(cfg) {
+          m_cfg(cfg),
+          m_threads(std::make_shared<thread_pool>(
+              std::max(m_cfg.m_agent_threads,
+                       m_cfg.m_speculative_batch_size + 1))) {
         m_cleanup_thread = std::thread([&]() {
             size_t id{};
             while(m_cleanup_queue.pop(id)) {
@@ -38,6 +43,72 @@ namespace cbdc::parsec::agent::rpc {
         });
     }
 
+    auto server_interface::speculative_exec(
+        runtime_locking_shard::key_type function,
+        parameter_type param,
+        interface::exec_callback_type result_callback,
+        runner::interface::factory_type runner_factory) -> bool {
+        {
+            std::unique_lock l(m_batch_mut);
+            m_pending_batch.push_back({std::move(function),
+                                       std::move(param),
+                                       std::move(result_callback)});
+            m_batch_runner_factory = std::move(runner_factory);
+            if(m_batches_running
+               >= std::max(m_cfg.m_speculative_batch_concurrency,
+                           size_t{1})) {
+                return true;
+            }
+            m_batches_running++;
+        }
+        start_batch();
+        return true;
+    }
+
+    void server_interface::start_batch() {
+        auto txs = std::vector<speculative_batch::tx_type>();
+        auto factory = runner::interface::factory_type();
+        {
+            std::unique_lock l(m_batch_mut);
+            auto n = std::min(m_pending_batch.size(),
+                              m_cfg.m_speculative_batch_size);
+            auto end = m_pending_batch.begin() + static_cast<ptrdiff_t>(n);
+            std::move(m_pending_batch.begin(), end, std::back_inserter(txs));
+            m_pending_batch.erase(m_pending_batch.begin(), end);
+            factory = m_batch_runner_factory;
+            // Another batch started in the meantime and took the queued
+            // functions
+            if(txs.empty()) {
+                m_batches_running--;
+                return;
+            }
+        }
+        m_log->trace("Starting speculative batch of", txs.size());
+        auto batch = std::make_shared<speculative_batch>(
+            m_log,
+            m_cfg,
+            std::move(factory),
+            m_broker,
+            std::move(txs),
+            m_secp,
+            m_threads,
+            [this]() {
+                {
+                    std::unique_lock l(m_batch_mut);
+                    if(m_pending_batch.empty()) {
+                        m_batches_running--;
+                        return;
+                    }
+                }
+                // Start the next batch on a pool thread so batches don't
+                // nest on the stack of the previous batch's last callback
+                m_threads->push([this]() {
+                    start_batch();
+                });
+            });
+        batch->exec();
+    }
+
     server_interface::~server_interface() {
         m_retry_queue.clear();
         m_retry_thread.join();
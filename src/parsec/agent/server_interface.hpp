@@ -9,6 +9,7 @@
 #include "interface.hpp"
 #include "messages.hpp"
 #include "parsec/agent/impl.hpp"
+#include "parsec/agent/speculative_batch.hpp"
 #include "parsec/broker/interface.hpp"
 #include "parsec/directory/interface.hpp"
 #include "util/common/blocking_queue.hpp"
@@ -62,13 +63,36 @@ namespace cbdc::parsec::agent::rpc {
         blocking_priority_queue<size_t, std::greater<>> m_retry_queue;
         std::thread m_retry_thread;
 
-        std::shared_ptr<thread_pool> m_threads{
-            std::make_shared<thread_pool>()};
+        std::shared_ptr<thread_pool> m_threads;
+
+        std::mutex m_batch_mut;
+        std::vector<speculative_batch::tx_type> m_pending_batch;
+        size_t m_batches_running{};
+        runner::interface::factory_type m_batch_runner_factory;
 
         std::shared_ptr<secp256k1_context> m_secp{
             secp256k1_context_create(SECP256K1_CONTEXT_SIGN
                                      | SECP256K1_CONTEXT_VERIFY),
             &secp256k1_context_destroy};
+
+        /// Queues a function for speculative execution. Starts a new batch
+        /// if fewer than the configured number of batches are executing.
+        /// Otherwise the function is executed in the next batch to start,
+        /// together with other functions queued in the meantime, up to the
+        /// configured batch size. Retries are handled within the batch, so
+        /// the result is never error_code::retry.
+        /// \param function key of the function bytecode.
+        /// \param param function parameter.
+        /// \param result_callback function to call with the result.
+        /// \param runner_factory factory for the runner type to use.
+        /// \return true.
+        auto speculative_exec(runtime_locking_shard::key_type function,
+                              parameter_type param,
+                              interface::exec_callback_type result_callback,
+                              runner::interface::factory_type runner_factory)
+            -> bool;
+
+        void start_batch();
     };
 }
 
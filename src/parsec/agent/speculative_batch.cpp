@@ -0,0 +1,684 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "speculative_batch.hpp"
+
+#include "util/common/variant_overloaded.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <thread>
+
+namespace cbdc::parsec::agent {
+    auto speculative_batch::version_type::operator==(
+        const version_type& rhs) const -> bool {
+        return m_tx == rhs.m_tx && m_incarnation == rhs.m_incarnation;
+    }
+
+    speculative_batch::speculative_batch(
+        std::shared_ptr<logging::log> logger,
+        cbdc::parsec::config cfg,
+        runner::interface::factory_type runner_factory,
+        std::shared_ptr<broker::interface> broker,
+        std::vector<tx_type> txs,
+        std::shared_ptr<secp256k1_context> secp,
+        std::shared_ptr<thread_pool> t_pool,
+        done_callback_type done_callback)
+        : m_log(std::move(logger)),
+          m_cfg(std::move(cfg)),
+          m_runner_factory(std::move(runner_factory)),
+          m_broker(std::move(broker)),
+          m_txs(std::move(txs)),
+          m_secp(std::move(secp)),
+          m_threads(std::move(t_pool)),
+          m_done_callback(std::move(done_callback)),
+          m_tx_states(m_txs.size()) {
+        assert(!m_txs.empty());
+    }
+
+    auto speculative_batch::exec() -> bool {
+        auto success = m_broker->begin(
+            [self = shared_from_this()](
+                broker::interface::ticketnum_or_errcode_type res) {
+                self->handle_begin(res);
+            });
+        if(!success) {
+            m_log->error("Failed to contact broker to begin");
+            do_result(interface::error_code::broker_unreachable);
+        }
+        return true;
+    }
+
+    auto speculative_batch::execution_count() const -> size_t {
+        std::unique_lock l(m_mut);
+        return m_executions;
+    }
+
+    void speculative_batch::handle_begin(
+        broker::interface::ticketnum_or_errcode_type res) {
+        std::visit(
+            overloaded{[&](const ticket_machine::ticket_number_type& n) {
+                           {
+                               std::unique_lock l(m_mut);
+                               m_ticket_number = n;
+                           }
+                           auto txs = std::vector<size_t>(m_txs.size());
+                           for(size_t i = 0; i < txs.size(); i++) {
+                               txs[i] = i;
+                           }
+                           start_round(std::move(txs));
+                       },
+                       [&](const broker::interface::error_code& /* e */) {
+                           m_log->error(
+                               "Broker failed to assign a ticket number");
+                           do_result(
+                               interface::error_code::ticket_number_assignment);
+                       }},
+            res);
+    }
+
+    void speculative_batch::start_round(std::vector<size_t> txs) {
+        assert(!txs.empty());
+        auto to_run
+            = std::make_shared<std::vector<std::pair<size_t, size_t>>>();
+        {
+            std::unique_lock l(m_mut);
+            m_round_pending = txs.size();
+            m_executions += txs.size();
+            for(auto tx : txs) {
+                auto& st = m_tx_states[tx];
+                if(st.m_result.has_value()) {
+                    st.m_incarnation++;
+                }
+                // Leave a placeholder for each previously written key so
+                // later functions wait for the new value rather than
+                // reading one which is about to change
+                for(const auto& key : st.m_writes) {
+                    m_data[key][tx].m_value.reset();
+                }
+                st.m_result.reset();
+                st.m_reads.clear();
+                st.m_read_conflict = false;
+                to_run->emplace_back(tx, st.m_incarnation);
+            }
+        }
+
+        // Executions suspend while waiting on reads so a few workers can
+        // start the whole round without a thread per function
+        auto next = std::make_shared<std::atomic<size_t>>();
+        auto n_workers = std::min(
+            to_run->size(),
+            static_cast<size_t>(
+                std::max(std::thread::hardware_concurrency(), 1U)));
+        auto workers = std::vector<thread_pool::task>();
+        workers.reserve(n_workers);
+        for(size_t i = 0; i < n_workers; i++) {
+            workers.emplace_back([self = shared_from_this(), to_run, next]() {
+                for(auto idx = (*next)++; idx < to_run->size();
+                    idx = (*next)++) {
+                    auto [tx, incarnation] = (*to_run)[idx];
+                    self->execute(tx, incarnation);
+                }
+            });
+        }
+        m_threads->push_batch(std::move(workers));
+    }
+
+    void speculative_batch::execute(size_t tx, size_t incarnation) {
+        const auto& function = m_txs[tx].m_function;
+        // One-byte functions are passed directly to the runner, as in
+        // agent::impl
+        if(function.size() == 1) {
+            run(tx, incarnation, function);
+            return;
+        }
+
+        auto success = read(
+            tx,
+            incarnation,
+            function,
+            broker::lock_type::read,
+            [this, tx, incarnation](
+                const broker::interface::try_lock_return_type& res) {
+                if(std::holds_alternative<broker::value_type>(res)) {
+                    run(tx, incarnation, std::get<broker::value_type>(res));
+                    return;
+                }
+                complete(tx,
+                         incarnation,
+                         runner::interface::error_code::function_load);
+            });
+        if(!success) {
+            complete(tx,
+                     incarnation,
+                     runner::interface::error_code::function_load);
+        }
+    }
+
+    void speculative_batch::run(size_t tx,
+                                size_t incarnation,
+                                broker::value_type function) {
+        auto ticket_number = [&]() {
+            std::unique_lock l(m_mut);
+            return m_ticket_number.value();
+        }();
+        auto runner = m_runner_factory(
+            m_log,
+            m_cfg,
+            std::move(function),
+            m_txs[tx].m_param,
+            false,
+            [this, tx, incarnation](
+                const runner::interface::run_return_type& run_res) {
+                complete(tx, incarnation, run_res);
+            },
+            [this, tx, incarnation](
+                broker::key_type key,
+                broker::lock_type locktype,
+                broker::interface::try_lock_callback_type res_cb) -> bool {
+                return read(tx,
+                            incarnation,
+                            std::move(key),
+                            locktype,
+                            std::move(res_cb));
+            },
+            m_secp,
+            m_threads,
+            ticket_number);
+        auto* r = runner.get();
+        {
+            std::unique_lock l(m_mut);
+            m_runners.emplace_back(std::move(runner));
+        }
+        if(!r->run()) {
+            m_log->error("Failed to start contract execution");
+            complete(tx,
+                     incarnation,
+                     runner::interface::error_code::internal_error);
+        }
+    }
+
+    auto speculative_batch::read(
+        size_t tx,
+        size_t incarnation,
+        broker::key_type key,
+        broker::lock_type locktype,
+        broker::interface::try_lock_callback_type result_callback) -> bool {
+        auto record_read = [this, tx](const broker::key_type& k,
+                                      read_version_type version) {
+            auto& st = m_tx_states[tx];
+            auto [it, inserted] = st.m_reads.emplace(k, version);
+            if(!inserted && !(it->second == version)) {
+                // Two reads of the same key saw different versions
+                st.m_read_conflict = true;
+            }
+        };
+
+        auto value = std::optional<broker::value_type>();
+        auto fetch = false;
+        auto ticket_number = ticket_machine::ticket_number_type();
+        {
+            std::unique_lock l(m_mut);
+            if(m_tx_states[tx].m_incarnation != incarnation) {
+                m_log->warn("Read from stale execution");
+                return false;
+            }
+            ticket_number = m_ticket_number.value();
+
+            auto it = m_data.find(key);
+            auto writer = std::map<size_t, entry_type>::iterator();
+            auto has_writer = false;
+            if(it != m_data.end()) {
+                writer = it->second.lower_bound(tx);
+                if(writer != it->second.begin()) {
+                    writer--;
+                    has_writer = true;
+                }
+            }
+
+            if(has_writer) {
+                if(!writer->second.m_value.has_value()) {
+                    // The writer is being re-executed, retry the read once
+                    // it completes
+                    m_tx_states[writer->first].m_waiters.emplace_back(
+                        [this,
+                         tx,
+                         incarnation,
+                         key,
+                         locktype,
+                         cb = std::move(result_callback)]() {
+                            if(!read(tx, incarnation, key, locktype, cb)) {
+                                cb(broker::interface::error_code::
+                                       invalid_shard_state);
+                            }
+                        });
+                    return true;
+                }
+                record_read(key,
+                            version_type{writer->first,
+                                         writer->second.m_incarnation});
+                value = writer->second.m_value.value();
+            } else if(auto base = m_base.find(key); base != m_base.end()) {
+                record_read(key, std::nullopt);
+                value = base->second;
+            } else {
+                auto& waiters = m_base_waiters[key];
+                fetch = waiters.empty();
+                waiters.emplace_back(
+                    [this,
+                     key,
+                     tx,
+                     incarnation,
+                     record_read,
+                     cb = std::move(result_callback)](
+                        broker::interface::try_lock_return_type res) {
+                        if(std::holds_alternative<broker::value_type>(res)) {
+                            std::unique_lock ll(m_mut);
+                            if(m_tx_states[tx].m_incarnation == incarnation) {
+                                record_read(key, std::nullopt);
+                            }
+                        }
+                        cb(std::move(res));
+                    });
+            }
+        }
+
+        if(value.has_value()) {
+            result_callback(std::move(value.value()));
+            return true;
+        }
+
+        if(fetch) {
+            auto success = m_broker->try_lock(
+                ticket_number,
+                key,
+                locktype,
+                [self = shared_from_this(),
+                 key](broker::interface::try_lock_return_type res) {
+                    self->handle_base(key, std::move(res));
+                });
+            if(!success) {
+                m_log->error("Failed to contact broker for try_lock");
+                handle_base(key,
+                            broker::interface::error_code::shard_unreachable);
+            }
+        }
+        return true;
+    }
+
+    void speculative_batch::handle_base(
+        const broker::key_type& key,
+        broker::interface::try_lock_return_type res) {
+        auto waiters
+            = std::vector<broker::interface::try_lock_callback_type>();
+        {
+            std::unique_lock l(m_mut);
+            std::visit(overloaded{[&](const broker::value_type& v) {
+                                      m_base.emplace(key, v);
+                                  },
+                                  [&](broker::interface::error_code /* e */) {
+                                      m_failed = true;
+                                  },
+                                  [&](const runtime_locking_shard::shard_error&
+                                          e) {
+                                      m_failed = true;
+                                      if(e.m_error_code
+                                         != runtime_locking_shard::
+                                             error_code::wounded) {
+                                          m_permanent_failure = true;
+                                      }
+                                  }},
+                       res);
+            auto it = m_base_waiters.find(key);
+            assert(it != m_base_waiters.end());
+            waiters.swap(it->second);
+            m_base_waiters.erase(it);
+        }
+        for(auto& waiter : waiters) {
+            waiter(res);
+        }
+    }
+
+    void
+    speculative_batch::complete(size_t tx,
+                                size_t incarnation,
+                                runner::interface::run_return_type res) {
+        auto waiters = std::vector<std::function<void()>>();
+        auto last = false;
+        {
+            std::unique_lock l(m_mut);
+            auto& st = m_tx_states[tx];
+            if(st.m_incarnation != incarnation || st.m_result.has_value()) {
+                m_log->warn("Result from stale execution");
+                return;
+            }
+
+            auto writes = decltype(st.m_writes)();
+            if(std::holds_alternative<broker::state_update_type>(res)) {
+                for(const auto& [k, v] :
+                    std::get<broker::state_update_type>(res)) {
+                    writes.insert(k);
+                    m_data[k][tx] = entry_type{incarnation, v};
+                }
+            }
+            for(const auto& k : st.m_writes) {
+                if(writes.find(k) != writes.end()) {
+                    continue;
+                }
+                auto it = m_data.find(k);
+                it->second.erase(tx);
+                if(it->second.empty()) {
+                    m_data.erase(it);
+                }
+            }
+            st.m_writes = std::move(writes);
+            st.m_result = std::move(res);
+            waiters.swap(st.m_waiters);
+            m_round_pending--;
+            last = m_round_pending == 0;
+        }
+
+        for(auto& waiter : waiters) {
+            waiter();
+        }
+        if(last) {
+            end_round();
+        }
+    }
+
+    auto speculative_batch::current_version(size_t tx,
+                                            const broker::key_type& key) const
+        -> read_version_type {
+        auto it = m_data.find(key);
+        if(it == m_data.end()) {
+            return std::nullopt;
+        }
+        auto writer = it->second.lower_bound(tx);
+        if(writer == it->second.begin()) {
+            return std::nullopt;
+        }
+        writer--;
+        return version_type{writer->first, writer->second.m_incarnation};
+    }
+
+    void speculative_batch::end_round() {
+        auto invalid = std::vector<size_t>();
+        auto failed = false;
+        auto permanent = false;
+        {
+            std::unique_lock l(m_mut);
+            failed = m_failed;
+            permanent = m_permanent_failure;
+            if(!failed) {
+                // Every function before the first invalid one only read
+                // final values, so each round fixes at least one more
+                // function and the batch converges to the sequential
+                // outcome
+                for(size_t i = 0; i < m_tx_states.size(); i++) {
+                    const auto& st = m_tx_states[i];
+                    auto valid = !st.m_read_conflict
+                              && std::all_of(
+                                     st.m_reads.begin(),
+                                     st.m_reads.end(),
+                                     [&](const auto& r) {
+                                         return current_version(i, r.first)
+                                             == r.second;
+                                     });
+                    if(!valid) {
+                        invalid.push_back(i);
+                    }
+                }
+            }
+        }
+
+        if(failed) {
+            m_log->trace("Speculative batch failed to read from shards");
+            if(permanent) {
+                do_rollback(interface::error_code::function_retrieval);
+            } else {
+                do_rollback(std::nullopt);
+            }
+            return;
+        }
+
+        if(invalid.empty()) {
+            do_lock();
+            return;
+        }
+
+        m_log->trace("Re-executing",
+                     invalid.size(),
+                     "of",
+                     m_txs.size(),
+                     "functions in speculative batch");
+        start_round(std::move(invalid));
+    }
+
+    void speculative_batch::do_lock() {
+        auto keys = std::vector<broker::key_type>();
+        auto ticket_number = ticket_machine::ticket_number_type();
+        {
+            std::unique_lock l(m_mut);
+            ticket_number = m_ticket_number.value();
+            m_updates.clear();
+            for(const auto& st : m_tx_states) {
+                if(!std::holds_alternative<broker::state_update_type>(
+                       st.m_result.value())) {
+                    continue;
+                }
+                for(const auto& [k, v] :
+                    std::get<broker::state_update_type>(st.m_result.value())) {
+                    m_updates[k] = v;
+                }
+            }
+            for(const auto& [k, v] : m_updates) {
+                keys.push_back(k);
+            }
+        }
+
+        if(keys.empty()) {
+            do_commit();
+            return;
+        }
+
+        // Upgrade to write locks on every key the batch updates before
+        // committing
+        struct lock_state {
+            std::atomic<size_t> m_pending{};
+            std::atomic_bool m_failed{false};
+            std::atomic_bool m_permanent{false};
+        };
+        auto state = std::make_shared<lock_state>();
+        state->m_pending = keys.size();
+        auto handle_lock
+            = [self = shared_from_this(),
+               state](const broker::interface::try_lock_return_type& res) {
+                  if(std::holds_alternative<
+                         runtime_locking_shard::shard_error>(res)) {
+                      state->m_failed = true;
+                      if(std::get<runtime_locking_shard::shard_error>(res)
+                             .m_error_code
+                         != runtime_locking_shard::error_code::wounded) {
+                          state->m_permanent = true;
+                      }
+                  } else if(std::holds_alternative<
+                                broker::interface::error_code>(res)) {
+                      state->m_failed = true;
+                  }
+                  if(--state->m_pending != 0) {
+                      return;
+                  }
+                  if(!state->m_failed) {
+                      self->do_commit();
+                  } else if(state->m_permanent) {
+                      self->do_rollback(interface::error_code::commit_error);
+                  } else {
+                      self->do_rollback(std::nullopt);
+                  }
+              };
+        for(auto& key : keys) {
+            auto success = m_broker->try_lock(ticket_number,
+                                              std::move(key),
+                                              broker::lock_type::write,
+                                              handle_lock);
+            if(!success) {
+                m_log->error("Failed to contact broker for try_lock");
+                handle_lock(broker::interface::error_code::shard_unreachable);
+            }
+        }
+    }
+
+    void speculative_batch::do_commit() {
+        auto ticket_number = ticket_machine::ticket_number_type();
+        auto updates = broker::state_update_type();
+        {
+            std::unique_lock l(m_mut);
+            ticket_number = m_ticket_number.value();
+            updates = m_updates;
+        }
+        m_log->trace(this, "Batch requesting commit for", ticket_number);
+        auto success = m_broker->commit(
+            ticket_number,
+            std::move(updates),
+            [self = shared_from_this()](
+                broker::interface::commit_return_type res) {
+                self->handle_commit(std::move(res));
+            });
+        if(!success) {
+            m_log->error("Failed to contact broker for commit");
+            do_rollback(std::nullopt);
+        }
+    }
+
+    void speculative_batch::handle_commit(
+        broker::interface::commit_return_type res) {
+        if(!res.has_value()) {
+            do_finish(std::nullopt);
+            return;
+        }
+        std::visit(
+            overloaded{
+                [&](broker::interface::error_code e) {
+                    m_log->error("Broker error for batch commit");
+                    if(e == broker::interface::error_code::commit_hazard) {
+                        do_rollback(interface::error_code::commit_error);
+                    } else {
+                        do_rollback(std::nullopt);
+                    }
+                },
+                [&](const runtime_locking_shard::shard_error& e) {
+                    if(e.m_error_code
+                       == runtime_locking_shard::error_code::wounded) {
+                        m_log->trace("Batch wounded during commit");
+                        do_rollback(std::nullopt);
+                    } else {
+                        m_log->error("Shard error for batch commit");
+                        do_rollback(interface::error_code::commit_error);
+                    }
+                }},
+            res.value());
+    }
+
+    void
+    speculative_batch::do_rollback(std::optional<interface::error_code> error) {
+        auto ticket_number = [&]() {
+            std::unique_lock l(m_mut);
+            return m_ticket_number.value();
+        }();
+        m_log->trace(this, "Batch rolling back", ticket_number);
+        auto success = m_broker->rollback(
+            ticket_number,
+            [self = shared_from_this(),
+             error](broker::interface::rollback_return_type res) {
+                if(res.has_value()) {
+                    self->m_log->error("Broker error rolling back batch");
+                    self->do_result(interface::error_code::rollback_error);
+                    return;
+                }
+                if(error.has_value()) {
+                    self->do_finish(error);
+                } else {
+                    self->restart();
+                }
+            });
+        if(!success) {
+            m_log->error("Error contacting broker for rollback");
+            do_result(interface::error_code::broker_unreachable);
+        }
+    }
+
+    void speculative_batch::restart() {
+        // Start over on a pool thread to avoid growing the stack when the
+        // broker responds synchronously
+        m_threads->push([self = shared_from_this()]() {
+            {
+                std::unique_lock l(self->m_mut);
+                self->m_tx_states
+                    = std::vector<tx_state_type>(self->m_txs.size());
+                self->m_data.clear();
+                self->m_base.clear();
+                self->m_failed = false;
+                self->m_permanent_failure = false;
+            }
+            self->m_log->debug("Restarting speculative batch");
+            auto txs = std::vector<size_t>(self->m_txs.size());
+            for(size_t i = 0; i < txs.size(); i++) {
+                txs[i] = i;
+            }
+            self->start_round(std::move(txs));
+        });
+    }
+
+    void
+    speculative_batch::do_finish(std::optional<interface::error_code> error) {
+        auto ticket_number = [&]() {
+            std::unique_lock l(m_mut);
+            return m_ticket_number.value();
+        }();
+        auto success = m_broker->finish(
+            ticket_number,
+            [self = shared_from_this(),
+             error](broker::interface::finish_return_type res) {
+                if(res.has_value()) {
+                    self->m_log->error("Broker error for batch finish");
+                    self->do_result(interface::error_code::finish_error);
+                    return;
+                }
+                self->do_result(error);
+            });
+        if(!success) {
+            m_log->error("Error contacting broker for finish");
+            do_result(interface::error_code::broker_unreachable);
+        }
+    }
+
+    void
+    speculative_batch::do_result(std::optional<interface::error_code> error) {
+        // Keep the batch alive until the done callback returns, even if the
+        // owner releases it
+        auto self = shared_from_this();
+        auto results = std::vector<interface::exec_return_type>();
+        {
+            std::unique_lock l(m_mut);
+            for(const auto& st : m_tx_states) {
+                if(error.has_value()) {
+                    results.emplace_back(error.value());
+                } else if(std::holds_alternative<broker::state_update_type>(
+                              st.m_result.value())) {
+                    results.emplace_back(std::get<broker::state_update_type>(
+                        st.m_result.value()));
+                } else {
+                    results.emplace_back(
+                        interface::error_code::function_execution);
+                }
+            }
+        }
+        for(size_t i = 0; i < m_txs.size(); i++) {
+            m_txs[i].m_result_callback(std::move(results[i]));
+        }
+        m_done_callback();
+    }
+}
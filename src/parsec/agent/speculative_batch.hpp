@@ -0,0 +1,199 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PARSEC_AGENT_SPECULATIVE_BATCH_H_
+#define OPENCBDC_TX_SRC_PARSEC_AGENT_SPECULATIVE_BATCH_H_
+
+#include "interface.hpp"
+#include "parsec/agent/runners/interface.hpp"
+#include "parsec/broker/interface.hpp"
+#include "util/common/logging.hpp"
+
+#include <map>
+#include <mutex>
+#include <unordered_set>
+
+namespace cbdc::parsec::agent {
+    /// \brief Executes a batch of functions speculatively under a single
+    ///        ticket.
+    ///
+    /// Every function in the batch runs in parallel against a multi-version
+    /// view of the state. Keys not written by an earlier function in the
+    /// batch are read from the shards under the batch's ticket. Each
+    /// execution records the versions of the keys it read. Once a round of
+    /// executions completes, each function's reads are validated against the
+    /// writes of the functions before it in the batch, and invalid functions
+    /// are re-executed. Readers which hit a key being re-written by an
+    /// earlier function wait for that function to finish. The outcome is the
+    /// same as executing the functions one after another in batch order,
+    /// and the merged state updates are committed atomically with one
+    /// broker commit. Conflicts within the batch therefore cost a local
+    /// re-execution rather than a wound and rollback. If the batch's ticket
+    /// is wounded by another ticket, the whole batch is rolled back and
+    /// re-executed.
+    class speculative_batch
+        : public std::enable_shared_from_this<speculative_batch> {
+      public:
+        /// Function call to execute as part of a batch.
+        struct tx_type {
+            /// Key of the function bytecode.
+            runtime_locking_shard::key_type m_function;
+            /// Function parameter.
+            parameter_type m_param;
+            /// Function to call with the execution result.
+            interface::exec_callback_type m_result_callback;
+        };
+
+        /// Callback type for notification that the batch has finished and
+        /// reported every result.
+        using done_callback_type = std::function<void()>;
+
+        /// Constructor.
+        /// \param logger log instance.
+        /// \param cfg config instance.
+        /// \param runner_factory function which constructs and returns a
+        ///                       pointer to a runner instance.
+        /// \param broker broker instance.
+        /// \param txs function calls to execute, in commit order.
+        /// \param secp secp256k1 context.
+        /// \param t_pool shared thread pool between all agents.
+        /// \param done_callback function to call after all results have
+        ///                      been reported.
+        speculative_batch(std::shared_ptr<logging::log> logger,
+                          cbdc::parsec::config cfg,
+                          runner::interface::factory_type runner_factory,
+                          std::shared_ptr<broker::interface> broker,
+                          std::vector<tx_type> txs,
+                          std::shared_ptr<secp256k1_context> secp,
+                          std::shared_ptr<thread_pool> t_pool,
+                          done_callback_type done_callback);
+
+        ~speculative_batch() = default;
+
+        speculative_batch(const speculative_batch&) = delete;
+        auto operator=(const speculative_batch&)
+            -> speculative_batch& = delete;
+        speculative_batch(speculative_batch&&) = delete;
+        auto operator=(speculative_batch&&) -> speculative_batch& = delete;
+
+        /// Begins a ticket for the batch and starts executing. The batch
+        /// must be owned by a std::shared_ptr.
+        /// \return true.
+        auto exec() -> bool;
+
+        /// Returns the number of executions started so far, including
+        /// re-executions due to conflicts.
+        /// \return number of executions.
+        [[nodiscard]] auto execution_count() const -> size_t;
+
+      private:
+        /// Version of a key written by a function in the batch.
+        struct version_type {
+            /// Index of the function in the batch.
+            size_t m_tx{};
+            /// Execution of the function which wrote the key.
+            size_t m_incarnation{};
+
+            auto operator==(const version_type& rhs) const -> bool;
+        };
+
+        /// Version observed by a read. Reads from the shards have no version.
+        using read_version_type = std::optional<version_type>;
+
+        /// Value written by a function. Holds no value while the function is
+        /// being re-executed and may write a different value.
+        struct entry_type {
+            size_t m_incarnation{};
+            std::optional<broker::value_type> m_value;
+        };
+
+        struct tx_state_type {
+            size_t m_incarnation{};
+            std::optional<runner::interface::run_return_type> m_result;
+            std::unordered_map<broker::key_type,
+                               read_version_type,
+                               hashing::const_sip_hash<broker::key_type>>
+                m_reads;
+            bool m_read_conflict{false};
+            std::unordered_set<broker::key_type,
+                               hashing::const_sip_hash<broker::key_type>>
+                m_writes;
+            std::vector<std::function<void()>> m_waiters;
+        };
+
+        template<typename T>
+        using key_map_type
+            = std::unordered_map<broker::key_type,
+                                 T,
+                                 hashing::const_sip_hash<broker::key_type>>;
+
+        std::shared_ptr<logging::log> m_log;
+        const cbdc::parsec::config m_cfg;
+        runner::interface::factory_type m_runner_factory;
+        std::shared_ptr<broker::interface> m_broker;
+        std::vector<tx_type> m_txs;
+        std::shared_ptr<secp256k1_context> m_secp;
+        std::shared_ptr<thread_pool> m_threads;
+        done_callback_type m_done_callback;
+
+        mutable std::mutex m_mut;
+        std::optional<ticket_machine::ticket_number_type> m_ticket_number;
+        std::vector<tx_state_type> m_tx_states;
+        key_map_type<std::map<size_t, entry_type>> m_data;
+        key_map_type<broker::value_type> m_base;
+        key_map_type<std::vector<broker::interface::try_lock_callback_type>>
+            m_base_waiters;
+        size_t m_round_pending{};
+        bool m_failed{false};
+        bool m_permanent_failure{false};
+        size_t m_executions{};
+        std::vector<std::unique_ptr<runner::interface>> m_runners;
+        broker::state_update_type m_updates;
+
+        void handle_begin(broker::interface::ticketnum_or_errcode_type res);
+
+        void start_round(std::vector<size_t> txs);
+
+        void execute(size_t tx, size_t incarnation);
+
+        void run(size_t tx, size_t incarnation, broker::value_type function);
+
+        auto read(size_t tx,
+                  size_t incarnation,
+                  broker::key_type key,
+                  broker::lock_type locktype,
+                  broker::interface::try_lock_callback_type result_callback)
+            -> bool;
+
+        void handle_base(const broker::key_type& key,
+                         broker::interface::try_lock_return_type res);
+
+        void complete(size_t tx,
+                      size_t incarnation,
+                      runner::interface::run_return_type res);
+
+        void end_round();
+
+        [[nodiscard]] auto current_version(size_t tx,
+                                           const broker::key_type& key) const
+            -> read_version_type;
+
+        void do_lock();
+
+        void do_commit();
+
+        void handle_commit(broker::interface::commit_return_type res);
+
+        void do_rollback(std::optional<interface::error_code> error);
+
+        void restart();
+
+        void do_finish(std::optional<interface::error_code> error);
+
+        void do_result(std::optional<interface::error_code> error);
+    };
+}
+
+#endif
@@ -133,6 +133,8 @@ namespace cbdc::parsec::broker {
                         key_type key,
                         lock_type locktype,
                         try_lock_callback_type result_callback) -> bool {
+        auto location = std::optional<
+            parsec::directory::interface::key_location_return_type>();
         auto maybe_error = [&]() -> std::optional<error_code> {
             std::unique_lock l(m_mut);
             auto it = m_tickets.find(ticket_number);
@@ -155,30 +157,35 @@ namespace cbdc::parsec::broker {
                     break;
             }
 
-            if(!m_directory->key_location(
-                   key,
-                   [=, this](std::optional<parsec::directory::interface::
-                                               key_location_return_type> res) {
-                       handle_find_key(ticket_number,
-                                       key,
-                                       locktype,
-                                       result_callback,
-                                       res);
-                   })) {
-                m_log->error("Failed to make key location directory request");
-                return error_code::directory_unreachable;
-            }
-
+            location = locate(key);
             return std::nullopt;
         }();
 
         if(maybe_error.has_value()) {
             result_callback(maybe_error.value());
+            return true;
         }
 
+        handle_find_key(ticket_number,
+                        std::move(key),
+                        locktype,
+                        std::move(result_callback),
+                        location);
+
         return true;
     }
 
+    auto impl::locate(const key_type& key)
+        -> parsec::directory::interface::key_location_return_type {
+        // Only fetch a new snapshot when keys have moved since the cached
+        // one was taken
+        if(!m_mapping
+           || m_mapping->m_version != m_directory->mapping_version()) {
+            m_mapping = m_directory->get_mapping();
+        }
+        return m_mapping->shard_for(key);
+    }
+
     void impl::handle_prepare(
         const commit_callback_type& commit_cb,
         ticket_number_type ticket_number,
@@ -13,7 +13,9 @@
 #include <memory>
 
 namespace cbdc::parsec::broker {
-    /// Implementation of a broker. Stores ticket states in memory.
+    /// Implementation of a broker. Stores ticket states in memory. Locates
+    /// keys using a cached snapshot of the directory mapping, which is
+    /// refreshed whenever the directory reports a new mapping version.
     /// Thread-safe.
     class impl : public interface {
       public:
@@ -104,6 +106,7 @@ namespace cbdc::parsec::broker {
 
         mutable std::recursive_mutex m_mut;
         ticket_number_type m_highest_ticket{};
+        std::shared_ptr<const directory::interface::mapping_type> m_mapping;
 
         enum class shard_state_type : uint8_t {
             begun,
@@ -153,6 +156,9 @@ namespace cbdc::parsec::broker {
                                runtime_locking_shard::ticket_state>>
             m_recovery_tickets;
 
+        auto locate(const key_type& key)
+            -> parsec::directory::interface::key_location_return_type;
+
         void handle_prepare(
             const commit_callback_type& commit_cb,
             ticket_number_type ticket_number,
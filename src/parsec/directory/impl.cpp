@@ -5,17 +5,288 @@
 
 #include "impl.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+#include <set>
+#include <thread>
+
 namespace cbdc::parsec::directory {
-    impl::impl(size_t n_shards) : m_n_shards(n_shards) {}
+    impl::impl(size_t n_shards, size_t n_vnodes)
+        : m_n_shards(n_shards),
+          m_n_vnodes(n_vnodes) {
+        assert(m_n_shards > 0);
+        assert(m_n_vnodes > 0);
+        auto mapping = std::make_shared<mapping_type>();
+        for(key_location_return_type shard = 0; shard < m_n_shards; shard++) {
+            for(size_t vnode = 0; vnode < m_n_vnodes; vnode++) {
+                mapping->m_ring.emplace(vnode_token(shard, vnode), shard);
+            }
+        }
+        // Keys hashing past the last token wrap around to the owner of the
+        // first token
+        mapping->m_ring.emplace(std::numeric_limits<uint64_t>::max(),
+                                mapping->m_ring.begin()->second);
+        m_mapping = std::move(mapping);
+    }
 
     auto impl::key_location(runtime_locking_shard::key_type key,
                             key_location_callback_type result_callback)
         -> bool {
-        auto key_hash = m_siphash(key);
-        // NOTE: using modulo creates a small bias from a true
-        // uniform distribution
-        auto shard = key_hash % m_n_shards;
+        auto mapping = get_mapping();
+        auto shard = mapping->shard_for(key);
         result_callback(shard);
         return true;
     }
+
+    auto impl::key_hash(const runtime_locking_shard::key_type& key) const
+        -> uint64_t {
+        return mapping_type::key_hash(key);
+    }
+
+    auto impl::get_mapping() const -> std::shared_ptr<const mapping_type> {
+        std::unique_lock l(m_mut);
+        return m_mapping;
+    }
+
+    auto impl::mapping_version() const -> uint64_t {
+        return m_version;
+    }
+
+    auto impl::add_shard() -> std::optional<
+        std::pair<key_location_return_type, std::vector<migration_type>>> {
+        std::unique_lock l(m_mut);
+        auto shard = m_n_shards;
+
+        // The new shard takes over the arc ending at each of its virtual
+        // nodes, measured from the preceding virtual node of any shard.
+        // Migrations change which shard owns each arc but not where the
+        // arcs of existing virtual nodes begin, so measure against the
+        // virtual node tokens rather than the current ring.
+        auto tokens = std::set<uint64_t>();
+        for(key_location_return_type s = 0; s <= shard; s++) {
+            for(size_t vnode = 0; vnode < m_n_vnodes; vnode++) {
+                tokens.insert(vnode_token(s, vnode));
+            }
+        }
+
+        auto ranges = std::vector<hash_range_type>();
+        for(size_t vnode = 0; vnode < m_n_vnodes; vnode++) {
+            auto token = vnode_token(shard, vnode);
+            auto it = tokens.find(token);
+            if(it != tokens.begin()) {
+                ranges.push_back({*std::prev(it) + 1, token});
+                continue;
+            }
+            // Hashes after the last virtual node wrap around to the owner of
+            // the first one, so the first arc is split into the part before
+            // the first token and the part after the last token
+            ranges.push_back({0, token});
+            auto last = *tokens.rbegin();
+            if(last < std::numeric_limits<uint64_t>::max()) {
+                ranges.push_back({last + 1,
+                                  std::numeric_limits<uint64_t>::max()});
+            }
+        }
+
+        std::sort(ranges.begin(),
+                  ranges.end(),
+                  [](const hash_range_type& a, const hash_range_type& b) {
+                      return a.m_begin < b.m_begin;
+                  });
+        auto migrations = std::vector<migration_type>();
+        for(auto& range : ranges) {
+            // Merge with the previous arc if the two are adjacent
+            if(!migrations.empty()
+               && migrations.back().m_range.m_end + 1 == range.m_begin) {
+                migrations.back().m_range.m_end = range.m_end;
+            } else {
+                migrations.push_back({range, shard});
+            }
+        }
+
+        // Refuse to add the shard rather than leave part of its arcs with
+        // their old owners
+        for(auto& m : migrations) {
+            if(overlaps_pending(m.m_range)) {
+                return std::nullopt;
+            }
+        }
+
+        m_n_shards++;
+        m_pending.insert(m_pending.end(), migrations.begin(), migrations.end());
+        return std::make_pair(shard, std::move(migrations));
+    }
+
+    auto impl::begin_migration(hash_range_type range,
+                               key_location_return_type destination)
+        -> bool {
+        std::unique_lock l(m_mut);
+        if(range.m_begin > range.m_end || destination >= m_n_shards) {
+            return false;
+        }
+        if(overlaps_pending(range)) {
+            return false;
+        }
+        m_pending.push_back({range, destination});
+        return true;
+    }
+
+    auto impl::run_migration(
+        hash_range_type range,
+        const std::vector<std::shared_ptr<runtime_locking_shard::impl>>&
+            shards,
+        std::chrono::milliseconds timeout) -> std::optional<uint64_t> {
+        static constexpr auto drain_poll_interval
+            = std::chrono::milliseconds(1);
+
+        auto destination = key_location_return_type();
+        auto owners = std::set<key_location_return_type>();
+        {
+            std::unique_lock l(m_mut);
+            auto it = find_pending(range);
+            if(it == m_pending.end()) {
+                return std::nullopt;
+            }
+            destination = it->m_destination;
+            // Every shard owning part of the range, up to and including the
+            // token which ends the last arc in the range
+            const auto& ring = m_mapping->m_ring;
+            for(auto t = ring.lower_bound(range.m_begin); t != ring.end();
+                t++) {
+                if(t->second != destination) {
+                    owners.insert(t->second);
+                }
+                if(t->first >= range.m_end) {
+                    break;
+                }
+            }
+        }
+        assert(destination < shards.size());
+
+        // New locks in the range are refused from here on, so once a shard
+        // reports no locks held in the range its keys stay unchanged
+        for(auto owner : owners) {
+            shards[owner]->fence(range);
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        auto state = runtime_locking_shard::state_update_type();
+        for(auto owner : owners) {
+            auto keys = shards[owner]->export_range(range);
+            while(!keys.has_value()) {
+                if(std::chrono::steady_clock::now() >= deadline) {
+                    for(auto o : owners) {
+                        shards[o]->unfence(range);
+                    }
+                    abort_migration(range);
+                    return std::nullopt;
+                }
+                std::this_thread::sleep_for(drain_poll_interval);
+                keys = shards[owner]->export_range(range);
+            }
+            state.merge(keys.value());
+        }
+
+        shards[destination]->import_range(range, state);
+        auto version = complete_migration(range);
+        assert(version.has_value());
+        for(auto owner : owners) {
+            shards[owner]->drop_range(range);
+        }
+        return version;
+    }
+
+    auto impl::complete_migration(hash_range_type range)
+        -> std::optional<uint64_t> {
+        std::unique_lock l(m_mut);
+        auto it = find_pending(range);
+        if(it == m_pending.end()) {
+            return std::nullopt;
+        }
+
+        auto mapping = std::make_shared<mapping_type>(*m_mapping);
+        assign(*mapping, it->m_range, it->m_destination);
+        mapping->m_version++;
+        auto version = mapping->m_version;
+        m_mapping = std::move(mapping);
+        m_version = version;
+        m_pending.erase(it);
+        return version;
+    }
+
+    auto impl::abort_migration(hash_range_type range) -> bool {
+        std::unique_lock l(m_mut);
+        auto it = find_pending(range);
+        if(it == m_pending.end()) {
+            return false;
+        }
+        m_pending.erase(it);
+        return true;
+    }
+
+    auto impl::pending_migrations() const -> std::vector<migration_type> {
+        std::unique_lock l(m_mut);
+        return m_pending;
+    }
+
+    auto impl::find_pending(hash_range_type range)
+        -> std::vector<migration_type>::iterator {
+        return std::find_if(m_pending.begin(),
+                            m_pending.end(),
+                            [&](const migration_type& m) {
+                                return m.m_range == range;
+                            });
+    }
+
+    auto impl::vnode_token(key_location_return_type shard, size_t vnode)
+        -> uint64_t {
+        static constexpr auto hasher
+            = hashing::const_sip_hash<std::array<uint64_t, 2>>();
+        return hasher(std::array<uint64_t, 2>{shard, vnode});
+    }
+
+    auto impl::overlaps_pending(hash_range_type range) const -> bool {
+        return std::any_of(m_pending.begin(),
+                           m_pending.end(),
+                           [&](const migration_type& m) {
+                               return range.m_begin <= m.m_range.m_end
+                                   && m.m_range.m_begin <= range.m_end;
+                           });
+    }
+
+    void impl::assign(mapping_type& mapping,
+                      hash_range_type range,
+                      key_location_return_type shard) {
+        auto& ring = mapping.m_ring;
+
+        // Split the arcs at the range boundaries, preserving the current
+        // owners outside the range
+        auto split = [&](uint64_t token) {
+            auto owner = mapping.shard_for(token);
+            ring.emplace(token, owner);
+        };
+        if(range.m_begin > 0) {
+            split(range.m_begin - 1);
+        }
+        split(range.m_end);
+
+        for(auto it = ring.lower_bound(range.m_begin);
+            it != ring.end() && it->first <= range.m_end;
+            it++) {
+            it->second = shard;
+        }
+
+        // Drop tokens made redundant by an adjacent token with the same
+        // owner to keep the ring compact
+        for(auto it = ring.begin(); it != ring.end();) {
+            auto next = std::next(it);
+            if(next != ring.end() && next->second == it->second) {
+                it = ring.erase(it);
+            } else {
+                it = next;
+            }
+        }
+    }
 }
@@ -7,14 +7,42 @@
 #define OPENCBDC_TX_SRC_PARSEC_DIRECTORY_IMPL_H_
 
 #include "interface.hpp"
+#include "parsec/runtime_locking_shard/impl.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
 
 namespace cbdc::parsec::directory {
-    /// Implementation of a directory which map keys to shard IDs. Thread-safe.
+    /// Implementation of a directory which map keys to shard IDs using a
+    /// consistent hash ring with virtual nodes. Key ranges on the ring can be
+    /// migrated between shards at runtime, while tickets are in flight.
+    /// Every change to the mapping produces a new immutable, versioned
+    /// snapshot which callers may cache. Thread-safe.
     class impl : public interface {
       public:
+        /// Default number of virtual nodes placed on the ring per shard.
+        static constexpr size_t default_vnodes = 64;
+
+        /// Inclusive range of key hashes on the ring.
+        using hash_range_type = runtime_locking_shard::impl::hash_range_type;
+
+        /// Key range scheduled to move to a different shard.
+        struct migration_type {
+            /// Range of key hashes to move.
+            hash_range_type m_range;
+            /// Shard ID to receive the range.
+            key_location_return_type m_destination{};
+        };
+
         /// Constructor.
         /// \param n_shards number of shards available to the directory.
-        explicit impl(size_t n_shards);
+        /// \param n_vnodes number of virtual nodes to place on the ring for
+        ///                 each shard.
+        explicit impl(size_t n_shards, size_t n_vnodes = default_vnodes);
 
         /// Returns the shard ID responsible for the given key. Calls the
         /// callback before returning.
@@ -25,9 +53,106 @@ namespace cbdc::parsec::directory {
                           key_location_callback_type result_callback)
             -> bool override;
 
+        /// Returns the position of the given key on the hash ring.
+        /// \param key key to hash.
+        /// \return key hash.
+        [[nodiscard]] auto key_hash(const runtime_locking_shard::key_type& key)
+            const -> uint64_t;
+
+        /// Returns the current mapping snapshot. The snapshot is immutable
+        /// and remains valid until released, so it may be cached and its
+        /// version compared against mapping_version to detect changes.
+        /// \return current mapping.
+        [[nodiscard]] auto get_mapping() const
+            -> std::shared_ptr<const mapping_type> override;
+
+        /// Returns the version of the current mapping.
+        /// \return current mapping version.
+        [[nodiscard]] auto mapping_version() const -> uint64_t override;
+
+        /// Adds a new shard to the directory. The mapping is not changed
+        /// until the returned migrations are completed, so keys continue to
+        /// be located on their current shards while they are copied to the
+        /// new shard.
+        /// \return ID of the new shard and the key ranges which must be
+        ///         migrated to the new shard, or std::nullopt if any of the
+        ///         ranges overlaps a pending migration. In that case the
+        ///         shard is not added and the caller should retry once the
+        ///         pending migrations have completed or been aborted.
+        auto add_shard() -> std::optional<
+            std::pair<key_location_return_type, std::vector<migration_type>>>;
+
+        /// Schedules a key range to move to the given shard. Keys in the
+        /// range are still located on their current shards until the
+        /// migration is completed.
+        /// \param range range of key hashes to move.
+        /// \param destination shard ID to receive the range.
+        /// \return false if the range is invalid, the destination shard does
+        ///         not exist or the range overlaps a pending migration.
+        auto begin_migration(hash_range_type range,
+                             key_location_return_type destination) -> bool;
+
+        /// Moves the keys in the range of a pending migration to its
+        /// destination shard and completes the migration. Fences the range
+        /// on the shards which currently own it so no new locks are granted,
+        /// waits for tickets holding locks in the range to commit or roll
+        /// back, copies the keys to the destination shard and then publishes
+        /// the new mapping. The previous owners keep the range fenced so
+        /// brokers with an outdated mapping have their tickets retried.
+        /// \param range range of a pending migration.
+        /// \param shards shard instances, indexed by shard ID.
+        /// \param timeout how long to wait for locks in the range to be
+        ///                released before giving up.
+        /// \return the new mapping version, or std::nullopt if there is no
+        ///         pending migration for the range or the locks were not
+        ///         released in time. In the latter case the migration is
+        ///         aborted and the range unfenced.
+        auto run_migration(
+            hash_range_type range,
+            const std::vector<std::shared_ptr<runtime_locking_shard::impl>>&
+                shards,
+            std::chrono::milliseconds timeout) -> std::optional<uint64_t>;
+
+        /// Completes a pending migration by reassigning the range to its
+        /// destination shard in a new mapping version. Only swaps the
+        /// mapping; run_migration also moves the keys and drains tickets
+        /// holding locks in the range.
+        /// \param range range of a pending migration.
+        /// \return the new mapping version, or std::nullopt if there is no
+        ///         pending migration for the range.
+        auto complete_migration(hash_range_type range)
+            -> std::optional<uint64_t>;
+
+        /// Cancels a pending migration, leaving the mapping unchanged.
+        /// \param range range of a pending migration.
+        /// \return false if there is no pending migration for the range.
+        auto abort_migration(hash_range_type range) -> bool;
+
+        /// Returns the migrations which have begun but not yet completed.
+        /// \return pending migrations.
+        [[nodiscard]] auto pending_migrations() const
+            -> std::vector<migration_type>;
+
       private:
+        mutable std::mutex m_mut;
         size_t m_n_shards{};
-        hashing::const_sip_hash<runtime_locking_shard::key_type> m_siphash{};
+        size_t m_n_vnodes{};
+        std::shared_ptr<const mapping_type> m_mapping;
+        std::atomic<uint64_t> m_version{};
+        std::vector<migration_type> m_pending;
+
+        [[nodiscard]] static auto
+        vnode_token(key_location_return_type shard, size_t vnode) -> uint64_t;
+
+        [[nodiscard]] auto overlaps_pending(hash_range_type range) const
+            -> bool;
+
+        [[nodiscard]] auto find_pending(hash_range_type range)
+            -> std::vector<migration_type>::iterator;
+
+        static void assign(mapping_type& mapping,
+                           hash_range_type range,
+                           key_location_return_type shard);
     };
 }
 
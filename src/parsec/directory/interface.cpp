@@ -0,0 +1,32 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "interface.hpp"
+
+#include <cassert>
+
+namespace cbdc::parsec::directory {
+    auto interface::mapping_type::shard_for(uint64_t key_hash) const
+        -> key_location_return_type {
+        // The ring always contains a token at the maximum hash value so
+        // lower_bound never returns end()
+        auto it = m_ring.lower_bound(key_hash);
+        assert(it != m_ring.end());
+        return it->second;
+    }
+
+    auto interface::mapping_type::shard_for(
+        const runtime_locking_shard::key_type& key) const
+        -> key_location_return_type {
+        return shard_for(key_hash(key));
+    }
+
+    auto interface::mapping_type::key_hash(
+        const runtime_locking_shard::key_type& key) -> uint64_t {
+        static constexpr auto hasher
+            = hashing::const_sip_hash<runtime_locking_shard::key_type>();
+        return hasher(key);
+    }
+}
@@ -8,6 +8,9 @@
 
 #include "parsec/runtime_locking_shard/interface.hpp"
 
+#include <map>
+#include <memory>
+
 namespace cbdc::parsec::directory {
     /// Interface for a directory. Maps keys to shard IDs.
     class interface {
@@ -26,6 +29,36 @@ namespace cbdc::parsec::directory {
         using key_location_callback_type
             = std::function<void(key_location_return_type)>;
 
+        /// Immutable snapshot of the mapping from key hashes to shard IDs.
+        struct mapping_type {
+            /// Version of the mapping. Incremented on every change.
+            uint64_t m_version{};
+            /// Ring tokens mapped to the shard which owns them. A key hash is
+            /// owned by the shard of the first token greater than or equal to
+            /// the hash. The ring always contains a token at the maximum hash
+            /// value so every lookup finds an owner without wrapping.
+            std::map<uint64_t, key_location_return_type> m_ring;
+
+            /// Returns the shard ID responsible for the given key hash.
+            /// \param key_hash hash of the key to locate.
+            /// \return shard ID.
+            [[nodiscard]] auto shard_for(uint64_t key_hash) const
+                -> key_location_return_type;
+
+            /// Returns the shard ID responsible for the given key.
+            /// \param key key to locate.
+            /// \return shard ID.
+            [[nodiscard]] auto
+            shard_for(const runtime_locking_shard::key_type& key) const
+                -> key_location_return_type;
+
+            /// Returns the position of the given key on the hash ring.
+            /// \param key key to hash.
+            /// \return key hash.
+            [[nodiscard]] static auto
+            key_hash(const runtime_locking_shard::key_type& key) -> uint64_t;
+        };
+
         /// Returns the shard ID responsible for the given key.
         /// \param key key to locate.
         /// \param result_callback function to call with key location.
@@ -34,6 +67,19 @@ namespace cbdc::parsec::directory {
                                   key_location_callback_type result_callback)
             -> bool
             = 0;
+
+        /// Returns the current mapping snapshot. The snapshot is immutable,
+        /// so callers may cache it and locate keys without going through
+        /// the directory until mapping_version reports a change.
+        /// \return current mapping.
+        [[nodiscard]] virtual auto get_mapping() const
+            -> std::shared_ptr<const mapping_type>
+            = 0;
+
+        /// Returns the version of the current mapping. Cheaper than
+        /// get_mapping, for checking whether a cached snapshot is stale.
+        /// \return current mapping version.
+        [[nodiscard]] virtual auto mapping_version() const -> uint64_t = 0;
     };
 }
 
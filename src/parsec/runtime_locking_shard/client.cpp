@@ -31,7 +31,11 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         return m_client->call(
             std::move(req),
             [result_callback](std::optional<response> resp) {
-                assert(resp.has_value());
+                if(!resp.has_value()) {
+                    result_callback(
+                        shard_error{error_code::internal_error, std::nullopt});
+                    return;
+                }
                 assert(std::holds_alternative<try_lock_return_type>(
                     resp.value()));
                 result_callback(std::get<try_lock_return_type>(resp.value()));
@@ -46,7 +50,11 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         return m_client->call(
             std::move(req),
             [result_callback](std::optional<response> resp) {
-                assert(resp.has_value());
+                if(!resp.has_value()) {
+                    result_callback(
+                        shard_error{error_code::internal_error, std::nullopt});
+                    return;
+                }
                 assert(
                     std::holds_alternative<prepare_return_type>(resp.value()));
                 result_callback(std::get<prepare_return_type>(resp.value()));
@@ -59,7 +67,11 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         return m_client->call(
             req,
             [result_callback](std::optional<response> resp) {
-                assert(resp.has_value());
+                if(!resp.has_value()) {
+                    result_callback(
+                        shard_error{error_code::internal_error, std::nullopt});
+                    return;
+                }
                 assert(
                     std::holds_alternative<commit_return_type>(resp.value()));
                 result_callback(std::get<commit_return_type>(resp.value()));
@@ -72,7 +84,11 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         return m_client->call(
             req,
             [result_callback](std::optional<response> resp) {
-                assert(resp.has_value());
+                if(!resp.has_value()) {
+                    result_callback(
+                        shard_error{error_code::internal_error, std::nullopt});
+                    return;
+                }
                 assert(std::holds_alternative<rollback_return_type>(
                     resp.value()));
                 result_callback(std::get<rollback_return_type>(resp.value()));
@@ -85,7 +101,11 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         return m_client->call(
             req,
             [result_callback](std::optional<response> resp) {
-                assert(resp.has_value());
+                if(!resp.has_value()) {
+                    result_callback(
+                        shard_error{error_code::internal_error, std::nullopt});
+                    return;
+                }
                 assert(
                     std::holds_alternative<finish_return_type>(resp.value()));
                 result_callback(std::get<finish_return_type>(resp.value()));
@@ -99,7 +119,10 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         return m_client->call(
             req,
             [result_callback](std::optional<response> resp) {
-                assert(resp.has_value());
+                if(!resp.has_value()) {
+                    result_callback(error_code::internal_error);
+                    return;
+                }
                 assert(std::holds_alternative<get_tickets_return_type>(
                     resp.value()));
                 result_callback(
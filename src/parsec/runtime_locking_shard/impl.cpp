@@ -5,7 +5,9 @@
 
 #include "impl.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <utility>
 
 namespace cbdc::parsec::runtime_locking_shard {
     impl::impl(std::shared_ptr<logging::log> logger)
@@ -19,86 +21,108 @@ namespace cbdc::parsec::runtime_locking_shard {
                         try_lock_callback_type result_callback) -> bool {
         auto callbacks = pending_callbacks_list_type();
         auto w_details = std::optional<wounded_details>();
+        auto needs_wound = false;
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock<std::mutex> l(m_mut);
+            auto acc = access(false);
 
             m_log->trace(ticket_number,
                          "requesting lock on",
                          key.to_hex(),
                          static_cast<int>(locktype));
 
-            auto it = m_tickets.find(ticket_number);
-            if(first_lock && it != m_tickets.end()) {
-                m_log->fatal(ticket_number,
-                             "called try_lock with first lock but ticket "
-                             "already exists");
-            }
-            if(it == m_tickets.end()) {
-                if(!first_lock) {
+            // Creating the ticket checks for an existing one under the
+            // same latch, so concurrent first locks can't both create it
+            auto ticket = ticket_ref();
+            if(first_lock) {
+                auto [emplaced, created] = emplace_ticket(ticket_number);
+                if(!created) {
+                    m_log->fatal(ticket_number,
+                                 "called try_lock with first lock but "
+                                 "ticket already exists");
+                }
+                ticket = std::move(emplaced);
+            } else {
+                ticket = find_ticket(ticket_number);
+                if(ticket == nullptr) {
                     m_log->error(ticket_number,
                                  "called try_lock with unknown ticket");
                     return error_code::unknown_ticket;
                 }
-                it = m_tickets.emplace(ticket_number, ticket_state_type{})
-                         .first;
-            }
-            auto& ticket = it->second;
-
-            // Callers shouldn't be using try_lock after prepare
-            if(ticket.m_state == ticket_state::prepared) {
-                m_log->error(ticket_number, "called try_lock after prepare");
-                return error_code::prepared;
-            }
-
-            if(ticket.m_state == ticket_state::committed) {
-                m_log->error(ticket_number, "called try_lock after commit");
-                return error_code::committed;
             }
 
-            // If the ticket way wounded don't bother trying to acquire any
-            // locks
-            if(ticket.m_state == ticket_state::wounded) {
+            // Keys being moved to another shard can't be locked here. The
+            // ticket is retried once its broker has located the key again.
+            if(fenced(key)) {
                 m_log->trace(ticket_number,
-                             "called try_lock after being wounded");
-                w_details = ticket.m_wounded_details;
+                             "requested lock on fenced key",
+                             key.to_hex());
                 return error_code::wounded;
             }
 
-            // Make sure the ticket doesn't already hold a lock on the key
-            if(auto lock_it = ticket.m_locks_held.find(key);
-               lock_it != ticket.m_locks_held.end()
-               && lock_it->second >= locktype) {
-                m_log->warn(this,
-                            ticket_number,
-                            "tried to acquire already held lock");
-                return error_code::lock_held;
-            }
+            auto key_latches = lock_keys(acc, {key});
+            auto& lock = element(key).m_lock;
+            {
+                std::unique_lock tl(ticket->m_mut);
 
-            if(ticket.m_queued_locks.find(key)
-               != ticket.m_queued_locks.end()) {
-                m_log->warn(ticket_number,
-                            "tried to acquire already queued lock");
-                return error_code::lock_queued;
-            }
+                // Callers shouldn't be using try_lock after prepare
+                if(ticket->m_state == ticket_state::prepared) {
+                    m_log->error(ticket_number,
+                                 "called try_lock after prepare");
+                    return error_code::prepared;
+                }
+
+                if(ticket->m_state == ticket_state::committed) {
+                    m_log->error(ticket_number, "called try_lock after commit");
+                    return error_code::committed;
+                }
+
+                // If the ticket way wounded don't bother trying to acquire
+                // any locks
+                if(ticket->m_state == ticket_state::wounded) {
+                    m_log->trace(ticket_number,
+                                 "called try_lock after being wounded");
+                    w_details = ticket->m_wounded_details;
+                    return error_code::wounded;
+                }
 
-            ticket.m_broker_id = broker_id;
+                // Make sure the ticket doesn't already hold a lock on the key
+                if(auto lock_it = ticket->m_locks_held.find(key);
+                   lock_it != ticket->m_locks_held.end()
+                   && lock_it->second >= locktype) {
+                    m_log->warn(this,
+                                ticket_number,
+                                "tried to acquire already held lock");
+                    return error_code::lock_held;
+                }
+
+                if(ticket->m_queued_locks.find(key)
+                   != ticket->m_queued_locks.end()) {
+                    m_log->warn(ticket_number,
+                                "tried to acquire already queued lock");
+                    return error_code::lock_queued;
+                }
 
-            // Grab the requested state element
-            auto& state_element = m_state[key];
-            auto& lock = state_element.m_lock;
+                ticket->m_broker_id = broker_id;
 
-            // Queue the lock
-            lock.m_queue.emplace(
-                ticket_number,
-                lock_queue_element_type{locktype, std::move(result_callback)});
-            ticket.m_queued_locks.insert(key);
+                // Queue the lock
+                lock.m_queue.emplace(
+                    ticket_number,
+                    lock_queue_element_type{locktype,
+                                            std::move(result_callback)});
+                ticket->m_queued_locks.insert(key);
+            }
 
             // Determine if the ticket will wait on any locks
             auto waiting_on = get_waiting_on(ticket_number, locktype, lock);
-            callbacks
-                = wound_tickets(std::move(key), waiting_on, ticket_number);
 
-            w_details = ticket.m_wounded_details;
+            // Wounding may release locks on any key so it needs exclusive
+            // access to the shard
+            if(!acc.exclusive() && has_woundable(waiting_on)) {
+                needs_wound = true;
+                return std::nullopt;
+            }
+
+            callbacks = wound_tickets(key, waiting_on, ticket_number);
 
             m_log->trace(this, "shard handled try_lock for", ticket_number);
             return std::nullopt;
@@ -106,16 +130,50 @@ namespace cbdc::parsec::runtime_locking_shard {
 
         if(maybe_error.has_value()) {
             result_callback(shard_error{maybe_error.value(), w_details});
-        } else {
-            // Call all the result callbacks without holding the lock
-            for(auto& callback : callbacks) {
-                callback.m_callback(std::move(callback.m_returning));
+            return true;
+        }
+
+        if(needs_wound) {
+            auto acc = access(true);
+            // The ticket may have been wounded or rolled back while the shard
+            // was released, in which case the queued lock has already been
+            // cancelled
+            auto ticket = find_ticket(ticket_number);
+            if(ticket != nullptr
+               && ticket->m_queued_locks.find(key)
+                      != ticket->m_queued_locks.end()) {
+                auto& lock = element(key).m_lock;
+                auto waiting_on = get_waiting_on(
+                    ticket_number,
+                    lock.m_queue.at(ticket_number).m_type,
+                    lock);
+                callbacks
+                    = wound_tickets(std::move(key), waiting_on, ticket_number);
             }
+            m_log->trace(this, "shard handled try_lock for", ticket_number);
+        }
+
+        // Call all the result callbacks without holding the lock
+        for(auto& callback : callbacks) {
+            callback.m_callback(std::move(callback.m_returning));
         }
 
         return true;
     }
 
+    auto impl::has_woundable(const std::vector<ticket_number_type>& tickets)
+        -> bool {
+        return std::any_of(tickets.begin(),
+                           tickets.end(),
+                           [&](ticket_number_type ticket_number) {
+                               auto ticket = find_ticket(ticket_number);
+                               assert(ticket != nullptr);
+                               std::unique_lock tl(ticket->m_mut);
+                               return ticket->m_state
+                                   != ticket_state::prepared;
+                           });
+    }
+
     auto impl::wound_tickets(
         key_type key,
         const std::vector<ticket_number_type>& blocking_tickets,
@@ -123,19 +181,23 @@ namespace cbdc::parsec::runtime_locking_shard {
         auto callbacks = pending_callbacks_list_type();
         auto keys = key_set_type();
         for(auto blocking_ticket_number : blocking_tickets) {
-            auto& blocking_ticket = m_tickets[blocking_ticket_number];
-            // Tickets can't be deadlocked by prepared tickets and
-            // we're not allowed to wound them anyway
-            if(blocking_ticket.m_state == ticket_state::prepared) {
-                continue;
-            }
+            auto blocking_ticket = find_ticket(blocking_ticket_number);
+            assert(blocking_ticket != nullptr);
+            {
+                std::unique_lock tl(blocking_ticket->m_mut);
+                // Tickets can't be deadlocked by prepared tickets and
+                // we're not allowed to wound them anyway
+                if(blocking_ticket->m_state == ticket_state::prepared) {
+                    continue;
+                }
 
-            // Mark the ticket as wounded
-            blocking_ticket.m_state = ticket_state::wounded;
-            blocking_ticket.m_wounded_details = {blocked_ticket, key};
+                // Mark the ticket as wounded
+                blocking_ticket->m_state = ticket_state::wounded;
+                blocking_ticket->m_wounded_details = {blocked_ticket, key};
+            }
 
             auto [wounded_callbacks, affected_keys]
-                = release_locks(blocking_ticket_number, blocking_ticket);
+                = release_locks(blocking_ticket_number, *blocking_ticket);
             callbacks.insert(
                 callbacks.end(),
                 std::make_move_iterator(wounded_callbacks.begin()),
@@ -163,8 +225,9 @@ namespace cbdc::parsec::runtime_locking_shard {
         };
         // Write locks wait on readers
         if(locktype == lock_type::write) {
-            std::copy_if(lock.m_readers.begin(),
-                         lock.m_readers.end(),
+            auto readers = lock.m_readers.items();
+            std::copy_if(readers.begin(),
+                         readers.end(),
                          std::back_inserter(waiting_on),
                          younger_ticket);
         }
@@ -182,46 +245,46 @@ namespace cbdc::parsec::runtime_locking_shard {
                        state_update_type state_update,
                        prepare_callback_type result_callback) -> bool {
         auto result = [&]() -> std::optional<shard_error> {
-            std::unique_lock<std::mutex> l(m_mut);
+            auto acc = access(false);
             // Grab the ticket and ensure it exists
-            auto ticket_it = m_tickets.find(ticket_number);
-            if(ticket_it == m_tickets.end()) {
+            auto ticket = find_ticket(ticket_number);
+            if(ticket == nullptr) {
                 m_log->error(this,
                              ticket_number,
                              "does not exist on shard for prepare");
                 return shard_error{error_code::unknown_ticket, std::nullopt};
             }
-            auto& ticket = ticket_it->second;
+            std::unique_lock tl(ticket->m_mut);
 
             // If the ticket is already prepared, return the result as such
-            if(ticket.m_state == ticket_state::prepared) {
+            if(ticket->m_state == ticket_state::prepared) {
                 m_log->warn(ticket_number,
                             "called prepare but already prepared");
                 return shard_error{error_code::prepared, std::nullopt};
             }
 
-            if(ticket.m_state == ticket_state::committed) {
+            if(ticket->m_state == ticket_state::committed) {
                 m_log->warn(ticket_number,
                             "called prepare but already committed");
                 return shard_error{error_code::committed, std::nullopt};
             }
 
             // If the ticket was wounded it can't be prepared
-            if(ticket.m_state == ticket_state::wounded) {
+            if(ticket->m_state == ticket_state::wounded) {
                 m_log->debug(ticket_number,
                              "called prepare after being wounded");
                 return shard_error{error_code::wounded,
-                                   ticket.m_wounded_details};
+                                   ticket->m_wounded_details};
             }
 
-            if(!ticket.m_queued_locks.empty()) {
+            if(!ticket->m_queued_locks.empty()) {
                 m_log->error(ticket_number, "still has queued locks");
                 return shard_error{error_code::lock_queued, std::nullopt};
             }
 
             for(auto& [key, value] : state_update) {
-                auto lk_it = ticket.m_locks_held.find(key);
-                if(lk_it == ticket.m_locks_held.end()) {
+                auto lk_it = ticket->m_locks_held.find(key);
+                if(lk_it == ticket->m_locks_held.end()) {
                     m_log->warn(ticket_number,
                                 "wanted state update for unheld lock");
                     return shard_error{error_code::lock_not_held,
@@ -235,8 +298,8 @@ namespace cbdc::parsec::runtime_locking_shard {
                 }
             }
 
-            ticket.m_state_update = std::move(state_update);
-            ticket.m_state = ticket_state::prepared;
+            ticket->m_state_update = std::move(state_update);
+            ticket->m_state = ticket_state::prepared;
             return std::nullopt;
         }();
 
@@ -248,29 +311,53 @@ namespace cbdc::parsec::runtime_locking_shard {
                       commit_callback_type result_callback) -> bool {
         auto callbacks = pending_callbacks_list_type();
         auto result = [&]() -> std::optional<shard_error> {
-            std::unique_lock<std::mutex> l(m_mut);
+            auto acc = access(false);
             // Grab the ticket and ensure it exists
-            auto ticket_it = m_tickets.find(ticket_number);
-            if(ticket_it == m_tickets.end()) {
+            auto ticket = find_ticket(ticket_number);
+            if(ticket == nullptr) {
                 m_log->error(this,
                              ticket_number,
                              "does not exist on shard for commit");
                 return shard_error{error_code::unknown_ticket, std::nullopt};
             }
-            auto& ticket = ticket_it->second;
 
-            // If the ticket is not prepared we can't commit
-            if(ticket.m_state != ticket_state::prepared) {
-                m_log->warn(ticket_number, "called commit but not prepared");
-                return shard_error{error_code::not_prepared, std::nullopt};
+            // Prepared tickets can't acquire or lose locks, so the set of
+            // keys to latch is stable until the ticket is committed
+            auto keys = std::vector<key_type>();
+            {
+                std::unique_lock tl(ticket->m_mut);
+                if(ticket->m_state != ticket_state::prepared) {
+                    m_log->warn(ticket_number,
+                                "called commit but not prepared");
+                    return shard_error{error_code::not_prepared,
+                                       std::nullopt};
+                }
+                keys.reserve(ticket->m_locks_held.size());
+                for(const auto& [key, lt] : ticket->m_locks_held) {
+                    keys.push_back(key);
+                }
             }
 
-            for(auto&& [key, value] : ticket.m_state_update) {
-                m_state[key].m_value = std::move(value);
+            auto key_latches = lock_keys(acc, keys);
+            {
+                std::unique_lock tl(ticket->m_mut);
+                // Another commit for the same ticket may have won the race
+                if(ticket->m_state != ticket_state::prepared) {
+                    m_log->warn(ticket_number,
+                                "called commit but not prepared");
+                    return shard_error{error_code::not_prepared,
+                                       std::nullopt};
+                }
+
+                for(auto&& [key, value] : ticket->m_state_update) {
+                    element(key).m_value = std::move(value);
+                }
+
+                ticket->m_state = ticket_state::committed;
             }
 
             auto [wounded_callbacks, affected_keys]
-                = release_locks(ticket_number, ticket);
+                = release_locks(ticket_number, *ticket);
             assert(wounded_callbacks.empty());
             callbacks = acquire_locks(affected_keys);
             callbacks.insert(
@@ -278,8 +365,6 @@ namespace cbdc::parsec::runtime_locking_shard {
                 std::make_move_iterator(wounded_callbacks.begin()),
                 std::make_move_iterator(wounded_callbacks.end()));
 
-            ticket.m_state = ticket_state::committed;
-
             m_log->trace(this, "Shard executed commit for", ticket_number);
             return std::nullopt;
         }();
@@ -302,9 +387,10 @@ namespace cbdc::parsec::runtime_locking_shard {
                              ticket_state_type& ticket)
         -> std::pair<pending_callbacks_list_type, key_set_type> {
         auto callbacks = pending_callbacks_list_type();
+        std::unique_lock tl(ticket.m_mut);
         // Unqueue any pending locks
         for(const auto& lock_key : ticket.m_queued_locks) {
-            auto& queued_element = m_state[lock_key];
+            auto& queued_element = element(lock_key);
             auto& lk = queued_element.m_lock;
             auto queue_node = lk.m_queue.extract(ticket_number);
             auto& queued_lock_element = queue_node.mapped();
@@ -319,7 +405,7 @@ namespace cbdc::parsec::runtime_locking_shard {
 
         for(auto& [lock_key, lt] : ticket.m_locks_held) {
             // Release any locks held by the blocking ticket
-            auto& locked_element = m_state[lock_key];
+            auto& locked_element = element(lock_key);
             auto& lk = locked_element.m_lock;
             // Release the read lock held by the wounded ticket
             if(lt == lock_type::read) {
@@ -358,19 +444,20 @@ namespace cbdc::parsec::runtime_locking_shard {
                         rollback_callback_type result_callback) -> bool {
         auto callbacks = pending_callbacks_list_type();
         auto result = [&]() -> std::optional<shard_error> {
-            std::unique_lock<std::mutex> l(m_mut);
+            // Rolling back an unprepared ticket races with its own lock
+            // requests, so take exclusive access to the shard
+            auto acc = access(true);
             // Grab the ticket and ensure it exists
-            auto ticket_it = m_tickets.find(ticket_number);
-            if(ticket_it == m_tickets.end()) {
+            auto ticket = find_ticket(ticket_number);
+            if(ticket == nullptr) {
                 m_log->error(this,
                              ticket_number,
                              "does not exist on shard for rollback");
                 return shard_error{error_code::unknown_ticket, std::nullopt};
             }
-            auto& ticket = ticket_it->second;
 
             auto [wounded_callbacks, affected_keys]
-                = release_locks(ticket_number, ticket);
+                = release_locks(ticket_number, *ticket);
             callbacks = acquire_locks(affected_keys);
             callbacks.insert(
                 callbacks.end(),
@@ -380,7 +467,7 @@ namespace cbdc::parsec::runtime_locking_shard {
             // We erase the ticket here as we won't need the ticket for
             // recovery. No need for a "rolled back" state and subsequent
             // finish.
-            m_tickets.erase(ticket_it);
+            erase_ticket(ticket_number);
 
             m_log->trace(this, "Shard handled rollback for", ticket_number);
 
@@ -398,26 +485,36 @@ namespace cbdc::parsec::runtime_locking_shard {
     auto impl::finish(ticket_number_type ticket_number,
                       finish_callback_type result_callback) -> bool {
         auto maybe_error = [&]() -> std::optional<shard_error> {
-            std::unique_lock l(m_mut);
-            auto ticket_it = m_tickets.find(ticket_number);
-            if(ticket_it == m_tickets.end()) {
+            auto acc = access(false);
+            auto ticket = find_ticket(ticket_number);
+            if(ticket == nullptr) {
                 m_log->error(this,
                              ticket_number,
                              "does not exist on shard for finish");
                 return shard_error{error_code::unknown_ticket, std::nullopt};
             }
 
-            auto& ticket = ticket_it->second;
+            {
+                std::unique_lock tl(ticket->m_mut);
+                if(ticket->m_state != ticket_state::committed) {
+                    m_log->error(this,
+                                 ticket_number,
+                                 "finish requested but not committed");
+                    return shard_error{error_code::not_committed,
+                                       std::nullopt};
+                }
+            }
 
-            if(ticket.m_state != ticket_state::committed) {
+            // Committed tickets hold no locks and are not queued on any key.
+            // Operations which found the ticket before it was erased see it
+            // as committed until they release it.
+            if(!erase_ticket(ticket_number)) {
                 m_log->error(this,
                              ticket_number,
-                             "finish requested but not committed");
-                return shard_error{error_code::not_committed, std::nullopt};
+                             "already finished on shard");
+                return shard_error{error_code::unknown_ticket, std::nullopt};
             }
 
-            m_tickets.erase(ticket_it);
-
             m_log->trace(this, "Shard handled finish for", ticket_number);
 
             return std::nullopt;
@@ -431,11 +528,15 @@ namespace cbdc::parsec::runtime_locking_shard {
     auto impl::get_tickets(broker_id_type broker_id,
                            get_tickets_callback_type result_callback) -> bool {
         auto result = [&]() -> get_tickets_success_type {
-            std::unique_lock l(m_mut);
+            auto acc = access(false);
             auto ret = get_tickets_success_type();
-            for(auto& [ticket_number, ticket] : m_tickets) {
-                if(ticket.m_broker_id == broker_id) {
-                    ret.emplace(ticket_number, ticket.m_state);
+            for(auto& partition : m_tickets) {
+                std::unique_lock pl(partition.m_mut);
+                for(auto& [ticket_number, ticket] : partition.m_index) {
+                    std::unique_lock tl(ticket->m_mut);
+                    if(ticket->m_broker_id == broker_id) {
+                        ret.emplace(ticket_number, ticket->m_state);
+                    }
                 }
             }
             return ret;
@@ -448,40 +549,137 @@ namespace cbdc::parsec::runtime_locking_shard {
 
     auto impl::recover(const replicated_shard::state_type& state,
                        const replicated_shard::tickets_type& tickets) -> bool {
-        std::unique_lock l(m_mut);
-        if(!m_tickets.empty() && !m_state.empty()) {
+        auto acc = access(true);
+        auto empty = std::all_of(m_tickets.begin(),
+                                 m_tickets.end(),
+                                 [](const ticket_partition_type& p) {
+                                     return p.m_index.empty();
+                                 })
+                  || std::all_of(m_keys.begin(),
+                                 m_keys.end(),
+                                 [](const key_partition_type& p) {
+                                     return p.m_state.empty();
+                                 });
+        if(!empty) {
             m_log->error("Shard state is not empty, cannot recover");
             return false;
         }
-        m_state.reserve(state.size());
         for(auto&& [k, v] : state) {
-            m_state.emplace(k, state_element_type{v, {}});
+            element(k).m_value = v;
         }
-        m_tickets.reserve(tickets.size());
         for(auto&& [tn, t] : tickets) {
-            auto ticket = ticket_state_type{};
-            ticket.m_broker_id = t.m_broker_id;
+            auto ticket = emplace_ticket(tn).first;
+            ticket->m_broker_id = t.m_broker_id;
             switch(t.m_state) {
                 case replicated_shard::ticket_state::committed:
-                    ticket.m_state = ticket_state::committed;
+                    ticket->m_state = ticket_state::committed;
                     break;
                 case replicated_shard::ticket_state::prepared:
-                    ticket.m_state = ticket_state::prepared;
+                    ticket->m_state = ticket_state::prepared;
                     for(const auto& [k, v] : t.m_state_update) {
-                        ticket.m_locks_held.emplace(k, lock_type::write);
-                        m_state[k].m_lock.m_writer = tn;
+                        ticket->m_locks_held.emplace(k, lock_type::write);
+                        element(k).m_lock.m_writer = tn;
                     }
                     break;
             }
-            ticket.m_state_update = t.m_state_update;
-            m_tickets.emplace(tn, std::move(ticket));
+            ticket->m_state_update = t.m_state_update;
         }
         return true;
     }
 
+    void impl::fence(hash_range_type range) {
+        auto acc = access(true);
+        remove_fence(range);
+        m_fences.push_back(range);
+    }
+
+    void impl::unfence(hash_range_type range) {
+        auto acc = access(true);
+        remove_fence(range);
+    }
+
+    auto impl::export_range(hash_range_type range)
+        -> std::optional<state_update_type> {
+        auto acc = access(true);
+        auto ret = state_update_type();
+        for(auto& partition : m_keys) {
+            for(auto& [key, elem] : partition.m_state) {
+                if(!range.contains(m_siphash(key))) {
+                    continue;
+                }
+                const auto& lock = elem.m_lock;
+                if(lock.m_writer.has_value() || lock.m_readers.size() > 0
+                   || !lock.m_queue.empty()) {
+                    return std::nullopt;
+                }
+                ret.emplace(key, elem.m_value);
+            }
+        }
+        return ret;
+    }
+
+    void impl::import_range(hash_range_type range,
+                            const state_update_type& state) {
+        auto acc = access(true);
+        for(const auto& [key, value] : state) {
+            assert(range.contains(m_siphash(key)));
+            element(key).m_value = value;
+        }
+        remove_fence(range);
+    }
+
+    void impl::drop_range(hash_range_type range) {
+        auto acc = access(true);
+        for(auto& partition : m_keys) {
+            std::erase_if(partition.m_state, [&](const auto& elem) {
+                return range.contains(m_siphash(elem.first));
+            });
+        }
+    }
+
+    auto impl::fenced(const key_type& key) const -> bool {
+        if(m_fences.empty()) {
+            return false;
+        }
+        auto hash = m_siphash(key);
+        return std::any_of(m_fences.begin(),
+                           m_fences.end(),
+                           [&](const hash_range_type& r) {
+                               return r.contains(hash);
+                           });
+    }
+
+    void impl::remove_fence(hash_range_type range) {
+        // Trim the parts of existing fences which overlap the range, keeping
+        // whatever lies either side of it
+        auto fences = std::vector<hash_range_type>();
+        for(auto& f : m_fences) {
+            if(f.m_end < range.m_begin || range.m_end < f.m_begin) {
+                fences.push_back(f);
+                continue;
+            }
+            if(f.m_begin < range.m_begin) {
+                fences.push_back({f.m_begin, range.m_begin - 1});
+            }
+            if(range.m_end < f.m_end) {
+                fences.push_back({range.m_end + 1, f.m_end});
+            }
+        }
+        m_fences = std::move(fences);
+    }
+
+    auto impl::hash_range_type::operator==(const hash_range_type& rhs) const
+        -> bool {
+        return m_begin == rhs.m_begin && m_end == rhs.m_end;
+    }
+
+    auto impl::hash_range_type::contains(uint64_t hash) const -> bool {
+        return m_begin <= hash && hash <= m_end;
+    }
+
     auto impl::acquire_lock(const key_type& key,
                             pending_callbacks_list_type& callbacks) -> bool {
-        auto& locked_element = m_state[key];
+        auto& locked_element = element(key);
         auto& lk = locked_element.m_lock;
         if(lk.m_queue.empty()) {
             return false;
@@ -490,7 +688,8 @@ namespace cbdc::parsec::runtime_locking_shard {
         auto queue_node = lk.m_queue.begin();
         const auto& queued_ticket_number = queue_node->first;
         auto& queued_lock_element = queue_node->second;
-        auto& queued_ticket = m_tickets[queued_ticket_number];
+        auto queued_ticket = find_ticket(queued_ticket_number);
+        assert(queued_ticket != nullptr);
         // Acquire the read lock if the ticket requested a
         // read
         if(queued_lock_element.m_type == lock_type::read) {
@@ -514,7 +713,7 @@ namespace cbdc::parsec::runtime_locking_shard {
                 return false;
             }
             if(lk.m_readers.size() == 1) {
-                if(*lk.m_readers.begin() != queued_ticket_number) {
+                if(lk.m_readers.items().front() != queued_ticket_number) {
                     return false;
                 }
 
@@ -528,8 +727,11 @@ namespace cbdc::parsec::runtime_locking_shard {
             lk.m_writer = queued_ticket_number;
             acquire_next = false;
         }
-        queued_ticket.m_queued_locks.erase(key);
-        queued_ticket.m_locks_held[key] = queued_lock_element.m_type;
+        {
+            std::unique_lock tl(queued_ticket->m_mut);
+            queued_ticket->m_queued_locks.erase(key);
+            queued_ticket->m_locks_held[key] = queued_lock_element.m_type;
+        }
         // Notify the ticket that the lock was acquired
         callbacks.emplace_back(pending_callback_element_type{
             std::move(queued_lock_element.m_callback),
@@ -538,4 +740,213 @@ namespace cbdc::parsec::runtime_locking_shard {
         lk.m_queue.erase(queue_node);
         return acquire_next;
     }
+
+    auto impl::access(bool exclusive) -> access_type {
+        // Once an operation is waiting for exclusive access, stop admitting
+        // new shared operations so it isn't starved
+        if(!exclusive && m_exclusive_waiting == 0) {
+            return {std::shared_lock(m_mut), {}};
+        }
+        m_exclusive_waiting++;
+        auto l = std::unique_lock(m_mut);
+        m_exclusive_waiting--;
+        return {{}, std::move(l)};
+    }
+
+    auto impl::access_type::exclusive() const -> bool {
+        return m_exclusive.owns_lock();
+    }
+
+    auto impl::lock_keys(const access_type& acc,
+                         const std::vector<key_type>& keys)
+        -> std::vector<std::unique_lock<std::mutex>> {
+        auto latches = std::vector<std::unique_lock<std::mutex>>();
+        if(acc.exclusive()) {
+            return latches;
+        }
+        // Latch partitions in ascending order to avoid deadlocks
+        auto partitions = std::vector<size_t>();
+        partitions.reserve(keys.size());
+        for(const auto& key : keys) {
+            partitions.push_back(m_siphash(key) % key_partition_count);
+        }
+        std::sort(partitions.begin(), partitions.end());
+        partitions.erase(std::unique(partitions.begin(), partitions.end()),
+                         partitions.end());
+        latches.reserve(partitions.size());
+        for(auto p : partitions) {
+            latches.emplace_back(m_keys[p].m_mut);
+        }
+        return latches;
+    }
+
+    auto impl::element(const key_type& key) -> state_element_type& {
+        auto& partition = m_keys[m_siphash(key) % key_partition_count];
+        return partition.m_state[key];
+    }
+
+    auto impl::find_ticket(ticket_number_type ticket_number) -> ticket_ref {
+        auto& partition = m_tickets[ticket_number % ticket_partition_count];
+        std::unique_lock pl(partition.m_mut);
+        auto it = partition.m_index.find(ticket_number);
+        if(it == partition.m_index.end()) {
+            return {};
+        }
+        return {partition, it->second};
+    }
+
+    auto impl::emplace_ticket(ticket_number_type ticket_number)
+        -> std::pair<ticket_ref, bool> {
+        auto& partition = m_tickets[ticket_number % ticket_partition_count];
+        std::unique_lock pl(partition.m_mut);
+        if(auto it = partition.m_index.find(ticket_number);
+           it != partition.m_index.end()) {
+            return {ticket_ref(partition, it->second), false};
+        }
+        auto* ticket = [&]() {
+            if(partition.m_free.empty()) {
+                return &partition.m_slab.emplace_back();
+            }
+            auto* t = partition.m_free.back();
+            partition.m_free.pop_back();
+            return t;
+        }();
+        partition.m_index.emplace(ticket_number, ticket);
+        return {ticket_ref(partition, ticket), true};
+    }
+
+    auto impl::erase_ticket(ticket_number_type ticket_number) -> bool {
+        auto& partition = m_tickets[ticket_number % ticket_partition_count];
+        std::unique_lock pl(partition.m_mut);
+        auto node = partition.m_index.extract(ticket_number);
+        if(node.empty()) {
+            return false;
+        }
+        // The caller holds a pin, so the last unpin recycles the ticket
+        node.mapped()->m_erased = true;
+        return true;
+    }
+
+    void impl::ticket_partition_type::unpin(ticket_state_type* ticket) {
+        std::unique_lock pl(m_mut);
+        assert(ticket->m_pins > 0);
+        ticket->m_pins--;
+        if(ticket->m_pins > 0 || !ticket->m_erased) {
+            return;
+        }
+        {
+            std::unique_lock tl(ticket->m_mut);
+            ticket->reset();
+        }
+        ticket->m_erased = false;
+        m_free.push_back(ticket);
+    }
+
+    impl::ticket_ref::ticket_ref(ticket_partition_type& partition,
+                                 ticket_state_type* ticket)
+        : m_partition(&partition),
+          m_ticket(ticket) {
+        // Callers hold the partition latch
+        m_ticket->m_pins++;
+    }
+
+    impl::ticket_ref::~ticket_ref() {
+        if(m_ticket != nullptr) {
+            m_partition->unpin(m_ticket);
+        }
+    }
+
+    impl::ticket_ref::ticket_ref(ticket_ref&& other) noexcept
+        : m_partition(std::exchange(other.m_partition, nullptr)),
+          m_ticket(std::exchange(other.m_ticket, nullptr)) {}
+
+    auto impl::ticket_ref::operator=(ticket_ref&& other) noexcept
+        -> ticket_ref& {
+        if(this != &other) {
+            if(m_ticket != nullptr) {
+                m_partition->unpin(m_ticket);
+            }
+            m_partition = std::exchange(other.m_partition, nullptr);
+            m_ticket = std::exchange(other.m_ticket, nullptr);
+        }
+        return *this;
+    }
+
+    auto impl::ticket_ref::operator->() const -> ticket_state_type* {
+        return m_ticket;
+    }
+
+    auto impl::ticket_ref::operator*() const -> ticket_state_type& {
+        return *m_ticket;
+    }
+
+    auto impl::ticket_ref::operator==(std::nullptr_t) const -> bool {
+        return m_ticket == nullptr;
+    }
+
+    void impl::ticket_state_type::reset() {
+        m_state = ticket_state::begun;
+        m_locks_held.clear();
+        m_queued_locks.clear();
+        m_state_update.clear();
+        m_broker_id = {};
+        m_wounded_details.reset();
+    }
+
+    void impl::reader_set_type::insert(ticket_number_type ticket_number) {
+        auto current = items();
+        if(std::find(current.begin(), current.end(), ticket_number)
+           != current.end()) {
+            return;
+        }
+        if(m_size < inline_capacity) {
+            m_inline[m_size] = ticket_number;
+        } else {
+            if(m_size == inline_capacity) {
+                m_spill.assign(m_inline.begin(), m_inline.end());
+            }
+            m_spill.push_back(ticket_number);
+        }
+        m_size++;
+    }
+
+    void impl::reader_set_type::erase(ticket_number_type ticket_number) {
+        if(m_size <= inline_capacity) {
+            auto end = m_inline.begin() + static_cast<ptrdiff_t>(m_size);
+            auto it = std::find(m_inline.begin(), end, ticket_number);
+            if(it != end) {
+                *it = m_inline[m_size - 1];
+                m_size--;
+            }
+            return;
+        }
+        auto it = std::find(m_spill.begin(), m_spill.end(), ticket_number);
+        if(it == m_spill.end()) {
+            return;
+        }
+        *it = m_spill.back();
+        m_spill.pop_back();
+        m_size--;
+        if(m_size == inline_capacity) {
+            std::copy(m_spill.begin(), m_spill.end(), m_inline.begin());
+            m_spill.clear();
+        }
+    }
+
+    void impl::reader_set_type::clear() {
+        m_size = 0;
+        m_spill.clear();
+    }
+
+    auto impl::reader_set_type::size() const -> size_t {
+        return m_size;
+    }
+
+    auto impl::reader_set_type::items() const
+        -> std::span<const ticket_number_type> {
+        if(m_size <= inline_capacity) {
+            return {m_inline.data(), m_size};
+        }
+        return {m_spill.data(), m_spill.size()};
+    }
 }
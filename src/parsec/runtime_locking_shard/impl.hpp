@@ -11,16 +11,39 @@
 #include "util/common/hashmap.hpp"
 #include "util/common/logging.hpp"
 
+#include <array>
+#include <atomic>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace cbdc::parsec::runtime_locking_shard {
     /// Implementation of a runtime locking shard. Stores keys in memory using
-    /// a hash map. Thread-safe.
+    /// a hash map partitioned by key hash, with a latch per partition so
+    /// operations on unrelated keys proceed in parallel. Thread-safe.
     class impl : public interface {
       public:
+        /// Inclusive range of key hashes. Used to move keys between shards.
+        struct hash_range_type {
+            /// First hash in the range.
+            uint64_t m_begin{};
+            /// Last hash in the range.
+            uint64_t m_end{};
+
+            auto operator==(const hash_range_type& rhs) const -> bool;
+
+            /// Returns true if the given hash is in the range.
+            /// \param hash key hash.
+            /// \return true if the range contains the hash.
+            [[nodiscard]] auto contains(uint64_t hash) const -> bool;
+        };
+
         /// Constructor.
         /// \param logger log instance.
         explicit impl(std::shared_ptr<logging::log> logger);
@@ -92,15 +115,75 @@ namespace cbdc::parsec::runtime_locking_shard {
         auto recover(const replicated_shard::state_type& state,
                      const replicated_shard::tickets_type& tickets) -> bool;
 
+        /// Stops tickets acquiring new locks on keys in the given range so
+        /// the keys can be moved to another shard. Lock requests on fenced
+        /// keys fail with error_code::wounded so the ticket is retried, by
+        /// which time its broker can locate the key on its new shard. Locks
+        /// already held or queued are unaffected.
+        /// \param range range of key hashes to fence.
+        void fence(hash_range_type range);
+
+        /// Lifts a fence placed by fence, such as when a migration is
+        /// aborted.
+        /// \param range range of key hashes to unfence.
+        void unfence(hash_range_type range);
+
+        /// Returns the keys in the given range and their values, provided no
+        /// ticket holds or is queued for a lock on any of them. The range
+        /// should be fenced first so the keys stay unlocked afterwards.
+        /// \param range range of key hashes to export.
+        /// \return keys in the range, or std::nullopt if tickets still hold
+        ///         locks in the range.
+        auto export_range(hash_range_type range)
+            -> std::optional<state_update_type>;
+
+        /// Stores keys moved from another shard and lifts any fence on the
+        /// range.
+        /// \param range range of key hashes being moved to this shard.
+        /// \param state keys and values from the range.
+        void import_range(hash_range_type range,
+                          const state_update_type& state);
+
+        /// Removes the keys in the given range once they have moved to
+        /// another shard. The range stays fenced so lock requests from
+        /// brokers with an outdated directory mapping are turned away.
+        /// \param range range of key hashes to remove.
+        void drop_range(hash_range_type range);
+
       private:
+        /// Number of partitions the key table is split into. Each partition
+        /// is guarded by its own latch.
+        static constexpr size_t key_partition_count = 64;
+        /// Number of partitions the ticket table is split into.
+        static constexpr size_t ticket_partition_count = 16;
+
         struct lock_queue_element_type {
             lock_type m_type;
             try_lock_callback_type m_callback;
         };
 
+        /// Set of tickets holding a read lock. Stores up to two readers
+        /// inline, which covers the common case, and spills to the heap
+        /// beyond that.
+        class reader_set_type {
+          public:
+            void insert(ticket_number_type ticket_number);
+            void erase(ticket_number_type ticket_number);
+            void clear();
+            [[nodiscard]] auto size() const -> size_t;
+            [[nodiscard]] auto items() const
+                -> std::span<const ticket_number_type>;
+
+          private:
+            static constexpr size_t inline_capacity = 2;
+            std::array<ticket_number_type, inline_capacity> m_inline{};
+            size_t m_size{};
+            std::vector<ticket_number_type> m_spill;
+        };
+
         struct rw_lock_type {
             std::optional<ticket_number_type> m_writer;
-            std::unordered_set<ticket_number_type> m_readers;
+            reader_set_type m_readers;
             std::map<ticket_number_type, lock_queue_element_type> m_queue;
         };
 
@@ -113,6 +196,7 @@ namespace cbdc::parsec::runtime_locking_shard {
             = std::unordered_set<key_type, hashing::const_sip_hash<key_type>>;
 
         struct ticket_state_type {
+            std::mutex m_mut;
             ticket_state m_state{ticket_state::begun};
             std::unordered_map<key_type,
                                lock_type,
@@ -122,6 +206,17 @@ namespace cbdc::parsec::runtime_locking_shard {
             state_update_type m_state_update;
             broker_id_type m_broker_id{};
             std::optional<wounded_details> m_wounded_details{};
+            /// Number of operations using the ticket. Guarded by the ticket
+            /// partition latch.
+            size_t m_pins{};
+            /// Whether the ticket has been removed from the index and
+            /// should be recycled once unpinned. Guarded by the ticket
+            /// partition latch.
+            bool m_erased{};
+
+            /// Returns the ticket to its initial state for reuse, keeping
+            /// any memory already allocated by its containers.
+            void reset();
         };
 
         struct pending_callback_element_type {
@@ -133,14 +228,104 @@ namespace cbdc::parsec::runtime_locking_shard {
         using pending_callbacks_list_type
             = std::vector<pending_callback_element_type>;
 
-        mutable std::mutex m_mut;
+        struct key_partition_type {
+            std::mutex m_mut;
+            std::unordered_map<key_type,
+                               state_element_type,
+                               hashing::const_sip_hash<key_type>>
+                m_state;
+        };
+
+        /// Ticket states are allocated from a slab so their addresses stay
+        /// stable and finished tickets are recycled without reallocating.
+        /// Erased tickets are only recycled once no operation still uses
+        /// them.
+        struct ticket_partition_type {
+            std::mutex m_mut;
+            std::deque<ticket_state_type> m_slab;
+            std::vector<ticket_state_type*> m_free;
+            std::unordered_map<ticket_number_type, ticket_state_type*>
+                m_index;
+
+            /// Releases an operation's pin on the given ticket, recycling
+            /// the ticket if it was the last pin on an erased ticket.
+            void unpin(ticket_state_type* ticket);
+        };
+
+        /// Ticket in use by an operation. The ticket's slot isn't recycled
+        /// while the reference exists, even if the ticket is erased.
+        class ticket_ref {
+          public:
+            ticket_ref() = default;
+            ticket_ref(ticket_partition_type& partition,
+                       ticket_state_type* ticket);
+            ~ticket_ref();
+
+            ticket_ref(const ticket_ref&) = delete;
+            auto operator=(const ticket_ref&) -> ticket_ref& = delete;
+            ticket_ref(ticket_ref&& other) noexcept;
+            auto operator=(ticket_ref&& other) noexcept -> ticket_ref&;
+
+            auto operator->() const -> ticket_state_type*;
+            auto operator*() const -> ticket_state_type&;
+            auto operator==(std::nullptr_t) const -> bool;
+
+          private:
+            ticket_partition_type* m_partition{};
+            ticket_state_type* m_ticket{};
+        };
+
+        /// Access to the shard state held by an operation. Most operations
+        /// hold the shard in shared mode and latch the partitions they touch.
+        /// Operations which may touch any key, such as wounding, hold the
+        /// shard exclusively and need no latches.
+        struct access_type {
+            std::shared_lock<std::shared_mutex> m_shared;
+            std::unique_lock<std::shared_mutex> m_exclusive;
+
+            [[nodiscard]] auto exclusive() const -> bool;
+        };
+
+        // Lock hierarchy: m_mut, then key partition latches in ascending
+        // order, then a ticket partition latch, then at most one ticket
+        // latch.
+        std::shared_mutex m_mut;
+        std::atomic<size_t> m_exclusive_waiting{};
         std::shared_ptr<logging::log> m_log;
 
-        std::unordered_map<key_type,
-                           state_element_type,
-                           hashing::const_sip_hash<key_type>>
-            m_state;
-        std::unordered_map<ticket_number_type, ticket_state_type> m_tickets;
+        std::array<key_partition_type, key_partition_count> m_keys;
+        std::array<ticket_partition_type, ticket_partition_count> m_tickets;
+        hashing::const_sip_hash<key_type> m_siphash{};
+        /// Ranges of keys being moved off the shard. Only modified with
+        /// exclusive access to the shard.
+        std::vector<hash_range_type> m_fences;
+
+        auto access(bool exclusive) -> access_type;
+
+        auto lock_keys(const access_type& acc,
+                       const std::vector<key_type>& keys)
+            -> std::vector<std::unique_lock<std::mutex>>;
+
+        auto element(const key_type& key) -> state_element_type&;
+
+        [[nodiscard]] auto fenced(const key_type& key) const -> bool;
+
+        void remove_fence(hash_range_type range);
+
+        auto find_ticket(ticket_number_type ticket_number) -> ticket_ref;
+
+        /// Returns the given ticket, creating it if it doesn't exist, and
+        /// whether the ticket was created.
+        auto emplace_ticket(ticket_number_type ticket_number)
+            -> std::pair<ticket_ref, bool>;
+
+        /// Removes the given ticket from the index. The ticket's slot is
+        /// recycled once the last operation using it releases it. Returns
+        /// false if the ticket was already erased.
+        auto erase_ticket(ticket_number_type ticket_number) -> bool;
+
+        auto has_woundable(const std::vector<ticket_number_type>& tickets)
+            -> bool;
 
         auto
         wound_tickets(key_type key,
@@ -7,6 +7,8 @@
 
 #include "util/serialization/format.hpp"
 
+#include <cassert>
+
 namespace cbdc::parsec::ticket_machine::rpc {
     client::client(std::vector<network::endpoint_t> endpoints)
         : m_client(std::make_unique<decltype(m_client)::element_type>(
@@ -19,77 +21,118 @@ namespace cbdc::parsec::ticket_machine::rpc {
     auto
     client::get_ticket_number(get_ticket_number_callback_type result_callback)
         -> bool {
-        auto num = ticket_number_type{};
-        {
+        auto num = try_claim();
+        if(!num.has_value()) {
             std::unique_lock l(m_mut);
-            constexpr auto fetch_threshold = 500;
-            if(m_tickets.size() < fetch_threshold && !m_fetching_tickets) {
-                auto res = fetch_tickets();
-                if(res) {
+            // Another caller may have installed a new range while we waited
+            // for the lock
+            num = try_claim();
+            if(!num.has_value() && m_standby.has_value()) {
+                activate(m_standby.value());
+                m_standby.reset();
+                m_has_standby = false;
+                num = try_claim();
+            }
+            if(!num.has_value()) {
+                if(!m_fetching_tickets) {
+                    if(!fetch_tickets()) {
+                        return false;
+                    }
                     m_fetching_tickets = true;
                 }
-                if(m_tickets.empty() && !res) {
-                    return false;
-                }
-            }
-            if(m_tickets.empty()) {
                 m_callbacks.emplace(std::move(result_callback));
                 return true;
             }
-
-            num = m_tickets.front();
-            m_tickets.pop();
         }
 
-        result_callback(ticket_number_range_type{num, num});
+        maybe_prefetch(num.value());
+        result_callback(ticket_number_range_type{num.value(), num.value()});
         return true;
     }
 
+    auto client::try_claim() -> std::optional<ticket_number_type> {
+        auto num = m_next.load();
+        while(num < m_end.load()) {
+            if(m_next.compare_exchange_weak(num, num + 1)) {
+                return num;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void client::maybe_prefetch(ticket_number_type claimed) {
+        if(m_end.load() - claimed > prefetch_threshold || m_has_standby
+           || m_fetching_tickets) {
+            return;
+        }
+        std::unique_lock l(m_mut);
+        if(m_has_standby || m_fetching_tickets) {
+            return;
+        }
+        if(fetch_tickets()) {
+            m_fetching_tickets = true;
+        }
+    }
+
+    void client::activate(ticket_number_range_type range) {
+        m_next = range.first;
+        m_end = range.second;
+    }
+
     auto client::fetch_tickets() -> bool {
         return m_client->call(
             std::monostate{},
             [this](std::optional<get_ticket_number_return_type> res) {
-                assert(res.has_value());
+                if(!res.has_value()) {
+                    handle_fetch_error(error_code{});
+                    return;
+                }
                 std::visit(overloaded{[&](ticket_number_range_type range) {
                                           handle_ticket_numbers(range);
                                       },
                                       [&](error_code e) {
-                                          auto callbacks
-                                              = decltype(m_callbacks)();
-                                          {
-                                              std::unique_lock ll(m_mut);
-                                              m_fetching_tickets = false;
-                                              callbacks.swap(m_callbacks);
-                                          }
-                                          while(!callbacks.empty()) {
-                                              callbacks.front()(e);
-                                              callbacks.pop();
-                                          }
+                                          handle_fetch_error(e);
                                       }},
                            res.value());
             });
     }
 
+    void client::handle_fetch_error(error_code e) {
+        auto callbacks = decltype(m_callbacks)();
+        {
+            std::unique_lock ll(m_mut);
+            m_fetching_tickets = false;
+            callbacks.swap(m_callbacks);
+        }
+        while(!callbacks.empty()) {
+            callbacks.front()(e);
+            callbacks.pop();
+        }
+    }
+
     void client::handle_ticket_numbers(ticket_number_range_type range) {
         auto callbacks = decltype(m_callbacks)();
-        auto tickets = decltype(m_tickets)();
+        auto tickets = std::queue<ticket_number_type>();
         {
             std::unique_lock ll(m_mut);
-            for(ticket_number_type i = range.first; i < range.second; i++) {
-                m_tickets.push(i);
-            }
-            while(!m_tickets.empty() && !m_callbacks.empty()) {
+            m_fetching_tickets = false;
+            // Serve callers waiting on this range first
+            while(range.first < range.second && !m_callbacks.empty()) {
                 callbacks.push(std::move(m_callbacks.front()));
                 m_callbacks.pop();
-                tickets.push(m_tickets.front());
-                m_tickets.pop();
+                tickets.push(range.first++);
             }
-            if(m_callbacks.empty()) {
-                m_fetching_tickets = false;
-            } else {
-                auto fetch_res = fetch_tickets();
-                if(!fetch_res) {
-                    m_fetching_tickets = false;
+            if(range.first < range.second) {
+                if(m_next.load() >= m_end.load()) {
+                    activate(range);
+                } else {
+                    m_standby = range;
+                    m_has_standby = true;
+                }
+            }
+            if(!m_callbacks.empty()) {
+                if(fetch_tickets()) {
+                    m_fetching_tickets = true;
                 }
             }
         }
@@ -10,6 +10,11 @@
 #include "messages.hpp"
 #include "util/rpc/tcp_client.hpp"
 
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <queue>
+
 namespace cbdc::parsec::ticket_machine::rpc {
     /// RPC client for a remote ticket machine.
     class client : public interface {
@@ -30,28 +35,48 @@ namespace cbdc::parsec::ticket_machine::rpc {
         /// \return true if the client initialized successfully.
         auto init() -> bool;
 
-        /// Requests a new batch of ticket numbers from the remote ticket
-        /// machine. Always returns a single ticket number (range size of 1).
-        /// Caches ticket numbers to avoid making an RPC request per call. If a
-        /// ticket number is available in the cache, calls the callback before
-        /// returning.
+        /// Returns a single ticket number (range size of 1). Ticket numbers
+        /// are handed out locally from a range leased from the remote ticket
+        /// machine. A second range is prefetched before the active range runs
+        /// out so callers rarely wait on an RPC. If a ticket number is
+        /// available locally, calls the callback before returning.
         /// \param result_callback function to call with the new ticket number.
         /// \return true if the request was initiated successfully.
         auto get_ticket_number(get_ticket_number_callback_type result_callback)
             -> bool override;
 
       private:
+        /// Number of ticket numbers remaining in the active range below which
+        /// the next range is prefetched.
+        static constexpr ticket_number_type prefetch_threshold = 500;
+
         std::unique_ptr<cbdc::rpc::tcp_client<request, response>> m_client;
-        std::queue<ticket_number_type> m_tickets;
-        bool m_fetching_tickets{false};
+
+        // Active range. Ticket numbers are claimed with a CAS on m_next while
+        // it is below m_end. When installing a new range, m_next is updated
+        // before m_end so a stale m_next can never pass the bounds check.
+        std::atomic<ticket_number_type> m_next{};
+        std::atomic<ticket_number_type> m_end{};
+
+        std::atomic_bool m_fetching_tickets{false};
+        std::atomic_bool m_has_standby{false};
 
         mutable std::mutex m_mut;
 
+        std::optional<ticket_number_range_type> m_standby;
         std::queue<get_ticket_number_callback_type> m_callbacks;
 
+        auto try_claim() -> std::optional<ticket_number_type>;
+
+        void maybe_prefetch(ticket_number_type claimed);
+
+        void activate(ticket_number_range_type range);
+
         auto fetch_tickets() -> bool;
 
         void handle_ticket_numbers(ticket_number_range_type range);
+
+        void handle_fetch_error(error_code e);
     };
 }
 
@@ -55,12 +55,15 @@ namespace cbdc::parsec::ticket_machine {
         }
         if(type == nuraft::cb_func::Type::BecomeLeader) {
             m_logger->warn("Became leader, starting listener");
-            m_server = std::make_unique<decltype(m_server)::element_type>(
+            auto rpc_server = std::make_unique<cbdc::rpc::tcp_server<
+                cbdc::rpc::async_server<rpc::request, rpc::response>>>(
                 m_server_endpoint);
-            m_server->register_raft_node(m_raft_serv);
-            if(!m_server->init()) {
+            if(!rpc_server->init()) {
                 m_logger->fatal("Couldn't start message handler server");
             }
+            m_server = std::make_unique<rpc::server>(m_logger,
+                                                     m_raft_serv,
+                                                     std::move(rpc_server));
         }
         return nuraft::cb_func::ReturnCode::Ok;
     }
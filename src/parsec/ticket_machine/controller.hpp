@@ -7,10 +7,9 @@
 #define OPENCBDC_TX_SRC_PARSEC_TICKET_MACHINE_CONTROLLER_H_
 
 #include "impl.hpp"
+#include "server.hpp"
 #include "state_machine.hpp"
 #include "util/raft/node.hpp"
-#include "util/raft/rpc_server.hpp"
-#include "util/rpc/tcp_server.hpp"
 
 namespace cbdc::parsec::ticket_machine {
     /// Manages a replicated ticket machine using Raft.
@@ -48,7 +47,7 @@ namespace cbdc::parsec::ticket_machine {
 
         std::shared_ptr<state_machine> m_state_machine;
         std::shared_ptr<raft::node> m_raft_serv;
-        std::unique_ptr<cbdc::rpc::tcp_server<raft::rpc::server>> m_server;
+        std::unique_ptr<rpc::server> m_server;
 
         std::vector<network::endpoint_t> m_raft_endpoints;
         network::endpoint_t m_server_endpoint;
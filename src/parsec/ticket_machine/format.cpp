@@ -0,0 +1,22 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "format.hpp"
+
+#include "util/serialization/format.hpp"
+
+namespace cbdc {
+    auto operator<<(serializer& ser,
+                    const parsec::ticket_machine::rpc::batch_request& req)
+        -> serializer& {
+        return ser << req.m_count;
+    }
+
+    auto operator>>(serializer& deser,
+                    parsec::ticket_machine::rpc::batch_request& req)
+        -> serializer& {
+        return deser >> req.m_count;
+    }
+}
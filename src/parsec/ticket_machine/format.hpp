@@ -0,0 +1,21 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PARSEC_TICKET_MACHINE_FORMAT_H_
+#define OPENCBDC_TX_SRC_PARSEC_TICKET_MACHINE_FORMAT_H_
+
+#include "messages.hpp"
+#include "util/serialization/serializer.hpp"
+
+namespace cbdc {
+    auto operator<<(serializer& ser,
+                    const parsec::ticket_machine::rpc::batch_request& req)
+        -> serializer&;
+    auto operator>>(serializer& deser,
+                    parsec::ticket_machine::rpc::batch_request& req)
+        -> serializer&;
+}
+
+#endif
@@ -18,4 +18,11 @@ namespace cbdc::parsec::ticket_machine {
             ticket_number_range_type{ticket_number, ticket_number + m_range});
         return true;
     }
+
+    auto impl::get_ticket_number_batch(uint64_t count)
+        -> ticket_number_range_type {
+        auto n_tickets = m_range * count;
+        auto ticket_number = m_next_ticket_number.fetch_add(n_tickets);
+        return {ticket_number, ticket_number + n_tickets};
+    }
 }
@@ -29,6 +29,13 @@ namespace cbdc::parsec::ticket_machine {
         auto get_ticket_number(get_ticket_number_callback_type result_callback)
             -> bool override;
 
+        /// Returns a single contiguous range covering the given number of
+        /// ticket number ranges, to be split between several requesters.
+        /// \param count number of ranges to allocate.
+        /// \return exclusive range of unique ticket numbers.
+        auto get_ticket_number_batch(uint64_t count)
+            -> ticket_number_range_type;
+
       private:
         std::shared_ptr<logging::log> m_log;
         std::atomic<ticket_number_type> m_next_ticket_number{};
@@ -13,6 +13,13 @@ namespace cbdc::parsec::ticket_machine::rpc {
     using request = std::variant<std::monostate>;
     /// Ticket machine RPC response type.
     using response = interface::get_ticket_number_return_type;
+
+    /// Request replicated through the raft log to grant several ticket
+    /// number ranges in a single log entry.
+    struct batch_request {
+        /// Number of ticket number ranges to grant.
+        uint64_t m_count{};
+    };
 }
 
 #endif
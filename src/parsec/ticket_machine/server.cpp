@@ -0,0 +1,116 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "server.hpp"
+
+#include "format.hpp"
+#include "util/common/variant_overloaded.hpp"
+#include "util/raft/util.hpp"
+#include "util/serialization/format.hpp"
+
+namespace cbdc::parsec::ticket_machine::rpc {
+    server::server(
+        std::shared_ptr<logging::log> logger,
+        std::shared_ptr<raft::node> raft_node,
+        std::unique_ptr<cbdc::rpc::async_server<request, response>> srv)
+        : m_log(std::move(logger)),
+          m_raft(std::move(raft_node)),
+          m_srv(std::move(srv)) {
+        m_srv->register_handler_callback(
+            [&](const request& req, callback_type callback) {
+                return handler_callback(req, std::move(callback));
+            });
+    }
+
+    auto server::handler_callback(const request& /* req */,
+                                  callback_type callback) -> bool {
+        auto batch = std::vector<callback_type>();
+        {
+            std::unique_lock l(m_mut);
+            m_pending.emplace_back(std::move(callback));
+            // Requests arriving during replication are granted by the next
+            // log entry
+            if(m_replicating) {
+                return true;
+            }
+            m_replicating = true;
+            batch.swap(m_pending);
+        }
+        replicate(std::move(batch));
+        return true;
+    }
+
+    void server::replicate(std::vector<callback_type> batch) {
+        auto req = batch_request{batch.size()};
+        auto req_buf
+            = make_buffer<batch_request, nuraft::ptr<nuraft::buffer>>(req);
+        auto callbacks
+            = std::make_shared<std::vector<callback_type>>(std::move(batch));
+        auto success
+            = m_raft->is_leader()
+           && m_raft->replicate(
+                  std::move(req_buf),
+                  [&, callbacks](raft::result_type& r,
+                                 nuraft::ptr<std::exception>& err) {
+                      auto res = std::optional<response>();
+                      if(!err) {
+                          if(const auto resp_buf = r.get()) {
+                              res = from_buffer<response>(*resp_buf);
+                          }
+                      }
+                      handle_batch(std::move(*callbacks), res);
+                  });
+        if(!success) {
+            m_log->error("Failed to replicate ticket number batch");
+            handle_batch(std::move(*callbacks), std::nullopt);
+        }
+    }
+
+    void server::handle_batch(std::vector<callback_type> batch,
+                              std::optional<response> res) {
+        // Start replicating the next batch before responding so requests
+        // queued in the meantime aren't delayed by the responses
+        auto next = std::vector<callback_type>();
+        {
+            std::unique_lock l(m_mut);
+            if(m_pending.empty()) {
+                m_replicating = false;
+            } else {
+                next.swap(m_pending);
+            }
+        }
+        if(!next.empty()) {
+            replicate(std::move(next));
+        }
+
+        if(!res.has_value()) {
+            for(auto& callback : batch) {
+                callback(std::nullopt);
+            }
+            return;
+        }
+
+        std::visit(
+            overloaded{
+                [&](interface::ticket_number_range_type range) {
+                    // Split the range evenly between the batched requests
+                    auto per_request
+                        = (range.second - range.first) / batch.size();
+                    auto start = range.first;
+                    for(auto& callback : batch) {
+                        callback(interface::ticket_number_range_type{
+                            start,
+                            start + per_request});
+                        start += per_request;
+                    }
+                },
+                [&](interface::error_code e) {
+                    for(auto& callback : batch) {
+                        callback(e);
+                    }
+                }},
+            res.value());
+    }
+}
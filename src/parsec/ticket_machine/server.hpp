@@ -0,0 +1,53 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PARSEC_TICKET_MACHINE_SERVER_H_
+#define OPENCBDC_TX_SRC_PARSEC_TICKET_MACHINE_SERVER_H_
+
+#include "messages.hpp"
+#include "util/common/logging.hpp"
+#include "util/raft/node.hpp"
+#include "util/rpc/async_server.hpp"
+
+#include <mutex>
+#include <vector>
+
+namespace cbdc::parsec::ticket_machine::rpc {
+    /// RPC server for a replicated ticket machine. Requests which arrive
+    /// while a raft log entry is being replicated are grouped and granted
+    /// together by the next log entry, so the number of raft entries does
+    /// not grow with the number of requesting brokers.
+    class server {
+      public:
+        /// Constructor. Registers the request handler with the RPC server.
+        /// \param logger log instance.
+        /// \param raft_node raft node replicating the ticket machine state.
+        /// \param srv pointer to an asynchronous RPC server.
+        server(std::shared_ptr<logging::log> logger,
+               std::shared_ptr<raft::node> raft_node,
+               std::unique_ptr<cbdc::rpc::async_server<request, response>> srv);
+
+      private:
+        using callback_type = std::function<void(std::optional<response>)>;
+
+        std::shared_ptr<logging::log> m_log;
+        std::shared_ptr<raft::node> m_raft;
+        std::unique_ptr<cbdc::rpc::async_server<request, response>> m_srv;
+
+        std::mutex m_mut;
+        std::vector<callback_type> m_pending;
+        bool m_replicating{false};
+
+        auto handler_callback(const request& req, callback_type callback)
+            -> bool;
+
+        void replicate(std::vector<callback_type> batch);
+
+        void handle_batch(std::vector<callback_type> batch,
+                          std::optional<response> res);
+    };
+}
+
+#endif
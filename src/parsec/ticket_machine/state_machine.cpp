@@ -5,16 +5,14 @@
 
 #include "state_machine.hpp"
 
-#include "util/rpc/format.hpp"
+#include "format.hpp"
+#include "util/raft/util.hpp"
 #include "util/serialization/format.hpp"
 
 namespace cbdc::parsec::ticket_machine {
     state_machine::state_machine(std::shared_ptr<logging::log> logger,
                                  ticket_number_type batch_size)
         : m_logger(std::move(logger)) {
-        register_handler_callback([&](rpc::request req) {
-            return process_request(req);
-        });
         m_ticket_machine = std::make_unique<impl>(m_logger, batch_size);
     }
 
@@ -22,15 +20,17 @@ namespace cbdc::parsec::ticket_machine {
         -> nuraft::ptr<nuraft::buffer> {
         m_last_committed_idx = log_idx;
 
-        auto resp = blocking_call(data);
-        if(!resp.has_value()) {
+        auto maybe_req = from_buffer<rpc::batch_request>(data);
+        if(!maybe_req.has_value()) {
             // TODO: This would only happen if there was a deserialization
             // error with the request. Maybe we should abort here as such an
-            // event would imply a bug in the coordinator.
+            // event would imply a bug in the RPC server.
             return nullptr;
         }
 
-        return resp.value();
+        auto resp = rpc::response(
+            m_ticket_machine->get_ticket_number_batch(maybe_req->m_count));
+        return make_buffer<rpc::response, nuraft::ptr<nuraft::buffer>>(resp);
     }
 
     auto state_machine::apply_snapshot(nuraft::snapshot& /* s */) -> bool {
@@ -52,15 +52,4 @@ namespace cbdc::parsec::ticket_machine {
         bool ret = false;
         when_done(ret, except);
     }
-
-    auto state_machine::process_request(rpc::request /* req */)
-        -> rpc::response {
-        auto ret = rpc::response();
-        [[maybe_unused]] auto success = m_ticket_machine->get_ticket_number(
-            [&](interface::get_ticket_number_return_type tkts) {
-                ret = tkts;
-            });
-        assert(success);
-        return ret;
-    }
 }
@@ -9,29 +9,24 @@
 #include "impl.hpp"
 #include "messages.hpp"
 #include "util/common/logging.hpp"
-#include "util/rpc/blocking_server.hpp"
 
 #include <libnuraft/nuraft.hxx>
 
 namespace cbdc::parsec::ticket_machine {
     /// NuRaft state machine implementation for a replicated ticket machine.
-    class state_machine
-        : public nuraft::state_machine,
-          public cbdc::rpc::blocking_server<rpc::request,
-                                            rpc::response,
-                                            nuraft::buffer&,
-                                            nuraft::ptr<nuraft::buffer>> {
+    /// Each log entry grants a batch of ticket number ranges.
+    class state_machine : public nuraft::state_machine {
       public:
         /// Constructor.
         /// \param logger log instance.
-        /// \param batch_size number of ticket numbers to return per request.
+        /// \param batch_size number of ticket numbers in each range.
         state_machine(std::shared_ptr<logging::log> logger,
                       ticket_number_type batch_size);
 
         /// Commit the given raft log entry at the given log index, and return
         /// the result.
         /// \param log_idx raft log index of the log entry.
-        /// \param data serialized RPC request.
+        /// \param data serialized batch request.
         /// \return serialized RPC response or nullptr if there was an error
         ///         processing the request.
         auto commit(uint64_t log_idx, nuraft::buffer& data)
@@ -56,8 +51,6 @@ namespace cbdc::parsec::ticket_machine {
             override;
 
       private:
-        auto process_request(rpc::request req) -> rpc::response;
-
         std::atomic<uint64_t> m_last_committed_idx{0};
 
         std::unique_ptr<impl> m_ticket_machine{};
@@ -168,6 +168,28 @@ namespace cbdc::parsec {
             cfg.m_contention_rate = std::stod(it->second);
         }
 
+        constexpr auto target_tps_key = "loadgen_tps";
+        it = opts->find(target_tps_key);
+        if(it != opts->end()) {
+            cfg.m_target_tps = std::stod(it->second);
+            if(cfg.m_target_tps < 0.0) {
+                return std::nullopt;
+            }
+        }
+
+        constexpr auto arrival_type_key = "loadgen_arrivals";
+        it = opts->find(arrival_type_key);
+        if(it != opts->end()) {
+            const auto& val = it->second;
+            if(val == "poisson") {
+                cfg.m_arrival_type = arrival_type::poisson;
+            } else if(val == "constant") {
+                cfg.m_arrival_type = arrival_type::constant;
+            } else {
+                return std::nullopt;
+            }
+        }
+
         constexpr auto default_loadgen_accounts = 1000;
         cfg.m_loadgen_accounts = default_loadgen_accounts;
         constexpr auto loadgen_accounts_key = "loadgen_accounts";
@@ -176,6 +198,25 @@ namespace cbdc::parsec {
             cfg.m_loadgen_accounts = std::stoull(it->second);
         }
 
+        constexpr auto speculative_batch_size_key = "speculative_batch_size";
+        it = opts->find(speculative_batch_size_key);
+        if(it != opts->end()) {
+            cfg.m_speculative_batch_size = std::stoull(it->second);
+        }
+
+        constexpr auto speculative_batch_concurrency_key
+            = "speculative_batch_concurrency";
+        it = opts->find(speculative_batch_concurrency_key);
+        if(it != opts->end()) {
+            cfg.m_speculative_batch_concurrency = std::stoull(it->second);
+        }
+
+        constexpr auto agent_threads_key = "agent_threads";
+        it = opts->find(agent_threads_key);
+        if(it != opts->end()) {
+            cfg.m_agent_threads = std::stoull(it->second);
+        }
+
         constexpr auto runner_type_key = "runner_type";
         it = opts->find(runner_type_key);
         if(it != opts->end()) {
@@ -19,6 +19,16 @@ namespace cbdc::parsec {
         erc20
     };
 
+    /// Distribution of transaction arrival times for open-loop load
+    /// generation
+    enum class arrival_type {
+        /// Evenly spaced arrivals at the target rate
+        constant,
+        /// Exponentially distributed inter-arrival times with a mean of the
+        /// target rate
+        poisson
+    };
+
     /// Execution/transaction model
     enum class runner_type {
         /// Transaction semantics defined using Lua.
@@ -51,6 +61,27 @@ namespace cbdc::parsec {
         /// The percentage of transactions that are using the same account
         /// to simulate contention
         double m_contention_rate;
+        /// Target transactions per second for each load generator. If zero,
+        /// load generators run closed-loop, sending each account's next
+        /// transaction when the previous one completes.
+        double m_target_tps{0.0};
+        /// Arrival process used by open-loop load generators
+        arrival_type m_arrival_type{arrival_type::poisson};
+        /// Maximum number of functions agents execute together in a
+        /// speculative batch under a single ticket. Speculative execution is
+        /// disabled if less than two.
+        size_t m_speculative_batch_size{0};
+        /// Maximum number of speculative batches each agent server executes
+        /// at once. Each batch runs under its own ticket, so conflicts
+        /// between concurrent batches are resolved by the shards as for
+        /// any other tickets.
+        size_t m_speculative_batch_concurrency{4};
+        /// Number of worker threads in the agent thread pool. EVM
+        /// executions hold a worker while waiting on the broker, so this
+        /// bounds how many functions the agent executes at once. The pool
+        /// always has more workers than the speculative batch size so a
+        /// batch cannot starve itself.
+        size_t m_agent_threads{128};
     };
 
     /// Reads the configuration parameters from the program arguments.
@@ -0,0 +1,289 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "block_store.hpp"
+
+#include "util/serialization/buffer_serializer.hpp"
+#include "util/serialization/format.hpp"
+#include "util/serialization/util.hpp"
+
+#include <array>
+#include <leveldb/write_batch.h>
+
+namespace cbdc::archiver {
+    leveldbWriteOptions::leveldbWriteOptions(bool do_sync) {
+        // Set base class member:
+        sync = do_sync;
+    }
+
+    const leveldbWriteOptions block_store::m_write_options{false};
+    const leveldbWriteOptions block_store::m_sync_write_options{true};
+
+    namespace {
+        /// Key prefixes separating the columns of the store.
+        enum class column : uint8_t {
+            /// Store metadata such as the best block height.
+            meta = 0,
+            /// Block transactions without attestations.
+            block = 1,
+            /// Attestations of each transaction in a block.
+            attestations = 2
+        };
+
+        using db_key = std::array<char, 1 + sizeof(uint64_t)>;
+
+        /// Key for the best block height in the metadata column.
+        constexpr uint64_t best_height_key = 0;
+
+        auto make_key(column col, uint64_t height) -> db_key {
+            auto key = db_key();
+            key[0] = static_cast<char>(col);
+            // Big-endian so that lexicographic key order is height order
+            for(size_t i = key.size() - 1; i > 0; i--) {
+                static constexpr uint64_t byte_mask = 0xff;
+                static constexpr uint64_t byte_bits = 8;
+                key[i] = static_cast<char>(height & byte_mask);
+                height >>= byte_bits;
+            }
+            return key;
+        }
+
+        auto parse_key(column col, const leveldb::Slice& key)
+            -> std::optional<uint64_t> {
+            if(key.size() != db_key().size()
+               || key.data()[0] != static_cast<char>(col)) {
+                return std::nullopt;
+            }
+            uint64_t height{};
+            for(size_t i = 1; i < key.size(); i++) {
+                static constexpr uint64_t byte_bits = 8;
+                height = (height << byte_bits)
+                       | static_cast<uint8_t>(key.data()[i]);
+            }
+            return height;
+        }
+
+        auto to_slice(const db_key& key) -> leveldb::Slice {
+            return {key.data(), key.size()};
+        }
+
+        auto to_slice(const cbdc::buffer& buf) -> leveldb::Slice {
+            return {buf.c_str(), buf.size()};
+        }
+
+        auto to_buffer(const leveldb::Slice& val) -> cbdc::buffer {
+            auto buf = cbdc::buffer();
+            buf.append(val.data(), val.size());
+            return buf;
+        }
+    }
+
+    block_store::block_store(std::string db_dir,
+                             options opts,
+                             std::shared_ptr<logging::log> logger)
+        : m_db_dir(std::move(db_dir)),
+          m_opts(opts),
+          m_logger(std::move(logger)) {}
+
+    auto block_store::init() -> bool {
+        leveldb::Options opt;
+        opt.create_if_missing = true;
+        opt.paranoid_checks = true;
+        opt.compression = m_opts.m_compression ? leveldb::kSnappyCompression
+                                               : leveldb::kNoCompression;
+
+        leveldb::DB* db_ptr{};
+        const auto res = leveldb::DB::Open(opt, m_db_dir, &db_ptr);
+        if(!res.ok()) {
+            m_logger->error(res.ToString());
+            return false;
+        }
+        m_db.reset(db_ptr);
+
+        std::string best_val;
+        const auto key = make_key(column::meta, best_height_key);
+        const auto best_res
+            = m_db->Get(m_read_options, to_slice(key), &best_val);
+        if(best_res.IsNotFound()) {
+            return true;
+        }
+        if(!best_res.ok()) {
+            m_logger->error(best_res.ToString());
+            return false;
+        }
+        auto buf = to_buffer(best_val);
+        auto best = from_buffer<uint64_t>(buf);
+        if(!best.has_value()) {
+            m_logger->error("Invalid best block height in archive");
+            return false;
+        }
+        m_best_height = best.value();
+        // Everything recovered from the database is durable
+        m_synced_height = best.value();
+        return true;
+    }
+
+    auto block_store::put(const atomizer::block& blk) -> bool {
+        auto blk_buf = cbdc::buffer();
+        auto blk_ser = buffer_serializer(blk_buf);
+        blk_ser << static_cast<uint64_t>(blk.m_transactions.size());
+        for(const auto& tx : blk.m_transactions) {
+            blk_ser << tx.m_id << tx.m_inputs << tx.m_uhs_outputs;
+        }
+
+        leveldb::WriteBatch batch;
+        const auto blk_key = make_key(column::block, blk.m_height);
+        batch.Put(to_slice(blk_key), to_slice(blk_buf));
+
+        auto att_buf = cbdc::buffer();
+        const auto att_key = make_key(column::attestations, blk.m_height);
+        if(m_opts.m_attestations) {
+            auto att_ser = buffer_serializer(att_buf);
+            att_ser << static_cast<uint64_t>(blk.m_transactions.size());
+            for(const auto& tx : blk.m_transactions) {
+                att_ser << tx.m_attestations;
+            }
+            batch.Put(to_slice(att_key), to_slice(att_buf));
+        }
+
+        const auto best_buf = make_buffer(blk.m_height);
+        const auto best_key = make_key(column::meta, best_height_key);
+        batch.Put(to_slice(best_key), to_slice(best_buf));
+
+        const auto do_sync = ++m_unsynced >= m_opts.m_sync_interval;
+        const auto res = m_db->Write(
+            do_sync ? m_sync_write_options : m_write_options,
+            &batch);
+        if(!res.ok()) {
+            m_logger->error("Failed to write block",
+                            blk.m_height,
+                            res.ToString());
+            return false;
+        }
+
+        m_best_height = blk.m_height;
+        if(do_sync) {
+            m_unsynced = 0;
+            m_synced_height = blk.m_height;
+        }
+        return true;
+    }
+
+    auto block_store::sync() -> bool {
+        if(m_unsynced == 0) {
+            return true;
+        }
+        // LevelDB syncs its whole log when writing a synced batch, so
+        // rewriting the best block height makes all prior writes durable
+        const auto best = m_best_height.load();
+        const auto best_buf = make_buffer(best);
+        const auto best_key = make_key(column::meta, best_height_key);
+        const auto res = m_db->Put(m_sync_write_options,
+                                   to_slice(best_key),
+                                   to_slice(best_buf));
+        if(!res.ok()) {
+            m_logger->error("Failed to sync archive", res.ToString());
+            return false;
+        }
+        m_unsynced = 0;
+        m_synced_height = best;
+        return true;
+    }
+
+    auto block_store::get(uint64_t height, bool attestations) const
+        -> std::optional<atomizer::block> {
+        std::string blk_str;
+        const auto key = make_key(column::block, height);
+        const auto res = m_db->Get(m_read_options, to_slice(key), &blk_str);
+        if(!res.ok()) {
+            return std::nullopt;
+        }
+        return decode_block(height, blk_str, attestations);
+    }
+
+    auto block_store::get_range(uint64_t start_height,
+                                uint64_t count,
+                                bool attestations) const
+        -> std::vector<atomizer::block> {
+        auto ret = std::vector<atomizer::block>();
+        auto it = std::unique_ptr<leveldb::Iterator>(
+            m_db->NewIterator(m_read_options));
+        const auto start_key = make_key(column::block, start_height);
+        auto expected = start_height;
+        for(it->Seek(to_slice(start_key)); it->Valid() && ret.size() < count;
+            it->Next()) {
+            const auto height = parse_key(column::block, it->key());
+            if(!height.has_value() || height.value() != expected) {
+                break;
+            }
+            auto blk = decode_block(expected, it->value(), attestations);
+            if(!blk.has_value()) {
+                break;
+            }
+            ret.emplace_back(std::move(blk.value()));
+            expected++;
+        }
+        return ret;
+    }
+
+    auto block_store::best_height() const -> uint64_t {
+        return m_best_height;
+    }
+
+    auto block_store::synced_height() const -> uint64_t {
+        return m_synced_height;
+    }
+
+    auto block_store::decode_block(uint64_t height,
+                                   const leveldb::Slice& val,
+                                   bool attestations) const
+        -> std::optional<atomizer::block> {
+        auto blk = atomizer::block();
+        blk.m_height = height;
+
+        auto blk_buf = to_buffer(val);
+        auto deser = buffer_serializer(blk_buf);
+        uint64_t n_txs{};
+        deser >> n_txs;
+        for(uint64_t i = 0; deser && i < n_txs; i++) {
+            auto tx = transaction::compact_tx();
+            deser >> tx.m_id >> tx.m_inputs >> tx.m_uhs_outputs;
+            blk.m_transactions.emplace_back(std::move(tx));
+        }
+        if(!deser) {
+            m_logger->error("Invalid archived block", height);
+            return std::nullopt;
+        }
+
+        if(!attestations || !m_opts.m_attestations) {
+            return blk;
+        }
+
+        std::string att_str;
+        const auto att_key = make_key(column::attestations, height);
+        const auto res
+            = m_db->Get(m_read_options, to_slice(att_key), &att_str);
+        if(!res.ok()) {
+            // The block was archived while attestations were not stored
+            return blk;
+        }
+        auto att_buf = to_buffer(att_str);
+        auto att_deser = buffer_serializer(att_buf);
+        uint64_t n_atts{};
+        att_deser >> n_atts;
+        if(n_atts != blk.m_transactions.size()) {
+            m_logger->error("Invalid archived attestations", height);
+            return std::nullopt;
+        }
+        for(auto& tx : blk.m_transactions) {
+            att_deser >> tx.m_attestations;
+        }
+        if(!att_deser) {
+            m_logger->error("Invalid archived attestations", height);
+            return std::nullopt;
+        }
+        return blk;
+    }
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_ARCHIVER_BLOCK_STORE_H_
+#define OPENCBDC_TX_SRC_ARCHIVER_BLOCK_STORE_H_
+
+#include "uhs/atomizer/atomizer/block.hpp"
+#include "util/common/logging.hpp"
+
+#include <atomic>
+#include <leveldb/db.h>
+#include <optional>
+#include <vector>
+
+namespace cbdc::archiver {
+    /// @brief  Wrapper for leveldb::WriteOptions to provide a constructor to
+    /// set base class member "sync". The base class default constructor is
+    /// built with "= default;", and as a result - in c++20 - the single
+    /// parameter constructor is not available.
+    struct leveldbWriteOptions : public leveldb::WriteOptions {
+        explicit leveldbWriteOptions(bool do_sync);
+    };
+
+    /// \brief LevelDB archive of atomizer blocks.
+    ///
+    /// Blocks are keyed by their big-endian height so that key order is
+    /// height order and ranges of blocks can be read with one iterator.
+    /// Transactions are stored without their sentinel attestations, which
+    /// are kept under a separate key per block and only read on request, or
+    /// are not stored at all. Writes are only synced to disk once every sync
+    /// interval blocks; \ref synced_height reports the highest block which
+    /// is known to be durable.
+    ///
+    /// One thread may write to the store while others read from it.
+    class block_store {
+      public:
+        /// Block store options.
+        struct options {
+            /// Compress stored values.
+            bool m_compression{false};
+            /// Store the sentinel attestations of each transaction.
+            bool m_attestations{true};
+            /// Number of blocks to write between syncs to disk.
+            size_t m_sync_interval{1};
+        };
+
+        /// Constructor.
+        /// \param db_dir path to the LevelDB database directory.
+        /// \param opts block store options.
+        /// \param logger pointer to shared logger.
+        block_store(std::string db_dir,
+                    options opts,
+                    std::shared_ptr<logging::log> logger);
+
+        /// Opens the database, creating it if it does not exist, and loads
+        /// the best block height.
+        /// \return true if the database was opened successfully.
+        auto init() -> bool;
+
+        /// Stores a block and sets it as the best block. Syncs the write to
+        /// disk if the sync interval has been reached.
+        /// \param blk block to store. Must have a height one above the
+        ///            current best block height.
+        /// \return true if the block was written.
+        auto put(const atomizer::block& blk) -> bool;
+
+        /// Syncs all previously written blocks to disk.
+        /// \return true if the sync succeeded.
+        auto sync() -> bool;
+
+        /// Returns the block at the given height.
+        /// \param height height of the block to return.
+        /// \param attestations true if the returned transactions should
+        ///                     include their stored sentinel attestations.
+        /// \return the block, or std::nullopt if the store does not contain
+        ///         a block at the given height.
+        auto get(uint64_t height, bool attestations) const
+            -> std::optional<atomizer::block>;
+
+        /// Returns contiguous blocks starting at the given height.
+        /// \param start_height height of the first block to return.
+        /// \param count maximum number of blocks to return.
+        /// \param attestations true if the returned transactions should
+        ///                     include their stored sentinel attestations.
+        /// \return blocks in height order, stopping at the best block or
+        ///         after count blocks. Empty if the store does not contain
+        ///         the block at start_height.
+        auto get_range(uint64_t start_height,
+                       uint64_t count,
+                       bool attestations) const
+            -> std::vector<atomizer::block>;
+
+        /// Returns the height of the most recently stored block.
+        /// \return best block height, or zero if the store is empty.
+        [[nodiscard]] auto best_height() const -> uint64_t;
+
+        /// Returns the height of the most recent block which has been synced
+        /// to disk.
+        /// \return synced block height, or zero if no block has been synced.
+        [[nodiscard]] auto synced_height() const -> uint64_t;
+
+      private:
+        std::string m_db_dir;
+        options m_opts;
+        std::shared_ptr<logging::log> m_logger;
+
+        std::unique_ptr<leveldb::DB> m_db;
+        std::atomic<uint64_t> m_best_height{0};
+        std::atomic<uint64_t> m_synced_height{0};
+        size_t m_unsynced{0};
+
+        static constexpr const leveldb::ReadOptions m_read_options{};
+        static const leveldbWriteOptions m_write_options;
+        static const leveldbWriteOptions m_sync_write_options;
+
+        auto decode_block(uint64_t height,
+                          const leveldb::Slice& val,
+                          bool attestations) const
+            -> std::optional<atomizer::block>;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_ARCHIVER_BLOCK_STORE_H_
@@ -5,6 +5,7 @@
 
 #include "client.hpp"
 
+#include "format.hpp"
 #include "uhs/atomizer/atomizer/format.hpp"
 #include "util/serialization/format.hpp"
 
@@ -23,7 +24,7 @@ namespace cbdc::archiver {
     auto client::get_block(uint64_t height)
         -> std::optional<cbdc::atomizer::block> {
         m_logger->info("Requesting block", height, "from archiver...");
-        if(!m_sock.send(height)) {
+        if(!m_sock.send(request{height})) {
             m_logger->error("Error requesting block from archiver.");
             return std::nullopt;
         }
@@ -43,4 +44,34 @@ namespace cbdc::archiver {
 
         return resp.value();
     }
+
+    auto client::get_blocks(uint64_t start_height,
+                            uint64_t count,
+                            bool attestations)
+        -> std::optional<std::vector<cbdc::atomizer::block>> {
+        m_logger->info("Requesting",
+                       count,
+                       "blocks from height",
+                       start_height,
+                       "from archiver...");
+        auto req = range_request{start_height, count, attestations};
+        if(!m_sock.send(request{req})) {
+            m_logger->error("Error requesting blocks from archiver.");
+            return std::nullopt;
+        }
+
+        cbdc::buffer resp_pkt;
+        if(!m_sock.receive(resp_pkt)) {
+            m_logger->error("Error receiving blocks from archiver.");
+            return std::nullopt;
+        }
+
+        auto resp = cbdc::from_buffer<range_response>(resp_pkt);
+        if(!resp.has_value()) {
+            m_logger->error("Invalid response packet");
+            return std::nullopt;
+        }
+
+        return resp.value();
+    }
 }
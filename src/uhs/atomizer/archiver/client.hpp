@@ -10,13 +10,32 @@
 #include "util/common/logging.hpp"
 #include "util/network/tcp_socket.hpp"
 
+#include <variant>
+
 namespace cbdc::archiver {
-    /// Height of the block to fetch from the archiver.
-    using request = uint64_t;
+    /// Request for a contiguous range of blocks from the archiver.
+    struct range_request {
+        /// Height of the first block to fetch.
+        uint64_t m_start_height{};
+        /// Maximum number of blocks to fetch. The archiver may return fewer
+        /// blocks than requested.
+        uint64_t m_count{};
+        /// True if the returned transactions should include their sentinel
+        /// attestations.
+        bool m_attestations{false};
+    };
+
+    /// Height of the block to fetch from the archiver, or a range of blocks
+    /// to fetch.
+    using request = std::variant<uint64_t, range_request>;
 
     /// The requested block, or std::nullopt if not found.
     using response = std::optional<cbdc::atomizer::block>;
 
+    /// The requested blocks in height order. Empty if the archiver does not
+    /// have the first requested block.
+    using range_response = std::vector<cbdc::atomizer::block>;
+
     /// \brief Retrieves blocks from a remote archiver via the network.
     ///
     /// \warning Not thread-safe. Only one thread can use the client without
@@ -40,6 +59,19 @@ namespace cbdc::archiver {
         auto get_block(uint64_t height)
             -> std::optional<cbdc::atomizer::block>;
 
+        /// Retrieves a contiguous range of blocks from the archiver in one
+        /// request.
+        /// \param start_height height of the first block to retrieve.
+        /// \param count maximum number of blocks to retrieve.
+        /// \param attestations true if the returned transactions should
+        ///                     include their sentinel attestations.
+        /// \return blocks starting at start_height, possibly fewer than
+        ///         count, or std::nullopt if the request failed.
+        auto get_blocks(uint64_t start_height,
+                        uint64_t count,
+                        bool attestations = false)
+            -> std::optional<std::vector<cbdc::atomizer::block>>;
+
       private:
         network::tcp_socket m_sock;
         network::endpoint_t m_endpoint;
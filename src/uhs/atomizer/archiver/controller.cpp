@@ -5,22 +5,16 @@
 
 #include "controller.hpp"
 
+#include "format.hpp"
 #include "uhs/atomizer/atomizer/format.hpp"
+#include "util/common/variant_overloaded.hpp"
 #include "util/serialization/format.hpp"
 #include "util/serialization/util.hpp"
 
-#include <leveldb/write_batch.h>
+#include <algorithm>
 #include <utility>
 
 namespace cbdc::archiver {
-
-    leveldbWriteOptions::leveldbWriteOptions(bool do_sync) {
-        // Set base class member:
-        sync = do_sync;
-    }
-
-    const leveldbWriteOptions controller::m_write_options{true};
-
     controller::controller(uint32_t archiver_id,
                            cbdc::config::options opts,
                            std::shared_ptr<logging::log> log,
@@ -28,6 +22,11 @@ namespace cbdc::archiver {
         : m_archiver_id(archiver_id),
           m_opts(std::move(opts)),
           m_logger(std::move(log)),
+          m_store(m_opts.m_archiver_db_dirs[m_archiver_id],
+                  {m_opts.m_archiver_compression,
+                   m_opts.m_archiver_attestations,
+                   m_opts.m_archiver_sync_interval},
+                  m_logger),
           m_max_samples(max_samples) {}
 
     controller::~controller() {
@@ -43,6 +42,10 @@ namespace cbdc::archiver {
         if(m_archiver_server.joinable()) {
             m_archiver_server.join();
         }
+
+        if(!m_store.sync()) {
+            m_logger->error("Failed to sync archived blocks");
+        }
     }
 
     auto controller::init() -> bool {
@@ -65,37 +68,12 @@ namespace cbdc::archiver {
     }
 
     auto controller::init_leveldb() -> bool {
-        leveldb::Options opt;
-        opt.create_if_missing = true;
-        opt.paranoid_checks = true;
-        opt.compression = leveldb::kNoCompression;
-
-        leveldb::DB* db_ptr{};
-        const auto res
-            = leveldb::DB::Open(opt,
-                                m_opts.m_archiver_db_dirs[m_archiver_id],
-                                &db_ptr);
-        if(!res.ok()) {
-            m_logger->error(res.ToString());
-            return false;
-        }
-        m_db.reset(db_ptr);
-        return true;
+        return m_store.init();
     }
 
     auto controller::init_best_block() -> bool {
-        std::string bestblock_val;
-        const auto blk_res
-            = m_db->Get(m_read_options, m_bestblock_key, &bestblock_val);
-        if(blk_res.IsNotFound()) {
-            bestblock_val = std::to_string(0);
-            const auto wr_res
-                = m_db->Put(m_write_options, m_bestblock_key, bestblock_val);
-            if(!wr_res.ok()) {
-                return false;
-            }
-        }
-        m_best_height = static_cast<uint64_t>(std::stoul(bestblock_val));
+        m_best_height = m_store.best_height();
+        m_prune_height = m_store.synced_height();
         return true;
     }
 
@@ -151,8 +129,14 @@ namespace cbdc::archiver {
             m_logger->error("Invalid request packet");
             return std::nullopt;
         }
-        auto blk = get_block(req.value());
-        return cbdc::make_buffer(blk);
+        return std::visit(
+            overloaded{[&](uint64_t height) {
+                           return cbdc::make_buffer(get_block(height));
+                       },
+                       [&](const range_request& r) {
+                           return cbdc::make_buffer(get_blocks(r));
+                       }},
+            req.value());
     }
 
     auto controller::atomizer_handler(cbdc::network::message_t&& pkt)
@@ -178,13 +162,7 @@ namespace cbdc::archiver {
         if(m_best_height == 0) {
             // This is the first call to digest_block. Check if there is
             // already a best height value in the database and set it if so.
-            std::string bestblock_val;
-            const auto blk_res
-                = m_db->Get(m_read_options, m_bestblock_key, &bestblock_val);
-            if(blk_res.ok()) {
-                m_best_height
-                    = static_cast<uint64_t>(std::stoul(bestblock_val));
-            }
+            m_best_height = m_store.best_height();
         }
 
         cbdc::atomizer::block next_blk;
@@ -207,22 +185,13 @@ namespace cbdc::archiver {
                 return;
             }
 
-            leveldb::WriteBatch batch;
-
             m_logger->trace("Digesting block ", blk.m_height, "... ");
 
-            auto blk_bytes = make_buffer(blk);
-            leveldb::Slice blk_slice(blk_bytes.c_str(), blk_bytes.size());
-
-            const auto height_str = std::to_string(blk.m_height);
-
-            batch.Put(height_str, blk_slice);
-            batch.Put(m_bestblock_key, height_str);
+            if(!m_store.put(blk)) {
+                return;
+            }
             m_best_height++;
 
-            const auto res = m_db->Write(m_write_options, &batch);
-            assert(res.ok());
-
             m_logger->trace("Digested block ", blk.m_height);
             if(m_sample_collection_active) {
                 const auto old_block_time = m_last_block_time;
@@ -237,9 +206,14 @@ namespace cbdc::archiver {
                 m_samples++;
             }
 
-            // Tell the atomizer cluster to prune all blocks <
-            // m_best_height
-            request_prune(m_best_height);
+            // Tell the atomizer cluster to prune all blocks below the
+            // highest block synced to disk. Unsynced blocks may be lost if
+            // the archiver host fails and must be requested again.
+            const auto synced_height = m_store.synced_height();
+            if(synced_height > m_prune_height) {
+                m_prune_height = synced_height;
+                request_prune(m_prune_height);
+            }
 
             auto it = m_deferred.find(blk.m_height + 1);
             if(it != m_deferred.end()) {
@@ -261,26 +235,32 @@ namespace cbdc::archiver {
     auto controller::get_block(uint64_t height)
         -> std::optional<cbdc::atomizer::block> {
         m_logger->trace(__func__, "(", height, ")");
-        std::string height_str = std::to_string(height);
-        std::string blk_str;
-        // Assume blocks with 100k 256-byte transactions.
-        static constexpr const auto expected_entry_sz = 256 * 100000;
-        blk_str.reserve(expected_entry_sz);
-        auto s = m_db->Get(m_read_options, height_str, &blk_str);
-
-        if(!s.ok()) {
+        auto blk = m_store.get(height, true);
+        if(!blk.has_value()) {
             m_logger->warn("block", height, "not found");
             m_logger->trace("end", __func__);
 
             return std::nullopt;
         }
 
-        auto buf = cbdc::buffer();
-        buf.append(blk_str.data(), blk_str.size());
-        auto blk = from_buffer<atomizer::block>(buf);
-        assert(blk.has_value());
         m_logger->trace("found block", height, "-", blk.value().m_height);
-        return blk.value();
+        return blk;
+    }
+
+    auto controller::get_blocks(const range_request& req)
+        -> std::vector<cbdc::atomizer::block> {
+        m_logger->trace(__func__,
+                        "(",
+                        req.m_start_height,
+                        ",",
+                        req.m_count,
+                        ")");
+        const auto count = std::min(
+            req.m_count,
+            static_cast<uint64_t>(m_opts.m_archiver_range_limit));
+        return m_store.get_range(req.m_start_height,
+                                 count,
+                                 req.m_attestations);
     }
 
     void controller::request_block(uint64_t height) {
@@ -6,23 +6,13 @@
 #ifndef OPENCBDC_TX_SRC_ARCHIVER_CONTROLLER_H_
 #define OPENCBDC_TX_SRC_ARCHIVER_CONTROLLER_H_
 
+#include "block_store.hpp"
 #include "client.hpp"
 #include "uhs/atomizer/atomizer/block.hpp"
 #include "util/common/config.hpp"
 #include "util/network/connection_manager.hpp"
 
-#include <leveldb/db.h>
-
 namespace cbdc::archiver {
-
-    /// @brief  Wrapper for leveldb::WriteOptions to provide a constructor to
-    /// set base class member "sync". The base class default constructor is
-    /// built with "= default;", and as a result - in c++20 - the single
-    /// parameter constructor is not available.
-    struct leveldbWriteOptions : public leveldb::WriteOptions {
-        explicit leveldbWriteOptions(bool do_sync);
-    };
-
     /// \brief Wrapper for the archiver executable implementation.
     ///
     /// Connects to the atomizer cluster to receive new blocks and listens for
@@ -51,7 +41,7 @@ namespace cbdc::archiver {
         /// \return true if initialization succeeded.
         auto init() -> bool;
 
-        /// Initializes the LevelDB database.
+        /// Initializes the LevelDB block store.
         /// \return true if initialization succeeded.
         auto init_leveldb() -> bool;
 
@@ -75,9 +65,11 @@ namespace cbdc::archiver {
         /// \return best block height.
         [[nodiscard]] auto best_block_height() const -> uint64_t;
 
-        /// Receives a request for an archived block and returns the block.
+        /// Receives a request for an archived block or range of blocks and
+        /// returns the requested blocks.
         /// \param pkt packet containing the request.
-        /// \return block or std::nullopt from \ref get_block.
+        /// \return block or std::nullopt from \ref get_block, or blocks from
+        ///         \ref get_blocks.
         /// \see \ref network::packet_handler_t
         auto server_handler(cbdc::network::message_t&& pkt)
             -> std::optional<cbdc::buffer>;
@@ -99,7 +91,8 @@ namespace cbdc::archiver {
         /// processing cache until receiving the next contiguous block, then
         /// digests each block in order.
         ///
-        /// Instructs connected atomizers to prune digested blocks.
+        /// Instructs connected atomizers to prune digested blocks once they
+        /// have been synced to disk.
         /// \param blk block to digest.
         void digest_block(const cbdc::atomizer::block& blk);
 
@@ -111,6 +104,14 @@ namespace cbdc::archiver {
         auto get_block(uint64_t height)
             -> std::optional<cbdc::atomizer::block>;
 
+        /// Queries the archiver database for a contiguous range of blocks.
+        /// Returns at most the configured range limit of blocks.
+        /// \param req range of blocks to retrieve.
+        /// \return blocks in height order, starting at the requested height.
+        ///         Empty if the database does not contain the first block.
+        auto get_blocks(const range_request& req)
+            -> std::vector<cbdc::atomizer::block>;
+
         /// \brief Returns true if this archiver is receiving blocks
         /// from the atomizer.
         ///
@@ -124,8 +125,9 @@ namespace cbdc::archiver {
         cbdc::config::options m_opts;
         std::shared_ptr<logging::log> m_logger;
 
-        std::unique_ptr<leveldb::DB> m_db;
+        block_store m_store;
         uint64_t m_best_height{0};
+        uint64_t m_prune_height{0};
         /// Blocks pending digestion, waiting for the archiver to digest
         /// preceding blocks from the atomizer, keyed by height.
         /// \see \ref digest_block
@@ -145,10 +147,6 @@ namespace cbdc::archiver {
 
         std::atomic_bool m_running{true};
 
-        const std::string m_bestblock_key = "bestblock";
-        static constexpr const leveldb::ReadOptions m_read_options{};
-        static const leveldbWriteOptions m_write_options;
-
         void request_block(uint64_t height);
         void request_prune(uint64_t height);
     };
@@ -0,0 +1,20 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "format.hpp"
+
+namespace cbdc {
+    auto operator<<(serializer& ser, const archiver::range_request& req)
+        -> serializer& {
+        return ser << req.m_start_height << req.m_count
+                   << req.m_attestations;
+    }
+
+    auto operator>>(serializer& deser, archiver::range_request& req)
+        -> serializer& {
+        return deser >> req.m_start_height >> req.m_count
+            >> req.m_attestations;
+    }
+}
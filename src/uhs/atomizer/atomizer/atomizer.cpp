@@ -10,20 +10,49 @@
 #include "util/serialization/buffer_serializer.hpp"
 #include "util/serialization/format.hpp"
 
+#include <algorithm>
+
 namespace cbdc::atomizer {
+    namespace {
+        /// Serializes the elements of a bucketed container with the same
+        /// layout as a single container holding them all.
+        template<typename T>
+        void serialize_buckets(serializer& ser,
+                               const bucketed_copy_on_write<T>& c) {
+            ser << static_cast<uint64_t>(c.size());
+            for(const auto& b : c.buckets()) {
+                for(const auto& elem : b.get()) {
+                    ser << elem;
+                }
+            }
+        }
+    }
+
     auto atomizer::make_block()
         -> std::pair<block, std::vector<cbdc::watchtower::tx_error>> {
         block blk;
 
-        blk.m_transactions.swap(m_complete_txs);
+        // Chunks shared with a snapshot are copied, the rest are moved
+        if(!m_complete_txs.empty()) {
+            blk.m_transactions.swap(m_complete_txs.front().mut());
+        }
+        for(size_t i = 1; i < m_complete_txs.size(); i++) {
+            auto& txs = m_complete_txs[i].mut();
+            blk.m_transactions.insert(blk.m_transactions.end(),
+                                      std::make_move_iterator(txs.begin()),
+                                      std::make_move_iterator(txs.end()));
+        }
+        m_complete_txs.clear();
 
         m_best_height++;
 
         std::vector<cbdc::watchtower::tx_error> errs;
-        for(auto&& tx : m_txs[m_spent_cache_depth]) {
-            errs.push_back(cbdc::watchtower::tx_error{
-                tx.first.m_id,
-                cbdc::watchtower::tx_error_incomplete{}});
+        for(const auto& b : m_txs[m_spent_cache_depth].buckets()) {
+            for(auto&& tx : b.get()) {
+                errs.push_back(cbdc::watchtower::tx_error{
+                    tx.first.m_id,
+                    cbdc::watchtower::tx_error_incomplete{}});
+            }
         }
 
         for(size_t i = m_spent_cache_depth; i > 0; i--) {
@@ -31,8 +60,8 @@ namespace cbdc::atomizer {
             m_txs[i] = std::move(m_txs[i - 1]);
         }
 
-        m_spent[0].clear();
-        m_txs[0].clear();
+        m_spent[0] = bucketed_copy_on_write<spent_type>();
+        m_txs[0] = bucketed_copy_on_write<pending_txs_type>();
         static constexpr auto initial_spent_cache_size = 500000;
         m_spent[0].reserve(initial_spent_cache_size);
 
@@ -55,13 +84,13 @@ namespace cbdc::atomizer {
         // Search the incomplete transactions vector for this notification's
         // block height offset. Note, we might be able to defer this insertion
         // until after we've checked if the transaction is complete.
-        auto it = m_txs[height_offset].find(tx);
-        if(it == m_txs[height_offset].end()) {
+        auto& pending = m_txs[height_offset].mut(tx);
+        auto it = pending.find(tx);
+        if(it == pending.end()) {
             // If we did not already receive a notification of this transaction
             // for its height offset, insert the transaction and its
             // attestations into the pending vector.
-            it = m_txs[height_offset]
-                     .insert({std::move(tx), std::move(attestations)})
+            it = pending.insert({std::move(tx), std::move(attestations)})
                      .first;
         } else {
             // Otherwise merge the new set of attestations with the existing
@@ -71,32 +100,36 @@ namespace cbdc::atomizer {
 
         std::unordered_set<uint32_t> total_attestations;
         size_t oldest_attestation{0};
-        std::map<size_t, decltype(m_txs)::value_type::const_iterator> tx_its;
+        std::map<size_t,
+                 std::pair<pending_txs_type*, pending_txs_type::const_iterator>>
+            tx_its;
 
         // Iterate over each height offset in the incomplete transactions
         // vector to accumulate the sets of attestations received for any
         // offset in our cache.
         for(size_t offset = 0; offset <= m_spent_cache_depth; offset++) {
-            const auto& tx_map = m_txs[offset];
-
             // Check if we received a notification of this TX for the given
-            // height offset.
-            const auto tx_it = tx_map.find(it->first);
-            if(tx_it != tx_map.end()) {
-                // Merge the attestations from this offset with the full set of
-                // attestations so far.
-                total_attestations.insert(tx_it->second.begin(),
-                                          tx_it->second.end());
-
-                // Keep track of the oldest height offset that we're using
-                // an attestation from.
-                oldest_attestation = offset;
-
-                // Store the iterator to the transaction in the incomplete TXs
-                // vector for the given height offset so we can quickly access
-                // it later.
-                tx_its.emplace(offset, tx_it);
+            // height offset. Only take a private copy of the map if so, as
+            // the iterator may be used below to modify it.
+            if(!m_txs[offset].get(it->first).contains(it->first)) {
+                continue;
             }
+            auto& tx_map = m_txs[offset].mut(it->first);
+            const auto tx_it = tx_map.find(it->first);
+
+            // Merge the attestations from this offset with the full set of
+            // attestations so far.
+            total_attestations.insert(tx_it->second.begin(),
+                                      tx_it->second.end());
+
+            // Keep track of the oldest height offset that we're using
+            // an attestation from.
+            oldest_attestation = offset;
+
+            // Store the iterator to the transaction in the incomplete TXs
+            // vector for the given height offset so we can quickly access
+            // it later.
+            tx_its.emplace(offset, std::make_pair(&tx_map, tx_it));
         }
 
         const auto& txit = it->first;
@@ -117,13 +150,13 @@ namespace cbdc::atomizer {
             // recovered while accumulating attestations, either extract the TX
             // from the oldest notification and move it to the complete TXs
             // vector, or erase the TX notification.
-            for(const auto& pending_offset : tx_its) {
-                if(pending_offset.first == oldest_attestation) {
-                    auto tx_ext = m_txs[pending_offset.first].extract(
-                        pending_offset.second);
-                    m_complete_txs.push_back(std::move(tx_ext.key()));
+            for(const auto& [offset, pos] : tx_its) {
+                auto& [tx_map, tx_it] = pos;
+                if(offset == oldest_attestation) {
+                    auto tx_ext = tx_map->extract(tx_it);
+                    add_complete_tx(std::move(tx_ext.key()));
                 } else {
-                    m_txs[pending_offset.first].erase(pending_offset.second);
+                    tx_map->erase(tx_it);
                 }
             }
         }
@@ -150,13 +183,17 @@ namespace cbdc::atomizer {
 
         add_tx_to_stxo_cache(tx);
 
-        m_complete_txs.push_back(std::move(tx));
+        add_complete_tx(std::move(tx));
 
         return std::nullopt;
     }
 
     auto atomizer::pending_transactions() const -> size_t {
-        return m_complete_txs.size();
+        size_t ret{0};
+        for(const auto& chunk : m_complete_txs) {
+            ret += chunk.get().size();
+        }
+        return ret;
     }
 
     auto atomizer::height() const -> uint64_t {
@@ -175,26 +212,96 @@ namespace cbdc::atomizer {
         auto buf = cbdc::buffer();
         auto ser = cbdc::buffer_serializer(buf);
 
-        ser << static_cast<uint64_t>(m_spent_cache_depth) << m_best_height
-            << m_complete_txs << m_spent << m_txs;
+        ser << static_cast<uint64_t>(m_spent_cache_depth) << m_best_height;
+
+        // Same layout as serializing vectors of the underlying containers
+        ser << static_cast<uint64_t>(pending_transactions());
+        for(const auto& chunk : m_complete_txs) {
+            for(const auto& tx : chunk.get()) {
+                ser << tx;
+            }
+        }
+        ser << static_cast<uint64_t>(m_spent.size());
+        for(const auto& spent : m_spent) {
+            serialize_buckets(ser, spent);
+        }
+        ser << static_cast<uint64_t>(m_txs.size());
+        for(const auto& txs : m_txs) {
+            serialize_buckets(ser, txs);
+        }
 
         return buf;
     }
 
     void atomizer::deserialize(cbdc::serializer& buf) {
-        m_complete_txs.clear();
+        auto complete_txs = complete_txs_type();
+        auto spent = std::vector<spent_type>();
+        auto txs = std::vector<pending_txs_type>();
 
-        m_spent.clear();
+        buf >> m_spent_cache_depth >> m_best_height >> complete_txs >> spent
+            >> txs;
 
+        m_complete_txs.clear();
+        if(!complete_txs.empty()) {
+            m_complete_txs.emplace_back(std::move(complete_txs));
+        }
+        m_spent.clear();
+        for(auto& s : spent) {
+            m_spent.emplace_back(std::move(s));
+        }
         m_txs.clear();
+        for(auto& t : txs) {
+            m_txs.emplace_back(std::move(t));
+        }
+    }
 
-        buf >> m_spent_cache_depth >> m_best_height >> m_complete_txs
-            >> m_spent >> m_txs;
+    auto atomizer::snapshot() -> std::shared_ptr<atomizer> {
+        auto ret = std::make_shared<atomizer>(m_best_height,
+                                              m_spent_cache_depth);
+        for(auto& chunk : m_complete_txs) {
+            ret->m_complete_txs.emplace_back(chunk.share());
+        }
+        for(size_t i = 0; i < m_spent.size(); i++) {
+            ret->m_spent[i] = m_spent[i].share();
+        }
+        for(size_t i = 0; i < m_txs.size(); i++) {
+            ret->m_txs[i] = m_txs[i].share();
+        }
+        return ret;
     }
 
     auto atomizer::operator==(const atomizer& other) const -> bool {
-        return m_txs == other.m_txs && m_complete_txs == other.m_complete_txs
-            && m_spent == other.m_spent && m_best_height == other.m_best_height
+        if(m_txs.size() != other.m_txs.size()
+           || m_spent.size() != other.m_spent.size()) {
+            return false;
+        }
+        if(m_txs != other.m_txs || m_spent != other.m_spent) {
+            return false;
+        }
+
+        // Equal atomizers may split their complete transactions into
+        // different chunks
+        auto complete_txs = [](const atomizer& atm) {
+            auto ret = std::vector<const transaction::compact_tx*>();
+            for(const auto& chunk : atm.m_complete_txs) {
+                for(const auto& tx : chunk.get()) {
+                    ret.push_back(&tx);
+                }
+            }
+            return ret;
+        };
+        auto txs = complete_txs(*this);
+        auto other_txs = complete_txs(other);
+        if(!std::equal(txs.begin(),
+                       txs.end(),
+                       other_txs.begin(),
+                       other_txs.end(),
+                       [](const auto* a, const auto* b) {
+                           return *a == *b;
+                       })) {
+            return false;
+        }
+        return m_best_height == other.m_best_height
             && m_spent_cache_depth == other.m_spent_cache_depth;
     }
 
@@ -227,7 +334,7 @@ namespace cbdc::atomizer {
         auto err_set = std::unordered_set<hash_t, hashing::null>{};
         for(size_t offset = 0; offset <= cache_check_range; offset++) {
             for(const auto& inp : tx.m_inputs) {
-                if(m_spent[offset].find(inp) != m_spent[offset].end()) {
+                if(m_spent[offset].get(inp).contains(inp)) {
                     err_set.insert(inp);
                 }
             }
@@ -246,6 +353,18 @@ namespace cbdc::atomizer {
         // None of the inputs have previously been spent during block heights
         // we used attestations from, so spend all the TX inputs in the current
         // block height (offset 0).
-        m_spent[0].insert(tx.m_inputs.begin(), tx.m_inputs.end());
+        for(const auto& inp : tx.m_inputs) {
+            m_spent[0].mut(inp).insert(inp);
+        }
+    }
+
+    void atomizer::add_complete_tx(transaction::compact_tx&& tx) {
+        if(m_complete_txs.empty()
+           || m_complete_txs.back().get().size() >= m_complete_chunk_size) {
+            auto chunk = complete_txs_type();
+            chunk.reserve(m_complete_chunk_size);
+            m_complete_txs.emplace_back(std::move(chunk));
+        }
+        m_complete_txs.back().mut().push_back(std::move(tx));
     }
 }
@@ -9,6 +9,7 @@
 #include "block.hpp"
 #include "uhs/atomizer/watchtower/tx_error_messages.hpp"
 #include "uhs/transaction/transaction.hpp"
+#include "util/common/copy_on_write.hpp"
 #include "util/common/hashmap.hpp"
 
 #include <map>
@@ -113,19 +114,38 @@ namespace cbdc::atomizer {
         /// \param buf serialized atomizer state produced with \ref serialize.
         void deserialize(serializer& buf);
 
+        /// Returns a copy of the atomizer which shares its internal state
+        /// with this instance. Shared state is copied a bucket or chunk at a
+        /// time by whichever instance modifies it first, so taking a copy
+        /// costs O(STXO cache depth) rather than O(state size), and no
+        /// single modification afterwards copies a whole cache. The returned
+        /// copy may be read from another thread while this instance
+        /// continues to be modified.
+        /// \return copy of the atomizer.
+        [[nodiscard]] auto snapshot() -> std::shared_ptr<atomizer>;
+
         auto operator==(const atomizer& other) const -> bool;
 
       private:
-        std::vector<std::unordered_map<transaction::compact_tx,
-                                       std::unordered_set<uint32_t>,
-                                       transaction::compact_tx_hasher>>
-            m_txs;
+        using pending_txs_type
+            = std::unordered_map<transaction::compact_tx,
+                                 std::unordered_set<uint32_t>,
+                                 transaction::compact_tx_hasher>;
 
         // These maps should be keyed/salted for safety. For now they
         // use input values directly as an optimization.
-        std::vector<transaction::compact_tx> m_complete_txs;
+        using spent_type = std::unordered_set<hash_t, hashing::null>;
+
+        using complete_txs_type = std::vector<transaction::compact_tx>;
+
+        std::vector<bucketed_copy_on_write<pending_txs_type>> m_txs;
 
-        std::vector<std::unordered_set<hash_t, hashing::null>> m_spent;
+        // Split into chunks so appending after a snapshot only copies the
+        // last chunk
+        std::vector<copy_on_write<complete_txs_type>> m_complete_txs;
+        static constexpr size_t m_complete_chunk_size{4096};
+
+        std::vector<bucketed_copy_on_write<spent_type>> m_spent;
 
         uint64_t m_best_height{};
         size_t m_spent_cache_depth;
@@ -143,6 +163,8 @@ namespace cbdc::atomizer {
             -> std::optional<watchtower::tx_error>;
 
         void add_tx_to_stxo_cache(const transaction::compact_tx& tx);
+
+        void add_complete_tx(transaction::compact_tx&& tx);
     };
 }
 
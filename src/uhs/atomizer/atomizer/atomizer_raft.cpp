@@ -30,7 +30,8 @@ namespace cbdc::atomizer {
                logger,
                std::move(raft_callback)),
           m_log(std::move(logger)),
-          m_opts(std::move(opts)) {}
+          m_opts(std::move(opts)),
+          m_stxo_cache_depth(stxo_cache_depth) {}
 
     auto atomizer_raft::get_sm() -> state_machine* {
         // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
@@ -52,61 +53,148 @@ namespace cbdc::atomizer {
         return get_sm()->tx_notify_count();
     }
 
+    namespace {
+        /// Returns true if the given notifications carry the same
+        /// transaction contents and sentinel attestations.
+        auto same_contents(const transaction::compact_tx& a,
+                           const transaction::compact_tx& b) -> bool {
+            return a.m_inputs == b.m_inputs
+                && a.m_uhs_outputs == b.m_uhs_outputs
+                && a.m_attestations == b.m_attestations;
+        }
+    }
+
     void atomizer_raft::tx_notify(tx_notify_request&& notif) {
-        if(!transaction::validation::check_attestations(
-               notif.m_tx,
-               m_opts.m_sentinel_public_keys,
-               m_opts.m_attestation_threshold)) {
+        auto& part = partition_for(notif.m_tx.m_id);
+
+        // Whether this call verifies the sentinel attestations on behalf of
+        // identical notifications
+        auto verifier = false;
+        {
+            std::unique_lock l(part.m_mut);
+            if(part.m_completed.find(notif.m_tx.m_id)
+               != part.m_completed.end()) {
+                return;
+            }
+            auto it = part.m_txs.find(notif.m_tx);
+            if(it == part.m_txs.end()) {
+                // Entries only gain attestations once the contents they
+                // are keyed on have been verified
+                it = part.m_txs.emplace(notif.m_tx, pending_tx()).first;
+                it->second.m_verifying = true;
+                verifier = true;
+            } else if(same_contents(it->first, notif.m_tx)) {
+                if(!it->second.m_verified) {
+                    it->second.m_waiting.push_back(std::move(notif));
+                    return;
+                }
+                if(add_attestations(it, notif)) {
+                    finish_tx(part, it, l);
+                }
+                return;
+            }
+            // Otherwise the notification carries different transaction
+            // contents or attestations under the same ID, so verify it
+            // without affecting the other notifications
+        }
+
+        const auto valid = transaction::validation::check_attestations(
+            notif.m_tx,
+            m_opts.m_sentinel_public_keys,
+            m_opts.m_attestation_threshold);
+        if(!valid) {
             m_log->warn("Received invalid compact transaction",
                         to_string(notif.m_tx.m_id));
+        }
+
+        std::unique_lock l(part.m_mut);
+        if(part.m_completed.find(notif.m_tx.m_id) != part.m_completed.end()) {
             return;
         }
+        auto it = part.m_txs.find(notif.m_tx);
+        auto waiting = std::vector<tx_notify_request>();
+        if(verifier && it != part.m_txs.end()) {
+            it->second.m_verifying = false;
+            std::swap(waiting, it->second.m_waiting);
+        }
 
-        auto maybe_tx = [&]() -> std::optional<decltype(m_txs)::node_type> {
-            std::unique_lock l(m_txs_mut);
-            auto it = m_txs.find(notif.m_tx);
-            if(it != m_txs.end()) {
-                for(auto n : notif.m_attestations) {
-                    auto p = std::make_pair(n, notif.m_block_height);
-                    auto n_it = it->second.find(p);
-                    if((n_it != it->second.end()
-                        && n_it->second < notif.m_block_height)
-                       || n_it == it->second.end()) {
-                        it->second.insert(std::move(p));
-                    }
-                }
-            } else {
-                auto attestations = attestation_set();
-                attestations.reserve(notif.m_attestations.size());
-                for(auto n : notif.m_attestations) {
-                    attestations.insert(
-                        std::make_pair(n, notif.m_block_height));
-                }
-                it = m_txs
-                         .insert(std::make_pair(std::move(notif.m_tx),
-                                                std::move(attestations)))
-                         .first;
+        if(!valid) {
+            // Any waiting notifications carry the same invalid attestations.
+            // Unverified entries hold no attestations. Leave entries created
+            // by other notifications to their own verification.
+            if(verifier && it != part.m_txs.end() && !it->second.m_verified) {
+                part.m_txs.erase(it);
             }
+            return;
+        }
 
-            // TODO: handle notifications that never spill over due to lack of
-            //       attestations
-            if(it->second.size() != it->first.m_inputs.size()) {
-                return std::nullopt;
+        if(it == part.m_txs.end()) {
+            it = part.m_txs.emplace(notif.m_tx, pending_tx()).first;
+        }
+        if(!it->second.m_verified) {
+            if(!same_contents(it->first, notif.m_tx)) {
+                // The entry's own contents are still being verified. Key it
+                // on these instead so it completes with verified contents.
+                auto entry = part.m_txs.extract(it);
+                entry.key() = notif.m_tx;
+                it = part.m_txs.insert(std::move(entry)).position;
             }
+            it->second.m_verified = true;
+        }
 
-            auto tx = m_txs.extract(it);
-            return tx;
-        }();
+        auto complete = add_attestations(it, notif);
+        for(const auto& w : waiting) {
+            complete = add_attestations(it, w);
+        }
+        if(complete) {
+            finish_tx(part, it, l);
+        }
+    }
 
-        if(!maybe_tx.has_value()) {
-            return;
+    void atomizer_raft::finish_tx(pending_partition& part,
+                                  pending_map::iterator it,
+                                  std::unique_lock<std::mutex>& l) {
+        if(part.m_completed_blocks.empty()) {
+            part.m_completed_blocks.emplace_back();
         }
+        part.m_completed_blocks.back().push_back(it->first.m_id);
+        part.m_completed.insert(it->first.m_id);
+        auto tx = part.m_txs.extract(it);
+        l.unlock();
+        complete_tx(std::move(tx));
+    }
 
-        auto& tx = maybe_tx.value();
+    auto atomizer_raft::partition_for(const hash_t& tx_id)
+        -> pending_partition& {
+        // Transaction IDs are uniformly distributed. Use a byte the map
+        // hasher does not so partitions do not skew map buckets.
+        return m_partitions[tx_id.back() % m_partition_count];
+    }
+
+    auto atomizer_raft::add_attestations(pending_map::iterator it,
+                                         const tx_notify_request& notif)
+        -> bool {
+        auto& attestations = it->second.m_attestations;
+        for(auto n : notif.m_attestations) {
+            auto p = std::make_pair(n, notif.m_block_height);
+            auto n_it = attestations.find(p);
+            if((n_it != attestations.end()
+                && n_it->second < notif.m_block_height)
+               || n_it == attestations.end()) {
+                attestations.insert(std::move(p));
+            }
+        }
+
+        // TODO: handle notifications that never spill over due to lack of
+        //       attestations
+        return attestations.size() == it->first.m_inputs.size();
+    }
+
+    void atomizer_raft::complete_tx(pending_map::node_type&& tx) {
         auto agg = aggregate_tx_notification();
         agg.m_tx = std::move(tx.key());
         uint64_t oldest{0};
-        for(const auto& att : tx.mapped()) {
+        for(const auto& att : tx.mapped().m_attestations) {
             if(oldest == 0 || att.second < oldest) {
                 oldest = att.second;
             }
@@ -117,6 +205,15 @@ namespace cbdc::atomizer {
             std::lock_guard<std::mutex> l(m_complete_mut);
             m_complete_txs.push_back(std::move(agg));
         }
+        m_complete_cv.notify_one();
+    }
+
+    auto atomizer_raft::wait_for_complete_txs(std::chrono::milliseconds timeout)
+        -> bool {
+        std::unique_lock l(m_complete_mut);
+        return m_complete_cv.wait_for(l, timeout, [&]() {
+            return !m_complete_txs.empty();
+        });
     }
 
     auto atomizer_raft::send_complete_txs(const raft::callback_type& result_fn)
@@ -129,7 +226,45 @@ namespace cbdc::atomizer {
         if(atns.m_agg_txs.empty()) {
             return false;
         }
-        return make_request(atns, result_fn);
+        auto new_log
+            = make_buffer<state_machine::request, nuraft::ptr<nuraft::buffer>>(
+                atns);
+        {
+            std::lock_guard l(m_pending_mut);
+            m_pending_block.m_txs += atns.m_agg_txs.size();
+            m_pending_block.m_bytes += new_log->size();
+            if(!m_pending_block.m_since.has_value()) {
+                m_pending_block.m_since = std::chrono::steady_clock::now();
+            }
+        }
+        return replicate(new_log, result_fn);
+    }
+
+    auto atomizer_raft::get_pending_block() -> pending_block {
+        std::lock_guard l(m_pending_mut);
+        return m_pending_block;
+    }
+
+    auto atomizer_raft::take_pending_block() -> pending_block {
+        auto ret = [&]() {
+            std::lock_guard l(m_pending_mut);
+            return std::exchange(m_pending_block, pending_block());
+        }();
+
+        // Notifications older than the STXO cache depth are rejected by the
+        // state machine, so completed IDs need not be remembered longer
+        for(auto& part : m_partitions) {
+            std::lock_guard l(part.m_mut);
+            part.m_completed_blocks.emplace_back();
+            while(part.m_completed_blocks.size() > m_stxo_cache_depth) {
+                for(const auto& id : part.m_completed_blocks.front()) {
+                    part.m_completed.erase(id);
+                }
+                part.m_completed_blocks.pop_front();
+            }
+        }
+
+        return ret;
     }
 
     auto atomizer_raft::attestation_hash::operator()(
@@ -8,10 +8,16 @@
 
 #include "messages.hpp"
 #include "state_machine.hpp"
+#include "util/common/hashmap.hpp"
 #include "util/network/connection_manager.hpp"
 #include "util/raft/node.hpp"
 #include "util/raft/state_manager.hpp"
 
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+
 namespace cbdc::atomizer {
     /// \brief Manager for an atomizer raft node.
     ///
@@ -20,6 +26,17 @@ namespace cbdc::atomizer {
     /// machine execution result via a callback function once available.
     class atomizer_raft : public cbdc::raft::node {
       public:
+        /// Transaction notifications replicated since the last block was
+        /// requested.
+        struct pending_block {
+            /// Number of complete transactions.
+            size_t m_txs{};
+            /// Serialized size of the replicated notifications in bytes.
+            size_t m_bytes{};
+            /// Time the first notification was replicated, if any.
+            std::optional<std::chrono::steady_clock::time_point> m_since;
+        };
+
         /// Constructor.
         /// \param atomizer_id ID of the raft node.
         /// \param raft_endpoints node endpoints for raft communications.
@@ -58,9 +75,26 @@ namespace cbdc::atomizer {
         /// received notifications to create an aggregate notification with a
         /// full set of input attestations, create an aggregate notification
         /// and add it to a list of complete transactions.
+        ///
+        /// Shards each notify the atomizer of the same compact transaction.
+        /// Its sentinel attestations are verified by the first caller only;
+        /// identical notifications arriving during verification are merged
+        /// by that caller once it completes. Attestations are only counted
+        /// for verified contents, and notifications for transactions
+        /// completed within the STXO cache depth are ignored. Pending
+        /// transactions are partitioned by transaction ID so notifications
+        /// for unrelated transactions do not contend. Safe to call from
+        /// multiple threads.
         /// \param notif transaction notification.
         void tx_notify(tx_notify_request&& notif);
 
+        /// Waits until there are complete transactions to send with
+        /// \ref send_complete_txs.
+        /// \param timeout maximum time to wait.
+        /// \return true if there are complete transactions to send.
+        [[nodiscard]] auto
+        wait_for_complete_txs(std::chrono::milliseconds timeout) -> bool;
+
         /// Replicate a transaction notification command in the state machine
         /// containing the current set of complete transactions.
         /// \param result_fn function to call with the state machine execution
@@ -69,6 +103,18 @@ namespace cbdc::atomizer {
         [[nodiscard]] auto
         send_complete_txs(const raft::callback_type& result_fn) -> bool;
 
+        /// Returns the transaction notifications replicated by
+        /// \ref send_complete_txs since the last call to
+        /// \ref take_pending_block.
+        /// \return pending block statistics.
+        [[nodiscard]] auto get_pending_block() -> pending_block;
+
+        /// Returns the transaction notifications replicated since the last
+        /// call and resets the statistics. Call when requesting a block.
+        /// Also forgets transactions completed before the STXO cache depth.
+        /// \return pending block statistics.
+        auto take_pending_block() -> pending_block;
+
       private:
         static constexpr const auto m_node_type = "atomizer";
 
@@ -86,16 +132,62 @@ namespace cbdc::atomizer {
         using attestation_set = std::
             unordered_set<attestation, attestation_hash, attestation_cmp>;
 
-        std::unordered_map<transaction::compact_tx,
-                           attestation_set,
-                           transaction::compact_tx_hasher>
-            m_txs;
+        /// Aggregation state of a transaction waiting for notifications
+        /// covering all of its inputs.
+        struct pending_tx {
+            /// Input attestations received from shards.
+            attestation_set m_attestations;
+            /// True once the contents the entry is keyed on have been
+            /// verified. Only verified entries hold attestations.
+            bool m_verified{false};
+            /// True while a thread is verifying the sentinel attestations
+            /// the entry was created with.
+            bool m_verifying{false};
+            /// Notifications identical to the ones being verified, received
+            /// during verification.
+            std::vector<tx_notify_request> m_waiting;
+        };
+
+        using pending_map = std::unordered_map<transaction::compact_tx,
+                                               pending_tx,
+                                               transaction::compact_tx_hasher>;
+
+        struct pending_partition {
+            std::mutex m_mut;
+            pending_map m_txs;
+            /// IDs of transactions completed in recent blocks, whose
+            /// notifications are ignored.
+            std::unordered_set<hash_t, hashing::null> m_completed;
+            /// IDs in m_completed by the block they were completed in,
+            /// oldest first.
+            std::deque<std::vector<hash_t>> m_completed_blocks;
+        };
+
+        static constexpr size_t m_partition_count{16};
+        std::array<pending_partition, m_partition_count> m_partitions;
+
         std::mutex m_complete_mut;
+        std::condition_variable m_complete_cv;
         std::vector<aggregate_tx_notification> m_complete_txs;
+        std::mutex m_pending_mut;
+        pending_block m_pending_block;
         std::shared_ptr<logging::log> m_log;
         config::options m_opts;
+        size_t m_stxo_cache_depth;
+
+        auto partition_for(const hash_t& tx_id) -> pending_partition&;
+
+        static auto add_attestations(pending_map::iterator it,
+                                     const tx_notify_request& notif) -> bool;
+
+        /// Removes a transaction with a full set of input attestations from
+        /// the pending set, then releases the partition lock and adds the
+        /// transaction to the complete transactions.
+        void finish_tx(pending_partition& part,
+                       pending_map::iterator it,
+                       std::unique_lock<std::mutex>& l);
 
-        std::mutex m_txs_mut;
+        void complete_tx(pending_map::node_type&& tx);
     };
 }
 
@@ -9,4 +9,27 @@ namespace cbdc {
         return (rhs.m_height == m_height)
             && (rhs.m_transactions == m_transactions);
     }
+
+    auto atomizer::filter_block(const block& blk,
+                                const config::shard_range_t& range)
+        -> block {
+        auto delta = transaction::compact_tx();
+        for(const auto& tx : blk.m_transactions) {
+            for(const auto& inp : tx.m_inputs) {
+                if(config::hash_in_shard_range(range, inp)) {
+                    delta.m_inputs.push_back(inp);
+                }
+            }
+            for(const auto& out : tx.m_uhs_outputs) {
+                if(config::hash_in_shard_range(range, out)) {
+                    delta.m_uhs_outputs.push_back(out);
+                }
+            }
+        }
+
+        auto ret = block();
+        ret.m_height = blk.m_height;
+        ret.m_transactions.push_back(std::move(delta));
+        return ret;
+    }
 }
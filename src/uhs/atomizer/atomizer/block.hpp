@@ -8,6 +8,7 @@
 
 #include "uhs/transaction/transaction.hpp"
 #include "util/common/buffer.hpp"
+#include "util/common/config.hpp"
 
 #include <cassert>
 #include <cstddef>
@@ -25,6 +26,19 @@ namespace cbdc::atomizer {
         /// Compact transactions settled by the atomizer in this block.
         std::vector<transaction::compact_tx> m_transactions;
     };
+
+    /// \brief Reduces a block to its changes within a UHS ID prefix range.
+    ///
+    /// Returns a block at the same height holding a single compact
+    /// transaction with a null ID and no attestations. Its inputs are the
+    /// in-range UHS IDs spent by the block, and its outputs the in-range UHS
+    /// IDs created by the block. Subscribers which track only the given range
+    /// can digest the result in place of the full block.
+    /// \param blk block to filter.
+    /// \param range inclusive UHS ID prefix range to retain.
+    /// \return filtered block.
+    auto filter_block(const block& blk, const config::shard_range_t& range)
+        -> block;
 }
 
 #endif // OPENCBDC_TX_SRC_ATOMIZER_BLOCK_H_
@@ -11,6 +11,8 @@
 #include "util/raft/util.hpp"
 #include "util/serialization/format.hpp"
 
+#include <latch>
+#include <map>
 #include <utility>
 
 namespace cbdc::atomizer {
@@ -36,6 +38,10 @@ namespace cbdc::atomizer {
         m_atomizer_network.close();
 
         m_running = false;
+        {
+            std::lock_guard l(m_block_mut);
+        }
+        m_block_cv.notify_one();
 
         if(m_tx_notify_thread.joinable()) {
             m_tx_notify_thread.join();
@@ -49,6 +55,11 @@ namespace cbdc::atomizer {
             m_main_thread.join();
         }
 
+        m_block_stream_queue.clear();
+        if(m_block_stream_thread.joinable()) {
+            m_block_stream_thread.join();
+        }
+
         m_notification_queue.clear();
         for(auto& t : m_notification_threads) {
             if(t.joinable()) {
@@ -87,6 +98,10 @@ namespace cbdc::atomizer {
             main_handler();
         }};
 
+        m_block_stream_thread = std::thread{[&] {
+            block_stream_handler();
+        }};
+
         auto n_threads = std::thread::hardware_concurrency();
         for(size_t i = 0; i < n_threads; i++) {
             m_notification_threads.emplace_back([&]() {
@@ -118,7 +133,7 @@ namespace cbdc::atomizer {
                                     to_string(notif.m_tx.m_id),
                                     "with height",
                                     notif.m_block_height);
-                    m_notification_queue.push(notif);
+                    m_notification_queue.push(std::move(notif));
                 },
                 [&](const prune_request& p) {
                     m_raft_node.make_request(p, nullptr);
@@ -149,6 +164,16 @@ namespace cbdc::atomizer {
                         m_atomizer_network.send(resp.m_blk, peer_id);
                     };
                     m_raft_node.make_request(g, result_fn);
+                },
+                [&](const subscribe_request& s) {
+                    m_logger->debug("Peer",
+                                    pkt.m_peer_id,
+                                    "subscribed to range",
+                                    static_cast<int>(s.m_range.first),
+                                    "-",
+                                    static_cast<int>(s.m_range.second));
+                    std::unique_lock l(m_subscriptions_mut);
+                    m_subscriptions[pkt.m_peer_id] = s.m_range;
                 }},
             maybe_req.value());
 
@@ -156,37 +181,70 @@ namespace cbdc::atomizer {
     }
 
     void controller::tx_notify_handler() {
+        // Only bounds how long shutdown waits for this thread
+        static constexpr auto complete_txs_wait
+            = std::chrono::milliseconds(100);
         while(m_running) {
+            if(!m_raft_node.wait_for_complete_txs(complete_txs_wait)) {
+                continue;
+            }
             if(!m_raft_node.send_complete_txs(
                    [&, this](auto&& res, auto&& err) {
                        err_return_handler(std::forward<decltype(res)>(res),
                                           std::forward<decltype(err)>(err));
                    })) {
-                static constexpr auto batch_send_delay
-                    = std::chrono::milliseconds(20);
-                std::this_thread::sleep_for(batch_send_delay);
+                continue;
+            }
+            if(block_full()) {
+                {
+                    std::lock_guard l(m_block_mut);
+                }
+                m_block_cv.notify_one();
             }
         }
     }
 
+    auto controller::block_full() -> bool {
+        const auto pending = m_raft_node.get_pending_block();
+        return (m_opts.m_block_tx_target != 0
+                && pending.m_txs >= m_opts.m_block_tx_target)
+            || (m_opts.m_block_byte_budget != 0
+                && pending.m_bytes >= m_opts.m_block_byte_budget);
+    }
+
     void controller::main_handler() {
-        auto last_time = std::chrono::high_resolution_clock::now();
+        const auto max_delay
+            = std::chrono::milliseconds(m_opts.m_target_block_interval);
+        const auto min_delay
+            = std::chrono::milliseconds(m_opts.m_min_block_interval);
+        auto last_time = std::chrono::steady_clock::now();
 
         while(m_running) {
-            const auto next_time
-                = last_time
-                + std::chrono::milliseconds(m_opts.m_target_block_interval);
-            std::this_thread::sleep_until(next_time);
-            last_time = std::chrono::high_resolution_clock::now();
+            {
+                std::unique_lock l(m_block_mut);
+                m_block_cv.wait_until(l, last_time + min_delay, [&]() {
+                    return !m_running;
+                });
+                m_block_cv.wait_until(l, last_time + max_delay, [&]() {
+                    return !m_running || block_full();
+                });
+            }
+            last_time = std::chrono::steady_clock::now();
 
-            if(m_raft_node.is_leader()) {
+            if(m_running && m_raft_node.is_leader()) {
+                const auto pending = m_raft_node.take_pending_block();
+                auto queue_delay = std::chrono::nanoseconds::zero();
+                if(pending.m_since.has_value()) {
+                    queue_delay = last_time - pending.m_since.value();
+                }
                 auto req = make_block_request();
-                auto res
-                    = m_raft_node.make_request(req, [&](auto&& r, auto&& err) {
-                          raft_result_handler(
-                              std::forward<decltype(r)>(r),
-                              std::forward<decltype(err)>(err));
-                      });
+                auto res = m_raft_node.make_request(
+                    req,
+                    [&, queue_delay](auto&& r, auto&& err) {
+                        raft_result_handler(std::forward<decltype(r)>(r),
+                                            std::forward<decltype(err)>(err),
+                                            queue_delay);
+                    });
                 if(!res && m_running) {
                     m_logger->error("Failed to make block at time",
                                     last_time.time_since_epoch().count());
@@ -196,7 +254,8 @@ namespace cbdc::atomizer {
     }
 
     void controller::raft_result_handler(raft::result_type& r,
-                                         nuraft::ptr<std::exception>& err) {
+                                         nuraft::ptr<std::exception>& err,
+                                         std::chrono::nanoseconds queue_delay) {
         if(err) {
             return;
         }
@@ -209,10 +268,6 @@ namespace cbdc::atomizer {
             std::holds_alternative<make_block_response>(maybe_resp.value()));
         auto& resp = std::get<make_block_response>(maybe_resp.value());
 
-        auto blk_pkt = make_shared_buffer(resp.m_blk);
-
-        m_atomizer_network.broadcast(blk_pkt);
-
         m_logger->info("Block h:",
                        resp.m_blk.m_height,
                        ", nTXs:",
@@ -220,7 +275,40 @@ namespace cbdc::atomizer {
                        ", log idx:",
                        m_raft_node.last_log_idx(),
                        ", notifications:",
-                       m_raft_node.tx_notify_count());
+                       m_raft_node.tx_notify_count(),
+                       ", queue delay us:",
+                       std::chrono::duration_cast<std::chrono::microseconds>(
+                           queue_delay)
+                           .count());
+
+        {
+            std::lock_guard l(m_metrics_mut);
+            m_block_txs.record(resp.m_blk.m_transactions.size());
+            m_queue_delay.record(
+                static_cast<uint64_t>(queue_delay.count()));
+            if(m_block_txs.count() >= m_metrics_log_interval) {
+                static constexpr auto p50 = 50.0;
+                static constexpr auto p99 = 99.0;
+                static constexpr auto ns_per_us = 1000;
+                m_logger->info(
+                    "Block fill txs p50:",
+                    m_block_txs.value_at_percentile(p50),
+                    "p99:",
+                    m_block_txs.value_at_percentile(p99),
+                    "max:",
+                    m_block_txs.max(),
+                    ", queue delay us p50:",
+                    m_queue_delay.value_at_percentile(p50) / ns_per_us,
+                    "p99:",
+                    m_queue_delay.value_at_percentile(p99) / ns_per_us);
+                m_block_txs.reset();
+                m_queue_delay.reset();
+            }
+        }
+
+        // Filter and send the block off the raft callback thread. A single
+        // worker keeps blocks in height order.
+        m_block_stream_queue.push(std::move(resp.m_blk));
 
         if(!resp.m_errs.empty()) {
             auto buf = make_shared_buffer(resp.m_errs);
@@ -263,8 +351,13 @@ namespace cbdc::atomizer {
             if(m_atomizer_server.joinable()) {
                 m_atomizer_server.join();
             }
-            // Reset the client network so we can use it again.
+            // Reset the client network so we can use it again. Peer IDs are
+            // reused after a reset so drop any previous subscriptions.
             m_atomizer_network.reset();
+            {
+                std::unique_lock l(m_subscriptions_mut);
+                m_subscriptions.clear();
+            }
             // Start listening on our client endpoint and start the handler
             // thread.
             auto as = m_atomizer_network.start_server(
@@ -283,13 +376,74 @@ namespace cbdc::atomizer {
     }
 
     void controller::notification_consumer() {
+        static constexpr size_t max_batch{100};
+        auto notifs = std::vector<tx_notify_request>();
+        notifs.reserve(max_batch);
         while(m_running) {
-            auto notif = tx_notify_request();
-            auto popped = m_notification_queue.pop(notif);
-            if(!popped) {
+            if(m_notification_queue.pop(notifs, max_batch) == 0) {
                 break;
             }
-            m_raft_node.tx_notify(std::move(notif));
+            for(auto& notif : notifs) {
+                m_raft_node.tx_notify(std::move(notif));
+            }
+            notifs.clear();
+        }
+    }
+
+    void controller::block_stream_handler() {
+        auto blk = block();
+        while(m_block_stream_queue.pop(blk)) {
+            send_block(blk);
+        }
+    }
+
+    void controller::send_block(const block& blk) {
+        // Group subscribers by range so each range is filtered once
+        auto ranges = std::map<config::shard_range_t,
+                               std::vector<network::peer_id_t>>();
+        auto subscribers = std::unordered_set<network::peer_id_t>();
+        {
+            std::unique_lock l(m_subscriptions_mut);
+            for(auto it = m_subscriptions.begin();
+                it != m_subscriptions.end();) {
+                if(!m_atomizer_network.connected(it->first)) {
+                    it = m_subscriptions.erase(it);
+                    continue;
+                }
+                ranges[it->second].push_back(it->first);
+                subscribers.insert(it->first);
+                it++;
+            }
+        }
+
+        // Filter the ranges in parallel. Each block is sent from this thread
+        // once all its ranges are filtered, so every subscriber receives
+        // blocks in height order.
+        auto pkts = std::vector<std::shared_ptr<cbdc::buffer>>(ranges.size());
+        auto filtered = std::latch(static_cast<std::ptrdiff_t>(ranges.size()));
+        size_t i{0};
+        for(const auto& entry : ranges) {
+            m_filter_pool.push(
+                [&blk, &range = entry.first, &pkt = pkts[i++], &filtered]() {
+                    pkt = make_shared_buffer(filter_block(blk, range));
+                    filtered.count_down();
+                });
+        }
+
+        // Peers which have not subscribed, such as archivers and
+        // watchtowers, receive the full block
+        if(m_atomizer_network.peer_count() > subscribers.size()) {
+            auto blk_pkt = make_shared_buffer(blk);
+            m_atomizer_network.broadcast(blk_pkt, subscribers);
+        }
+
+        filtered.wait();
+        i = 0;
+        for(const auto& entry : ranges) {
+            for(const auto peer_id : entry.second) {
+                m_atomizer_network.send(pkts[i], peer_id);
+            }
+            i++;
         }
     }
 }
@@ -8,13 +8,27 @@
 
 #include "atomizer_raft.hpp"
 #include "uhs/atomizer/atomizer/block.hpp"
+#include "util/common/blocking_queue.hpp"
+#include "util/common/bounded_queue.hpp"
 #include "util/common/config.hpp"
+#include "util/common/hdr_histogram.hpp"
+#include "util/common/thread_pool.hpp"
 #include "util/network/connection_manager.hpp"
 
+#include <condition_variable>
 #include <memory>
+#include <unordered_map>
 
 namespace cbdc::atomizer {
-    /// Wrapper for the atomizer raft executable implementation.
+    /// \brief Wrapper for the atomizer raft executable implementation.
+    ///
+    /// While leader, creates a block once the target block interval has
+    /// elapsed, or earlier once the transactions replicated since the last
+    /// block reach the configured transaction target or byte budget. Complete
+    /// transactions are replicated as soon as they arrive. Block fill and
+    /// the delay between a transaction being replicated and its block being
+    /// requested are logged periodically. Each new block is filtered for the
+    /// subscribed shard ranges in parallel on a thread pool.
     class controller {
       public:
         controller() = delete;
@@ -52,21 +66,43 @@ namespace cbdc::atomizer {
         std::thread m_tx_notify_thread;
         std::thread m_main_thread;
 
-        blocking_queue<tx_notify_request> m_notification_queue;
+        static constexpr size_t m_notification_queue_size{65536};
+        mpmc_queue<tx_notify_request> m_notification_queue{
+            m_notification_queue_size};
         std::vector<std::thread> m_notification_threads;
 
+        blocking_queue<block> m_block_stream_queue;
+        std::thread m_block_stream_thread;
+        thread_pool m_filter_pool;
+
+        std::mutex m_subscriptions_mut;
+        std::unordered_map<network::peer_id_t, config::shard_range_t>
+            m_subscriptions;
+
+        std::mutex m_block_mut;
+        std::condition_variable m_block_cv;
+
+        static constexpr size_t m_metrics_log_interval{100};
+        std::mutex m_metrics_mut;
+        hdr_histogram m_block_txs;
+        hdr_histogram m_queue_delay;
+
         auto server_handler(cbdc::network::message_t&& pkt)
             -> std::optional<cbdc::buffer>;
         void tx_notify_handler();
         void main_handler();
+        [[nodiscard]] auto block_full() -> bool;
         void raft_result_handler(raft::result_type& r,
-                                 nuraft::ptr<std::exception>& err);
+                                 nuraft::ptr<std::exception>& err,
+                                 std::chrono::nanoseconds queue_delay);
         void err_return_handler(raft::result_type& r,
                                 nuraft::ptr<std::exception>& err);
         auto raft_callback(nuraft::cb_func::Type type,
                            nuraft::cb_func::Param* param)
             -> nuraft::cb_func::ReturnCode;
         void notification_consumer();
+        void block_stream_handler();
+        void send_block(const block& blk);
     };
 }
 
@@ -21,18 +21,38 @@ namespace cbdc {
         return packet >> blk.m_height >> blk.m_transactions;
     }
 
+    namespace {
+        void serialize_snapshot_state(serializer& ser,
+                                      atomizer::atomizer& atm,
+                                      nuraft::snapshot& snp) {
+            auto atomizer_buf = atm.serialize();
+            auto snp_buf = snp.serialize();
+            ser << static_cast<uint64_t>(snp_buf->size());
+            ser.write(snp_buf->data_begin(), snp_buf->size());
+            ser.write(atomizer_buf.data(), atomizer_buf.size());
+        }
+    }
+
     auto operator<<(serializer& ser,
                     const atomizer::state_machine::snapshot& snp)
         -> serializer& {
-        auto atomizer_buf = snp.m_atomizer->serialize();
-        auto snp_buf = snp.m_snp->serialize();
-        ser << static_cast<uint64_t>(snp_buf->size());
-        ser.write(snp_buf->data_begin(), snp_buf->size());
-        ser.write(atomizer_buf.data(), atomizer_buf.size());
+        serialize_snapshot_state(ser, *snp.m_atomizer, *snp.m_snp);
         ser << *snp.m_blocks;
         return ser;
     }
 
+    auto operator<<(serializer& ser,
+                    const atomizer::state_machine::snapshot_view& snp)
+        -> serializer& {
+        serialize_snapshot_state(ser, *snp.m_atomizer, *snp.m_snp);
+        // Same layout as the blockstore_t map in a full snapshot
+        ser << static_cast<uint64_t>(snp.m_blocks.size());
+        for(const auto& [height, blk] : snp.m_blocks) {
+            ser << height << *blk;
+        }
+        return ser;
+    }
+
     auto operator>>(serializer& deser, atomizer::state_machine::snapshot& snp)
         -> serializer& {
         uint64_t snp_sz{};
@@ -114,6 +134,15 @@ namespace cbdc {
         return deser >> r.m_block_height;
     }
 
+    auto operator<<(serializer& ser, const atomizer::subscribe_request& r)
+        -> serializer& {
+        return ser << r.m_range;
+    }
+    auto operator>>(serializer& deser, atomizer::subscribe_request& r)
+        -> serializer& {
+        return deser >> r.m_range;
+    }
+
     auto operator<<(serializer& ser, const atomizer::make_block_response& r)
         -> serializer& {
         return ser << r.m_blk << r.m_errs;
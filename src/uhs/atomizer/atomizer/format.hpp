@@ -16,6 +16,10 @@ namespace cbdc {
     auto operator>>(serializer& deser, atomizer::state_machine::snapshot& snp)
         -> serializer&;
 
+    auto operator<<(serializer& ser,
+                    const atomizer::state_machine::snapshot_view& snp)
+        -> serializer&;
+
     auto operator<<(serializer& packet,
                     const atomizer::aggregate_tx_notification& msg)
         -> serializer&;
@@ -53,6 +57,11 @@ namespace cbdc {
     auto operator>>(serializer& deser, atomizer::get_block_request& r)
         -> serializer&;
 
+    auto operator<<(serializer& ser, const atomizer::subscribe_request& r)
+        -> serializer&;
+    auto operator>>(serializer& deser, atomizer::subscribe_request& r)
+        -> serializer&;
+
     auto operator<<(serializer& ser, const atomizer::make_block_response& r)
         -> serializer&;
     auto operator>>(serializer& deser, atomizer::make_block_response& r)
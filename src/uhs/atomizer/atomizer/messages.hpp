@@ -76,6 +76,17 @@ namespace cbdc::atomizer {
         uint64_t m_block_height{};
     };
 
+    /// \brief Block stream subscription request.
+    ///
+    /// Sent to the atomizer by subscribers which track only a subset of the
+    /// UHS. After subscribing, the atomizer sends the peer the output of
+    /// \ref filter_block for each new block instead of the full block. The
+    /// subscription lasts for the lifetime of the connection.
+    struct subscribe_request {
+        /// Inclusive UHS ID prefix range to receive.
+        config::shard_range_t m_range{};
+    };
+
     /// List of watchtower errors returned by the atomizer state machine.
     using errors = std::vector<watchtower::tx_error>;
 
@@ -94,8 +105,10 @@ namespace cbdc::atomizer {
     };
 
     /// Atomizer RPC request.
-    using request
-        = std::variant<tx_notify_request, prune_request, get_block_request>;
+    using request = std::variant<tx_notify_request,
+                                 prune_request,
+                                 get_block_request,
+                                 subscribe_request>;
 }
 
 #endif
@@ -10,6 +10,7 @@
 #include "format.hpp"
 #include "util/raft/serialization.hpp"
 #include "util/raft/util.hpp"
+#include "util/serialization/buffer_serializer.hpp"
 #include "util/serialization/format.hpp"
 #include "util/serialization/istream_serializer.hpp"
 #include "util/serialization/ostream_serializer.hpp"
@@ -25,7 +26,6 @@ namespace cbdc::atomizer {
         : m_snapshot_dir(std::move(snapshot_dir)),
           m_stxo_cache_depth(stxo_cache_depth) {
         m_atomizer = std::make_shared<atomizer>(0, m_stxo_cache_depth);
-        m_blocks = std::make_shared<decltype(m_blocks)::element_type>();
         auto err = std::error_code();
         std::filesystem::create_directory(m_snapshot_dir, err);
         if(err) {
@@ -39,6 +39,12 @@ namespace cbdc::atomizer {
         }
     }
 
+    state_machine::~state_machine() {
+        if(m_snp_thread.joinable()) {
+            m_snp_thread.join();
+        }
+    }
+
     auto state_machine::commit(nuraft::ulong log_idx, nuraft::buffer& data)
         -> nuraft::ptr<nuraft::buffer> {
         assert(log_idx == m_last_committed_idx + 1);
@@ -71,20 +77,21 @@ namespace cbdc::atomizer {
                 [&](const make_block_request& /* r */)
                     -> std::optional<response> {
                     auto [blk, errs] = m_atomizer->make_block();
-                    m_blocks->emplace(blk.m_height, blk);
+                    m_blocks.emplace(blk.m_height,
+                                     std::make_shared<const block>(blk));
                     return make_block_response{blk, errs};
                 },
                 [&](const get_block_request& r) -> std::optional<response> {
-                    auto it = m_blocks->find(r.m_block_height);
-                    if(it != m_blocks->end()) {
-                        return get_block_response{it->second};
+                    auto it = m_blocks.find(r.m_block_height);
+                    if(it != m_blocks.end()) {
+                        return get_block_response{*it->second};
                     }
                     return std::nullopt;
                 },
                 [&](const prune_request& r) -> std::optional<response> {
-                    for(auto it = m_blocks->begin(); it != m_blocks->end();) {
-                        if(it->second.m_height < r.m_block_height) {
-                            it = m_blocks->erase(it);
+                    for(auto it = m_blocks.begin(); it != m_blocks.end();) {
+                        if(it->second->m_height < r.m_block_height) {
+                            it = m_blocks.erase(it);
                         } else {
                             it++;
                         }
@@ -109,64 +116,98 @@ namespace cbdc::atomizer {
 
     auto
     state_machine::read_logical_snp_obj(nuraft::snapshot& s,
-                                        void*& /* user_snp_ctx */,
-                                        nuraft::ulong /* obj_id */,
+                                        void*& user_snp_ctx,
+                                        nuraft::ulong obj_id,
                                         nuraft::ptr<nuraft::buffer>& data_out,
                                         bool& is_last_obj) -> int {
         auto path = get_snapshot_path(s.get_last_log_idx());
-        {
-            std::shared_lock<std::shared_mutex> l(m_snp_mut);
-            auto ss = std::ifstream(path, std::ios::in | std::ios::binary);
-            if(!ss.good()) {
-                // Requested snapshot doesn't exit anymore, not fatal
+        std::shared_lock<std::shared_mutex> l(m_snp_mut);
+        auto ss = std::ifstream(path, std::ios::in | std::ios::binary);
+        if(!ss.good()) {
+            // Requested snapshot doesn't exit anymore, not fatal
+            return -1;
+        }
+        auto err = std::error_code();
+        auto sz = std::filesystem::file_size(path, err);
+        if(err) {
+            // If we got this far, this should work unless our system is
+            // broken
+            std::exit(EXIT_FAILURE);
+        }
+
+        auto idx = s.get_last_log_idx();
+        auto* ctx = static_cast<snp_read_ctx*>(user_snp_ctx);
+        if(ctx == nullptr || ctx->m_idx != idx) {
+            free_user_snp_ctx(user_snp_ctx);
+            // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+            ctx = new snp_read_ctx{idx};
+            user_snp_ctx = ctx;
+        }
+
+        // Each object is one chunk record. Find the records up to the
+        // requested one, continuing from the last record found for an
+        // earlier object.
+        auto deser = cbdc::istream_serializer(ss);
+        auto& offsets = ctx->m_offsets;
+        while(offsets.size() <= obj_id + 1) {
+            auto offset = offsets.back();
+            if(offset >= sz) {
                 return -1;
             }
-            auto err = std::error_code();
-            auto sz = std::filesystem::file_size(path, err);
-            if(err) {
-                // If we got this far, this should work unless our system is
-                // broken
-                std::exit(EXIT_FAILURE);
-            }
-            auto buf = nuraft::buffer::alloc(sz);
-            auto read_vec = std::vector<char>(sz);
-            ss.read(read_vec.data(),
-                    static_cast<std::streamsize>(buf->size()));
-            if(!ss.good()) {
-                // If we got this far, this should work unless our system is
-                // broken
-                std::exit(EXIT_FAILURE);
+            ss.seekg(static_cast<std::streamoff>(offset));
+            uint64_t chunk_sz{0};
+            if(!(deser >> chunk_sz)) {
+                return -1;
             }
-            std::memcpy(buf->data_begin(), read_vec.data(), sz);
-            data_out = std::move(buf);
+            offsets.push_back(offset + sizeof(chunk_sz) + chunk_sz
+                              + sizeof(hash_t));
         }
 
-        // TODO: send and receive in chunks
-        is_last_obj = true;
+        auto offset = offsets[obj_id];
+        auto record_sz = offsets[obj_id + 1] - offset;
+        if(offset + record_sz > sz) {
+            return -1;
+        }
+        auto buf = nuraft::buffer::alloc(record_sz);
+        ss.seekg(static_cast<std::streamoff>(offset));
+        if(!deser.read(buf->data_begin(), record_sz)) {
+            std::exit(EXIT_FAILURE);
+        }
+        data_out = std::move(buf);
+        is_last_obj = offset + record_sz == sz;
 
         return 0;
     }
 
+    void state_machine::free_user_snp_ctx(void*& user_snp_ctx) {
+        // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+        delete static_cast<snp_read_ctx*>(user_snp_ctx);
+        user_snp_ctx = nullptr;
+    }
+
     void state_machine::save_logical_snp_obj(nuraft::snapshot& s,
                                              nuraft::ulong& obj_id,
                                              nuraft::buffer& data,
-                                             bool /* is_first_obj */,
-                                             bool /* is_last_obj */) {
-        assert(obj_id == 0);
+                                             bool is_first_obj,
+                                             bool is_last_obj) {
+        if(!check_chunk(data)) {
+            // Leave the object ID unchanged so the leader sends the chunk
+            // again
+            return;
+        }
+
         auto tmp_path = get_tmp_path();
         {
             std::unique_lock<std::shared_mutex> l(m_snp_mut);
-            auto ss = std::ofstream(tmp_path,
-                                    std::ios::out | std::ios::trunc
-                                        | std::ios::binary);
+            auto mode = std::ios::out | std::ios::binary;
+            mode |= is_first_obj ? std::ios::trunc : std::ios::app;
+            auto ss = std::ofstream(tmp_path, mode);
             if(!ss.good()) {
                 // Since we're the exclusive writer, this should work
                 std::exit(EXIT_FAILURE);
             }
 
-            auto write_vec = std::vector<char>(data.size());
-            std::memcpy(write_vec.data(), data.data_begin(), data.size());
-            ss.write(write_vec.data(),
+            ss.write(reinterpret_cast<const char*>(data.data_begin()),
                      static_cast<std::streamsize>(data.size()));
             if(!ss.good()) {
                 std::exit(EXIT_FAILURE);
@@ -175,11 +216,13 @@ namespace cbdc::atomizer {
             ss.flush();
             ss.close();
 
-            auto path = get_snapshot_path(s.get_last_log_idx());
-            auto err = std::error_code();
-            std::filesystem::rename(tmp_path, path, err);
-            if(err) {
-                std::exit(EXIT_FAILURE);
+            if(is_last_obj) {
+                auto path = get_snapshot_path(s.get_last_log_idx());
+                auto err = std::error_code();
+                std::filesystem::rename(tmp_path, path, err);
+                if(err) {
+                    std::exit(EXIT_FAILURE);
+                }
             }
         }
 
@@ -189,7 +232,11 @@ namespace cbdc::atomizer {
     auto state_machine::apply_snapshot(nuraft::snapshot& s) -> bool {
         auto snp = read_snapshot(s.get_last_log_idx());
         if(snp) {
-            m_blocks = snp->m_blocks;
+            m_blocks.clear();
+            for(auto& [height, blk] : *snp->m_blocks) {
+                m_blocks.emplace(height,
+                                 std::make_shared<const block>(std::move(blk)));
+            }
             m_atomizer = snp->m_atomizer;
             m_last_committed_idx = s.get_last_log_idx();
         }
@@ -212,55 +259,133 @@ namespace cbdc::atomizer {
         nuraft::snapshot& s,
         nuraft::async_result<bool>::handler_type& when_done) {
         assert(s.get_last_log_idx() == last_commit_index());
-        nuraft::ptr<std::exception> except(nullptr);
-        bool ret = true;
 
+        // Capturing the view only copies pointers. The atomizer copies any
+        // shared state before the next commit modifies it, and blocks are
+        // immutable once created.
         auto snp_ser = s.serialize();
-        auto snp = snapshot{m_atomizer,
-                            nuraft::snapshot::deserialize(*snp_ser),
-                            m_blocks};
+        auto snp = snapshot_view{m_atomizer->snapshot(),
+                                 nuraft::snapshot::deserialize(*snp_ser),
+                                 m_blocks};
+
+        // NuRaft does not create another snapshot until when_done is called,
+        // so any previous snapshot thread has finished or is about to.
+        if(m_snp_thread.joinable()) {
+            m_snp_thread.join();
+        }
 
+        m_snp_thread = std::thread(
+            [this, view = std::move(snp), done = when_done]() mutable {
+                write_snapshot(view);
+                // Release the shared state before reporting completion
+                view = snapshot_view{};
+                bool ret = true;
+                nuraft::ptr<std::exception> except(nullptr);
+                done(ret, except);
+            });
+    }
+
+    void state_machine::write_snapshot(const snapshot_view& snp) {
+        auto buf = cbdc::buffer();
+        auto ser = cbdc::buffer_serializer(buf);
+        if(!(ser << snp)) {
+            std::exit(EXIT_FAILURE);
+        }
+
+        auto idx = snp.m_snp->get_last_log_idx();
         auto tmp_path = get_tmp_path();
-        auto path = get_snapshot_path(s.get_last_log_idx());
-        {
-            std::unique_lock<std::shared_mutex> l(m_snp_mut);
-            auto ss = std::ofstream(tmp_path,
-                                    std::ios::out | std::ios::trunc
-                                        | std::ios::binary);
-            if(!ss.good()) {
-                // We're the exclusive writer so these file operations should
-                // work
-                std::exit(EXIT_FAILURE);
-            }
+        auto path = get_snapshot_path(idx);
+        std::unique_lock<std::shared_mutex> l(m_snp_mut);
+        auto ss = std::ofstream(tmp_path,
+                                std::ios::out | std::ios::trunc
+                                    | std::ios::binary);
+        if(!ss.good()) {
+            // We're the exclusive writer so these file operations should
+            // work
+            std::exit(EXIT_FAILURE);
+        }
 
-            auto ser = cbdc::ostream_serializer(ss);
-            if(!(ser << snp)) {
-                std::exit(EXIT_FAILURE);
-            }
+        write_chunks(ss, buf);
 
-            ss.flush();
-            ss.close();
+        ss.flush();
+        if(!ss.good()) {
+            std::exit(EXIT_FAILURE);
+        }
+        ss.close();
 
-            auto err = std::error_code();
-            std::filesystem::rename(tmp_path, path, err);
-            if(err) {
-                std::exit(EXIT_FAILURE);
-            }
+        auto err = std::error_code();
+        std::filesystem::rename(tmp_path, path, err);
+        if(err) {
+            std::exit(EXIT_FAILURE);
+        }
 
-            for(const auto& p :
-                std::filesystem::directory_iterator(m_snapshot_dir)) {
-                auto name = p.path().filename().generic_string();
-                if(name == m_tmp_file
-                   || std::stoull(name) < s.get_last_log_idx()) {
-                    std::filesystem::remove(p, err);
-                    if(err) {
-                        std::exit(EXIT_FAILURE);
-                    }
+        for(const auto& p :
+            std::filesystem::directory_iterator(m_snapshot_dir)) {
+            auto name = p.path().filename().generic_string();
+            if(name == m_tmp_file || std::stoull(name) < idx) {
+                std::filesystem::remove(p, err);
+                if(err) {
+                    std::exit(EXIT_FAILURE);
                 }
             }
         }
+    }
 
-        when_done(ret, except);
+    void state_machine::write_chunks(std::ostream& out,
+                                     const cbdc::buffer& data) {
+        auto ser = cbdc::ostream_serializer(out);
+        const auto* ptr = static_cast<const std::byte*>(data.data());
+        size_t offset{0};
+        do {
+            auto len = std::min(m_chunk_size, data.size() - offset);
+            auto checksum = hash_data(ptr + offset, len);
+            ser << static_cast<uint64_t>(len);
+            ser.write(ptr + offset, len);
+            ser << checksum;
+            offset += len;
+        } while(offset < data.size());
+    }
+
+    auto state_machine::read_chunks(std::istream& in)
+        -> std::optional<cbdc::buffer> {
+        auto deser = cbdc::istream_serializer(in);
+        auto ret = cbdc::buffer();
+        auto chunk = std::vector<std::byte>();
+        while(in.peek() != std::istream::traits_type::eof()) {
+            uint64_t len{};
+            if(!(deser >> len) || len > m_chunk_size) {
+                return std::nullopt;
+            }
+            chunk.resize(len);
+            auto checksum = hash_t();
+            if(!deser.read(chunk.data(), len) || !(deser >> checksum)) {
+                return std::nullopt;
+            }
+            if(hash_data(chunk.data(), len) != checksum) {
+                return std::nullopt;
+            }
+            ret.append(chunk.data(), len);
+        }
+        return ret;
+    }
+
+    auto state_machine::check_chunk(const nuraft::buffer& chunk) -> bool {
+        uint64_t len{};
+        if(chunk.size() < sizeof(len) + sizeof(hash_t)) {
+            return false;
+        }
+        const auto* ptr
+            = reinterpret_cast<const std::byte*>(chunk.data_begin());
+        std::memcpy(&len, ptr, sizeof(len));
+        if(len > m_chunk_size
+           || chunk.size() != sizeof(len) + len + sizeof(hash_t)) {
+            return false;
+        }
+        auto checksum = hash_t();
+        std::memcpy(checksum.data(),
+                    ptr + sizeof(len) + len,
+                    checksum.size());
+        return hash_data(ptr + sizeof(len), len) == checksum;
     }
 
     auto state_machine::tx_notify_count() -> uint64_t {
@@ -319,9 +444,17 @@ namespace cbdc::atomizer {
         if(err) {
             std::exit(EXIT_FAILURE);
         }
-        auto deser = cbdc::istream_serializer(ss);
+        auto buf = read_chunks(ss);
+        if(!buf.has_value()) {
+            // The snapshot is corrupt
+            if(open_fail_fatal) {
+                std::exit(EXIT_FAILURE);
+            }
+            return std::nullopt;
+        }
+        auto deser = cbdc::buffer_serializer(buf.value());
         auto new_atm = std::make_shared<atomizer>(0, m_stxo_cache_depth);
-        auto new_blocks = std::make_shared<decltype(m_blocks)::element_type>();
+        auto new_blocks = std::make_shared<blockstore_t>();
         auto snp
             = snapshot{std::move(new_atm), nullptr, std::move(new_blocks)};
         if(!(deser >> snp)) {
@@ -11,12 +11,18 @@
 
 #include <libnuraft/nuraft.hxx>
 #include <shared_mutex>
+#include <thread>
 
 namespace cbdc::atomizer {
     /// \brief Raft state machine for managing a replicated atomizer.
     ///
     /// Contains a \ref atomizer and a cache of recently created blocks.
     /// Accepts requests to retrieve and prune recent blocks from the cache.
+    /// Snapshots capture a copy-on-write view of the state and are written
+    /// on a background thread, so creating a snapshot does not delay
+    /// committing subsequent log entries. Snapshot files are stored as a
+    /// sequence of checksummed chunks, which are also the objects
+    /// transferred to followers.
     class state_machine : public nuraft::state_machine {
       public:
         /// Constructor.
@@ -26,6 +32,14 @@ namespace cbdc::atomizer {
         ///                     Will create the directory if it doesn't exist.
         state_machine(size_t stxo_cache_depth, std::string snapshot_dir);
 
+        /// Destructor. Waits for any snapshot being written to complete.
+        ~state_machine() override;
+
+        state_machine(const state_machine&) = delete;
+        auto operator=(const state_machine&) -> state_machine& = delete;
+        state_machine(state_machine&&) = delete;
+        auto operator=(state_machine&&) -> state_machine& = delete;
+
         /// Atomizer state machine request.
         using request = std::variant<aggregate_tx_notify_request,
                                      make_block_request,
@@ -69,6 +83,10 @@ namespace cbdc::atomizer {
                              nuraft::ptr<nuraft::buffer>& data_out,
                              bool& is_last_obj) -> int override;
 
+        /// Frees the snapshot context used by \ref read_logical_snp_obj.
+        /// \param user_snp_ctx pointer to the snapshot context.
+        void free_user_snp_ctx(void*& user_snp_ctx) override;
+
         /// Saves the portion of the state machine snapshot associated with
         /// the given metadata and object ID into persistent storage.
         /// \param s metadata of snapshot to save.
@@ -101,10 +119,12 @@ namespace cbdc::atomizer {
         /// \return log index.
         [[nodiscard]] auto last_commit_index() -> nuraft::ulong override;
 
-        /// Creates a snapshot with the given metadata.
+        /// Captures the current state and writes it to a snapshot with the
+        /// given metadata on a background thread. Returns once the state has
+        /// been captured, before the snapshot is written.
         /// \param s snapshot metadata.
         /// \param when_done function to call when snapshot creation is
-        ///                  complete.
+        ///                  complete. Called from the background thread.
         void create_snapshot(
             nuraft::snapshot& s,
             nuraft::async_result<bool>::handler_type& when_done) override;
@@ -129,7 +149,41 @@ namespace cbdc::atomizer {
             std::shared_ptr<blockstore_t> m_blocks{};
         };
 
+        /// Maps block heights to immutable blocks shared with snapshots.
+        using block_cache_t
+            = std::unordered_map<uint64_t,
+                                 std::shared_ptr<const cbdc::atomizer::block>>;
+
+        /// Immutable view of the state machine captured to write a snapshot.
+        /// Serializes to the same format as \ref snapshot.
+        struct snapshot_view {
+            /// Copy-on-write copy of the atomizer.
+            std::shared_ptr<cbdc::atomizer::atomizer> m_atomizer;
+            /// Pointer to the nuraft snapshot metadata.
+            nuraft::ptr<nuraft::snapshot> m_snp{};
+            /// Blocks in the block cache.
+            block_cache_t m_blocks;
+        };
+
+      protected:
+        /// Serializes the given view of the state and writes it to the
+        /// snapshot file for its log index, replacing older snapshots.
+        /// Called on the background snapshot thread.
+        /// \param snp view of the state to write.
+        virtual void write_snapshot(const snapshot_view& snp);
+
       private:
+        /// Position of the chunk records found so far while sending a
+        /// snapshot, so successive objects are read without rescanning the
+        /// file.
+        struct snp_read_ctx {
+            /// Log index of the snapshot being read.
+            uint64_t m_idx{};
+            /// Offset of the start of each chunk record found, followed by
+            /// the offset of the end of the last one.
+            std::vector<uint64_t> m_offsets{0};
+        };
+
         [[nodiscard]] auto get_snapshot_path(uint64_t idx) const
             -> std::string;
 
@@ -138,12 +192,23 @@ namespace cbdc::atomizer {
         [[nodiscard]] auto read_snapshot(uint64_t idx)
             -> std::optional<snapshot>;
 
+        static void write_chunks(std::ostream& out, const cbdc::buffer& data);
+
+        [[nodiscard]] static auto read_chunks(std::istream& in)
+            -> std::optional<cbdc::buffer>;
+
+        [[nodiscard]] static auto check_chunk(const nuraft::buffer& chunk)
+            -> bool;
+
         static constexpr auto m_tmp_file = "tmp";
 
+        /// Maximum size of the payload in each snapshot chunk.
+        static constexpr size_t m_chunk_size = 4UL << 20UL;
+
         std::atomic<uint64_t> m_last_committed_idx{0};
 
         std::shared_ptr<cbdc::atomizer::atomizer> m_atomizer;
-        std::shared_ptr<blockstore_t> m_blocks;
+        block_cache_t m_blocks;
 
         std::atomic<uint64_t> m_tx_notify_count{0};
 
@@ -152,6 +217,8 @@ namespace cbdc::atomizer {
         size_t m_stxo_cache_depth{};
 
         std::shared_mutex m_snp_mut;
+
+        std::thread m_snp_thread;
     };
 }
 #endif // OPENCBDC_TX_SRC_ATOMIZER_STATE_MACHINE_H_
@@ -6,6 +6,7 @@
 #include "controller.hpp"
 
 #include "uhs/sentinel/format.hpp"
+#include "util/serialization/util.hpp"
 #include "util/rpc/tcp_server.hpp"
 
 #include <random>
@@ -19,6 +20,23 @@ namespace cbdc::sentinel {
           m_opts(std::move(opts)),
           m_logger(std::move(logger)) {}
 
+    controller::~controller() {
+        {
+            std::unique_lock l(m_batch_mut);
+            m_running = false;
+        }
+        m_batch_cv.notify_one();
+        if(m_batch_thread.joinable()) {
+            m_batch_thread.join();
+        }
+
+        for(size_t i = 0; i < m_batches.size(); i++) {
+            if(!m_batches[i].m_txs.empty()) {
+                send_batch(i, m_batches[i].m_txs);
+            }
+        }
+    }
+
     auto controller::init() -> bool {
         auto skey = m_opts.m_sentinel_private_keys.find(m_sentinel_id);
         if(skey == m_opts.m_sentinel_private_keys.end()) {
@@ -52,6 +70,13 @@ namespace cbdc::sentinel {
 
         m_shard_dist = decltype(m_shard_dist)(0, m_shard_data.size() - 1);
 
+        m_batches.resize(m_shard_data.size());
+        if(m_opts.m_sentinel_batch_size > 1) {
+            m_batch_thread = std::thread([&]() {
+                batch_flusher();
+            });
+        }
+
         for(const auto& ep : m_opts.m_sentinel_endpoints) {
             if(ep == m_opts.m_sentinel_endpoints[m_sentinel_id]) {
                 continue;
@@ -78,7 +103,9 @@ namespace cbdc::sentinel {
 
         m_rpc_server = std::make_unique<decltype(m_rpc_server)::element_type>(
             this,
-            std::move(rpc_server));
+            std::move(rpc_server),
+            m_opts.m_sentinel_validation_threads,
+            m_opts.m_sentinel_validation_queue_size);
 
         return true;
     }
@@ -170,8 +197,6 @@ namespace cbdc::sentinel {
     }
 
     void controller::send_compact_tx(const transaction::compact_tx& ctx) {
-        auto ctx_pkt = std::make_shared<cbdc::buffer>(cbdc::make_buffer(ctx));
-
         auto offset = [&]() {
             std::unique_lock l(m_rand_mut);
             return m_shard_dist(m_rand);
@@ -192,15 +217,86 @@ namespace cbdc::sentinel {
                 if(inputs_sent.find(j) != inputs_sent.end()) {
                     continue;
                 }
-                if(!config::hash_in_shard_range(range, ctx.m_inputs[i])) {
+                if(!config::hash_in_shard_range(range, ctx.m_inputs[j])) {
                     continue;
                 }
                 inputs_sent.insert(j);
                 should_send = true;
             }
-            if(should_send) {
-                m_shard_network.send(ctx_pkt, pid);
+            if(!should_send) {
+                continue;
+            }
+
+            if(m_opts.m_sentinel_batch_size <= 1) {
+                send_batch(idx, {ctx});
+                continue;
+            }
+
+            auto full = std::vector<transaction::compact_tx>();
+            {
+                std::unique_lock l(m_batch_mut);
+                auto& batch = m_batches[idx];
+                if(batch.m_txs.empty()) {
+                    batch.m_deadline
+                        = std::chrono::steady_clock::now()
+                        + std::chrono::microseconds(
+                              m_opts.m_sentinel_batch_delay);
+                    m_batch_cv.notify_one();
+                }
+                batch.m_txs.push_back(ctx);
+                if(batch.m_txs.size() >= m_opts.m_sentinel_batch_size) {
+                    std::swap(full, batch.m_txs);
+                }
+            }
+            if(!full.empty()) {
+                send_batch(idx, full);
+            }
+        }
+    }
+
+    void controller::send_batch(
+        size_t shard_idx,
+        const std::vector<transaction::compact_tx>& txs) {
+        auto pkt = make_shared_buffer(txs);
+        m_shard_network.send(pkt, m_shard_data[shard_idx].m_peer_id);
+    }
+
+    void controller::batch_flusher() {
+        std::unique_lock l(m_batch_mut);
+        while(m_running) {
+            auto next = std::optional<std::chrono::steady_clock::time_point>();
+            for(const auto& batch : m_batches) {
+                if(!batch.m_txs.empty()
+                   && (!next.has_value() || batch.m_deadline < next.value())) {
+                    next = batch.m_deadline;
+                }
+            }
+            if(!next.has_value()) {
+                m_batch_cv.wait(l);
+                continue;
+            }
+            if(m_batch_cv.wait_until(l, next.value())
+               == std::cv_status::no_timeout) {
+                // A new batch may have an earlier deadline
+                continue;
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+            auto expired = std::vector<
+                std::pair<size_t, std::vector<transaction::compact_tx>>>();
+            for(size_t i = 0; i < m_batches.size(); i++) {
+                auto& batch = m_batches[i];
+                if(!batch.m_txs.empty() && batch.m_deadline <= now) {
+                    expired.emplace_back(i, std::move(batch.m_txs));
+                    batch.m_txs.clear();
+                }
+            }
+
+            l.unlock();
+            for(const auto& [idx, txs] : expired) {
+                send_batch(idx, txs);
             }
+            l.lock();
         }
     }
 }
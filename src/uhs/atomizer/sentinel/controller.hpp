@@ -13,11 +13,19 @@
 #include "util/common/config.hpp"
 #include "util/network/connection_manager.hpp"
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <random>
+#include <thread>
 
 namespace cbdc::sentinel {
-    /// Sentinel implementation.
+    /// \brief Sentinel implementation.
+    ///
+    /// Compact transactions with enough attestations are batched per
+    /// destination shard and sent as a single message once the batch reaches
+    /// the configured size, or once its oldest transaction has waited for the
+    /// configured maximum delay.
     class controller : public interface {
       public:
         controller() = delete;
@@ -34,7 +42,8 @@ namespace cbdc::sentinel {
                    config::options opts,
                    std::shared_ptr<logging::log> logger);
 
-        ~controller() override = default;
+        /// Sends any partially filled shard batches.
+        ~controller() override;
 
         /// Initializes the controller. Establishes connections to the shards
         /// \return true if initialization succeeded.
@@ -83,6 +92,20 @@ namespace cbdc::sentinel {
 
         privkey_t m_privkey{};
 
+        /// Compact transactions waiting to be sent to a shard.
+        struct shard_batch {
+            /// Transactions in the batch.
+            std::vector<transaction::compact_tx> m_txs;
+            /// Time by which the batch must be sent.
+            std::chrono::steady_clock::time_point m_deadline;
+        };
+
+        std::mutex m_batch_mut;
+        std::condition_variable m_batch_cv;
+        std::vector<shard_batch> m_batches;
+        bool m_running{true};
+        std::thread m_batch_thread;
+
         void send_transaction(const transaction::full_tx& tx);
 
         void validate_result_handler(async_interface::validate_result v_res,
@@ -95,6 +118,11 @@ namespace cbdc::sentinel {
                                  std::unordered_set<size_t> requested);
 
         void send_compact_tx(const transaction::compact_tx& ctx);
+
+        void send_batch(size_t shard_idx,
+                        const std::vector<transaction::compact_tx>& txs);
+
+        void batch_flusher();
     };
 }
 
@@ -8,39 +8,30 @@
 namespace cbdc::sentinel::rpc {
     server::server(
         interface* impl,
-        std::unique_ptr<cbdc::rpc::async_server<request, response>> srv)
+        std::unique_ptr<cbdc::rpc::async_server<request, response>> srv,
+        size_t n_threads,
+        size_t max_queued)
         : m_impl(impl),
+          m_pool(n_threads, max_queued),
           m_srv(std::move(srv)) {
         m_srv->register_handler_callback(
             [&](request req, callback_type callback) -> bool {
-                m_queue.push({std::move(req), std::move(callback)});
-                return true;
+                // Blocks while the queue is full, so the handler stops
+                // reading requests until the validation threads catch up
+                return m_pool.push(
+                    [&, r = std::move(req), cb = std::move(callback)](
+                        secp256k1_context* /* secp */) {
+                        handle_request(r, cb);
+                    });
             });
-
-        auto n_threads = std::thread::hardware_concurrency();
-        for(size_t i = 0; i < n_threads; i++) {
-            m_threads.emplace_back([&]() {
-                while(handle_request()) {}
-            });
-        }
     }
 
     server::~server() {
-        m_queue.clear();
-        for(auto& t : m_threads) {
-            if(t.joinable()) {
-                t.join();
-            }
-        }
+        // Stop accepting requests before stopping the validation threads
+        m_srv.reset();
     }
 
-    auto server::handle_request() -> bool {
-        auto req = request_type();
-        auto popped = m_queue.pop(req);
-        if(!popped) {
-            return false;
-        }
-
+    void server::handle_request(request req, const callback_type& callback) {
         auto res = std::visit(
             overloaded{
                 [&](execute_request e_req) -> std::optional<response> {
@@ -48,11 +39,18 @@ namespace cbdc::sentinel::rpc {
                 },
                 [&](validate_request v_req) -> std::optional<response> {
                     return m_impl->validate_transaction(std::move(v_req));
+                },
+                [&](validate_batch_request v_req) -> std::optional<response> {
+                    auto resp = validate_batch_response();
+                    resp.m_attestations.reserve(v_req.m_txs.size());
+                    for(auto& tx : v_req.m_txs) {
+                        resp.m_attestations.emplace_back(
+                            m_impl->validate_transaction(std::move(tx)));
+                    }
+                    return resp;
                 }},
-            req.first);
-
-        req.second(res);
+            std::move(req));
 
-        return true;
+        callback(std::move(res));
     }
 }
@@ -7,22 +7,30 @@
 #define OPENCBDC_TX_SRC_SENTINEL_SERVER_H_
 
 #include "uhs/sentinel/interface.hpp"
+#include "uhs/sentinel/validation_pool.hpp"
 #include "uhs/transaction/messages.hpp"
 #include "util/rpc/async_server.hpp"
 #include "util/rpc/format.hpp"
 
 namespace cbdc::sentinel::rpc {
-    /// RPC server for a sentinel.
+    /// RPC server for a sentinel. Handles requests on a pool of validation
+    /// threads and responds in the order requests complete.
     class server {
       public:
         /// Constructor. Registers the sentinel implementation with the RPC
         /// server using a request handler callback.
         /// \param impl pointer to a sentinel implementation.
         /// \param srv pointer to a blocking RPC server.
+        /// \param n_threads number of validation threads. 0 uses one thread
+        ///                  per hardware thread.
+        /// \param max_queued maximum number of requests waiting for a
+        ///                   validation thread.
         server(
             interface* impl, // TODO: convert sentinel::controller to
                              //       contain a shared_ptr to an implementation
-            std::unique_ptr<cbdc::rpc::async_server<request, response>> srv);
+            std::unique_ptr<cbdc::rpc::async_server<request, response>> srv,
+            size_t n_threads,
+            size_t max_queued);
 
         ~server();
 
@@ -33,15 +41,12 @@ namespace cbdc::sentinel::rpc {
 
       private:
         using callback_type = std::function<void(std::optional<response>)>;
-        using request_type = std::pair<request, callback_type>;
 
         interface* m_impl;
+        validation_pool m_pool;
         std::unique_ptr<cbdc::rpc::async_server<request, response>> m_srv;
-        blocking_queue<request_type> m_queue;
 
-        std::vector<std::thread> m_threads;
-
-        auto handle_request() -> bool;
+        void handle_request(request req, const callback_type& callback);
     };
 }
 
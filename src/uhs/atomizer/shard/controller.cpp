@@ -58,6 +58,12 @@ namespace cbdc::shard {
             m_logger->warn("Failed to connect to watchtowers.");
         }
 
+        // Subscribe to the blocks filtered to this shard's range each time
+        // the connection to an atomizer is established, so the subscription
+        // stays open across reconnects and leader changes
+        auto sub = atomizer::request{
+            atomizer::subscribe_request{m_opts.m_shard_ranges[m_shard_id]}};
+        m_atomizer_network.set_handshake(make_shared_buffer(sub));
         m_atomizer_network.cluster_connect(m_opts.m_atomizer_endpoints, false);
         if(!m_atomizer_network.connected_to_one()) {
             m_logger->warn("Failed to connect to any atomizers");
@@ -105,7 +111,7 @@ namespace cbdc::shard {
 
     auto controller::server_handler(cbdc::network::message_t&& pkt)
         -> std::optional<cbdc::buffer> {
-        m_request_queue.push(pkt);
+        m_request_queue.push(std::move(pkt));
         return std::nullopt;
     }
 
@@ -133,19 +139,22 @@ namespace cbdc::shard {
                 break;
             }
 
-            // Attempt to catch up to the latest block
-            for(uint64_t i = m_shard.best_block_height() + 1; i < blk.m_height;
-                i++) {
-                const auto past_blk = m_archiver_client.get_block(i);
-                if(past_blk) {
-                    m_shard.digest_block(past_blk.value());
-                } else {
+            // Attempt to catch up to the latest block, fetching the missing
+            // blocks from the archiver in ranges
+            while(m_shard.best_block_height() + 1 < blk.m_height) {
+                const auto start = m_shard.best_block_height() + 1;
+                const auto past_blks
+                    = m_archiver_client.get_blocks(start,
+                                                   blk.m_height - start);
+                if(!past_blks.has_value() || past_blks->empty()) {
                     m_logger->info("Waiting for archiver sync");
                     const auto wait_time = std::chrono::milliseconds(10);
                     std::this_thread::sleep_for(wait_time);
-                    i--;
                     continue;
                 }
+                for(const auto& past_blk : past_blks.value()) {
+                    m_shard.digest_block(past_blk);
+                }
             }
         }
 
@@ -156,27 +165,34 @@ namespace cbdc::shard {
     void controller::request_consumer() {
         auto pkt = network::message_t();
         while(m_request_queue.pop(pkt)) {
-            auto maybe_tx = from_buffer<transaction::compact_tx>(*pkt.m_pkt);
-            if(!maybe_tx.has_value()) {
+            auto maybe_txs
+                = from_buffer<std::vector<transaction::compact_tx>>(*pkt.m_pkt);
+            if(!maybe_txs.has_value()) {
                 m_logger->error("Invalid transaction packet");
                 continue;
             }
 
-            auto& tx = maybe_tx.value();
-
-            m_logger->info("Digesting transaction", to_string(tx.m_id), "...");
-
-            if(!transaction::validation::check_attestations(
-                   tx,
-                   m_opts.m_sentinel_public_keys,
-                   m_opts.m_attestation_threshold)) {
-                m_logger->warn("Received invalid compact transaction",
-                               to_string(tx.m_id));
-                continue;
+            auto txs = std::vector<transaction::compact_tx>();
+            txs.reserve(maybe_txs->size());
+            for(auto& tx : maybe_txs.value()) {
+                m_logger->info("Digesting transaction",
+                               to_string(tx.m_id),
+                               "...");
+
+                if(!transaction::validation::check_attestations(
+                       tx,
+                       m_opts.m_sentinel_public_keys,
+                       m_opts.m_attestation_threshold)) {
+                    m_logger->warn("Received invalid compact transaction",
+                                   to_string(tx.m_id));
+                    continue;
+                }
+                txs.emplace_back(std::move(tx));
             }
 
-            auto res = m_shard.digest_transaction(std::move(tx));
+            auto results = m_shard.digest_transactions(std::move(txs));
 
+            auto errs = std::vector<cbdc::watchtower::tx_error>();
             auto res_handler = overloaded{
                 [&](const atomizer::tx_notify_request& msg) {
                     m_logger->info("Digested transaction",
@@ -194,16 +210,20 @@ namespace cbdc::shard {
                             to_string(msg.m_tx.m_id));
                     }
                 },
-                [&](const cbdc::watchtower::tx_error& err) {
+                [&](cbdc::watchtower::tx_error& err) {
                     m_logger->info("error for Tx:",
                                    to_string(err.tx_id()),
                                    err.to_string());
-                    // TODO: batch errors into a single RPC
-                    auto data = std::vector<cbdc::watchtower::tx_error>{err};
-                    auto buf = make_shared_buffer(data);
-                    m_watchtower_network.broadcast(buf);
+                    errs.emplace_back(std::move(err));
                 }};
-            std::visit(res_handler, res);
+            for(auto& res : results) {
+                std::visit(res_handler, res);
+            }
+
+            if(!errs.empty()) {
+                auto buf = make_shared_buffer(errs);
+                m_watchtower_network.broadcast(buf);
+            }
         }
     }
 }
@@ -9,6 +9,7 @@
 #include "shard.hpp"
 #include "uhs/atomizer/archiver/client.hpp"
 #include "uhs/atomizer/atomizer/block.hpp"
+#include "util/common/bounded_queue.hpp"
 #include "util/common/config.hpp"
 #include "util/network/connection_manager.hpp"
 
@@ -57,7 +58,8 @@ namespace cbdc::shard {
 
         cbdc::archiver::client m_archiver_client;
 
-        blocking_queue<network::message_t> m_request_queue;
+        static constexpr size_t m_request_queue_size{65536};
+        mpmc_queue<network::message_t> m_request_queue{m_request_queue_size};
         std::vector<std::thread> m_handler_threads;
 
         auto server_handler(cbdc::network::message_t&& pkt)
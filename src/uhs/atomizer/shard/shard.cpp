@@ -5,6 +5,9 @@
 
 #include "shard.hpp"
 
+#include "util/common/hashmap.hpp"
+
+#include <algorithm>
 #include <utility>
 
 namespace cbdc::shard {
@@ -103,8 +106,14 @@ namespace cbdc::shard {
     }
 
     auto shard::digest_transaction(transaction::compact_tx tx)
-        -> std::variant<atomizer::tx_notify_request,
-                        cbdc::watchtower::tx_error> {
+        -> digest_result {
+        auto txs = std::vector<transaction::compact_tx>();
+        txs.emplace_back(std::move(tx));
+        return std::move(digest_transactions(std::move(txs)).front());
+    }
+
+    auto shard::digest_transactions(std::vector<transaction::compact_tx> txs)
+        -> std::vector<digest_result> {
         std::shared_ptr<const leveldb::Snapshot> snp{};
         uint64_t snp_height{};
         {
@@ -113,57 +122,88 @@ namespace cbdc::shard {
             snp = m_snp;
         }
 
+        auto ret = std::vector<digest_result>();
+        ret.reserve(txs.size());
+
         // Don't process transactions until we've heard from the atomizer
         if(snp_height == 0) {
-            return cbdc::watchtower::tx_error{
-                tx.m_id,
-                cbdc::watchtower::tx_error_sync{}};
+            for(auto& tx : txs) {
+                ret.emplace_back(cbdc::watchtower::tx_error{
+                    tx.m_id,
+                    cbdc::watchtower::tx_error_sync{}});
+            }
+            return ret;
         }
 
-        if(tx.m_inputs.empty()) {
-            return cbdc::watchtower::tx_error{
-                tx.m_id,
-                cbdc::watchtower::tx_error_inputs_dne{{}}};
+        // Look up the inputs of the whole batch in key order against a single
+        // snapshot, once per distinct input
+        auto keys = std::vector<hash_t>();
+        for(const auto& tx : txs) {
+            for(const auto& inp : tx.m_inputs) {
+                // Only check for inputs/outputs relevant to this shard
+                if(is_output_on_shard(inp)) {
+                    keys.push_back(inp);
+                }
+            }
         }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
 
         auto read_options = m_read_options;
         read_options.snapshot = snp.get();
 
-        // Check TX inputs exist
-        std::unordered_set<uint64_t> attestations;
-        std::vector<hash_t> dne_inputs;
-        for(uint64_t i = 0; i < tx.m_inputs.size(); i++) {
-            const auto& inp = tx.m_inputs[i];
-            // Only check for inputs/outputs relevant to this shard
-            if(!is_output_on_shard(inp)) {
-                continue;
-            }
-
+        auto unspent = std::unordered_set<hash_t, hashing::null>();
+        unspent.reserve(keys.size());
+        for(const auto& inp : keys) {
             std::array<char, sizeof(inp)> inp_arr{};
             std::memcpy(inp_arr.data(), inp.data(), inp.size());
             leveldb::Slice OutPointKey(inp_arr.data(), inp.size());
             std::string op;
 
             const auto& res = m_db->Get(read_options, OutPointKey, &op);
-            if(res.IsNotFound()) {
-                dne_inputs.push_back(inp);
-            } else {
-                attestations.insert(i);
+            if(!res.IsNotFound()) {
+                unspent.insert(inp);
             }
         }
 
-        if(!dne_inputs.empty()) {
-            return cbdc::watchtower::tx_error{
-                tx.m_id,
-                cbdc::watchtower::tx_error_inputs_dne{dne_inputs}};
-        }
+        for(auto& tx : txs) {
+            if(tx.m_inputs.empty()) {
+                ret.emplace_back(cbdc::watchtower::tx_error{
+                    tx.m_id,
+                    cbdc::watchtower::tx_error_inputs_dne{{}}});
+                continue;
+            }
 
-        atomizer::tx_notify_request msg;
-        msg.m_attestations = std::move(attestations);
-        msg.m_tx = std::move(tx);
-        msg.m_block_height = snp_height;
+            // Check TX inputs exist
+            std::unordered_set<uint64_t> attestations;
+            std::vector<hash_t> dne_inputs;
+            for(uint64_t i = 0; i < tx.m_inputs.size(); i++) {
+                const auto& inp = tx.m_inputs[i];
+                if(!is_output_on_shard(inp)) {
+                    continue;
+                }
+                if(unspent.find(inp) == unspent.end()) {
+                    dne_inputs.push_back(inp);
+                } else {
+                    attestations.insert(i);
+                }
+            }
+
+            if(!dne_inputs.empty()) {
+                ret.emplace_back(cbdc::watchtower::tx_error{
+                    tx.m_id,
+                    cbdc::watchtower::tx_error_inputs_dne{dne_inputs}});
+                continue;
+            }
+
+            atomizer::tx_notify_request msg;
+            msg.m_attestations = std::move(attestations);
+            msg.m_tx = std::move(tx);
+            msg.m_block_height = snp_height;
+            ret.emplace_back(std::move(msg));
+        }
 
-        return msg;
+        return ret;
     }
 
     auto shard::best_block_height() const -> uint64_t {
@@ -35,6 +35,11 @@ namespace cbdc::shard {
     /// blocks from the atomizer to update its internal state.
     class shard {
       public:
+        /// Result of digesting a transaction: a notification to forward to
+        /// the atomizer or an error to forward to the watchtower.
+        using digest_result
+            = std::variant<atomizer::tx_notify_request, watchtower::tx_error>;
+
         /// Constructor. Call open_db() before using.
         /// \param prefix_range the inclusive UHS ID prefix range which this shard should track.
         explicit shard(config::shard_range_t prefix_range);
@@ -49,8 +54,15 @@ namespace cbdc::shard {
         /// transaction error to forward to the watchtower.
         /// \param tx the transaction to digest.
         /// \return result message to forward.
-        auto digest_transaction(transaction::compact_tx tx)
-            -> std::variant<atomizer::tx_notify_request, watchtower::tx_error>;
+        auto digest_transaction(transaction::compact_tx tx) -> digest_result;
+
+        /// Digests a batch of transactions as with \ref digest_transaction.
+        /// All transactions are checked against the same UTXO set snapshot,
+        /// and inputs shared between transactions are looked up once.
+        /// \param txs the transactions to digest.
+        /// \return result message to forward for each transaction, in order.
+        auto digest_transactions(std::vector<transaction::compact_tx> txs)
+            -> std::vector<digest_result>;
 
         /// Updates records to reflect changes from a new, contiguous
         /// transaction block from the atomizer. Deletes spent UTXOs and adds
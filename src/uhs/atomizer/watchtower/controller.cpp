@@ -107,9 +107,11 @@ auto cbdc::watchtower::controller::atomizer_handler(
     if(blk.m_height != (m_last_blk_height + 1)) {
         m_logger->warn("Block not contiguous. Last block:", m_last_blk_height);
         while(blk.m_height != (m_last_blk_height + 1)) {
-            auto missed_blk
-                = m_archiver_client.get_block(m_last_blk_height + 1);
-            if(!missed_blk) {
+            auto missed_blks
+                = m_archiver_client.get_blocks(m_last_blk_height + 1,
+                                               blk.m_height
+                                                   - (m_last_blk_height + 1));
+            if(!missed_blks || missed_blks->empty()) {
                 m_logger->warn("Waiting for archiver sync");
                 static constexpr auto archiver_wait_time
                     = std::chrono::milliseconds(100);
@@ -117,8 +119,10 @@ auto cbdc::watchtower::controller::atomizer_handler(
                 continue;
             }
 
-            m_last_blk_height = (*missed_blk).m_height;
-            m_watchtower.add_block(std::move(*missed_blk));
+            for(auto& missed_blk : *missed_blks) {
+                m_last_blk_height = missed_blk.m_height;
+                m_watchtower.add_block(std::move(missed_blk));
+            }
         }
     }
     m_last_blk_height = blk.m_height;
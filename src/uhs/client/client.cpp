@@ -113,6 +113,7 @@ namespace cbdc {
         // Mark all inputs as pending spend
         for(const auto& in : tx.m_inputs) {
             m_pending_spend.insert({in.hash(), in});
+            m_changes.push_back({pending_change::target::spend, in.hash(), in});
         }
 
         save();
@@ -203,6 +204,8 @@ namespace cbdc {
     void client::import_send_input(const transaction::input& in) {
         if(m_wallet.is_spendable(in)) {
             m_pending_inputs.insert({in.m_prevout.m_tx_id, in});
+            m_changes.push_back(
+                {pending_change::target::inputs, in.m_prevout.m_tx_id, in});
             save();
         } else {
             m_logger->warn("Ignoring non-spendable input");
@@ -232,7 +235,9 @@ namespace cbdc {
     }
 
     void client::import_transaction(const transaction::full_tx& tx) {
-        m_pending_txs.insert({transaction::tx_id(tx), tx});
+        const auto tx_id = transaction::tx_id(tx);
+        m_pending_txs.insert({tx_id, tx});
+        m_changes.push_back({pending_change::target::txs, tx_id, tx});
         save();
     }
 
@@ -256,6 +261,8 @@ namespace cbdc {
         if(it != m_pending_txs.end()) {
             auto tx = it->second;
             m_pending_txs.erase(it);
+            m_changes.push_back(
+                {pending_change::target::txs, tx_id, std::nullopt});
 
             // Add the used inputs back to the wallet if they are still
             // pending and not used in any other pending transaction.
@@ -265,6 +272,9 @@ namespace cbdc {
                     auto pending = check_pending(i);
                     if(!pending) {
                         m_pending_spend.erase(ps_it);
+                        m_changes.push_back({pending_change::target::spend,
+                                             i.hash(),
+                                             std::nullopt});
                         m_wallet.confirm_inputs({i});
                     }
                 }
@@ -288,9 +298,14 @@ namespace cbdc {
                 const auto ps_it = m_pending_spend.find(i.hash());
                 if(ps_it != m_pending_spend.end()) {
                     m_pending_spend.erase(ps_it);
+                    m_changes.push_back({pending_change::target::spend,
+                                         i.hash(),
+                                         std::nullopt});
                 }
             }
             m_pending_txs.erase(it);
+            m_changes.push_back(
+                {pending_change::target::txs, tx_id, std::nullopt});
             success = true;
         }
 
@@ -298,6 +313,8 @@ namespace cbdc {
         if(pi_it != m_pending_inputs.end()) {
             m_wallet.confirm_inputs({pi_it->second});
             m_pending_inputs.erase(pi_it);
+            m_changes.push_back(
+                {pending_change::target::inputs, tx_id, std::nullopt});
             success = true;
         }
 
@@ -309,7 +326,8 @@ namespace cbdc {
     void client::load_client_state() {
         std::ifstream client_file(m_client_file,
                                   std::ios::binary | std::ios::in);
-        if(client_file.good()) {
+        const auto found = client_file.good();
+        if(found) {
             auto deser = cbdc::istream_serializer(client_file);
             if(!(deser >> m_pending_txs >> m_pending_inputs
                  >> m_pending_spend)) {
@@ -318,24 +336,95 @@ namespace cbdc {
         } else {
             m_logger->warn("Existing client file not found");
         }
+
+        auto jnl = journal<pending_change>(m_client_file + ".journal");
+        const auto n_changes = jnl.replay([&](pending_change&& c) {
+            apply_change(std::move(c));
+        });
+        if(n_changes > 0) {
+            m_logger->info("Replayed", n_changes, "client state changes");
+        }
+
+        // Keep appending to the journal just replayed so saving costs time
+        // proportional to the changes since. Without a client file, the
+        // first save writes one.
+        if(found) {
+            m_journal
+                = std::make_unique<journal<pending_change>>(std::move(jnl));
+        }
+    }
+
+    void client::apply_change(pending_change&& c) {
+        switch(c.m_target) {
+            case pending_change::target::txs:
+                if(!c.m_value.has_value()) {
+                    m_pending_txs.erase(c.m_key);
+                } else if(auto* tx = std::get_if<transaction::full_tx>(
+                              &c.m_value.value())) {
+                    m_pending_txs.insert({c.m_key, std::move(*tx)});
+                }
+                break;
+            case pending_change::target::inputs:
+            case pending_change::target::spend: {
+                auto& pending = c.m_target == pending_change::target::inputs
+                                  ? m_pending_inputs
+                                  : m_pending_spend;
+                if(!c.m_value.has_value()) {
+                    pending.erase(c.m_key);
+                } else if(auto* in = std::get_if<transaction::input>(
+                              &c.m_value.value())) {
+                    pending.insert({c.m_key, std::move(*in)});
+                }
+                break;
+            }
+        }
     }
 
     void client::save_client_state() {
-        std::ofstream client_file(m_client_file,
-                                  std::ios::binary | std::ios::trunc
-                                      | std::ios::out);
-        if(!client_file.good()) {
-            m_logger->fatal("Failed to open client file for saving");
+        const auto tmp_file = m_client_file + ".tmp";
+        {
+            std::ofstream client_file(tmp_file,
+                                      std::ios::binary | std::ios::trunc
+                                          | std::ios::out);
+            if(!client_file.good()) {
+                m_logger->fatal("Failed to open client file for saving");
+            }
+            auto ser = cbdc::ostream_serializer(client_file);
+            if(!(ser << m_pending_txs << m_pending_inputs
+                     << m_pending_spend)) {
+                m_logger->fatal("Failed to write client data");
+            }
         }
-        auto ser = cbdc::ostream_serializer(client_file);
-        if(!(ser << m_pending_txs << m_pending_inputs << m_pending_spend)) {
-            m_logger->fatal("Failed to write client data");
+        auto ec = std::error_code();
+        std::filesystem::rename(tmp_file, m_client_file, ec);
+        if(ec) {
+            m_logger->fatal("Failed to replace client file:", ec.message());
         }
     }
 
     void client::save() {
-        save_client_state();
-        m_wallet.save(m_wallet_file);
+        auto compact = !m_journal;
+        if(!m_journal) {
+            m_journal = std::make_unique<journal<pending_change>>(
+                m_client_file + ".journal");
+        } else {
+            if(!m_journal->append(m_changes)) {
+                m_logger->fatal("Failed to write client journal");
+            }
+            const auto live = m_pending_txs.size() + m_pending_inputs.size()
+                            + m_pending_spend.size();
+            compact = m_journal->size() > std::max(live, m_min_journal_size);
+        }
+        m_changes.clear();
+
+        if(compact) {
+            save_client_state();
+            if(!m_journal->clear()) {
+                m_logger->fatal("Failed to clear client journal");
+            }
+        }
+
+        m_wallet.persist(m_wallet_file);
     }
 
     auto client::pending_txs() const
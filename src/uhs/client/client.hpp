@@ -7,8 +7,11 @@
 #define OPENCBDC_TX_SRC_CLIENT_CLIENT_H_
 
 #include "uhs/sentinel/client.hpp"
+#include "uhs/transaction/messages.hpp"
 #include "uhs/transaction/validation.hpp"
 #include "uhs/transaction/wallet.hpp"
+#include "util/common/journal.hpp"
+#include "util/serialization/format.hpp"
 
 namespace cbdc {
     namespace address {
@@ -19,7 +22,12 @@ namespace cbdc {
             -> std::optional<cbdc::hash_t>;
     }
 
-    /// External client for sending new transactions to the system.
+    /// \brief External client for sending new transactions to the system.
+    ///
+    /// Persists its state after every operation. The pending transaction
+    /// and input sets are written to the client file and the wallet to the
+    /// wallet file; changes since then are appended to a journal next to
+    /// each file, which is compacted into the file once it outgrows it.
     class client {
       public:
         /// Constructor.
@@ -297,6 +305,42 @@ namespace cbdc {
         std::string m_client_file;
         std::string m_wallet_file;
 
+        /// Change to the pending state recorded in the client journal.
+        struct pending_change {
+            /// Pending state the change applies to.
+            enum class target : uint8_t {
+                /// m_pending_txs.
+                txs = 0,
+                /// m_pending_inputs.
+                inputs = 1,
+                /// m_pending_spend.
+                spend = 2
+            };
+
+            target m_target{};
+            hash_t m_key{};
+            /// Value to insert under the key, or std::nullopt to erase it.
+            std::optional<
+                std::variant<transaction::full_tx, transaction::input>>
+                m_value;
+
+            friend auto operator<<(serializer& ser, const pending_change& c)
+                -> serializer& {
+                return ser << c.m_target << c.m_key << c.m_value;
+            }
+
+            friend auto operator>>(serializer& deser, pending_change& c)
+                -> serializer& {
+                return deser >> c.m_target >> c.m_key >> c.m_value;
+            }
+        };
+
+        /// Minimum number of journal entries before compacting the journal.
+        static constexpr size_t m_min_journal_size{1024};
+
+        std::unique_ptr<journal<pending_change>> m_journal;
+        std::vector<pending_change> m_changes;
+
         /// Add the provided transaction to the memory pool, awaiting
         /// confirmation from the network.
         /// \param tx transaction to add.
@@ -304,6 +348,7 @@ namespace cbdc {
 
         void load_client_state();
         void save_client_state();
+        void apply_change(pending_change&& c);
 
         void save();
 
@@ -17,7 +17,8 @@ namespace cbdc {
           m_coordinator_client(opts.m_coordinator_endpoints[0]),
           m_shard_status_client(opts.m_locking_shard_readonly_endpoints,
                                 opts.m_shard_ranges,
-                                m_client_timeout),
+                                m_client_timeout,
+                                opts.m_shard_read_max_lag),
           m_logger(logger),
           m_opts(opts) {}
 
@@ -44,9 +45,13 @@ namespace cbdc {
             txids.insert(tx_id);
         }
 
-        for(const auto& tx_id : txids) {
-            m_logger->debug("Requesting status of", to_string(tx_id));
-            auto res = m_shard_status_client.check_tx_id(tx_id);
+        // Check all the TX IDs together so each shard receives one request
+        auto tx_ids = std::vector<hash_t>(txids.begin(), txids.end());
+        m_logger->debug("Requesting status of", tx_ids.size(), "TXs");
+        auto results = m_shard_status_client.check_tx_ids(tx_ids);
+        for(size_t i = 0; i < tx_ids.size(); i++) {
+            const auto& tx_id = tx_ids[i];
+            const auto& res = results[i];
             if(!res.has_value()) {
                 m_logger->error("Timeout waiting for shard response");
                 success = false;
@@ -46,6 +46,20 @@ namespace cbdc::sentinel::rpc {
             });
     }
 
+    auto client::execute_transaction_ref(
+        const transaction::full_tx& tx,
+        std::function<void(execute_result_type)> result_callback) -> bool {
+        return m_client.call_as<execute_request>(
+            tx,
+            [cb = std::move(result_callback)](std::optional<response> res) {
+                if(!res.has_value()) {
+                    cb(std::nullopt);
+                    return;
+                }
+                cb(std::get<execute_response>(res.value()));
+            });
+    }
+
     auto client::validate_transaction(cbdc::transaction::full_tx tx)
         -> std::optional<validate_response> {
         auto res = m_client.call(validate_request{std::move(tx)});
@@ -68,4 +82,19 @@ namespace cbdc::sentinel::rpc {
                 cb(std::get<validate_response>(res.value()));
             });
     }
+
+    auto client::validate_transactions(
+        std::vector<transaction::full_tx> txs,
+        std::function<void(validate_batch_result_type)> result_callback)
+        -> bool {
+        return m_client.call(
+            validate_batch_request{std::move(txs)},
+            [cb = std::move(result_callback)](std::optional<response> res) {
+                if(!res.has_value()) {
+                    cb(std::nullopt);
+                    return;
+                }
+                cb(std::get<validate_batch_response>(std::move(res.value())));
+            });
+    }
 }
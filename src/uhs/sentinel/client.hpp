@@ -57,6 +57,17 @@ namespace cbdc::sentinel::rpc {
             std::function<void(execute_result_type)> result_callback)
             -> bool override;
 
+        /// Send a transaction to the sentinel and return the response via a
+        /// callback function asynchronously. Serializes the request straight
+        /// from the given transaction, so callers which reuse a transaction
+        /// between calls avoid copying it.
+        /// \param tx transaction to send to the sentinel.
+        /// \param result_callback callback function to call with the result.
+        /// \return true if the request was sent successfully.
+        auto execute_transaction_ref(
+            const transaction::full_tx& tx,
+            std::function<void(execute_result_type)> result_callback) -> bool;
+
         /// Return type from transaction validation.
         using validate_result_type = std::optional<validate_response>;
 
@@ -78,6 +89,21 @@ namespace cbdc::sentinel::rpc {
             std::function<void(validate_result_type)> result_callback)
             -> bool override;
 
+        /// Return type from batch transaction validation.
+        using validate_batch_result_type
+            = std::optional<validate_batch_response>;
+
+        /// Send several transactions to the sentinel for validation in a
+        /// single request and return the responses via a callback function
+        /// asynchronously.
+        /// \param txs transactions to validate and attest to.
+        /// \param result_callback callback function to call with the result.
+        /// \return true if the request was sent successfully.
+        auto validate_transactions(
+            std::vector<transaction::full_tx> txs,
+            std::function<void(validate_batch_result_type)> result_callback)
+            -> bool;
+
       private:
         cbdc::config::options m_opts;
         std::shared_ptr<logging::log> m_logger;
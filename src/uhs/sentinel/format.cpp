@@ -18,4 +18,26 @@ namespace cbdc {
         -> serializer& {
         return packet >> r.m_tx_status >> r.m_tx_error;
     }
+
+    auto operator<<(serializer& packet,
+                    const sentinel::validate_batch_request& r)
+        -> serializer& {
+        return packet << r.m_txs;
+    }
+
+    auto operator>>(serializer& packet, sentinel::validate_batch_request& r)
+        -> serializer& {
+        return packet >> r.m_txs;
+    }
+
+    auto operator<<(serializer& packet,
+                    const sentinel::validate_batch_response& r)
+        -> serializer& {
+        return packet << r.m_attestations;
+    }
+
+    auto operator>>(serializer& packet, sentinel::validate_batch_response& r)
+        -> serializer& {
+        return packet >> r.m_attestations;
+    }
 }
@@ -13,6 +13,17 @@ namespace cbdc {
         -> serializer&;
     auto operator>>(serializer& packet, sentinel::execute_response& r)
         -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const sentinel::validate_batch_request& r) -> serializer&;
+    auto operator>>(serializer& packet, sentinel::validate_batch_request& r)
+        -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const sentinel::validate_batch_response& r)
+        -> serializer&;
+    auto operator>>(serializer& packet, sentinel::validate_batch_response& r)
+        -> serializer&;
 }
 
 #endif // OPENCBDC_TX_SRC_SENTINEL_FORMAT_H_
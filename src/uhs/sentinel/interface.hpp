@@ -65,12 +65,27 @@ namespace cbdc::sentinel {
     /// the given transaction.
     using validate_response = transaction::sentinel_attestation;
 
-    /// Sentinel RPC request type. Either a transaction execution or validation
-    /// request.
-    using request = std::variant<execute_request, validate_request>;
-    /// Sentinel RPC response type. Either a transaction execution or
-    /// validation response.
-    using response = std::variant<execute_response, validate_response>;
+    /// Request type for validating and attesting to several transactions
+    /// with one RPC.
+    struct validate_batch_request {
+        /// Transactions to validate.
+        std::vector<transaction::full_tx> m_txs;
+    };
+    /// Response type from batch transaction validation.
+    struct validate_batch_response {
+        /// Sentinel attestation for each transaction in the request, in the
+        /// same order, or std::nullopt if the transaction was invalid.
+        std::vector<std::optional<validate_response>> m_attestations;
+    };
+
+    /// Sentinel RPC request type. Either a transaction execution, validation,
+    /// or batch validation request.
+    using request = std::
+        variant<execute_request, validate_request, validate_batch_request>;
+    /// Sentinel RPC response type. Either a transaction execution, validation,
+    /// or batch validation response.
+    using response = std::
+        variant<execute_response, validate_response, validate_batch_response>;
 
     /// Interface for a sentinel.
     class interface {
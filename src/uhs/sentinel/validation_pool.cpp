@@ -0,0 +1,81 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "validation_pool.hpp"
+
+#include <algorithm>
+#include <memory>
+
+namespace cbdc::sentinel {
+    validation_pool::validation_pool(size_t n_threads, size_t max_queued)
+        : m_max_queued(max_queued) {
+        if(n_threads == 0) {
+            n_threads = std::max(std::thread::hardware_concurrency(), 1U);
+        }
+        m_threads.reserve(n_threads);
+        for(size_t i = 0; i < n_threads; i++) {
+            m_threads.emplace_back([&]() {
+                worker();
+            });
+        }
+    }
+
+    validation_pool::~validation_pool() {
+        {
+            std::unique_lock l(m_mut);
+            m_running = false;
+            m_queue.clear();
+        }
+        m_not_empty.notify_all();
+        m_not_full.notify_all();
+        for(auto& t : m_threads) {
+            if(t.joinable()) {
+                t.join();
+            }
+        }
+    }
+
+    auto validation_pool::push(task_type task) -> bool {
+        {
+            std::unique_lock l(m_mut);
+            m_not_full.wait(l, [&]() {
+                return !m_running || m_queue.size() < m_max_queued;
+            });
+            if(!m_running) {
+                return false;
+            }
+            m_queue.push_back(std::move(task));
+        }
+        m_not_empty.notify_one();
+        return true;
+    }
+
+    auto validation_pool::size() const -> size_t {
+        return m_threads.size();
+    }
+
+    void validation_pool::worker() {
+        auto secp = std::unique_ptr<secp256k1_context,
+                                    decltype(&secp256k1_context_destroy)>(
+            secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
+            &secp256k1_context_destroy);
+        auto task = task_type();
+        while(true) {
+            {
+                std::unique_lock l(m_mut);
+                m_not_empty.wait(l, [&]() {
+                    return !m_running || !m_queue.empty();
+                });
+                if(!m_running) {
+                    return;
+                }
+                task = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            m_not_full.notify_one();
+            task(secp.get());
+        }
+    }
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_SENTINEL_VALIDATION_POOL_H_
+#define OPENCBDC_TX_SRC_SENTINEL_VALIDATION_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <secp256k1.h>
+#include <thread>
+#include <vector>
+
+namespace cbdc::sentinel {
+    /// \brief Pool of threads which validate and attest to transactions.
+    ///
+    /// Moves transaction validation and signing off the RPC handler thread
+    /// so a sentinel uses more than one core. Each thread has its own
+    /// secp256k1 context which it passes to the tasks it runs. Tasks run in
+    /// the order they were pushed but may complete in any order. The queue
+    /// of waiting tasks is bounded, and \ref push blocks while it is full so
+    /// that callers stop accepting new requests.
+    class validation_pool {
+      public:
+        /// Task to run on a validation thread. Receives the thread's
+        /// secp256k1 context.
+        using task_type = std::function<void(secp256k1_context*)>;
+
+        /// Constructor. Starts the validation threads.
+        /// \param n_threads number of validation threads. 0 uses one thread
+        ///                  per hardware thread.
+        /// \param max_queued maximum number of tasks waiting for a thread.
+        validation_pool(size_t n_threads, size_t max_queued);
+
+        /// Destructor. Discards waiting tasks and stops the validation
+        /// threads after their current task.
+        ~validation_pool();
+
+        validation_pool(const validation_pool&) = delete;
+        auto operator=(const validation_pool&) -> validation_pool& = delete;
+        validation_pool(validation_pool&&) = delete;
+        auto operator=(validation_pool&&) -> validation_pool& = delete;
+
+        /// Queues a task to run on a validation thread. Blocks while the
+        /// queue is full. Must not be called from a validation thread.
+        /// \param task task to run.
+        /// \return true if the task was queued, false if the pool is
+        ///         stopping.
+        auto push(task_type task) -> bool;
+
+        /// Returns the number of validation threads.
+        /// \return number of threads.
+        [[nodiscard]] auto size() const -> size_t;
+
+      private:
+        size_t m_max_queued;
+        std::mutex m_mut;
+        std::condition_variable m_not_empty;
+        std::condition_variable m_not_full;
+        std::deque<task_type> m_queue;
+        bool m_running{true};
+        std::vector<std::thread> m_threads;
+
+        void worker();
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_SENTINEL_VALIDATION_POOL_H_
@@ -0,0 +1,163 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "corpus.hpp"
+
+#include "messages.hpp"
+#include "util/serialization/buffer_serializer.hpp"
+#include "util/serialization/format.hpp"
+#include "util/serialization/util.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cbdc::transaction {
+    namespace {
+        /// Identifies corpus files. "CBDCCRP1" in ASCII.
+        constexpr uint64_t corpus_magic{0x3150524343444243};
+        constexpr size_t header_size{sizeof(uint64_t) * 2};
+
+        /// Deserializes a vector into its existing storage, keeping the
+        /// capacity of the elements which remain.
+        template<typename T>
+        auto read_reusing(serializer& deser,
+                          std::vector<T>& vec,
+                          size_t record_size) -> bool {
+            uint64_t len{};
+            if(!(deser >> len)) {
+                return false;
+            }
+            // Each element takes at least one byte, so a corrupt length
+            // cannot trigger a large allocation
+            if(len > record_size) {
+                return false;
+            }
+            vec.resize(len);
+            for(auto& elem : vec) {
+                if constexpr(std::is_same_v<T, witness_t>) {
+                    elem.clear();
+                }
+                if(!(deser >> elem)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    corpus_writer::corpus_writer(std::string file) : m_file(std::move(file)) {}
+
+    auto corpus_writer::init() -> bool {
+        m_out.open(m_file, std::ios::binary | std::ios::trunc | std::ios::out);
+        m_count = 0;
+        m_buf.clear();
+        auto ser = buffer_serializer(m_buf);
+        ser << corpus_magic << m_count;
+        m_out.write(m_buf.c_str(), static_cast<std::streamsize>(m_buf.size()));
+        return m_out.good();
+    }
+
+    auto corpus_writer::append(const std::vector<full_tx>& txs) -> bool {
+        m_buf.clear();
+        auto ser = buffer_serializer(m_buf);
+        for(const auto& tx : txs) {
+            ser << static_cast<uint64_t>(serialized_size(tx)) << tx;
+        }
+        m_out.write(m_buf.c_str(), static_cast<std::streamsize>(m_buf.size()));
+        if(!m_out.good()) {
+            return false;
+        }
+        m_count += txs.size();
+        return true;
+    }
+
+    auto corpus_writer::close() -> bool {
+        m_buf.clear();
+        auto ser = buffer_serializer(m_buf);
+        ser << corpus_magic << m_count;
+        m_out.seekp(0);
+        m_out.write(m_buf.c_str(), static_cast<std::streamsize>(m_buf.size()));
+        m_out.close();
+        return !m_out.fail();
+    }
+
+    auto corpus_writer::size() const -> uint64_t {
+        return m_count;
+    }
+
+    corpus_reader::corpus_reader(std::string file) : m_file(std::move(file)) {}
+
+    corpus_reader::~corpus_reader() {
+        if(m_data != nullptr) {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+            munmap(const_cast<std::byte*>(m_data), m_data_size);
+        }
+    }
+
+    auto corpus_reader::init() -> bool {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+        auto fd = ::open(m_file.c_str(), O_RDONLY);
+        if(fd < 0) {
+            return false;
+        }
+        struct stat st {};
+        if(fstat(fd, &st) != 0
+           || static_cast<size_t>(st.st_size) < header_size) {
+            ::close(fd);
+            return false;
+        }
+        m_data_size = static_cast<size_t>(st.st_size);
+        auto* data
+            = mmap(nullptr, m_data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(data == MAP_FAILED) {
+            return false;
+        }
+        // Transactions are replayed in order
+        madvise(data, m_data_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const std::byte*>(data);
+
+        m_record.clear();
+        m_record.append(m_data, header_size);
+        auto deser = buffer_serializer(m_record);
+        uint64_t magic{};
+        deser >> magic >> m_count;
+        rewind();
+        return magic == corpus_magic;
+    }
+
+    auto corpus_reader::next(full_tx& tx) -> bool {
+        uint64_t len{};
+        if(m_cursor + sizeof(len) > m_data_size) {
+            return false;
+        }
+        // Sizes are serialized in machine byte order
+        std::memcpy(&len, m_data + m_cursor, sizeof(len));
+        if(len > m_data_size - m_cursor - sizeof(len)) {
+            return false;
+        }
+        m_cursor += sizeof(len);
+
+        m_record.clear();
+        m_record.append(m_data + m_cursor, len);
+        m_cursor += len;
+
+        auto deser = buffer_serializer(m_record);
+        return read_reusing(deser, tx.m_inputs, len)
+            && read_reusing(deser, tx.m_outputs, len)
+            && read_reusing(deser, tx.m_witness, len);
+    }
+
+    void corpus_reader::rewind() {
+        m_cursor = header_size;
+    }
+
+    auto corpus_reader::size() const -> uint64_t {
+        return m_count;
+    }
+}
@@ -0,0 +1,105 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_TRANSACTION_CORPUS_H_
+#define OPENCBDC_TX_SRC_TRANSACTION_CORPUS_H_
+
+#include "transaction.hpp"
+#include "util/common/buffer.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace cbdc::transaction {
+    /// \brief Writes a corpus file of signed transactions.
+    ///
+    /// A corpus holds transactions generated ahead of a benchmark so load
+    /// generators can replay them with \ref corpus_reader rather than
+    /// generating and signing them live. The file starts with a header
+    /// holding the number of transactions, followed by each serialized
+    /// transaction prefixed by its size.
+    class corpus_writer {
+      public:
+        /// Constructor. Does not open or create the corpus file.
+        /// \param file path to the corpus file.
+        explicit corpus_writer(std::string file);
+
+        /// Creates the corpus file, replacing any existing file, and writes
+        /// an empty header.
+        /// \return true if the file was created successfully.
+        auto init() -> bool;
+
+        /// Appends the given transactions to the corpus file.
+        /// \param txs transactions to append.
+        /// \return true if the transactions were written successfully.
+        auto append(const std::vector<full_tx>& txs) -> bool;
+
+        /// Writes the final transaction count to the header and closes the
+        /// corpus file.
+        /// \return true if the file was completed successfully.
+        auto close() -> bool;
+
+        /// Returns the number of transactions appended to the corpus.
+        /// \return number of transactions.
+        [[nodiscard]] auto size() const -> uint64_t;
+
+      private:
+        std::string m_file;
+        std::ofstream m_out;
+        uint64_t m_count{};
+        cbdc::buffer m_buf;
+    };
+
+    /// \brief Replays transactions from a corpus file.
+    ///
+    /// Maps the corpus file into memory and decodes transactions in the
+    /// order they were written. Decoding reuses the storage of the caller's
+    /// transaction, so replaying a corpus of similarly-shaped transactions
+    /// does not allocate per transaction. Not thread-safe.
+    /// \see corpus_writer
+    class corpus_reader {
+      public:
+        /// Constructor. Does not open the corpus file.
+        /// \param file path to the corpus file.
+        explicit corpus_reader(std::string file);
+
+        /// Destructor. Unmaps the corpus file.
+        ~corpus_reader();
+
+        corpus_reader(const corpus_reader&) = delete;
+        auto operator=(const corpus_reader&) -> corpus_reader& = delete;
+        corpus_reader(corpus_reader&&) = delete;
+        auto operator=(corpus_reader&&) -> corpus_reader& = delete;
+
+        /// Maps the corpus file into memory and checks its header.
+        /// \return true if the file is a complete corpus.
+        auto init() -> bool;
+
+        /// Decodes the next transaction in the corpus.
+        /// \param tx transaction into which to decode. Its existing storage
+        ///           is reused.
+        /// \return true if a transaction was decoded, false at the end of
+        ///         the corpus or if the next record is corrupt.
+        auto next(full_tx& tx) -> bool;
+
+        /// Returns to the first transaction in the corpus.
+        void rewind();
+
+        /// Returns the number of transactions in the corpus.
+        /// \return number of transactions.
+        [[nodiscard]] auto size() const -> uint64_t;
+
+      private:
+        std::string m_file;
+        const std::byte* m_data{nullptr};
+        size_t m_data_size{};
+        size_t m_cursor{};
+        uint64_t m_count{};
+        cbdc::buffer m_record;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_TRANSACTION_CORPUS_H_
@@ -7,10 +7,12 @@
 
 #include "uhs/transaction/messages.hpp"
 #include "uhs/transaction/validation.hpp"
+#include "util/common/variant_overloaded.hpp"
 #include "util/serialization/format.hpp"
 #include "util/serialization/istream_serializer.hpp"
 #include "util/serialization/ostream_serializer.hpp"
 
+#include <filesystem>
 #include <secp256k1_schnorrsig.h>
 
 namespace cbdc {
@@ -150,6 +152,7 @@ namespace cbdc {
             m_witness_programs.insert(
                 {transaction::validation::get_p2pk_witness_commitment(ret),
                  ret});
+            record(std::make_pair(ret, seckey));
         }
 
         return ret;
@@ -217,20 +220,143 @@ namespace cbdc {
         const std::vector<transaction::input>& debits) {
         std::unique_lock<std::shared_mutex> lu(m_utxos_mut);
         for(const auto& inp : credits) {
-            const auto added = m_utxos_set.insert(inp);
-            if(added.second) {
-                m_balance += inp.m_prevout_data.m_value;
-                m_spend_queue.push_back(inp);
+            if(add_utxo(inp)) {
+                record(inp);
             }
         }
 
         for(const auto& inp : debits) {
-            const auto erased = m_utxos_set.erase(inp) > 0;
-            if(erased) {
-                m_balance -= inp.m_prevout_data.m_value;
+            const auto it = m_utxo_slots.find(inp.m_prevout);
+            if(it != m_utxo_slots.end()) {
+                spend_slot(it->second);
+                record(inp.m_prevout);
             }
         }
-        assert(m_spend_queue.size() == m_utxos_set.size());
+        compact_arena();
+    }
+
+    auto transaction::wallet::out_point_hash::operator()(
+        const out_point& op) const noexcept -> size_t {
+        return hashing::null()(op.m_tx_id) ^ std::hash<uint64_t>()(op.m_index);
+    }
+
+    auto transaction::wallet::add_utxo(const transaction::input& inp)
+        -> bool {
+        const auto slot = m_arena.size();
+        const auto added = m_utxo_slots.emplace(inp.m_prevout, slot).second;
+        if(!added) {
+            return false;
+        }
+        m_arena.push_back(utxo_slot{inp, true});
+        auto& bucket = m_value_buckets[inp.m_prevout_data.m_value];
+        bucket.m_slots.push_back(slot);
+        bucket.m_live++;
+        m_utxo_count++;
+        m_balance += inp.m_prevout_data.m_value;
+        return true;
+    }
+
+    void transaction::wallet::spend_slot(size_t slot) {
+        auto& utxo = m_arena[slot];
+        assert(utxo.m_live);
+        utxo.m_live = false;
+        const auto value = utxo.m_input.m_prevout_data.m_value;
+        m_utxo_slots.erase(utxo.m_input.m_prevout);
+        const auto bucket = m_value_buckets.find(value);
+        if(--bucket->second.m_live == 0) {
+            m_value_buckets.erase(bucket);
+        }
+        m_utxo_count--;
+        m_balance -= value;
+    }
+
+    auto transaction::wallet::next_live_slot(size_t from) const
+        -> std::optional<size_t> {
+        for(auto i = std::max(from, m_arena_head); i < m_arena.size(); i++) {
+            if(m_arena[i].m_live) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+
+    auto transaction::wallet::bucket_slot(value_bucket& bucket) -> size_t {
+        while(!m_arena[bucket.m_slots.back()].m_live) {
+            bucket.m_slots.pop_back();
+        }
+        return bucket.m_slots.back();
+    }
+
+    auto transaction::wallet::select_inputs(uint64_t amount)
+        -> std::vector<transaction::input> {
+        assert(m_balance >= amount);
+        auto ret = std::vector<transaction::input>();
+        uint64_t total{0};
+        auto spend = [&](size_t slot) {
+            const auto& inp = m_arena[slot].m_input;
+            ret.push_back(inp);
+            total += inp.m_prevout_data.m_value;
+            record(inp.m_prevout);
+            spend_slot(slot);
+        };
+
+        if(m_coin_selection == coin_selection::oldest_first) {
+            while(total < amount) {
+                const auto slot = next_live_slot(m_arena_head).value();
+                m_arena_head = slot + 1;
+                spend(slot);
+            }
+            return ret;
+        }
+
+        if(amount == 0) {
+            return ret;
+        }
+
+        if(m_coin_selection == coin_selection::exact_match) {
+            const auto it = m_value_buckets.find(amount);
+            if(it != m_value_buckets.end()) {
+                spend(bucket_slot(it->second));
+                return ret;
+            }
+        }
+
+        // Fewest inputs: a single UTXO with the least change if one covers
+        // the amount, otherwise the largest UTXOs
+        const auto it = m_value_buckets.lower_bound(amount);
+        if(it != m_value_buckets.end()) {
+            spend(bucket_slot(it->second));
+            return ret;
+        }
+        while(total < amount) {
+            spend(bucket_slot(std::prev(m_value_buckets.end())->second));
+        }
+        return ret;
+    }
+
+    void transaction::wallet::compact_arena() {
+        if(m_arena.size() < m_min_arena_size
+           || m_arena.size() < 2 * m_utxo_count) {
+            return;
+        }
+        auto arena = std::move(m_arena);
+        m_arena.clear();
+        m_arena.reserve(m_utxo_count);
+        m_arena_head = 0;
+        m_utxo_count = 0;
+        m_balance = 0;
+        m_utxo_slots.clear();
+        m_value_buckets.clear();
+        for(auto& utxo : arena) {
+            if(utxo.m_live) {
+                add_utxo(utxo.m_input);
+            }
+        }
+    }
+
+    void transaction::wallet::set_coin_selection(coin_selection policy) {
+        std::unique_lock<std::shared_mutex> lu(m_utxos_mut);
+        m_coin_selection = policy;
     }
 
     auto transaction::wallet::seed(const privkey_t& privkey,
@@ -252,6 +378,7 @@ namespace cbdc {
             m_pubkeys.push_back(pubkey);
             m_keys.insert({pubkey, privkey});
             m_witness_programs.insert({witness_commitment, pubkey});
+            record(std::make_pair(pubkey, privkey));
         }
         seed_readonly(witness_commitment, value, begin_seed, end_seed);
         return true;
@@ -297,7 +424,7 @@ namespace cbdc {
 
     auto transaction::wallet::count() const -> size_t {
         std::shared_lock<std::shared_mutex> lg(m_utxos_mut);
-        auto size = m_utxos_set.size();
+        auto size = m_utxo_count;
         if(m_seed_from != m_seed_to) {
             size += (m_seed_to - m_seed_from);
         }
@@ -321,45 +448,153 @@ namespace cbdc {
         }
 
         {
+            // Same encoding as a serialized std::vector<input>, oldest first
             std::shared_lock<std::shared_mutex> lu(m_utxos_mut);
-            ser << m_utxos_set;
+            ser << static_cast<uint64_t>(m_utxo_count);
+            for(const auto& utxo : m_arena) {
+                if(utxo.m_live) {
+                    ser << utxo.m_input;
+                }
+            }
         }
     }
 
     void transaction::wallet::load(const std::string& wallet_file) {
         std::ifstream wal_file(wallet_file, std::ios::binary | std::ios::in);
-        if(wal_file.good()) {
-            auto deser = istream_serializer(wal_file);
-            {
-                std::unique_lock<std::shared_mutex> lk(m_keys_mut);
-
-                m_keys.clear();
-                m_pubkeys.clear();
-                m_witness_programs.clear();
-
-                deser >> m_keys;
-                for(const auto& k : m_keys) {
-                    m_pubkeys.push_back(k.first);
-                    m_witness_programs.insert(
-                        {transaction::validation::get_p2pk_witness_commitment(
-                             k.first),
-                         k.first});
-                }
-            }
+        if(!wal_file.good()) {
+            return;
+        }
 
-            {
-                std::unique_lock<std::shared_mutex> lu(m_utxos_mut);
+        auto keys = decltype(m_keys)();
+        auto utxos = std::vector<input>();
+        auto deser = istream_serializer(wal_file);
+        deser >> keys >> utxos;
+
+        // Changes persisted after the wallet file was written. Replaying
+        // inserts and erases is idempotent, so the journal may overlap the
+        // wallet file if compaction was interrupted.
+        auto utxo_changes = std::vector<change>();
+        auto jnl = journal<change>(journal_file(wallet_file));
+        jnl.replay([&](change c) {
+            if(auto* key = std::get_if<std::pair<pubkey_t, privkey_t>>(&c)) {
+                keys.insert(*key);
+            } else {
+                utxo_changes.emplace_back(std::move(c));
+            }
+        });
 
-                m_utxos_set.clear();
-                m_spend_queue.clear();
-                m_balance = 0;
+        {
+            std::unique_lock<std::shared_mutex> lk(m_keys_mut);
+
+            m_keys = std::move(keys);
+            m_pubkeys.clear();
+            m_witness_programs.clear();
+
+            for(const auto& k : m_keys) {
+                m_pubkeys.push_back(k.first);
+                m_witness_programs.insert(
+                    {transaction::validation::get_p2pk_witness_commitment(
+                         k.first),
+                     k.first});
+            }
+        }
 
-                deser >> m_utxos_set;
-                for(const auto& utxo : m_utxos_set) {
-                    m_balance += utxo.m_prevout_data.m_value;
-                    m_spend_queue.push_back(utxo);
-                }
+        {
+            std::unique_lock<std::shared_mutex> lu(m_utxos_mut);
+
+            m_arena.clear();
+            m_arena.reserve(utxos.size());
+            m_arena_head = 0;
+            m_utxo_count = 0;
+            m_balance = 0;
+            m_utxo_slots.clear();
+            m_value_buckets.clear();
+
+            for(const auto& utxo : utxos) {
+                add_utxo(utxo);
+            }
+            for(const auto& c : utxo_changes) {
+                std::visit(overloaded{[&](const input& inp) {
+                                          add_utxo(inp);
+                                      },
+                                      [&](const out_point& spent) {
+                                          const auto it
+                                              = m_utxo_slots.find(spent);
+                                          if(it != m_utxo_slots.end()) {
+                                              spend_slot(it->second);
+                                          }
+                                      },
+                                      [&](const auto& /* key */) {}},
+                           c);
             }
+            compact_arena();
+        }
+
+        // Keep appending to the journal just replayed, so persisting after
+        // loading costs time proportional to the changes made since
+        std::unique_lock<std::mutex> pl(m_persist_mut);
+        m_journal = std::make_unique<journal<change>>(std::move(jnl));
+        std::unique_lock<std::mutex> l(m_changes_mut);
+        m_recording = true;
+        m_changes.clear();
+    }
+
+    void transaction::wallet::persist(const std::string& wallet_file) {
+        std::unique_lock<std::mutex> pl(m_persist_mut);
+        size_t live{0};
+        {
+            std::shared_lock<std::shared_mutex> lk(m_keys_mut);
+            live += m_keys.size();
+        }
+        {
+            std::shared_lock<std::shared_mutex> lu(m_utxos_mut);
+            live += m_utxo_count;
+        }
+
+        auto changes = std::vector<change>();
+        {
+            std::unique_lock<std::mutex> l(m_changes_mut);
+            m_recording = true;
+            std::swap(changes, m_changes);
+        }
+
+        if(!m_journal || m_journal->file() != journal_file(wallet_file)) {
+            m_journal = std::make_unique<journal<change>>(
+                journal_file(wallet_file));
+            compact(wallet_file);
+            return;
+        }
+
+        // Append even if compacting next, so a journal left behind by an
+        // interrupted compaction still holds every change it covers
+        if(!m_journal->append(changes)) {
+            std::exit(EXIT_FAILURE);
+        }
+
+        if(m_journal->size() > std::max(live, m_min_journal_size)) {
+            compact(wallet_file);
+        }
+    }
+
+    void transaction::wallet::compact(const std::string& wallet_file) {
+        const auto tmp_file = wallet_file + ".tmp";
+        save(tmp_file);
+        auto ec = std::error_code();
+        std::filesystem::rename(tmp_file, wallet_file, ec);
+        if(ec || !m_journal->clear()) {
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    auto transaction::wallet::journal_file(const std::string& wallet_file)
+        -> std::string {
+        return wallet_file + ".journal";
+    }
+
+    void transaction::wallet::record(change c) {
+        std::unique_lock<std::mutex> l(m_changes_mut);
+        if(m_recording) {
+            m_changes.emplace_back(std::move(c));
         }
     }
 
@@ -378,7 +613,7 @@ namespace cbdc {
 
         {
             std::unique_lock<std::shared_mutex> ul(m_utxos_mut);
-            if((m_utxos_set.size() + m_seed_to - m_seed_from) < input_count) {
+            if((m_utxo_count + m_seed_to - m_seed_from) < input_count) {
                 return std::nullopt;
             }
 
@@ -398,12 +633,14 @@ namespace cbdc {
                 seeded_inputs++;
             }
 
-            for(auto utxo = m_spend_queue.begin();
-                (utxo != m_spend_queue.end())
-                && (ret.m_inputs.size() < input_count);
-                utxo++) {
-                ret.m_inputs.push_back(*utxo);
-                total_amount += utxo->m_prevout_data.m_value;
+            auto slots = std::vector<size_t>();
+            for(auto slot = next_live_slot(m_arena_head);
+                slot.has_value() && (ret.m_inputs.size() < input_count);
+                slot = next_live_slot(slot.value() + 1)) {
+                const auto& utxo = m_arena[slot.value()].m_input;
+                ret.m_inputs.push_back(utxo);
+                total_amount += utxo.m_prevout_data.m_value;
+                slots.push_back(slot.value());
             }
 
             output_val = total_amount / output_count;
@@ -414,12 +651,14 @@ namespace cbdc {
                 return std::nullopt;
             }
 
-            for(size_t i = seeded_inputs; i < ret.m_inputs.size(); i++) {
-                auto& inp = ret.m_inputs[i];
-                m_balance -= inp.m_prevout_data.m_value;
-                m_utxos_set.erase(inp);
-                m_spend_queue.pop_front();
+            for(auto slot : slots) {
+                record(m_arena[slot].m_input.m_prevout);
+                spend_slot(slot);
             }
+            if(!slots.empty()) {
+                m_arena_head = slots.back() + 1;
+            }
+            compact_arena();
         }
 
         auto wit_comm
@@ -510,25 +749,19 @@ namespace cbdc {
                 seeded_inputs++;
             }
 
-            auto utxo = m_spend_queue.begin();
-            while((total_amount < amount) && (utxo != m_spend_queue.end())) {
-                ret.m_inputs.push_back(*utxo);
-                ret.m_witness.emplace_back(sig_len, std::byte(0));
-                total_amount += utxo->m_prevout_data.m_value;
-                std::advance(utxo, 1);
-            }
-
-            if(total_amount < amount) {
+            const auto remaining
+                = total_amount < amount ? amount - total_amount : 0;
+            if(m_balance < remaining) {
                 m_seed_from -= seeded_inputs;
                 return std::nullopt;
             }
 
-            for(size_t i = seeded_inputs; i < ret.m_inputs.size(); i++) {
-                const auto del_utxo = m_spend_queue.begin();
-                m_balance -= del_utxo->m_prevout_data.m_value;
-                m_utxos_set.erase(*del_utxo);
-                m_spend_queue.pop_front();
+            for(auto& inp : select_inputs(remaining)) {
+                total_amount += inp.m_prevout_data.m_value;
+                ret.m_inputs.push_back(std::move(inp));
+                ret.m_witness.emplace_back(sig_len, std::byte(0));
             }
+            compact_arena();
         }
         return {{ret, total_amount}};
     }
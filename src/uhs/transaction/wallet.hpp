@@ -9,28 +9,44 @@
 #include "uhs/transaction/transaction.hpp"
 #include "util/common/config.hpp"
 #include "util/common/hashmap.hpp"
+#include "util/common/journal.hpp"
 #include "util/common/random_source.hpp"
 
 #include <atomic>
 #include <fstream>
-#include <list>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <random>
 #include <secp256k1.h>
-#include <set>
 #include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <variant>
 
 namespace cbdc::transaction {
     /// \brief Cryptographic wallet for digital currency assets and secrets.
     ///
     /// Stores unspent transaction outputs (UTXOs), and public/private key
-    /// pairs for Pay-to-Public-Key transaction attestations.
+    /// pairs for Pay-to-Public-Key transaction attestations. UTXOs are kept
+    /// in a contiguous arena in the order they were added, indexed by
+    /// outpoint and by value, so that selecting and removing inputs does not
+    /// depend on the number of UTXOs in the wallet.
     class wallet {
       public:
+        /// Policy for choosing the UTXOs to spend when sending an amount.
+        enum class coin_selection : uint8_t {
+            /// Spend the oldest UTXOs first.
+            oldest_first,
+            /// Spend a single UTXO worth exactly the amount if there is one,
+            /// otherwise select as for fewest_inputs.
+            exact_match,
+            /// Spend the smallest UTXO worth at least the amount if there is
+            /// one, otherwise the largest UTXOs until the amount is covered.
+            fewest_inputs
+        };
+
         /// \brief Constructor.
         ///
         /// Initializes the randomization engine for key shuffling.
@@ -190,10 +206,32 @@ namespace cbdc::transaction {
         void save(const std::string& wallet_file) const;
 
         /// Overwrites the current state of the wallet with data loaded from a
-        /// file saved via the Wallet::save function.
+        /// file saved via the Wallet::save function, and applies any changes
+        /// recorded in the file's journal by \ref persist. Later calls to
+        /// \ref persist for the same file append to that journal.
         /// \param wallet_file path to wallet file location.
         void load(const std::string& wallet_file);
 
+        /// \brief Persists the changes to the wallet since the last call.
+        ///
+        /// The first call for a wallet file not previously passed to
+        /// \ref load saves the whole wallet with \ref save and starts
+        /// recording changes to keys and UTXOs. Later calls append the
+        /// recorded changes to a journal next to the wallet file, so the cost
+        /// is proportional to the number of changes rather than the size of
+        /// the wallet. Once the journal holds more entries than the wallet
+        /// holds keys and UTXOs, it is compacted into a new wallet file.
+        /// Exits the process if writing fails, as \ref save does.
+        /// \param wallet_file path to wallet file location.
+        void persist(const std::string& wallet_file);
+
+        /// Returns the path of the journal \ref persist keeps for the given
+        /// wallet file.
+        /// \param wallet_file path to wallet file location.
+        /// \return journal file path.
+        static auto journal_file(const std::string& wallet_file)
+            -> std::string;
+
         /// \brief Creates a new transaction from seeded outputs.
         ///
         /// Creates a new transaction that receives a spendable input from the
@@ -211,27 +249,56 @@ namespace cbdc::transaction {
         /// \param credits the inputs to add to the wallet's set of UTXOs.
         void confirm_inputs(const std::vector<input>& credits);
 
+        /// Sets the policy used to choose UTXOs in the amount-based
+        /// \ref send_to and \ref fan. Defaults to oldest first. Seeded
+        /// outputs are always spent first.
+        /// \param policy coin selection policy.
+        void set_coin_selection(coin_selection policy);
+
       private:
-        struct cmp_input {
-            auto operator()(const input& lhs, const input& rhs) const -> bool {
-                // First sort by tx hash then output index
-                return std::tie(lhs.m_prevout.m_tx_id, lhs.m_prevout.m_index)
-                     < std::tie(rhs.m_prevout.m_tx_id, rhs.m_prevout.m_index);
-            }
+        struct out_point_hash {
+            auto operator()(const out_point& op) const noexcept -> size_t;
+        };
+
+        /// Slot in the UTXO arena.
+        struct utxo_slot {
+            /// Spendable input.
+            input m_input;
+            /// False once the input is spent. Spent slots are reclaimed
+            /// when the arena is compacted.
+            bool m_live{false};
         };
 
-        /// Locks access to m_utxos and m_balance (the sum of the UTXOs).
+        /// Arena slots of the UTXOs with a given value.
+        struct value_bucket {
+            /// Slot indexes, including spent slots not yet removed.
+            std::vector<size_t> m_slots;
+            /// Number of live slots.
+            size_t m_live{0};
+        };
+
+        /// Locks access to the UTXO arena, its indexes and m_balance (the sum
+        /// of the UTXOs).
         /// \warning Do not lock simultaneously with m_keys_mut.
         mutable std::shared_mutex m_utxos_mut;
         uint64_t m_balance{0};
-        /// Stores the current set of spendable inputs.
-        std::set<input, cmp_input> m_utxos_set;
+        /// Spendable inputs, oldest first.
+        std::vector<utxo_slot> m_arena;
+        /// Index of the first arena slot which may be live.
+        size_t m_arena_head{0};
+        /// Number of live arena slots.
+        size_t m_utxo_count{0};
+        /// Arena slot of each spendable input by outpoint.
+        std::unordered_map<out_point, size_t, out_point_hash> m_utxo_slots;
+        /// Arena slots of spendable inputs by value.
+        std::map<uint64_t, value_bucket> m_value_buckets;
+        coin_selection m_coin_selection{coin_selection::oldest_first};
+        /// Minimum arena size before reclaiming spent slots.
+        static constexpr size_t m_min_arena_size{1024};
         size_t m_seed_from{0};
         size_t m_seed_to{0};
         uint32_t m_seed_value{0};
         hash_t m_seed_witness_commitment{0};
-        /// Queue of spendable inputs, oldest first.
-        std::list<input> m_spend_queue;
 
         /// Locks access to m_keys and related members m_pubkeys and
         /// m_witness_programs.
@@ -249,6 +316,24 @@ namespace cbdc::transaction {
         std::unordered_map<hash_t, pubkey_t, hashing::const_sip_hash<hash_t>>
             m_witness_programs;
 
+        /// Change recorded for the journal: a new key pair, a new UTXO, or
+        /// the outpoint of a spent UTXO.
+        using change
+            = std::variant<std::pair<pubkey_t, privkey_t>, input, out_point>;
+
+        /// Serializes calls to \ref persist and guards m_journal.
+        std::mutex m_persist_mut;
+        std::unique_ptr<journal<change>> m_journal;
+
+        /// Locks access to m_recording and m_changes.
+        /// \warning Lock after m_utxos_mut or m_keys_mut, never before.
+        std::mutex m_changes_mut;
+        bool m_recording{false};
+        std::vector<change> m_changes;
+
+        /// Minimum number of journal entries before compacting the journal.
+        static constexpr size_t m_min_journal_size{1024};
+
         /// Creates a new input from the seed set based on the parameters
         /// passed in a preceding call to the \ref seed function.
         /// \param seed_idx the index in the seed set to generate the input
@@ -274,6 +359,50 @@ namespace cbdc::transaction {
 
         auto accumulate_inputs(uint64_t amount)
             -> std::optional<std::pair<full_tx, uint64_t>>;
+
+        /// Adds an input to the UTXO arena and indexes. Requires a unique
+        /// lock on m_utxos_mut.
+        /// \param inp input to add.
+        /// \return false if the wallet already holds the input.
+        auto add_utxo(const input& inp) -> bool;
+
+        /// Marks an arena slot as spent and removes it from the indexes.
+        /// Requires a unique lock on m_utxos_mut.
+        /// \param slot index of a live arena slot.
+        void spend_slot(size_t slot);
+
+        /// Returns the index of the oldest live arena slot at or after the
+        /// given index, if any.
+        /// \param from arena index to start searching from.
+        /// \return live slot index or std::nullopt.
+        auto next_live_slot(size_t from) const -> std::optional<size_t>;
+
+        /// Returns the index of a live arena slot in the given bucket and
+        /// removes spent slots from the back of the bucket.
+        /// \param bucket value bucket with at least one live slot.
+        /// \return live slot index.
+        auto bucket_slot(value_bucket& bucket) -> size_t;
+
+        /// Spends UTXOs worth at least the given amount according to the
+        /// coin selection policy. Requires a unique lock on m_utxos_mut and
+        /// m_balance to cover the amount.
+        /// \param amount amount to cover.
+        /// \return spent inputs.
+        auto select_inputs(uint64_t amount) -> std::vector<input>;
+
+        /// Reclaims spent arena slots once they outnumber live slots.
+        /// Invalidates slot indexes. Requires a unique lock on m_utxos_mut.
+        void compact_arena();
+
+        /// Records a change for the next call to \ref persist, if
+        /// \ref persist has been called.
+        /// \param c change to record.
+        void record(change c);
+
+        /// Saves the whole wallet to the given file via a temporary file,
+        /// then clears the journal.
+        /// \param wallet_file path to wallet file location.
+        void compact(const std::string& wallet_file);
     };
 }
 
@@ -12,6 +12,7 @@
 #include "util/serialization/format.hpp"
 #include "util/serialization/util.hpp"
 
+#include <cstring>
 #include <utility>
 
 namespace cbdc::coordinator {
@@ -27,7 +28,7 @@ namespace cbdc::coordinator {
           m_shard_endpoints(m_opts.m_locking_shard_endpoints),
           m_shard_ranges(m_opts.m_shard_ranges),
           m_batch_size(m_opts.m_batch_size),
-          m_exec_threads(m_opts.m_coordinator_max_threads) {
+          m_batch_limit(m_batch_size) {
         m_raft_params.election_timeout_lower_bound_
             = static_cast<int>(m_opts.m_election_timeout_lower);
         m_raft_params.election_timeout_upper_bound_
@@ -143,40 +144,43 @@ namespace cbdc::coordinator {
         return nuraft::cb_func::ReturnCode::Ok;
     }
 
-    auto
+    void
     controller::prepare_cb(const hash_t& dtx_id,
-                           const std::vector<transaction::compact_tx>& txs)
-        -> bool {
+                           const std::vector<transaction::compact_tx>& txs,
+                           distributed_tx::phase_result_cb_t result_cb) {
         // Send the prepare status for this dtx ID and the txs contained within
-        // to the coordinator RSM and ensure it replicated (or failed) before
-        // returning.
+        // to the coordinator RSM and report whether it replicated.
         auto comm = sm_command{{state_machine::command::prepare, dtx_id}, txs};
-        return replicate_sm_command(comm).has_value();
+        queue_sm_command(comm, std::move(result_cb));
     }
 
-    auto
+    void
     controller::commit_cb(const hash_t& dtx_id,
                           const std::vector<bool>& complete_txs,
-                          const std::vector<std::vector<uint64_t>>& tx_idxs)
-        -> bool {
+                          const std::vector<std::vector<uint64_t>>& tx_idxs,
+                          distributed_tx::phase_result_cb_t result_cb) {
         // Send the commit status for this dtx ID and the result from prepare,
         // along with the mapping of which txs are relevant to each shard in
-        // the prepare result to the RSM and check if it replicated.
+        // the prepare result to the RSM and report whether it replicated.
         auto comm = sm_command{{state_machine::command::commit, dtx_id},
                                std::make_pair(complete_txs, tx_idxs)};
-        return replicate_sm_command(comm).has_value();
+        queue_sm_command(comm, std::move(result_cb));
     }
 
-    auto controller::discard_cb(const hash_t& dtx_id) -> bool {
-        // Send the discard status for this dtx ID and check if it replicated.
+    void controller::discard_cb(const hash_t& dtx_id,
+                                distributed_tx::phase_result_cb_t result_cb) {
+        // Send the discard status for this dtx ID and report whether it
+        // replicated.
         auto comm = sm_command{{state_machine::command::discard, dtx_id}};
-        return replicate_sm_command(comm).has_value();
+        queue_sm_command(comm, std::move(result_cb));
     }
 
-    auto controller::done_cb(const hash_t& dtx_id) -> bool {
-        // Send the done status for this dtx ID and check if it replicated.
+    void controller::done_cb(const hash_t& dtx_id,
+                             distributed_tx::phase_result_cb_t result_cb) {
+        // Send the done status for this dtx ID and report whether it
+        // replicated.
         auto comm = sm_command{{state_machine::command::done, dtx_id}};
-        return replicate_sm_command(comm).has_value();
+        queue_sm_command(comm, std::move(result_cb));
     }
 
     void controller::stop() {
@@ -201,6 +205,9 @@ namespace cbdc::coordinator {
             }
         }
 
+        // Stop replicating dtx phase changes and fail any that are queued
+        stop_sm_replicator();
+
         // Join the handler and batch execution threads
         if(m_batch_exec_thread.joinable()) {
             m_batch_exec_thread.join();
@@ -297,12 +304,9 @@ namespace cbdc::coordinator {
             batch_set_cbs(*coord);
             auto dtx_id_str = to_string(coord->get_id());
             m_logger->info("Recovering dtx", dtx_id_str);
-            // Create a lambda that handles the execution and cleanup of the
-            // dtx
-            auto f = [&, c{std::move(coord)}, s{std::move(dtx_id_str)}](
-                         size_t thread_idx) {
-                // Execute the dtx from its most recent phase
-                auto exec_res = c->execute();
+            // Create a lambda that handles the result of the dtx
+            auto f = [&, s{std::move(dtx_id_str)}](
+                         std::optional<std::vector<bool>> exec_res) {
                 if(!exec_res) {
                     m_logger->error("Failed to recover dtx", s);
                     // We probably stopped being the leader so set the success
@@ -311,15 +315,10 @@ namespace cbdc::coordinator {
                 } else {
                     m_logger->info("Recovered dtx", s);
                 }
-                // Mark the thread we were using as done so it can be re-used
-                {
-                    std::shared_lock<std::shared_mutex> l(m_exec_mut);
-                    m_exec_threads[thread_idx].second = false;
-                }
             };
-            // Schedule the lambda on an available executor thread. Blocks
-            // until there's a thread available
-            schedule_exec(std::move(f));
+            // Execute the dtx from its most recent phase. Blocks until
+            // there are fewer than the maximum number of dtxs executing.
+            schedule_exec(std::move(coord), std::move(f));
         }
 
         // Make sure we recovered fully before returning
@@ -335,28 +334,33 @@ namespace cbdc::coordinator {
         // the dtxn is currently in as the state machine already knows about
         // it, we can skip re-notification.
         if(s != distributed_tx::dtx_state::prepare) {
-            c.set_prepare_cb([&](auto&& dtx_id, auto&& txs) {
-                return prepare_cb(std::forward<decltype(dtx_id)>(dtx_id),
-                                  std::forward<decltype(txs)>(txs));
+            c.set_prepare_cb([&](auto&& dtx_id, auto&& txs, auto&& cb) {
+                prepare_cb(std::forward<decltype(dtx_id)>(dtx_id),
+                           std::forward<decltype(txs)>(txs),
+                           std::forward<decltype(cb)>(cb));
             });
         }
         if(s != distributed_tx::dtx_state::commit) {
-            c.set_commit_cb(
-                [&](auto&& dtx_id, auto&& complete_txs, auto&& tx_idxs) {
-                    return commit_cb(
-                        std::forward<decltype(dtx_id)>(dtx_id),
-                        std::forward<decltype(complete_txs)>(complete_txs),
-                        std::forward<decltype(tx_idxs)>(tx_idxs));
-                });
+            c.set_commit_cb([&](auto&& dtx_id,
+                                auto&& complete_txs,
+                                auto&& tx_idxs,
+                                auto&& cb) {
+                commit_cb(std::forward<decltype(dtx_id)>(dtx_id),
+                          std::forward<decltype(complete_txs)>(complete_txs),
+                          std::forward<decltype(tx_idxs)>(tx_idxs),
+                          std::forward<decltype(cb)>(cb));
+            });
         }
         if(s != distributed_tx::dtx_state::discard) {
-            c.set_discard_cb([&](auto&& dtx_id) {
-                return discard_cb(std::forward<decltype(dtx_id)>(dtx_id));
+            c.set_discard_cb([&](auto&& dtx_id, auto&& cb) {
+                discard_cb(std::forward<decltype(dtx_id)>(dtx_id),
+                           std::forward<decltype(cb)>(cb));
             });
         }
         if(s != distributed_tx::dtx_state::done) {
-            c.set_done_cb([&](auto&& dtx_id) {
-                return done_cb(std::forward<decltype(dtx_id)>(dtx_id));
+            c.set_done_cb([&](auto&& dtx_id, auto&& cb) {
+                done_cb(std::forward<decltype(dtx_id)>(dtx_id),
+                        std::forward<decltype(cb)>(cb));
             });
         }
     }
@@ -384,6 +388,7 @@ namespace cbdc::coordinator {
             // New batch we're going to swap out with the current batch being
             // built by the handler thread
             auto new_batch = std::shared_ptr<distributed_tx>();
+            size_t batch_limit{};
             {
                 std::shared_lock<std::shared_mutex> l(m_shards_mut);
                 new_batch
@@ -399,6 +404,7 @@ namespace cbdc::coordinator {
                 std::lock_guard<std::mutex> l(m_batch_mut);
                 batch = std::move(m_current_batch);
                 txs = std::move(m_current_txs);
+                batch_limit = m_batch_limit;
                 m_current_batch = std::move(new_batch);
                 batch_set_cbs(*m_current_batch);
                 m_current_txs = std::make_shared<
@@ -409,15 +415,15 @@ namespace cbdc::coordinator {
             // the current batch
             m_batch_cv.notify_one();
 
-            // Lambda to execute the batch and respond to the sentinel with the
-            // result
-            auto f = [&, b{std::move(batch)}, t{std::move(txs)}](
-                         size_t thread_idx) {
-                auto dtxid = to_string(b->get_id());
-                m_logger->info("dtxn start:", dtxid, "size:", t->size());
-                auto s = std::chrono::high_resolution_clock::now();
-                // Execute the batch from the start
-                auto res = b->execute();
+            // Lambda to respond to the sentinel with the result of the batch
+            auto dtxid = to_string(batch->get_id());
+            m_logger->info("dtxn start:", dtxid, "size:", txs->size());
+            auto f = [&,
+                      t{std::move(txs)},
+                      dtxid,
+                      batch_limit,
+                      s{std::chrono::high_resolution_clock::now()}](
+                         std::optional<std::vector<bool>> res) {
                 // For each tx result in the batch create a message with
                 // the txid and the result, and send it to the appropriate
                 // sentinel.
@@ -444,16 +450,14 @@ namespace cbdc::coordinator {
                                    l,
                                    "size:",
                                    res->size());
-                }
-                // Mark our thread as done so it can be re-used
-                {
-                    std::shared_lock<std::shared_mutex> l(m_exec_mut);
-                    m_exec_threads[thread_idx].second = false;
+                    update_batch_limit(e - s, res->size(), batch_limit);
                 }
             };
-            // Schedule our executor lambda, block until there's a thread
-            // available
-            schedule_exec(std::move(f));
+            // Execute the batch from the start, block until there are fewer
+            // than the maximum number of dtxs executing. Earlier batches may
+            // still be in any phase, so the phases of consecutive batches
+            // overlap.
+            schedule_exec(std::move(batch), std::move(f));
         }
     }
 
@@ -468,6 +472,135 @@ namespace cbdc::coordinator {
         return m_raft_serv->replicate_sync(buf);
     }
 
+    void
+    controller::queue_sm_command(const sm_command& c,
+                                 distributed_tx::phase_result_cb_t result_cb) {
+        auto buf = buffer();
+        auto ser = buffer_serializer(buf);
+        ser << c;
+        auto queued = [&]() {
+            std::lock_guard<std::mutex> l(m_sm_mut);
+            if(!m_sm_running) {
+                return false;
+            }
+            m_sm_queue.emplace_back(std::move(buf), std::move(result_cb));
+            return true;
+        }();
+        if(!queued) {
+            result_cb(false);
+            return;
+        }
+        m_sm_cv.notify_one();
+    }
+
+    void controller::sm_replicator_func() {
+        auto cmds = decltype(m_sm_queue)();
+        while(true) {
+            {
+                std::unique_lock<std::mutex> l(m_sm_mut);
+                m_sm_cv.wait(l, [&]() {
+                    return !m_sm_queue.empty() || !m_sm_running;
+                });
+                if(!m_sm_running) {
+                    break;
+                }
+                std::swap(cmds, m_sm_queue);
+            }
+
+            // Replicate every command queued while the previous log entry
+            // was replicating in a single log entry, so concurrent dtxs
+            // share the cost of each raft round trip.
+            auto res = std::optional<nuraft::ptr<nuraft::buffer>>();
+            if(cmds.size() == 1) {
+                const auto& cmd = cmds.front().first;
+                auto buf = nuraft::buffer::alloc(cmd.size());
+                std::memcpy(buf->data_begin(), cmd.data(), cmd.size());
+                res = m_raft_serv->replicate_sync(buf);
+            } else {
+                auto batch = command_batch();
+                batch.reserve(cmds.size());
+                for(auto& cmd : cmds) {
+                    batch.emplace_back(std::move(cmd.first));
+                }
+                auto comm = sm_command{{state_machine::command::batch},
+                                       std::move(batch)};
+                res = replicate_sm_command(comm);
+            }
+
+            for(auto& cmd : cmds) {
+                cmd.second(res.has_value());
+            }
+            cmds.clear();
+        }
+
+        // Fail any commands which were queued after the last log entry
+        {
+            std::lock_guard<std::mutex> l(m_sm_mut);
+            std::swap(cmds, m_sm_queue);
+        }
+        for(auto& cmd : cmds) {
+            cmd.second(false);
+        }
+    }
+
+    void controller::stop_sm_replicator() {
+        {
+            std::lock_guard<std::mutex> l(m_sm_mut);
+            m_sm_running = false;
+        }
+        m_sm_cv.notify_one();
+        if(m_sm_thread.joinable()) {
+            m_sm_thread.join();
+        }
+    }
+
+    void controller::update_batch_limit(std::chrono::nanoseconds latency,
+                                        size_t batch_size,
+                                        size_t batch_limit) {
+        if(m_opts.m_coordinator_batch_latency_target == 0) {
+            return;
+        }
+        auto target = std::chrono::milliseconds(
+            m_opts.m_coordinator_batch_latency_target);
+        {
+            std::lock_guard<std::mutex> l(m_batch_mut);
+            // Only react to batches cut under the current limit, so the
+            // batches already in the pipeline when the limit changes don't
+            // change it again
+            if(batch_limit != m_batch_limit) {
+                return;
+            }
+            auto limit = next_batch_limit(m_batch_limit,
+                                          m_batch_size,
+                                          latency,
+                                          target,
+                                          batch_size);
+            if(limit == m_batch_limit) {
+                return;
+            }
+            m_batch_limit = limit;
+            m_logger->debug("Coordinator batch limit:", m_batch_limit);
+        }
+        m_batch_cv.notify_all();
+    }
+
+    auto controller::next_batch_limit(size_t limit,
+                                      size_t max_limit,
+                                      std::chrono::nanoseconds latency,
+                                      std::chrono::nanoseconds target,
+                                      size_t batch_size) -> size_t {
+        if(latency > target) {
+            // Back off multiplicatively so latency recovers quickly
+            return std::max(limit * 9 / 10, size_t{1});
+        }
+        if(batch_size >= limit) {
+            // Grow additively while full batches complete within the target
+            return std::min(limit + std::max(max_limit / 20, size_t{1}),
+                            max_limit);
+        }
+        return limit;
+    }
+
     void controller::connect_shards() {
         // Make a network::network for each shard cluster and a locking
         // shard client to manage RPCs. Add the clients to the m_shards map so
@@ -488,49 +621,34 @@ namespace cbdc::coordinator {
         }
     }
 
-    void controller::schedule_exec(std::function<void(size_t)>&& f) {
-        // Loop until we successfully scheduled the given lambda on a thread
-        bool found_thread{false};
-        while(!found_thread) {
+    void controller::schedule_exec(std::shared_ptr<distributed_tx> dtx,
+                                   distributed_tx::result_callback_type&& f) {
+        {
+            std::unique_lock l(m_exec_mut);
+            m_exec_cv.wait(l, [&]() {
+                return m_execs < m_opts.m_coordinator_max_threads;
+            });
+            m_execs++;
+        }
+        // The callback holds a reference to the dtx so it stays alive until
+        // it completes. No thread waits on the dtx while it executes.
+        auto* d = dtx.get();
+        d->execute([&, dtx = std::move(dtx), cb = std::move(f)](
+                       std::optional<std::vector<bool>> res) {
+            cb(std::move(res));
             {
-                std::unique_lock<std::shared_mutex> l(m_exec_mut);
-                for(size_t i{0}; i < m_exec_threads.size(); i++) {
-                    auto& thr = m_exec_threads[i];
-                    // If the thread is marked done we can use it
-                    if(!thr.second) {
-                        // Make sure the previous thread is joined
-                        if(thr.first && thr.first->joinable()) {
-                            thr.first->join();
-                        }
-                        // Mark the thread as in-use
-                        thr.second = true;
-                        // Start the thread with the given lambda and provide
-                        // index of the thread so it can mark itself as done
-                        // Not use-after-move because the outer loop exits once
-                        // f has been moved due to found_thread.
-                        thr.first // NOLINTNEXTLINE(bugprone-use-after-move)
-                            = std::make_shared<std::thread>(std::move(f), i);
-                        found_thread = true;
-                        break;
-                    }
-                }
+                std::unique_lock l(m_exec_mut);
+                m_execs--;
             }
-            if(!found_thread) {
-                // For now just yield to the scheduler if there were no
-                // complete threads this time. In the future this could be a
-                // condition variable instead.
-                std::this_thread::yield();
-            }
-        }
+            m_exec_cv.notify_all();
+        });
     }
 
     void controller::join_execs() {
-        std::shared_lock<std::shared_mutex> l(m_exec_mut);
-        for(auto& t : m_exec_threads) {
-            if(t.first && t.first->joinable()) {
-                t.first->join();
-            }
-        }
+        std::unique_lock l(m_exec_mut);
+        m_exec_cv.wait(l, [&]() {
+            return m_execs == 0;
+        });
     }
 
     void controller::start_stop_func() {
@@ -595,6 +713,14 @@ namespace cbdc::coordinator {
         m_logger->warn("Connecting to shards");
         // Connect to the shard clusters
         connect_shards();
+        // Start replicating dtx phase changes before recovering dtxs
+        {
+            std::lock_guard<std::mutex> l(m_sm_mut);
+            m_sm_running = true;
+        }
+        m_sm_thread = std::thread([&] {
+            sm_replicator_func();
+        });
         m_logger->warn("Became leader, recovering dtxs");
         // Attempt recovery of existing dtxs until we stop being the leader or
         // recovery succeeds
@@ -702,7 +828,7 @@ namespace cbdc::coordinator {
             // Wait until there's space in the current batch
             std::unique_lock<std::mutex> l(m_batch_mut);
             m_batch_cv.wait(l, [&]() {
-                return m_current_txs->size() < m_batch_size || !m_running;
+                return m_current_txs->size() < m_batch_limit || !m_running;
             });
             if(!m_running) {
                 return false;
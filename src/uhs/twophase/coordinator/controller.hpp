@@ -81,6 +81,10 @@ namespace cbdc::coordinator {
         using discard_txs
             = std::unordered_set<hash_t, hashing::const_sip_hash<hash_t>>;
 
+        /// Serialized commands which the state machine applies in order
+        /// from a single log entry.
+        using command_batch = std::vector<buffer>;
+
         /// Metadata of a command for the state machine.
         struct sm_command_header {
             /// The type of command.
@@ -98,8 +102,10 @@ namespace cbdc::coordinator {
             /// The command's metadata.
             sm_command_header m_header{};
 
-            /// Associated transactions to prepare or commit, if applicable.
-            std::optional<std::variant<prepare_tx, commit_tx>> m_data{};
+            /// Associated transactions to prepare or commit, or the commands
+            /// in a batch, if applicable.
+            std::optional<std::variant<prepare_tx, commit_tx, command_batch>>
+                m_data{};
         };
 
         /// \brief Current state of distributed transactions managed by a
@@ -135,6 +141,21 @@ namespace cbdc::coordinator {
                                  callback_type result_callback)
             -> bool override;
 
+        /// Returns the batch size limit to use after a batch completes.
+        /// Backs off multiplicatively when the batch missed the latency
+        /// target, and grows additively when a full batch met it.
+        /// \param limit current batch size limit.
+        /// \param max_limit largest allowed batch size limit.
+        /// \param latency time taken to complete the batch.
+        /// \param target batch latency target.
+        /// \param batch_size number of transactions in the batch.
+        /// \return the new batch size limit.
+        static auto next_batch_limit(size_t limit,
+                                     size_t max_limit,
+                                     std::chrono::nanoseconds latency,
+                                     std::chrono::nanoseconds target,
+                                     size_t batch_size) -> size_t;
+
       private:
         size_t m_node_id;
         size_t m_coordinator_id;
@@ -157,13 +178,21 @@ namespace cbdc::coordinator {
                                            hashing::const_sip_hash<hash_t>>>
             m_current_txs;
         size_t m_batch_size;
+        size_t m_batch_limit;
         std::shared_mutex m_shards_mut;
         std::thread m_batch_exec_thread;
         std::unique_ptr<rpc::server> m_rpc_server;
         network::endpoint_t m_handler_endpoint;
-        std::vector<std::pair<std::shared_ptr<std::thread>, std::atomic_bool>>
-            m_exec_threads;
-        std::shared_mutex m_exec_mut;
+        std::mutex m_exec_mut;
+        std::condition_variable m_exec_cv;
+        size_t m_execs{0};
+
+        std::mutex m_sm_mut;
+        std::condition_variable m_sm_cv;
+        bool m_sm_running{false};
+        std::vector<std::pair<buffer, distributed_tx::phase_result_cb_t>>
+            m_sm_queue;
+        std::thread m_sm_thread;
 
         std::thread m_start_thread;
         bool m_start_flag{false};
@@ -186,24 +215,38 @@ namespace cbdc::coordinator {
                            nuraft::cb_func::Param* param)
             -> nuraft::cb_func::ReturnCode;
 
-        auto prepare_cb(const hash_t& dtx_id,
-                        const std::vector<transaction::compact_tx>& txs)
-            -> bool;
-        auto commit_cb(const hash_t& dtx_id,
+        void prepare_cb(const hash_t& dtx_id,
+                        const std::vector<transaction::compact_tx>& txs,
+                        distributed_tx::phase_result_cb_t result_cb);
+        void commit_cb(const hash_t& dtx_id,
                        const std::vector<bool>& complete_txs,
-                       const std::vector<std::vector<uint64_t>>& tx_idxs)
-            -> bool;
-        auto discard_cb(const hash_t& dtx_id) -> bool;
-        auto done_cb(const hash_t& dtx_id) -> bool;
+                       const std::vector<std::vector<uint64_t>>& tx_idxs,
+                       distributed_tx::phase_result_cb_t result_cb);
+        void discard_cb(const hash_t& dtx_id,
+                        distributed_tx::phase_result_cb_t result_cb);
+        void done_cb(const hash_t& dtx_id,
+                     distributed_tx::phase_result_cb_t result_cb);
 
         void batch_set_cbs(distributed_tx& c);
 
         [[nodiscard]] auto replicate_sm_command(const sm_command& c)
             -> std::optional<nuraft::ptr<nuraft::buffer>>;
 
+        void queue_sm_command(const sm_command& c,
+                              distributed_tx::phase_result_cb_t result_cb);
+
+        void sm_replicator_func();
+
+        void stop_sm_replicator();
+
+        void update_batch_limit(std::chrono::nanoseconds latency,
+                                size_t batch_size,
+                                size_t batch_limit);
+
         void connect_shards();
 
-        void schedule_exec(std::function<void(size_t)>&& f);
+        void schedule_exec(std::shared_ptr<distributed_tx> dtx,
+                           distributed_tx::result_callback_type&& f);
 
         void join_execs();
     };
@@ -5,6 +5,7 @@
 
 #include "distributed_tx.hpp"
 
+#include <algorithm>
 #include <future>
 
 namespace cbdc::coordinator {
@@ -20,156 +21,208 @@ namespace cbdc::coordinator {
         assert(!m_shards.empty());
     }
 
-    auto distributed_tx::prepare() -> std::optional<std::vector<bool>> {
-        if(m_prepare_cb) {
-            auto res = m_prepare_cb(m_dtx_id, m_full_txs);
+    auto distributed_tx::execute() -> std::optional<std::vector<bool>> {
+        auto res = std::promise<std::optional<std::vector<bool>>>();
+        auto res_fut = res.get_future();
+        execute([&](std::optional<std::vector<bool>> r) {
+            res.set_value(std::move(r));
+        });
+        return res_fut.get();
+    }
+
+    void distributed_tx::execute(result_callback_type result_callback) {
+        m_result_callback = std::move(result_callback);
+        switch(m_state) {
+            case dtx_state::start:
+            case dtx_state::prepare:
+                prepare();
+                break;
+            case dtx_state::commit:
+                commit();
+                break;
+            case dtx_state::discard:
+                discard();
+                break;
+            case dtx_state::done:
+                finish(m_complete_txs);
+                break;
+            case dtx_state::failed:
+                finish(std::nullopt);
+                break;
+        }
+    }
+
+    void distributed_tx::start_phase(size_t n_requests) {
+        std::unique_lock l(m_phase_mut);
+        // One extra count for the thread issuing the requests, so the phase
+        // can't complete until every request has been issued
+        m_pending_requests = n_requests + 1;
+        m_phase_failed = false;
+    }
+
+    auto distributed_tx::shard_result(bool success) -> bool {
+        std::unique_lock l(m_phase_mut);
+        if(!success) {
+            m_phase_failed = true;
+        }
+        return --m_pending_requests == 0;
+    }
+
+    void distributed_tx::finish(std::optional<std::vector<bool>> res) {
+        if(!res.has_value()) {
+            m_state = dtx_state::failed;
+        }
+        // The callback may destroy the dtx
+        auto cb = std::move(m_result_callback);
+        cb(std::move(res));
+    }
+
+    void distributed_tx::prepare() {
+        auto dtxid_str = to_string(m_dtx_id);
+        m_logger->info("Preparing", dtxid_str);
+        if(!m_prepare_cb) {
+            prepare_shards();
+            return;
+        }
+        m_prepare_cb(m_dtx_id, m_full_txs, [&](bool res) {
             if(!res) {
-                m_state = dtx_state::failed;
-                return std::nullopt;
+                finish(std::nullopt);
+                return;
             }
-        }
-        auto futures = std::vector<
-            std::pair<std::future<std::optional<std::vector<bool>>>,
-                      size_t>>();
+            prepare_shards();
+        });
+    }
+
+    void distributed_tx::prepare_shards() {
+        m_prepare_results = std::vector<bool>(m_full_txs.size(), true);
+        auto n_requests = std::count_if(m_tx_idxs.begin(),
+                                        m_tx_idxs.end(),
+                                        [](const auto& idxs) {
+                                            return !idxs.empty();
+                                        });
+        start_phase(static_cast<size_t>(n_requests));
         for(size_t i{0}; i < m_shards.size(); i++) {
             if(m_tx_idxs[i].empty()) {
                 continue;
             }
-            const auto& shard = m_shards[i];
-            auto f = std::async(std::launch::async,
-                                &locking_shard::interface::lock_outputs,
-                                shard,
-                                std::move(m_txs[i]),
-                                m_dtx_id);
-            futures.emplace_back(std::move(f), i);
+            m_shards[i]->async_lock_outputs(
+                std::move(m_txs[i]),
+                m_dtx_id,
+                [&, i](std::optional<std::vector<bool>> res) {
+                    prepare_result(i, std::move(res));
+                });
         }
-        auto ret = std::vector<bool>(m_full_txs.size(), true);
-        for(auto& f : futures) {
-            auto res = f.first.get();
-            if(!res) {
-                m_state = dtx_state::failed;
-                return std::nullopt;
-            }
-            if(res->size() != m_tx_idxs[f.second].size()) {
+        if(shard_result(true)) {
+            prepared();
+        }
+    }
+
+    void
+    distributed_tx::prepare_result(size_t shard_idx,
+                                   std::optional<std::vector<bool>> res) {
+        if(res.has_value()) {
+            const auto& idxs = m_tx_idxs[shard_idx];
+            if(res->size() != idxs.size()) {
                 m_logger->fatal(
                     "Shard prepare response has not enough statuses",
                     to_string(m_dtx_id),
                     "expected:",
-                    m_tx_idxs[f.second].size(),
+                    idxs.size(),
                     "got:",
                     res->size());
             }
+            std::unique_lock l(m_phase_mut);
             for(size_t i{0}; i < res->size(); i++) {
                 if(!(*res)[i]) {
-                    ret[m_tx_idxs[f.second][i]] = false;
+                    m_prepare_results[idxs[i]] = false;
                 }
             }
         }
+        if(shard_result(res.has_value())) {
+            prepared();
+        }
+    }
+
+    void distributed_tx::prepared() {
+        if(m_phase_failed) {
+            finish(std::nullopt);
+            return;
+        }
+        m_complete_txs = std::move(m_prepare_results);
+        if(m_complete_txs.size() != m_full_txs.size()) {
+            m_logger->fatal("Prepare has incorrect number of statuses",
+                            to_string(m_dtx_id),
+                            "expected:",
+                            m_full_txs.size(),
+                            "got:",
+                            m_complete_txs.size());
+        }
         m_state = dtx_state::commit;
-        return ret;
+        m_logger->info("Prepared", to_string(m_dtx_id));
+        commit();
     }
 
-    auto distributed_tx::commit(const std::vector<bool>& complete_txs)
-        -> bool {
-        if(m_commit_cb) {
-            auto res = m_commit_cb(m_dtx_id, complete_txs, m_tx_idxs);
+    void distributed_tx::commit() {
+        auto dtxid_str = to_string(m_dtx_id);
+        m_logger->info("Committing", dtxid_str);
+        if(!m_commit_cb) {
+            commit_shards();
+            return;
+        }
+        m_commit_cb(m_dtx_id, m_complete_txs, m_tx_idxs, [&](bool res) {
             if(!res) {
-                m_state = dtx_state::failed;
-                return false;
+                finish(std::nullopt);
+                return;
             }
-        }
-        auto futures = std::vector<std::future<bool>>();
+            commit_shards();
+        });
+    }
+
+    void distributed_tx::commit_shards() {
+        auto n_requests = std::count_if(m_tx_idxs.begin(),
+                                        m_tx_idxs.end(),
+                                        [](const auto& idxs) {
+                                            return !idxs.empty();
+                                        });
+        start_phase(static_cast<size_t>(n_requests));
         for(size_t i{0}; i < m_shards.size(); i++) {
             if(m_tx_idxs[i].empty()) {
                 continue;
             }
-            const auto& shard = m_shards[i];
             auto shard_complete_txs = std::vector<bool>(m_tx_idxs[i].size());
             for(size_t j{0}; j < shard_complete_txs.size(); j++) {
-                shard_complete_txs[j] = complete_txs[m_tx_idxs[i][j]];
+                shard_complete_txs[j] = m_complete_txs[m_tx_idxs[i][j]];
             }
-            auto f = std::async(std::launch::async,
-                                &locking_shard::interface::apply_outputs,
-                                shard,
-                                std::move(shard_complete_txs),
-                                m_dtx_id);
-            futures.emplace_back(std::move(f));
+            m_shards[i]->async_apply_outputs(std::move(shard_complete_txs),
+                                             m_dtx_id,
+                                             [&](bool res) {
+                                                 if(shard_result(res)) {
+                                                     committed();
+                                                 }
+                                             });
         }
-        for(auto& f : futures) {
-            auto res = f.get();
-            if(!res) {
-                m_state = dtx_state::failed;
-                return false;
-            }
+        if(shard_result(true)) {
+            committed();
         }
-        m_state = dtx_state::discard;
-        return true;
     }
 
-    auto distributed_tx::execute() -> std::optional<std::vector<bool>> {
-        auto dtxid_str = to_string(m_dtx_id);
-        if(m_state == dtx_state::prepare || m_state == dtx_state::start) {
-            m_logger->info("Preparing", dtxid_str);
-            auto res = prepare();
-            if(!res) {
-                return std::nullopt;
-            }
-            m_complete_txs = std::move(*res);
-            if(m_complete_txs.size() != m_full_txs.size()) {
-                m_logger->fatal("Prepare has incorrect number of statuses",
-                                dtxid_str,
-                                "expected:",
-                                m_full_txs.size(),
-                                "got:",
-                                m_complete_txs.size());
-            }
-            m_logger->info("Prepared", dtxid_str);
+    void distributed_tx::committed() {
+        if(m_phase_failed) {
+            finish(std::nullopt);
+            return;
         }
-        if(m_state == dtx_state::commit) {
-            m_logger->info("Committing", dtxid_str);
-            auto res = commit(m_complete_txs);
-            if(!res) {
-                return std::nullopt;
-            }
-            m_logger->info("Committed", dtxid_str);
-        }
-        if(m_state == dtx_state::discard) {
-            m_logger->info("Discarding", dtxid_str);
-            auto res = discard();
-            if(!res) {
-                return std::nullopt;
-            }
-            m_logger->info("Discarded", dtxid_str);
-        }
-        return m_complete_txs;
+        m_state = dtx_state::discard;
+        m_logger->info("Committed", to_string(m_dtx_id));
+        discard();
     }
 
     auto distributed_tx::add_tx(const transaction::compact_tx& tx) -> size_t {
         for(size_t i{0}; i < m_shards.size(); i++) {
-            const auto& shard = m_shards[i];
-            auto stx = locking_shard::tx();
-            stx.m_tx = tx;
-            bool active{false};
-            if(shard->hash_in_shard_range(tx.m_id)) {
-                active = true;
-            } else {
-                for(const auto& inp : tx.m_inputs) {
-                    if(shard->hash_in_shard_range(inp)) {
-                        active = true;
-                        break;
-                    }
-                }
-                if(!active) {
-                    for(const auto& out : tx.m_uhs_outputs) {
-                        if(shard->hash_in_shard_range(out)) {
-                            active = true;
-                            break;
-                        }
-                    }
-                }
-            }
-            if(active) {
-                m_txs[i].emplace_back(std::move(stx));
+            // Each shard only receives the parts of the transaction in its
+            // range
+            auto stx = m_shards[i]->project_tx(tx);
+            if(stx.has_value()) {
+                m_txs[i].emplace_back(std::move(stx.value()));
                 m_tx_idxs[i].emplace_back(m_full_txs.size());
             }
         }
@@ -177,42 +230,66 @@ namespace cbdc::coordinator {
         return m_full_txs.size() - 1;
     }
 
-    auto distributed_tx::discard() -> bool {
-        if(m_discard_cb) {
-            auto res = m_discard_cb(m_dtx_id);
+    void distributed_tx::discard() {
+        auto dtxid_str = to_string(m_dtx_id);
+        m_logger->info("Discarding", dtxid_str);
+        if(!m_discard_cb) {
+            discard_shards();
+            return;
+        }
+        m_discard_cb(m_dtx_id, [&](bool res) {
             if(!res) {
-                m_state = dtx_state::failed;
-                return false;
+                finish(std::nullopt);
+                return;
             }
-        }
-        auto futures = std::vector<std::future<bool>>();
+            discard_shards();
+        });
+    }
+
+    void distributed_tx::discard_shards() {
+        auto n_requests = std::count_if(m_tx_idxs.begin(),
+                                        m_tx_idxs.end(),
+                                        [](const auto& idxs) {
+                                            return !idxs.empty();
+                                        });
+        start_phase(static_cast<size_t>(n_requests));
         for(size_t i{0}; i < m_shards.size(); i++) {
             if(m_tx_idxs[i].empty()) {
                 continue;
             }
-            const auto& shard = m_shards[i];
-            auto f = std::async(std::launch::async,
-                                &locking_shard::interface::discard_dtx,
-                                shard,
-                                m_dtx_id);
-            futures.emplace_back(std::move(f));
+            m_shards[i]->async_discard_dtx(m_dtx_id, [&](bool res) {
+                if(shard_result(res)) {
+                    discarded();
+                }
+            });
         }
-        for(auto& f : futures) {
-            auto res = f.get();
-            if(!res) {
-                m_state = dtx_state::failed;
-                return false;
-            }
+        if(shard_result(true)) {
+            discarded();
+        }
+    }
+
+    void distributed_tx::discarded() {
+        if(m_phase_failed) {
+            finish(std::nullopt);
+            return;
         }
-        if(m_done_cb) {
-            auto res = m_done_cb(m_dtx_id);
+        if(!m_done_cb) {
+            done();
+            return;
+        }
+        m_done_cb(m_dtx_id, [&](bool res) {
             if(!res) {
-                m_state = dtx_state::failed;
-                return false;
+                finish(std::nullopt);
+                return;
             }
-        }
+            done();
+        });
+    }
+
+    void distributed_tx::done() {
         m_state = dtx_state::done;
-        return true;
+        m_logger->info("Discarded", to_string(m_dtx_id));
+        finish(m_complete_txs);
     }
 
     auto distributed_tx::get_id() const -> hash_t {
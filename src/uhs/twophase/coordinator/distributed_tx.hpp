@@ -12,14 +12,19 @@
 #include "util/common/random_source.hpp"
 #include "util/raft/node.hpp"
 
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 namespace cbdc::coordinator {
     /// Class to manage a single distributed transaction (dtx) batch between
     /// shards. Capable of recovering previously failed dtxs and sharing the
     /// results of each dtx phase with callback functions (usually for
-    /// replication).
+    /// replication). Each phase issues its shard requests asynchronously and
+    /// moves to the next phase from the callback of the last shard to
+    /// respond, so no thread waits on a shard. Phase callbacks report their
+    /// results asynchronously in the same way.
     class distributed_tx {
       public:
         /// Constructs a new transaction coordinator instance
@@ -35,13 +40,33 @@ namespace cbdc::coordinator {
 
         /// Executes the dtx batch to completion or failure, either from start,
         /// or an intermediate state if one of the recover functions were used.
+        /// Blocks until the dtx completes.
         /// \return empty optional if the dtx failed, or a vector of flags
         ///         indicating which constituent transactions settled and which
         ///         were rolled back by the transaction's index in the batch.
         [[nodiscard]] auto execute() -> std::optional<std::vector<bool>>;
 
+        /// Callback function type for the result of an asynchronous dtx
+        /// execution. Receives the same value \ref execute returns.
+        using result_callback_type
+            = std::function<void(std::optional<std::vector<bool>>)>;
+
+        /// Executes the dtx batch asynchronously, either from start, or an
+        /// intermediate state if one of the recover functions were used.
+        /// Each phase starts on the thread which reports the result of its
+        /// phase callback, and the result callback runs on the thread which
+        /// completes the last operation of the dtx, possibly before this
+        /// method returns. The dtx must not be destroyed before
+        /// the result callback is called. The dtx does not access its state
+        /// after calling the result callback, so the callback may destroy
+        /// it.
+        /// \param result_callback function to call once with the result of
+        ///                        the dtx.
+        void execute(result_callback_type result_callback);
+
         /// Adds a TX to the batch managed by this coordinator and dtx ID.
-        /// Should not be used after calling execute().
+        /// Each shard the TX touches receives only its in-range inputs and
+        /// outputs. Should not be used after calling execute().
         /// \param tx compact transaction to add
         /// \return the index of the transaction withing the dtx batch
         auto add_tx(const transaction::compact_tx& tx) -> size_t;
@@ -50,49 +75,55 @@ namespace cbdc::coordinator {
         /// \return dtx ID for this coordinator
         [[nodiscard]] auto get_id() const -> hash_t;
 
-        using discard_cb_t = std::function<bool(const hash_t&)>;
-        using done_cb_t = std::function<bool(const hash_t&)>;
+        /// Callback function type with which phase callbacks report
+        /// whether their operation was successful. Reporting false halts
+        /// further execution of the dtx and sets the dtx state to failed.
+        using phase_result_cb_t = std::function<void(bool)>;
+
+        using discard_cb_t
+            = std::function<void(const hash_t&, phase_result_cb_t)>;
+        using done_cb_t
+            = std::function<void(const hash_t&, phase_result_cb_t)>;
         using commit_cb_t
-            = std::function<bool(const hash_t&,
+            = std::function<void(const hash_t&,
                                  const std::vector<bool>&,
-                                 const std::vector<std::vector<uint64_t>>&)>;
+                                 const std::vector<std::vector<uint64_t>>&,
+                                 phase_result_cb_t)>;
         using prepare_cb_t
-            = std::function<bool(const hash_t&,
-                                 const std::vector<transaction::compact_tx>&)>;
+            = std::function<void(const hash_t&,
+                                 const std::vector<transaction::compact_tx>&,
+                                 phase_result_cb_t)>;
 
         /// Registers a callback to be called before starting the prepare phase
-        /// of the dtx
-        /// \param cb callback function taking the dtx ID and a vector of
-        ///           transactions in the dtx. Returns true if the callback
-        ///           operation was successful. Returning false halts further
-        ///           execution of the dtx and sets the dtx state to failed.
+        /// of the dtx. The phase starts once the callback reports its result,
+        /// which it may do asynchronously.
+        /// \param cb callback function taking the dtx ID, a vector of
+        ///           transactions in the dtx and a function to call with the
+        ///           result of the callback operation.
         void set_prepare_cb(const prepare_cb_t& cb);
 
         /// Registers a callback to be called before starting the commit phase
-        /// of the dtx
+        /// of the dtx. The phase starts once the callback reports its result,
+        /// which it may do asynchronously.
         /// \param cb callback function taking the dtx ID, a vector of flags
-        ///           indicating which transactions to complete, and a vector
+        ///           indicating which transactions to complete, a vector
         ///           of vectors indicating the indexes for each shard included
-        ///           in the complete transactions vector. Returns true if the
-        ///           callback operation was successful. Returning false halts
-        ///           further execution of the dtx and sets the dtx state to
-        ///           failed.
+        ///           in the complete transactions vector, and a function to
+        ///           call with the result of the callback operation.
         void set_commit_cb(const commit_cb_t& cb);
 
         /// Registers a callback to be called before the discard phase of the
-        /// dtx is started
-        /// \param cb callback function taking the dtx ID as argument and
-        ///           returning true if the callback operation was successful.
-        ///           Returning false halts further execution of the dtx and
-        ///           sets the dtx state to failed.
+        /// dtx is started. The phase starts once the callback reports its
+        /// result, which it may do asynchronously.
+        /// \param cb callback function taking the dtx ID and a function to
+        ///           call with the result of the callback operation.
         void set_discard_cb(const discard_cb_t& cb);
 
         /// Registers a callback to be called before the done phase of the dtx
-        /// is started
-        /// \param cb callback function taking the dtx ID as argument and
-        ///           returning true if the callback operation was successful.
-        ///           Returning false halts further execution of the dtx and
-        ///           sets the dtx state to failed.
+        /// is started. The dtx completes once the callback reports its
+        /// result, which it may do asynchronously.
+        /// \param cb callback function taking the dtx ID and a function to
+        ///           call with the result of the callback operation.
         void set_done_cb(const done_cb_t& cb);
 
         /// Sets the state of the dtx to prepare and re-adds all the txs
@@ -145,12 +176,34 @@ namespace cbdc::coordinator {
         [[nodiscard]] auto get_state() const -> dtx_state;
 
       private:
-        [[nodiscard]] auto prepare() -> std::optional<std::vector<bool>>;
+        void prepare();
+
+        void prepare_shards();
+
+        void prepare_result(size_t shard_idx,
+                            std::optional<std::vector<bool>> res);
+
+        void prepared();
+
+        void commit();
+
+        void commit_shards();
 
-        [[nodiscard]] auto commit(const std::vector<bool>& complete_txs)
-            -> bool;
+        void committed();
 
-        auto discard() -> bool;
+        void discard();
+
+        void discard_shards();
+
+        void discarded();
+
+        void done();
+
+        void start_phase(size_t n_requests);
+
+        auto shard_result(bool success) -> bool;
+
+        void finish(std::optional<std::vector<bool>> res);
 
         hash_t m_dtx_id;
         std::vector<std::shared_ptr<locking_shard::interface>> m_shards;
@@ -164,6 +217,12 @@ namespace cbdc::coordinator {
         dtx_state m_state{dtx_state::start};
         std::vector<bool> m_complete_txs;
         std::shared_ptr<logging::log> m_logger;
+
+        result_callback_type m_result_callback;
+        std::mutex m_phase_mut;
+        size_t m_pending_requests{};
+        bool m_phase_failed{false};
+        std::vector<bool> m_prepare_results;
     };
 }
 
@@ -43,6 +43,13 @@ namespace cbdc {
                 ser << data;
                 break;
             }
+            case coordinator::state_machine::command::batch: {
+                const auto& data
+                    = std::get<coordinator::controller::command_batch>(
+                        c.m_data.value());
+                ser << data;
+                break;
+            }
             // Discard, done and get don't have a payload
             case coordinator::state_machine::command::discard:
             case coordinator::state_machine::command::done:
@@ -10,11 +10,18 @@
 #include "util/raft/serialization.hpp"
 #include "util/serialization/util.hpp"
 
+#include <cstring>
+
 namespace cbdc::coordinator {
     auto state_machine::commit(uint64_t log_idx, nuraft::buffer& data)
         -> nuraft::ptr<nuraft::buffer> {
         assert(log_idx == m_last_committed_idx + 1);
         m_last_committed_idx = log_idx;
+        return apply(data);
+    }
+
+    auto state_machine::apply(nuraft::buffer& data)
+        -> nuraft::ptr<nuraft::buffer> {
         auto comm = cbdc::coordinator::controller::sm_command_header();
         auto deser = cbdc::nuraft_serializer(data);
         // Deserialize the header from the state machine command
@@ -87,6 +94,18 @@ namespace cbdc::coordinator {
                 assert(ser.end_of_buffer());
                 return ret;
             }
+            case command::batch: {
+                // Apply each of the serialized commands in the batch in the
+                // order the coordinator issued them
+                auto cmds = cbdc::coordinator::controller::command_batch();
+                deser >> cmds;
+                for(const auto& cmd : cmds) {
+                    auto cmd_buf = nuraft::buffer::alloc(cmd.size());
+                    std::memcpy(cmd_buf->data_begin(), cmd.data(), cmd.size());
+                    apply(*cmd_buf);
+                }
+                break;
+            }
         }
         return nullptr;
     }
@@ -32,7 +32,8 @@ namespace cbdc::coordinator {
             commit = 1,  ///< Moves a dtx from prepare to commit.
             discard = 2, ///< Moves a dtx from commit to discard.
             done = 3,    ///< Clears the dtx from the coordinator state.
-            get = 4      ///< Retrieves all active dtxs.
+            get = 4,     ///< Retrieves all active dtxs.
+            batch = 5    ///< Applies a list of commands in order.
         };
 
         /// Used to store dtxs, which phase they are in and relevant data
@@ -88,6 +89,8 @@ namespace cbdc::coordinator {
             nuraft::async_result<bool>::handler_type& when_done) override;
 
       private:
+        auto apply(nuraft::buffer& data) -> nuraft::ptr<nuraft::buffer>;
+
         std::atomic<uint64_t> m_last_committed_idx{0};
         coordinator_state m_state{};
         std::shared_ptr<logging::log> m_logger;
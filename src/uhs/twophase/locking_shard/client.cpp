@@ -8,12 +8,18 @@
 #include "format.hpp"
 #include "util/serialization/format.hpp"
 
+#include <future>
+
 namespace cbdc::locking_shard::rpc {
     client::client(std::vector<network::endpoint_t> endpoints,
                    const std::pair<uint8_t, uint8_t>& output_range,
-                   logging::log& logger)
+                   logging::log& logger,
+                   std::chrono::milliseconds initial_timeout,
+                   std::chrono::milliseconds max_timeout)
         : interface(output_range),
-          m_log(logger) {
+          m_log(logger),
+          m_initial_timeout(initial_timeout),
+          m_max_timeout(max_timeout) {
         m_client = std::make_unique<decltype(m_client)::element_type>(
             std::move(endpoints));
     }
@@ -23,7 +29,13 @@ namespace cbdc::locking_shard::rpc {
     }
 
     auto client::init() -> bool {
-        return m_client->init();
+        if(!m_client->init()) {
+            return false;
+        }
+        m_retry_thread = std::thread([&]() {
+            retry_loop();
+        });
+        return true;
     }
 
     auto client::lock_outputs(std::vector<tx>&& txs, const hash_t& dtx_id)
@@ -49,27 +61,169 @@ namespace cbdc::locking_shard::rpc {
         return res.has_value();
     }
 
+    void client::async_lock_outputs(std::vector<tx>&& txs,
+                                    const hash_t& dtx_id,
+                                    const lock_callback_type& result_callback) {
+        auto req = request{dtx_id, std::move(txs)};
+        send_request(std::move(req),
+                     [result_callback](std::optional<response> resp) {
+                         if(!resp.has_value()) {
+                             result_callback(std::nullopt);
+                             return;
+                         }
+                         result_callback(
+                             std::get<lock_response>(std::move(resp.value())));
+                     });
+    }
+
+    void
+    client::async_apply_outputs(std::vector<bool>&& complete_txs,
+                                const hash_t& dtx_id,
+                                const result_callback_type& result_callback) {
+        auto req = request{dtx_id, std::move(complete_txs)};
+        send_request(std::move(req),
+                     [result_callback](std::optional<response> resp) {
+                         result_callback(resp.has_value());
+                     });
+    }
+
+    void
+    client::async_discard_dtx(const hash_t& dtx_id,
+                              const result_callback_type& result_callback) {
+        auto req = request{dtx_id, discard_params()};
+        send_request(std::move(req),
+                     [result_callback](std::optional<response> resp) {
+                         result_callback(resp.has_value());
+                     });
+    }
+
     auto client::send_request(const request& req) -> std::optional<response> {
-        auto result_timeout = std::chrono::seconds(3);
-        constexpr auto max_result_timeout = std::chrono::seconds(10);
-        constexpr auto retry_delay = std::chrono::seconds(1);
-        auto res = std::optional<response>();
-        while(m_running && !res.has_value()) {
-            res = m_client->call(req, result_timeout);
-            if(!res.has_value()) {
-                m_log.warn("Shard request failed");
-                if(m_running) {
-                    std::this_thread::sleep_for(retry_delay);
-                    result_timeout
-                        = std::min(max_result_timeout, result_timeout * 2);
+        auto res = std::promise<std::optional<response>>();
+        auto fut = res.get_future();
+        send_request(req, [&res](std::optional<response> resp) {
+            res.set_value(std::move(resp));
+        });
+        return fut.get();
+    }
+
+    void client::send_request(request req,
+                              response_callback_type result_callback) {
+        auto p = std::make_shared<pending_request>();
+        p->m_req = std::move(req);
+        p->m_callback = std::move(result_callback);
+        p->m_timeout = m_initial_timeout;
+        {
+            std::unique_lock l(m_pending_mut);
+            if(!m_running) {
+                // Never registered, so must not go through complete(), which
+                // would erase whichever request holds the default ID
+                l.unlock();
+                p->m_callback(std::nullopt);
+                return;
+            }
+            p->m_id = m_next_pending_id++;
+            p->m_deadline = std::chrono::steady_clock::now() + p->m_timeout;
+            m_pending.emplace(p->m_id, p);
+        }
+        send_pending(p);
+    }
+
+    void client::send_pending(const std::shared_ptr<pending_request>& p) {
+        // stop() waits for senders to finish before destroying m_client
+        {
+            std::unique_lock l(m_pending_mut);
+            if(!m_running) {
+                return;
+            }
+            m_senders++;
+        }
+
+        // A failed send or empty response leaves the request pending so the
+        // retry thread sends it again once it times out
+        [[maybe_unused]] auto sent
+            = m_client->call(p->m_req, [&, p](std::optional<response> resp) {
+                  if(resp.has_value()) {
+                      complete(p, std::move(resp));
+                  }
+              });
+
+        {
+            std::unique_lock l(m_pending_mut);
+            m_senders--;
+        }
+        m_senders_cv.notify_all();
+    }
+
+    void client::complete(const std::shared_ptr<pending_request>& p,
+                          std::optional<response> resp) {
+        if(p->m_done.exchange(true)) {
+            return;
+        }
+        {
+            std::unique_lock l(m_pending_mut);
+            m_pending.erase(p->m_id);
+        }
+        p->m_callback(std::move(resp));
+    }
+
+    void client::retry_loop() {
+        std::unique_lock l(m_pending_mut);
+        while(m_running) {
+            // New requests are added without waking this thread, so wake at
+            // least once per initial timeout to catch them
+            const auto now = std::chrono::steady_clock::now();
+            auto next = now + m_initial_timeout;
+            auto expired = std::vector<std::shared_ptr<pending_request>>();
+            for(auto& [id, p] : m_pending) {
+                if(p->m_deadline <= now) {
+                    p->m_timeout = std::min(m_max_timeout, p->m_timeout * 2);
+                    p->m_deadline = now + p->m_timeout;
+                    expired.push_back(p);
                 }
+                next = std::min(next, p->m_deadline);
             }
+
+            if(!expired.empty()) {
+                l.unlock();
+                for(const auto& p : expired) {
+                    m_log.warn("Shard request failed");
+                    send_pending(p);
+                }
+                l.lock();
+                continue;
+            }
+
+            m_pending_cv.wait_until(l, next);
         }
-        return res;
     }
 
     void client::stop() {
-        m_running = false;
+        {
+            std::unique_lock l(m_pending_mut);
+            m_running = false;
+        }
+        m_pending_cv.notify_one();
+        if(m_retry_thread.joinable()) {
+            m_retry_thread.join();
+        }
+        {
+            std::unique_lock l(m_pending_mut);
+            m_senders_cv.wait(l, [&]() {
+                return m_senders == 0;
+            });
+        }
+        // Joins the response handler thread, so no response completes a
+        // request after this point
         m_client.reset();
+
+        // Requests still pending will never receive a response
+        auto pending = decltype(m_pending)();
+        {
+            std::unique_lock l(m_pending_mut);
+            std::swap(pending, m_pending);
+        }
+        for(auto& [id, p] : pending) {
+            complete(p, std::nullopt);
+        }
     }
 }
@@ -11,8 +11,17 @@
 #include "util/common/logging.hpp"
 #include "util/rpc/tcp_client.hpp"
 
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+
 namespace cbdc::locking_shard::rpc {
-    /// RPC client for the mutable interface to a locking shard raft cluster.
+    /// \brief RPC client for the mutable interface to a locking shard raft
+    /// cluster.
+    ///
+    /// Requests are retried with a growing timeout until the shard responds
+    /// or the client stops. Synchronous requests wait for their
+    /// asynchronous counterparts.
     class client final : public interface {
       public:
         /// Constructs a new locking shard client for issuing RPCs to a remote
@@ -23,9 +32,17 @@ namespace cbdc::locking_shard::rpc {
         /// \param output_range inclusive range of UHS ID prefixes covered by
         ///                     the shard cluster
         /// \param logger log instance for writing status messages
+        /// \param initial_timeout time to wait for a response before
+        ///                        sending a request again
+        /// \param max_timeout limit for the wait, which doubles with each
+        ///                    retry
         client(std::vector<network::endpoint_t> endpoints,
                const std::pair<uint8_t, uint8_t>& output_range,
-               logging::log& logger);
+               logging::log& logger,
+               std::chrono::milliseconds initial_timeout
+               = std::chrono::seconds(3),
+               std::chrono::milliseconds max_timeout
+               = std::chrono::seconds(10));
 
         client() = delete;
         ~client() override;
@@ -35,7 +52,7 @@ namespace cbdc::locking_shard::rpc {
         auto operator=(client&&) -> client& = delete;
 
         /// Initializes the RPC client. Connects to the shard cluster and
-        /// starts the response handler thread.
+        /// starts the response handler and request retry threads.
         /// \return false if there is only one node in the cluster and
         ///         connecting to it failed.
         auto init() -> bool;
@@ -64,18 +81,89 @@ namespace cbdc::locking_shard::rpc {
         /// \return true if the discard operation succeeded
         auto discard_dtx(const hash_t& dtx_id) -> bool override;
 
+        /// Issues a lock RPC to the remote shard without waiting for the
+        /// response.
+        /// \param txs vector of txs representing the input and output UHS
+        ///            IDs to lock for spending or creation
+        /// \param dtx_id dtx ID for this batch of transactions
+        /// \param result_callback function to call with the lock result, or
+        ///                        std::nullopt if the client stopped.
+        void async_lock_outputs(
+            std::vector<tx>&& txs,
+            const hash_t& dtx_id,
+            const lock_callback_type& result_callback) override;
+
+        /// Issues an apply RPC to the remote shard without waiting for the
+        /// response.
+        /// \param complete_txs vector of flags to indicate which transactions
+        ///                     in the distributed transaction should be
+        ///                     finalized or rolled back
+        /// \param dtx_id dtx ID upon which to perform apply
+        /// \param result_callback function to call with true if the apply
+        ///                        operation succeeded.
+        void async_apply_outputs(
+            std::vector<bool>&& complete_txs,
+            const hash_t& dtx_id,
+            const result_callback_type& result_callback) override;
+
+        /// Issues a discard RPC to the remote shard without waiting for the
+        /// response.
+        /// \param dtx_id dtx ID to discard
+        /// \param result_callback function to call with true if the discard
+        ///                        operation succeeded.
+        void async_discard_dtx(
+            const hash_t& dtx_id,
+            const result_callback_type& result_callback) override;
+
         /// Shuts down the client and unblocks any existing requests waiting
         /// for a response.
         void stop() override;
 
       private:
+        using response_callback_type
+            = std::function<void(std::optional<response>)>;
+
+        /// Asynchronous request waiting for a response.
+        struct pending_request {
+            uint64_t m_id{};
+            request m_req;
+            response_callback_type m_callback;
+            std::chrono::milliseconds m_timeout;
+            std::chrono::steady_clock::time_point m_deadline;
+            std::atomic_bool m_done{false};
+        };
+
         auto send_request(const request& req) -> std::optional<response>;
 
+        void send_request(request req, response_callback_type result_callback);
+
+        void send_pending(const std::shared_ptr<pending_request>& p);
+
+        void complete(const std::shared_ptr<pending_request>& p,
+                      std::optional<response> resp);
+
+        void retry_loop();
+
         std::atomic_bool m_running{true};
 
         std::unique_ptr<cbdc::rpc::tcp_client<request, response>> m_client;
 
         logging::log& m_log;
+
+        std::chrono::milliseconds m_initial_timeout;
+        std::chrono::milliseconds m_max_timeout;
+
+        std::mutex m_pending_mut;
+        std::condition_variable m_pending_cv;
+        std::unordered_map<uint64_t, std::shared_ptr<pending_request>>
+            m_pending;
+        uint64_t m_next_pending_id{};
+        std::thread m_retry_thread;
+
+        /// Number of threads sending with m_client. Guarded by
+        /// m_pending_mut.
+        size_t m_senders{};
+        std::condition_variable m_senders_cv;
     };
 }
 
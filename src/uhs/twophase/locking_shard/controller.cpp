@@ -106,7 +106,20 @@ namespace cbdc::locking_shard {
         m_status_server
             = std::make_unique<decltype(m_status_server)::element_type>(
                 m_shard,
-                std::move(status_rpc_server));
+                std::move(status_rpc_server),
+                [&]() -> std::optional<uint64_t> {
+                    // Followers only learn of commits from the leader so
+                    // cannot bound their lag without one
+                    if(!m_raft_serv->has_leader()) {
+                        return std::nullopt;
+                    }
+                    auto applied = m_raft_serv->last_log_idx();
+                    if(m_raft_serv->committed_log_idx()
+                       > applied + m_opts.m_shard_read_max_lag) {
+                        return std::nullopt;
+                    }
+                    return applied;
+                });
 
         return true;
     }
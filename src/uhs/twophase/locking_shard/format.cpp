@@ -11,11 +11,11 @@
 namespace cbdc {
     auto operator<<(serializer& packet, const locking_shard::tx& tx)
         -> serializer& {
-        return packet << tx.m_tx;
+        return packet << tx.m_id << tx.m_inputs << tx.m_uhs_outputs;
     }
 
     auto operator>>(serializer& packet, locking_shard::tx& tx) -> serializer& {
-        return packet >> tx.m_tx;
+        return packet >> tx.m_id >> tx.m_inputs >> tx.m_uhs_outputs;
     }
 
     auto operator<<(serializer& packet, const locking_shard::rpc::request& p)
@@ -49,4 +49,38 @@ namespace cbdc {
                     locking_shard::rpc::uhs_status_request& p) -> serializer& {
         return packet >> p.m_uhs_id;
     }
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::batch_status_request& p)
+        -> serializer& {
+        return packet << p.m_uhs_ids << p.m_tx_ids;
+    }
+
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::batch_status_request& p)
+        -> serializer& {
+        return packet >> p.m_uhs_ids >> p.m_tx_ids;
+    }
+
+    auto operator<<(serializer& packet, const locking_shard::batch_status& p)
+        -> serializer& {
+        return packet << p.m_unspent << p.m_confirmed;
+    }
+
+    auto operator>>(serializer& packet, locking_shard::batch_status& p)
+        -> serializer& {
+        return packet >> p.m_unspent >> p.m_confirmed;
+    }
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::batch_status_response& p)
+        -> serializer& {
+        return packet << p.m_applied_idx << p.m_status;
+    }
+
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::batch_status_response& p)
+        -> serializer& {
+        return packet >> p.m_applied_idx >> p.m_status;
+    }
 }
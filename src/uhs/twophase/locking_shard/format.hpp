@@ -30,6 +30,25 @@ namespace cbdc {
         -> serializer&;
     auto operator>>(serializer& packet,
                     locking_shard::rpc::uhs_status_request& p) -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::batch_status_request& p)
+        -> serializer&;
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::batch_status_request& p)
+        -> serializer&;
+
+    auto operator<<(serializer& packet, const locking_shard::batch_status& p)
+        -> serializer&;
+    auto operator>>(serializer& packet, locking_shard::batch_status& p)
+        -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::batch_status_response& p)
+        -> serializer&;
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::batch_status_response& p)
+        -> serializer&;
 }
 
 #endif // OPENCBDC_TX_SRC_LOCKING_SHARD_MESSAGES_H_
@@ -7,6 +7,7 @@
 
 #include "util/common/config.hpp"
 
+#include <tuple>
 #include <utility>
 
 namespace cbdc::locking_shard {
@@ -17,7 +18,49 @@ namespace cbdc::locking_shard {
         return config::hash_in_shard_range(m_output_range, h);
     }
 
+    void interface::async_lock_outputs(
+        std::vector<tx>&& txs,
+        const hash_t& dtx_id,
+        const lock_callback_type& result_callback) {
+        result_callback(lock_outputs(std::move(txs), dtx_id));
+    }
+
+    void interface::async_apply_outputs(
+        std::vector<bool>&& complete_txs,
+        const hash_t& dtx_id,
+        const result_callback_type& result_callback) {
+        result_callback(apply_outputs(std::move(complete_txs), dtx_id));
+    }
+
+    void
+    interface::async_discard_dtx(const hash_t& dtx_id,
+                                 const result_callback_type& result_callback) {
+        result_callback(discard_dtx(dtx_id));
+    }
+
+    auto interface::project_tx(const transaction::compact_tx& ctx) const
+        -> std::optional<tx> {
+        auto stx = tx();
+        for(const auto& inp : ctx.m_inputs) {
+            if(hash_in_shard_range(inp)) {
+                stx.m_inputs.push_back(inp);
+            }
+        }
+        for(const auto& out : ctx.m_uhs_outputs) {
+            if(hash_in_shard_range(out)) {
+                stx.m_uhs_outputs.push_back(out);
+            }
+        }
+        if(stx.m_inputs.empty() && stx.m_uhs_outputs.empty()
+           && !hash_in_shard_range(ctx.m_id)) {
+            return std::nullopt;
+        }
+        stx.m_id = ctx.m_id;
+        return stx;
+    }
+
     auto tx::operator==(const tx& rhs) const -> bool {
-        return m_tx == rhs.m_tx;
+        return std::tie(m_id, m_inputs, m_uhs_outputs)
+            == std::tie(rhs.m_id, rhs.m_inputs, rhs.m_uhs_outputs);
     }
 }
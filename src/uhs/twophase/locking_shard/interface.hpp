@@ -9,15 +9,25 @@
 #include "uhs/transaction/transaction.hpp"
 #include "util/common/hash.hpp"
 
+#include <functional>
 #include <optional>
 #include <variant>
 #include <vector>
 
 namespace cbdc::locking_shard {
-    /// Transaction type processed by locking shards.
+    /// \brief Transaction type processed by locking shards.
+    ///
+    /// Holds only the parts of a compact transaction relevant to a single
+    /// shard. The coordinator checks sentinel attestations before
+    /// projecting transactions, so attestations are not sent to shards.
+    /// \see interface::project_tx
     struct tx {
-        /// Compact TX.
-        transaction::compact_tx m_tx;
+        /// Compact transaction ID.
+        hash_t m_id{};
+        /// Input UHS IDs in the shard's range.
+        std::vector<hash_t> m_inputs{};
+        /// Output UHS IDs in the shard's range.
+        std::vector<hash_t> m_uhs_outputs{};
 
         auto operator==(const tx& rhs) const -> bool;
     };
@@ -40,6 +50,15 @@ namespace cbdc::locking_shard {
         interface(interface&&) = delete;
         auto operator=(interface&&) -> interface& = delete;
 
+        /// Callback function type for the result of an asynchronous lock
+        /// operation.
+        using lock_callback_type
+            = std::function<void(std::optional<std::vector<bool>>)>;
+
+        /// Callback function type for the result of an asynchronous apply or
+        /// discard operation.
+        using result_callback_type = std::function<void(bool)>;
+
         /// Attempts to lock the input hashes for the given vector of
         /// transactions. Only considers input hashes relevant to this shard
         /// based on the shard range. The batch of transactions is a single
@@ -72,6 +91,14 @@ namespace cbdc::locking_shard {
         [[nodiscard]] virtual auto hash_in_shard_range(const hash_t& h) const
             -> bool;
 
+        /// Projects a compact transaction onto the shard's range.
+        /// \param ctx compact transaction to project.
+        /// \return the transaction with only its inputs and outputs in the
+        ///         shard's range, or std::nullopt if neither they nor the
+        ///         transaction ID are in the shard's range.
+        [[nodiscard]] auto project_tx(const transaction::compact_tx& ctx) const
+            -> std::optional<tx>;
+
         /// Discards any cached information about a given distributed
         /// transaction.
         /// \param dtx_id distributed transaction ID of a previous apply
@@ -79,6 +106,41 @@ namespace cbdc::locking_shard {
         /// \return true if the discard operation succeeded.
         virtual auto discard_dtx(const hash_t& dtx_id) -> bool = 0;
 
+        /// Asynchronous version of \ref lock_outputs. The default
+        /// implementation calls \ref lock_outputs and then the callback
+        /// before returning.
+        /// \param txs list of txs to attempt to lock.
+        /// \param dtx_id distributed tx ID for lock operation.
+        /// \param result_callback function to call exactly once with the
+        ///                        result of \ref lock_outputs.
+        virtual void
+        async_lock_outputs(std::vector<tx>&& txs,
+                           const hash_t& dtx_id,
+                           const lock_callback_type& result_callback);
+
+        /// Asynchronous version of \ref apply_outputs. The default
+        /// implementation calls \ref apply_outputs and then the callback
+        /// before returning.
+        /// \param complete_txs vector of flags indicating which txs to apply.
+        /// \param dtx_id distributed transaction ID of the previous lock
+        ///               operation.
+        /// \param result_callback function to call exactly once with the
+        ///                        result of \ref apply_outputs.
+        virtual void
+        async_apply_outputs(std::vector<bool>&& complete_txs,
+                            const hash_t& dtx_id,
+                            const result_callback_type& result_callback);
+
+        /// Asynchronous version of \ref discard_dtx. The default
+        /// implementation calls \ref discard_dtx and then the callback
+        /// before returning.
+        /// \param dtx_id distributed transaction ID to discard.
+        /// \param result_callback function to call exactly once with the
+        ///                        result of \ref discard_dtx.
+        virtual void
+        async_discard_dtx(const hash_t& dtx_id,
+                          const result_callback_type& result_callback);
+
         /// Stops the locking shard implementation from processing further
         /// commands and unblocks any pending commands.
         virtual void stop() = 0;
@@ -6,7 +6,6 @@
 #include "locking_shard.hpp"
 
 #include "messages.hpp"
-#include "uhs/transaction/validation.hpp"
 #include "util/common/config.hpp"
 #include "util/serialization/format.hpp"
 #include "util/serialization/istream_serializer.hpp"
@@ -102,26 +101,18 @@ namespace cbdc::locking_shard {
     }
 
     auto locking_shard::check_and_lock_tx(const tx& t) -> bool {
+        // The coordinator checks attestations before sending transactions
+        // to shards
         bool success{true};
-        if(!transaction::validation::check_attestations(
-               t.m_tx,
-               m_opts.m_sentinel_public_keys,
-               m_opts.m_attestation_threshold)) {
-            m_logger->warn("Received invalid compact transaction",
-                           to_string(t.m_tx.m_id));
-            success = false;
-        }
-        if(success) {
-            for(const auto& uhs_id : t.m_tx.m_inputs) {
-                if(hash_in_shard_range(uhs_id)
-                   && m_uhs.find(uhs_id) == m_uhs.end()) {
-                    success = false;
-                    break;
-                }
+        for(const auto& uhs_id : t.m_inputs) {
+            if(hash_in_shard_range(uhs_id)
+               && m_uhs.find(uhs_id) == m_uhs.end()) {
+                success = false;
+                break;
             }
         }
         if(success) {
-            for(const auto& uhs_id : t.m_tx.m_inputs) {
+            for(const auto& uhs_id : t.m_inputs) {
                 if(hash_in_shard_range(uhs_id)) {
                     auto n = m_uhs.extract(uhs_id);
                     assert(!n.empty());
@@ -157,16 +148,16 @@ namespace cbdc::locking_shard {
         }
         for(size_t i{0}; i < dtx.size(); i++) {
             auto&& tx = dtx[i];
-            if(hash_in_shard_range(tx.m_tx.m_id)) {
-                m_completed_txs.add(tx.m_tx.m_id);
+            if(hash_in_shard_range(tx.m_id)) {
+                m_completed_txs.add(tx.m_id);
             }
 
-            for(auto&& uhs_id : tx.m_tx.m_uhs_outputs) {
+            for(auto&& uhs_id : tx.m_uhs_outputs) {
                 if(hash_in_shard_range(uhs_id) && complete_txs[i]) {
                     m_uhs.emplace(uhs_id);
                 }
             }
-            for(auto&& uhs_id : tx.m_tx.m_inputs) {
+            for(auto&& uhs_id : tx.m_inputs) {
                 if(hash_in_shard_range(uhs_id)) {
                     auto was_locked = m_locked.erase(uhs_id);
                     if(!complete_txs[i] && (was_locked != 0U)) {
@@ -196,4 +187,20 @@ namespace cbdc::locking_shard {
         -> std::optional<bool> {
         return m_completed_txs.contains(tx_id);
     }
+
+    auto locking_shard::check_status(const std::vector<hash_t>& uhs_ids,
+                                     const std::vector<hash_t>& tx_ids)
+        -> std::optional<batch_status> {
+        auto res = batch_status();
+        res.m_unspent.resize(uhs_ids.size());
+        {
+            std::shared_lock<std::shared_mutex> l(m_mut);
+            for(size_t i = 0; i < uhs_ids.size(); i++) {
+                res.m_unspent[i] = m_uhs.find(uhs_ids[i]) != m_uhs.end()
+                                || m_locked.find(uhs_ids[i]) != m_locked.end();
+            }
+        }
+        res.m_confirmed = m_completed_txs.contains(tx_ids);
+        return res;
+    }
 }
@@ -124,6 +124,16 @@ namespace cbdc::locking_shard {
         [[nodiscard]] auto check_tx_id(const hash_t& tx_id)
             -> std::optional<bool> final;
 
+        /// Queries the status of multiple UHS IDs and TX IDs at once. Checks
+        /// all the UHS IDs under one acquisition of the UHS lock, and all the
+        /// TX IDs under one acquisition of the confirmed TX IDs cache lock.
+        /// \param uhs_ids UHS IDs to query for whether they are unspent.
+        /// \param tx_ids TX IDs to query for whether they are confirmed.
+        /// \return status of each UHS ID and TX ID.
+        [[nodiscard]] auto check_status(const std::vector<hash_t>& uhs_ids,
+                                        const std::vector<hash_t>& tx_ids)
+            -> std::optional<batch_status> final;
+
       private:
         auto read_preseed_file(const std::string& preseed_file) -> bool;
         auto check_and_lock_tx(const tx& t) -> bool;
@@ -33,9 +33,11 @@ namespace cbdc::locking_shard {
     auto state_machine::commit(uint64_t log_idx, nuraft::buffer& data)
         -> nuraft::ptr<nuraft::buffer> {
         assert(log_idx == m_last_committed_idx + 1);
-        m_last_committed_idx = log_idx;
 
+        // Only advance the index once the entry is applied so the status
+        // server never reports an index ahead of the shard state
         auto resp = blocking_call(data);
+        m_last_committed_idx = log_idx;
         if(!resp.has_value()) {
             // TODO: This would only happen if there was a deserialization
             // error with the request. Maybe we should abort here as such an
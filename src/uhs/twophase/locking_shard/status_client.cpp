@@ -7,28 +7,42 @@
 
 #include "format.hpp"
 
+#include <utility>
+
 namespace cbdc::locking_shard::rpc {
     status_client::status_client(
         std::vector<std::vector<network::endpoint_t>>
             shard_read_only_endpoints,
         std::vector<config::shard_range_t> shard_ranges,
-        std::chrono::milliseconds timeout)
+        std::chrono::milliseconds timeout,
+        uint64_t max_lag)
         : m_shard_ranges(std::move(shard_ranges)),
-          m_request_timeout(timeout) {
+          m_request_timeout(timeout),
+          m_max_lag(max_lag) {
         assert(m_shard_ranges.size() == shard_read_only_endpoints.size());
-        m_shard_clients.reserve(m_shard_ranges.size());
+        m_replicas.reserve(m_shard_ranges.size());
+        m_lookups.reserve(m_shard_ranges.size());
         for(auto& cluster : shard_read_only_endpoints) {
-            m_shard_clients.emplace_back(
-                std::make_unique<
-                    cbdc::rpc::tcp_client<status_request, status_response>>(
-                    std::move(cluster)));
+            auto replicas = std::make_unique<shard_replicas>();
+            for(auto& ep : cluster) {
+                replicas->m_clients.emplace_back(
+                    std::make_unique<client_type>(
+                        std::vector<network::endpoint_t>{std::move(ep)}));
+            }
+            m_replicas.emplace_back(std::move(replicas));
+            m_lookups.emplace_back(std::make_unique<shard_lookups>());
         }
     }
 
     auto status_client::init() -> bool {
-        for(auto& client : m_shard_clients) {
-            if(!client->init()) {
-                return false;
+        for(auto& replicas : m_replicas) {
+            // Tolerate unreachable replicas as long as the cluster has
+            // others to fail over to
+            auto error_fatal = replicas->m_clients.size() <= 1;
+            for(auto& client : replicas->m_clients) {
+                if(!client->init(error_fatal)) {
+                    return false;
+                }
             }
         }
         return true;
@@ -36,11 +50,252 @@ namespace cbdc::locking_shard::rpc {
 
     auto status_client::check_tx_id(const hash_t& tx_id)
         -> std::optional<bool> {
-        return make_request<tx_status_request>(tx_id);
+        return lookup(tx_id, true);
     }
 
     auto status_client::check_unspent(const hash_t& uhs_id)
         -> std::optional<bool> {
-        return make_request<uhs_status_request>(uhs_id);
+        return lookup(uhs_id, false);
+    }
+
+    auto status_client::check_status(const std::vector<hash_t>& uhs_ids,
+                                     const std::vector<hash_t>& tx_ids)
+        -> std::optional<batch_status> {
+        auto [unspent, confirmed] = query(uhs_ids, tx_ids);
+        auto res = batch_status();
+        res.m_unspent.reserve(unspent.size());
+        for(const auto& u : unspent) {
+            if(!u.has_value()) {
+                return std::nullopt;
+            }
+            res.m_unspent.push_back(u.value());
+        }
+        res.m_confirmed.reserve(confirmed.size());
+        for(const auto& c : confirmed) {
+            if(!c.has_value()) {
+                return std::nullopt;
+            }
+            res.m_confirmed.push_back(c.value());
+        }
+        return res;
+    }
+
+    auto status_client::check_tx_ids(const std::vector<hash_t>& tx_ids)
+        -> std::vector<std::optional<bool>> {
+        return query({}, tx_ids).second;
+    }
+
+    auto status_client::lookup(const hash_t& val, bool is_tx_id)
+        -> std::optional<bool> {
+        auto shard = shard_index(val);
+        if(!shard.has_value()) {
+            return std::nullopt;
+        }
+        auto& lookups = *m_lookups[shard.value()];
+        std::unique_lock l(lookups.m_mut);
+        if(!lookups.m_next) {
+            lookups.m_next = std::make_shared<lookup_batch>();
+        }
+        auto batch = lookups.m_next;
+        auto& ids = is_tx_id ? batch->m_req.m_tx_ids : batch->m_req.m_uhs_ids;
+        auto idx = ids.size();
+        ids.push_back(val);
+
+        // Wait until another caller completes the batch, or until no batch
+        // is in flight, in which case this caller sends the batch
+        lookups.m_cv.wait(l, [&]() {
+            return batch->m_done || !lookups.m_in_flight;
+        });
+        if(!batch->m_done) {
+            lookups.m_in_flight = true;
+            lookups.m_next.reset();
+            l.unlock();
+            auto res = std::optional<batch_status>();
+            auto deadline
+                = std::chrono::steady_clock::now() + m_request_timeout;
+            auto n_replicas = m_replicas[shard.value()]->m_clients.size();
+            for(size_t i = 0; i < n_replicas && !res.has_value(); i++) {
+                auto timeout = m_request_timeout;
+                if(timeout != std::chrono::milliseconds::zero()) {
+                    timeout = std::chrono::duration_cast<
+                        std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now());
+                    if(timeout <= std::chrono::milliseconds::zero()) {
+                        break;
+                    }
+                }
+                res = fresh_status(
+                    shard.value(),
+                    next_replica(shard.value()).call(batch->m_req, timeout));
+            }
+            l.lock();
+            batch->m_res = std::move(res);
+            batch->m_done = true;
+            lookups.m_in_flight = false;
+            lookups.m_cv.notify_all();
+        }
+
+        if(!batch->m_res.has_value()) {
+            return std::nullopt;
+        }
+        const auto& flags = is_tx_id ? batch->m_res->m_confirmed
+                                     : batch->m_res->m_unspent;
+        if(idx >= flags.size()) {
+            return std::nullopt;
+        }
+        return flags[idx];
+    }
+
+    auto status_client::query(const std::vector<hash_t>& uhs_ids,
+                              const std::vector<hash_t>& tx_ids)
+        -> query_result {
+        // Shared with the response callbacks, which may run after this
+        // call has timed out
+        struct query_state {
+            std::mutex m_mut;
+            std::condition_variable m_cv;
+            std::vector<std::optional<status_response>> m_responses;
+            size_t m_pending{};
+        };
+        auto state = std::make_shared<query_state>();
+        state->m_responses.resize(m_replicas.size());
+        auto results = query_result();
+        results.first.resize(uhs_ids.size());
+        results.second.resize(tx_ids.size());
+
+        // Split the IDs into one request per shard cluster, recording the
+        // position of each ID in the query
+        using query_idxs
+            = std::pair<std::vector<size_t>, std::vector<size_t>>;
+        auto reqs = std::vector<batch_status_request>(m_replicas.size());
+        auto idxs = std::vector<query_idxs>(m_replicas.size());
+        for(size_t i = 0; i < uhs_ids.size(); i++) {
+            if(auto shard = shard_index(uhs_ids[i])) {
+                reqs[shard.value()].m_uhs_ids.push_back(uhs_ids[i]);
+                idxs[shard.value()].first.push_back(i);
+            }
+        }
+        for(size_t i = 0; i < tx_ids.size(); i++) {
+            if(auto shard = shard_index(tx_ids[i])) {
+                reqs[shard.value()].m_tx_ids.push_back(tx_ids[i]);
+                idxs[shard.value()].second.push_back(i);
+            }
+        }
+
+        auto shards = std::vector<size_t>();
+        for(size_t i = 0; i < reqs.size(); i++) {
+            if(!reqs[i].m_uhs_ids.empty() || !reqs[i].m_tx_ids.empty()) {
+                shards.push_back(i);
+            }
+        }
+
+        // Send every request before waiting for any response, then resend
+        // the requests which were not served to the next replica of their
+        // shard cluster until each replica has been tried
+        auto deadline = std::chrono::steady_clock::now() + m_request_timeout;
+        for(size_t attempt = 0; !shards.empty(); attempt++) {
+            {
+                std::unique_lock l(state->m_mut);
+                state->m_pending = shards.size();
+            }
+            for(auto shard : shards) {
+                auto sent = next_replica(shard).call(
+                    reqs[shard],
+                    [state, shard](std::optional<status_response> res) {
+                        {
+                            std::unique_lock l(state->m_mut);
+                            state->m_responses[shard] = std::move(res);
+                            state->m_pending--;
+                        }
+                        state->m_cv.notify_one();
+                    });
+                if(!sent) {
+                    std::unique_lock l(state->m_mut);
+                    state->m_pending--;
+                }
+            }
+
+            std::unique_lock l(state->m_mut);
+            auto done = [&]() {
+                return state->m_pending == 0;
+            };
+            auto timed_out = false;
+            if(m_request_timeout == std::chrono::milliseconds::zero()) {
+                state->m_cv.wait(l, done);
+            } else {
+                timed_out = !state->m_cv.wait_until(l, deadline, done);
+            }
+
+            auto retry = std::vector<size_t>();
+            for(auto shard : shards) {
+                auto status = fresh_status(
+                    shard,
+                    std::exchange(state->m_responses[shard], std::nullopt));
+                const auto& shard_idxs = idxs[shard];
+                if(status.has_value()
+                   && status->m_unspent.size() == shard_idxs.first.size()
+                   && status->m_confirmed.size()
+                          == shard_idxs.second.size()) {
+                    for(size_t i = 0; i < shard_idxs.first.size(); i++) {
+                        results.first[shard_idxs.first[i]]
+                            = status->m_unspent[i];
+                    }
+                    for(size_t i = 0; i < shard_idxs.second.size(); i++) {
+                        results.second[shard_idxs.second[i]]
+                            = status->m_confirmed[i];
+                    }
+                } else if(attempt + 1
+                          < m_replicas[shard]->m_clients.size()) {
+                    retry.push_back(shard);
+                }
+            }
+            if(timed_out) {
+                break;
+            }
+            shards = std::move(retry);
+        }
+        return results;
+    }
+
+    auto status_client::shard_index(const hash_t& val) const
+        -> std::optional<size_t> {
+        // TODO: optimize the algorithm for shard selection.
+        for(size_t i = 0; i < m_shard_ranges.size(); i++) {
+            if(config::hash_in_shard_range(m_shard_ranges[i], val)) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+
+    auto status_client::next_replica(size_t shard) -> client_type& {
+        auto& replicas = *m_replicas[shard];
+        assert(!replicas.m_clients.empty());
+        auto idx = replicas.m_next++ % replicas.m_clients.size();
+        return *replicas.m_clients[idx];
+    }
+
+    auto status_client::fresh_status(size_t shard,
+                                     std::optional<status_response> res)
+        -> std::optional<batch_status> {
+        if(!res.has_value()) {
+            return std::nullopt;
+        }
+        auto* resp = std::get_if<batch_status_response>(&res.value());
+        if(resp == nullptr || !resp->m_status.has_value()) {
+            return std::nullopt;
+        }
+
+        // Track the most recent state reported by any replica so replicas
+        // which are behind but have not noticed can be skipped
+        auto& latest = m_replicas[shard]->m_applied_idx;
+        auto latest_idx = latest.load();
+        while(resp->m_applied_idx > latest_idx
+              && !latest.compare_exchange_weak(latest_idx,
+                                               resp->m_applied_idx)) {}
+        if(resp->m_applied_idx + m_max_lag < latest_idx) {
+            return std::nullopt;
+        }
+        return std::move(resp->m_status);
     }
 }
@@ -11,11 +11,22 @@
 #include "util/common/config.hpp"
 #include "util/rpc/tcp_client.hpp"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
 namespace cbdc::locking_shard::rpc {
     /// Client for interacting with the read-only port on 2PC shards. Allows
     /// for checking whether a TX ID has been confirmed or whether a UHS ID
-    /// is currently unspent. Connects to all shard nodes to handle failover
-    /// and routes requests to the relevant shard.
+    /// is currently unspent. Connects to every replica of each shard cluster
+    /// and routes requests to the relevant shard, sending each request to
+    /// the replicas in turn to spread load across them. Moves on to the next
+    /// replica when one is unreachable or too stale to serve a request,
+    /// including replicas too far behind the most recent replica the client
+    /// has heard from. Coalesces concurrent single lookups to the same shard
+    /// cluster into one batch request, so each shard cluster has at most one
+    /// lookup batch in flight and callers which arrive meanwhile share the
+    /// next one.
     class status_client : public status_interface {
       public:
         /// Constructor.
@@ -26,11 +37,15 @@ namespace cbdc::locking_shard::rpc {
         ///                     shard_read_only_endpoints.
         /// \param timeout optional timeout for status requests. Zero indicates
         ///                no timeout.
+        /// \param max_lag number of log entries a replica may be behind the
+        ///                most recent replica of its shard cluster for its
+        ///                responses to be accepted.
         status_client(std::vector<std::vector<network::endpoint_t>>
                           shard_read_only_endpoints,
                       std::vector<config::shard_range_t> shard_ranges,
                       std::chrono::milliseconds timeout
-                      = std::chrono::milliseconds::zero());
+                      = std::chrono::milliseconds::zero(),
+                      uint64_t max_lag = config::defaults::shard_read_max_lag);
 
         /// Destructor.
         ~status_client() override = default;
@@ -41,8 +56,8 @@ namespace cbdc::locking_shard::rpc {
         status_client(status_client&&) = delete;
         auto operator=(status_client&&) -> status_client& = delete;
 
-        /// Initializes the client by creating a TCP RPC client for each shard
-        /// cluster.
+        /// Initializes the client by connecting a TCP RPC client to each
+        /// shard replica.
         /// \return true if the RPC clients initialized successfully.
         auto init() -> bool;
 
@@ -62,23 +77,78 @@ namespace cbdc::locking_shard::rpc {
         [[nodiscard]] auto check_tx_id(const hash_t& tx_id)
             -> std::optional<bool> override;
 
+        /// Queries the shard clusters responsible for the given UHS IDs and
+        /// TX IDs for their status, sending one batch request to each shard
+        /// cluster.
+        /// \param uhs_ids UHS IDs to query for whether they are unspent.
+        /// \param tx_ids TX IDs to query for whether they are confirmed.
+        /// \return status of each UHS ID and TX ID, or std::nullopt if any
+        ///         request failed or timed out.
+        [[nodiscard]] auto check_status(const std::vector<hash_t>& uhs_ids,
+                                        const std::vector<hash_t>& tx_ids)
+            -> std::optional<batch_status> override;
+
+        /// Queries the shard clusters responsible for the given TX IDs for
+        /// whether they are in the confirmed TX IDs cache. Sends one batch
+        /// request to each shard cluster and issues them all before waiting
+        /// for any response.
+        /// \param tx_ids TX IDs to query.
+        /// \return result for each TX ID in the same order as tx_ids. True if
+        ///         the cache contains the TX ID, or std::nullopt if the request
+        ///         failed or timed out.
+        [[nodiscard]] auto check_tx_ids(const std::vector<hash_t>& tx_ids)
+            -> std::vector<std::optional<bool>>;
+
       private:
-        std::vector<std::unique_ptr<
-            cbdc::rpc::tcp_client<status_request, status_response>>>
-            m_shard_clients;
+        /// Single lookups coalesced into one batch request.
+        struct lookup_batch {
+            batch_status_request m_req;
+            std::optional<batch_status> m_res;
+            bool m_done{false};
+        };
+
+        /// Lookup batches for a shard cluster.
+        struct shard_lookups {
+            std::mutex m_mut;
+            std::condition_variable m_cv;
+            std::shared_ptr<lookup_batch> m_next;
+            bool m_in_flight{false};
+        };
+
+        /// Results of a query for each UHS ID and TX ID.
+        using query_result = std::pair<std::vector<std::optional<bool>>,
+                                       std::vector<std::optional<bool>>>;
+
+        using client_type
+            = cbdc::rpc::tcp_client<status_request, status_response>;
+
+        /// RPC clients for each replica of a shard cluster.
+        struct shard_replicas {
+            std::vector<std::unique_ptr<client_type>> m_clients;
+            /// Replica to send the next request to.
+            std::atomic<size_t> m_next{};
+            /// Highest applied log index reported by any replica.
+            std::atomic<uint64_t> m_applied_idx{};
+        };
+
+        std::vector<std::unique_ptr<shard_replicas>> m_replicas;
         std::vector<config::shard_range_t> m_shard_ranges;
         std::chrono::milliseconds m_request_timeout;
+        uint64_t m_max_lag;
+        std::vector<std::unique_ptr<shard_lookups>> m_lookups;
+
+        auto lookup(const hash_t& val, bool is_tx_id) -> std::optional<bool>;
+
+        auto query(const std::vector<hash_t>& uhs_ids,
+                   const std::vector<hash_t>& tx_ids) -> query_result;
+
+        [[nodiscard]] auto shard_index(const hash_t& val) const
+            -> std::optional<size_t>;
+
+        auto next_replica(size_t shard) -> client_type&;
 
-        template<typename T>
-        auto make_request(const hash_t& val) -> std::optional<bool> {
-            // TODO: optimize the algorithm for shard selection.
-            for(size_t i = 0; i < m_shard_ranges.size(); i++) {
-                if(config::hash_in_shard_range(m_shard_ranges[i], val)) {
-                    return m_shard_clients[i]->call(T{val}, m_request_timeout);
-                }
-            }
-            return std::nullopt;
-        }
+        auto fresh_status(size_t shard, std::optional<status_response> res)
+            -> std::optional<batch_status>;
     };
 }
 
@@ -10,8 +10,17 @@
 
 #include <optional>
 #include <variant>
+#include <vector>
 
 namespace cbdc::locking_shard {
+    /// Result of a batch status query.
+    struct batch_status {
+        /// Whether each queried UHS ID is unspent, in query order.
+        std::vector<bool> m_unspent{};
+        /// Whether each queried TX ID is confirmed, in query order.
+        std::vector<bool> m_confirmed{};
+    };
+
     /// Interface for querying the read-only state of a locking shard. Returns
     /// whether a given UHS ID is currently unspent or a TX ID has been
     /// confirmed.
@@ -38,6 +47,16 @@ namespace cbdc::locking_shard {
         ///         if the query failed.
         [[nodiscard]] virtual auto check_tx_id(const hash_t& tx_id)
             -> std::optional<bool> = 0;
+
+        /// Queries the status of multiple UHS IDs and TX IDs at once.
+        /// \param uhs_ids UHS IDs to query for whether they are unspent.
+        /// \param tx_ids TX IDs to query for whether they are confirmed.
+        /// \return status of each UHS ID and TX ID, or std::nullopt if the
+        ///         query failed.
+        [[nodiscard]] virtual auto
+        check_status(const std::vector<hash_t>& uhs_ids,
+                     const std::vector<hash_t>& tx_ids)
+            -> std::optional<batch_status> = 0;
     };
 }
 
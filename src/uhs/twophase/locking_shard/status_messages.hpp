@@ -6,9 +6,12 @@
 #ifndef OPENCBDC_TX_SRC_LOCKING_SHARD_STATUS_MESSAGES_H_
 #define OPENCBDC_TX_SRC_LOCKING_SHARD_STATUS_MESSAGES_H_
 
+#include "status_interface.hpp"
 #include "util/common/hash.hpp"
 
+#include <optional>
 #include <variant>
+#include <vector>
 
 namespace cbdc::locking_shard::rpc {
     /// RPC message for clients to use to request the status of a UHS ID.
@@ -23,13 +26,33 @@ namespace cbdc::locking_shard::rpc {
         hash_t m_tx_id{};
     };
 
-    /// Status request RPC message wrapper, holding either a UHS ID or TX ID
+    /// RPC message for clients to use to request the status of multiple UHS
+    /// IDs and TX IDs at once.
+    struct batch_status_request {
+        /// UHS IDs to check.
+        std::vector<hash_t> m_uhs_ids{};
+        /// TX IDs to check.
+        std::vector<hash_t> m_tx_ids{};
+    };
+
+    /// Status request RPC message wrapper, holding a UHS ID, TX ID or batch
     /// query request.
-    using status_request = std::variant<uhs_status_request, tx_status_request>;
+    using status_request = std::
+        variant<uhs_status_request, tx_status_request, batch_status_request>;
+
+    /// RPC message for shard replicas to respond to batch status requests.
+    struct batch_status_response {
+        /// Index of the last raft log entry applied to the replica state
+        /// which served the request.
+        uint64_t m_applied_idx{};
+        /// Status of each ID in the request, or std::nullopt if the replica
+        /// was too far behind the cluster to serve the request.
+        std::optional<batch_status> m_status{};
+    };
 
     /// Status response RPC messages indicating whether the shard contains
-    /// given UHS or TX ID.
-    using status_response = bool;
+    /// given UHS or TX ID, or the status of each ID in a batch request.
+    using status_response = std::variant<bool, batch_status_response>;
 }
 
 #endif
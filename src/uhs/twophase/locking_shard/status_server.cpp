@@ -11,9 +11,11 @@ namespace cbdc::locking_shard::rpc {
     status_server::status_server(
         std::shared_ptr<status_interface> impl,
         std::unique_ptr<
-            cbdc::rpc::blocking_server<status_request, status_response>> srv)
+            cbdc::rpc::blocking_server<status_request, status_response>> srv,
+        applied_idx_func_type applied_idx)
         : m_impl(std::move(impl)),
-          m_srv(std::move(srv)) {
+          m_srv(std::move(srv)),
+          m_applied_idx(std::move(applied_idx)) {
         m_srv->register_handler_callback([&](status_request req) {
             return request_handler(req);
         });
@@ -21,13 +23,38 @@ namespace cbdc::locking_shard::rpc {
 
     auto status_server::request_handler(status_request req)
         -> std::optional<status_response> {
-        return std::visit(overloaded{[&](const uhs_status_request& r) {
-                                         return m_impl->check_unspent(
-                                             r.m_uhs_id);
-                                     },
-                                     [&](const tx_status_request& r) {
-                                         return m_impl->check_tx_id(r.m_tx_id);
-                                     }},
-                          req);
+        // Read the index before the state so the response reflects at least
+        // every entry up to the reported index
+        auto applied_idx = m_applied_idx ? m_applied_idx()
+                                         : std::optional<uint64_t>(0);
+        return std::visit(
+            overloaded{[&](const uhs_status_request& r) {
+                           // Single requests cannot report staleness, so
+                           // leave them for the client to retry elsewhere
+                           if(!applied_idx.has_value()) {
+                               return std::optional<status_response>();
+                           }
+                           return std::optional<status_response>(
+                               m_impl->check_unspent(r.m_uhs_id));
+                       },
+                       [&](const tx_status_request& r) {
+                           if(!applied_idx.has_value()) {
+                               return std::optional<status_response>();
+                           }
+                           return std::optional<status_response>(
+                               m_impl->check_tx_id(r.m_tx_id));
+                       },
+                       [&](const batch_status_request& r) {
+                           auto res = batch_status_response();
+                           if(applied_idx.has_value()) {
+                               res.m_applied_idx = applied_idx.value();
+                               res.m_status = m_impl->check_status(
+                                   r.m_uhs_ids,
+                                   r.m_tx_ids);
+                           }
+                           return std::optional<status_response>(
+                               std::move(res));
+                       }},
+            req);
     }
 }
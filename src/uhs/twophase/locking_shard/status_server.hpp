@@ -10,26 +10,40 @@
 #include "status_messages.hpp"
 #include "util/rpc/blocking_server.hpp"
 
+#include <functional>
 #include <memory>
 
 namespace cbdc::locking_shard::rpc {
-    /// Server for handling TX and UHS ID status requests.
+    /// Server for handling TX and UHS ID status requests. Runs on every
+    /// replica of a shard cluster, serving requests from the replica's
+    /// applied state as long as it is close enough to the rest of the
+    /// cluster.
     class status_server {
       public:
+        /// Function type which returns the index of the last log entry
+        /// applied to the shard state, or std::nullopt if the replica is too
+        /// far behind the cluster to serve requests.
+        using applied_idx_func_type = std::function<std::optional<uint64_t>()>;
+
         /// Constructor.
         /// \param impl pointer to an implementation of the locking shard status
         ///             interface.
         /// \param srv pointer to an initialized RPC server which is ready to accept requests.
+        /// \param applied_idx function to check the replica's state before
+        ///                    serving each request. If null, requests are
+        ///                    always served and report a log index of zero.
         status_server(
             std::shared_ptr<status_interface> impl,
             std::unique_ptr<cbdc::rpc::blocking_server<status_request,
-                                                       status_response>> srv);
+                                                       status_response>> srv,
+            applied_idx_func_type applied_idx = nullptr);
 
       private:
         std::shared_ptr<status_interface> m_impl;
         std::unique_ptr<
             cbdc::rpc::blocking_server<status_request, status_response>>
             m_srv;
+        applied_idx_func_type m_applied_idx;
 
         auto request_handler(status_request req)
             -> std::optional<status_response>;
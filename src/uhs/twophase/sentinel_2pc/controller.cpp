@@ -9,6 +9,8 @@
 #include "util/rpc/tcp_server.hpp"
 #include "util/serialization/util.hpp"
 
+#include <algorithm>
+#include <numeric>
 #include <utility>
 
 namespace cbdc::sentinel_2pc {
@@ -24,6 +26,24 @@ namespace cbdc::sentinel_2pc {
                                                opts.m_coordinator_endpoints
                                                    .size())]) {}
 
+    controller::~controller() {
+        // Validation tasks may be running, so stop them before the state
+        // they use
+        m_rpc_server.reset();
+        m_validation_pool.reset();
+        {
+            std::unique_lock l(m_batch_mut);
+            m_running = false;
+        }
+        m_batch_cv.notify_one();
+        if(m_batch_thread.joinable()) {
+            m_batch_thread.join();
+        }
+        // Responses from peer sentinels update the batching state, so stop
+        // the clients before it is destroyed
+        m_sentinel_clients.clear();
+    }
+
     auto controller::init() -> bool {
         if(m_opts.m_sentinel_endpoints.empty()) {
             m_logger->error("No sentinel endpoints are defined.");
@@ -49,6 +69,10 @@ namespace cbdc::sentinel_2pc {
             m_logger->info("Sentinel public key:", cbdc::to_string(pubkey));
         }
 
+        m_validation_pool = std::make_unique<sentinel::validation_pool>(
+            m_opts.m_sentinel_validation_threads,
+            m_opts.m_sentinel_validation_queue_size);
+
         auto retry_delay = std::chrono::seconds(1);
         auto retry_threshold = 4;
         while(!m_coordinator_client.init() && retry_threshold-- > 0) {
@@ -74,10 +98,11 @@ namespace cbdc::sentinel_2pc {
             m_sentinel_clients.emplace_back(std::move(client));
         }
 
-        constexpr size_t dist_lower_bound = 0;
-        const size_t dist_upper_bound
-            = m_sentinel_clients.empty() ? 0 : m_sentinel_clients.size() - 1;
-        m_dist = decltype(m_dist)(dist_lower_bound, dist_upper_bound);
+        m_batches.resize(m_sentinel_clients.size());
+        m_batches_in_flight.resize(m_sentinel_clients.size());
+        m_batch_thread = std::thread([&]() {
+            batch_sender();
+        });
 
         auto rpc_server = std::make_unique<cbdc::rpc::tcp_server<
             cbdc::rpc::async_server<cbdc::sentinel::request,
@@ -98,30 +123,36 @@ namespace cbdc::sentinel_2pc {
     auto controller::execute_transaction(
         transaction::full_tx tx,
         execute_result_callback_type result_callback) -> bool {
-        const auto validation_err = transaction::validation::check_tx(tx);
-        if(validation_err.has_value()) {
-            auto tx_id = transaction::tx_id(tx);
-            m_logger->debug(
-                "Rejected (",
-                transaction::validation::to_string(validation_err.value()),
-                ")",
-                to_string(tx_id));
-            result_callback(cbdc::sentinel::execute_response{
-                cbdc::sentinel::tx_status::static_invalid,
-                validation_err});
-            return true;
+        if(!m_validation_pool) {
+            return false;
         }
+        return m_validation_pool->push(
+            [&, tx = std::move(tx), cb = std::move(result_callback)](
+                secp256k1_context* secp) mutable {
+                const auto validation_err
+                    = transaction::validation::check_tx(tx);
+                if(validation_err.has_value()) {
+                    auto tx_id = transaction::tx_id(tx);
+                    m_logger->debug("Rejected (",
+                                    transaction::validation::to_string(
+                                        validation_err.value()),
+                                    ")",
+                                    to_string(tx_id));
+                    cb(cbdc::sentinel::execute_response{
+                        cbdc::sentinel::tx_status::static_invalid,
+                        validation_err});
+                    return;
+                }
 
-        auto compact_tx = cbdc::transaction::compact_tx(tx);
-
-        if(m_opts.m_attestation_threshold > 0) {
-            auto attestation = compact_tx.sign(m_secp.get(), m_privkey);
-            compact_tx.m_attestations.insert(attestation);
-        }
+                auto compact_tx = cbdc::transaction::compact_tx(tx);
 
-        gather_attestations(tx, std::move(result_callback), compact_tx, {});
+                if(m_opts.m_attestation_threshold > 0) {
+                    auto attestation = compact_tx.sign(secp, m_privkey);
+                    compact_tx.m_attestations.insert(attestation);
+                }
 
-        return true;
+                gather_attestations(tx, std::move(cb), compact_tx);
+            });
     }
 
     void
@@ -143,67 +174,264 @@ namespace cbdc::sentinel_2pc {
     auto controller::validate_transaction(
         transaction::full_tx tx,
         validate_result_callback_type result_callback) -> bool {
-        const auto validation_err = transaction::validation::check_tx(tx);
-        if(validation_err.has_value()) {
-            result_callback(std::nullopt);
-            return true;
+        if(!m_validation_pool) {
+            return false;
         }
-        auto compact_tx = cbdc::transaction::compact_tx(tx);
-        auto attestation = compact_tx.sign(m_secp.get(), m_privkey);
-        result_callback(std::move(attestation));
-        return true;
+        return m_validation_pool->push(
+            [&, tx = std::move(tx), cb = std::move(result_callback)](
+                secp256k1_context* secp) {
+                const auto validation_err
+                    = transaction::validation::check_tx(tx);
+                if(validation_err.has_value()) {
+                    cb(std::nullopt);
+                    return;
+                }
+                auto compact_tx = cbdc::transaction::compact_tx(tx);
+                auto attestation = compact_tx.sign(secp, m_privkey);
+                cb(std::move(attestation));
+            });
     }
 
-    void controller::validate_result_handler(
-        validate_result v_res,
+    void controller::gather_attestations(
         const transaction::full_tx& tx,
         execute_result_callback_type result_callback,
-        transaction::compact_tx ctx,
-        std::unordered_set<size_t> requested) {
-        if(!v_res.has_value()) {
-            m_logger->error(to_string(ctx.m_id),
-                            "invalid according to remote sentinel");
+        const transaction::compact_tx& ctx) {
+        const auto threshold = m_opts.m_attestation_threshold;
+        if(ctx.m_attestations.size() >= threshold) {
+            m_logger->debug("Accepted", to_string(ctx.m_id));
+            send_compact_tx(ctx, std::move(result_callback));
+            return;
+        }
+
+        const auto needed = threshold - ctx.m_attestations.size();
+        if(needed > m_sentinel_clients.size()) {
+            m_logger->error("Not enough sentinels to attest to",
+                            to_string(ctx.m_id));
             result_callback(std::nullopt);
             return;
         }
-        ctx.m_attestations.insert(std::move(v_res.value()));
-        gather_attestations(tx,
-                            std::move(result_callback),
-                            ctx,
-                            std::move(requested));
+
+        auto pending = std::make_shared<pending_attestations>();
+        pending->m_tx = tx;
+        pending->m_ctx = ctx;
+        pending->m_result_callback = std::move(result_callback);
+        pending->m_unrequested.resize(m_sentinel_clients.size());
+        std::iota(pending->m_unrequested.begin(),
+                  pending->m_unrequested.end(),
+                  size_t{0});
+        {
+            std::unique_lock l(m_rand_mut);
+            std::shuffle(pending->m_unrequested.begin(),
+                         pending->m_unrequested.end(),
+                         m_rand);
+        }
+
+        // Ask enough peers to reach the threshold, plus spares, at once
+        // rather than waiting on each peer in turn
+        const auto fanout = std::min(needed + m_opts.m_attestation_spares,
+                                     m_sentinel_clients.size());
+        std::unique_lock l(pending->m_mut);
+        for(size_t i = 0; i < fanout; i++) {
+            request_attestation(pending);
+        }
+        if(!pending->m_unrequested.empty()) {
+            arm_hedge(pending);
+        }
     }
 
-    void controller::gather_attestations(
-        const transaction::full_tx& tx,
-        execute_result_callback_type result_callback,
-        const transaction::compact_tx& ctx,
-        std::unordered_set<size_t> requested) {
-        if(ctx.m_attestations.size() < m_opts.m_attestation_threshold) {
-            auto success = false;
-            while(!success) {
-                auto sentinel_id = m_dist(m_rand);
-                if(requested.find(sentinel_id) != requested.end()) {
-                    continue;
+    void controller::request_attestation(const pending_ptr& pending) {
+        // Called with the pending transaction's mutex held
+        auto peer = pending->m_unrequested.back();
+        pending->m_unrequested.pop_back();
+        pending->m_outstanding++;
+
+        auto notify = false;
+        {
+            std::unique_lock l(m_batch_mut);
+            auto& batch = m_batches[peer];
+            if(batch.m_txs.empty()) {
+                batch.m_deadline
+                    = std::chrono::steady_clock::now()
+                    + std::chrono::microseconds(m_opts.m_sentinel_batch_delay);
+                notify = true;
+            }
+            batch.m_txs.push_back(pending->m_tx);
+            batch.m_pending.push_back(pending);
+            notify = notify
+                  || batch.m_txs.size() >= m_opts.m_sentinel_batch_size;
+        }
+        if(notify) {
+            m_batch_cv.notify_one();
+        }
+    }
+
+    void controller::arm_hedge(const pending_ptr& pending) {
+        if(m_opts.m_attestation_hedge_delay == 0) {
+            return;
+        }
+        auto deadline
+            = std::chrono::steady_clock::now()
+            + std::chrono::milliseconds(m_opts.m_attestation_hedge_delay);
+        {
+            std::unique_lock l(m_batch_mut);
+            m_hedges.emplace_back(deadline, pending);
+        }
+        m_batch_cv.notify_one();
+    }
+
+    void controller::attestation_handler(const pending_ptr& pending,
+                                         validate_result v_res) {
+        const auto threshold = m_opts.m_attestation_threshold;
+        auto forward = false;
+        auto failed = false;
+        {
+            std::unique_lock l(pending->m_mut);
+            pending->m_outstanding--;
+            if(pending->m_done) {
+                return;
+            }
+            auto& atts = pending->m_ctx.m_attestations;
+            if(v_res.has_value()) {
+                atts.insert(std::move(v_res.value()));
+                forward = atts.size() >= threshold;
+            } else {
+                // The peer rejected the transaction or could not be reached.
+                // Replace it with another peer if the outstanding requests
+                // can no longer reach the threshold.
+                while(atts.size() + pending->m_outstanding < threshold
+                      && !pending->m_unrequested.empty()) {
+                    request_attestation(pending);
                 }
-                success
-                    = m_sentinel_clients[sentinel_id]->validate_transaction(
-                        tx,
-                        [=, this](validate_result v_res) {
-                            auto r = requested;
-                            r.insert(sentinel_id);
-                            validate_result_handler(v_res,
-                                                    tx,
-                                                    result_callback,
-                                                    ctx,
-                                                    r);
-                        });
+                failed = atts.size() + pending->m_outstanding < threshold;
             }
+            pending->m_done = forward || failed;
+        }
+
+        // Nothing else touches a pending transaction once it is done
+        if(forward) {
+            m_logger->debug("Accepted", to_string(pending->m_ctx.m_id));
+            send_compact_tx(pending->m_ctx,
+                            std::move(pending->m_result_callback));
+        } else if(failed) {
+            m_logger->error(to_string(pending->m_ctx.m_id),
+                            "invalid according to remote sentinels");
+            pending->m_result_callback(std::nullopt);
+        }
+    }
+
+    void controller::hedge(const pending_ptr& pending) {
+        std::unique_lock l(pending->m_mut);
+        if(pending->m_done) {
             return;
         }
+        // Peers are slow to respond, so ask enough further peers to reach
+        // the threshold without them
+        const auto missing = m_opts.m_attestation_threshold
+                           - pending->m_ctx.m_attestations.size();
+        for(size_t i = 0; i < missing && !pending->m_unrequested.empty();
+            i++) {
+            request_attestation(pending);
+        }
+        if(!pending->m_unrequested.empty()) {
+            arm_hedge(pending);
+        }
+    }
+
+    void controller::send_batch(size_t peer, peer_batch batch) {
+        auto pending = std::make_shared<std::vector<pending_ptr>>(
+            std::move(batch.m_pending));
+        auto success = m_sentinel_clients[peer]->validate_transactions(
+            std::move(batch.m_txs),
+            [&, peer, pending](
+                sentinel::rpc::client::validate_batch_result_type res) {
+                batch_done(peer);
+                for(size_t i = 0; i < pending->size(); i++) {
+                    auto v_res = validate_result();
+                    if(res.has_value() && i < res->m_attestations.size()) {
+                        v_res = std::move(res->m_attestations[i]);
+                    }
+                    attestation_handler((*pending)[i], std::move(v_res));
+                }
+            });
+        if(!success) {
+            m_logger->warn("Failed to request attestations from sentinel");
+            batch_done(peer);
+            for(const auto& p : *pending) {
+                attestation_handler(p, std::nullopt);
+            }
+        }
+    }
+
+    void controller::batch_done(size_t peer) {
+        auto notify = false;
+        {
+            std::unique_lock l(m_batch_mut);
+            m_batches_in_flight[peer]--;
+            notify = m_batches_in_flight[peer] == 0
+                  && !m_batches[peer].m_txs.empty();
+        }
+        if(notify) {
+            m_batch_cv.notify_one();
+        }
+    }
+
+    void controller::batch_sender() {
+        std::unique_lock l(m_batch_mut);
+        while(m_running) {
+            const auto now = std::chrono::steady_clock::now();
+            auto next = std::chrono::steady_clock::time_point::max();
+            auto ready = std::vector<std::pair<size_t, peer_batch>>();
+            for(size_t peer = 0; peer < m_batches.size(); peer++) {
+                auto& batch = m_batches[peer];
+                if(batch.m_txs.empty()) {
+                    continue;
+                }
+                // Send at once to an idle peer. Otherwise collect requests
+                // while the previous batch is answered, so batching only
+                // adds latency under load.
+                if(m_batches_in_flight[peer] == 0
+                   || batch.m_txs.size() >= m_opts.m_sentinel_batch_size
+                   || batch.m_deadline <= now) {
+                    m_batches_in_flight[peer]++;
+                    ready.emplace_back(peer, std::exchange(batch, {}));
+                } else {
+                    next = std::min(next, batch.m_deadline);
+                }
+            }
+
+            // Hedge deadlines are armed with a constant delay so the queue
+            // is ordered by deadline
+            auto hedges = std::vector<pending_ptr>();
+            while(!m_hedges.empty() && m_hedges.front().first <= now) {
+                if(auto p = m_hedges.front().second.lock()) {
+                    hedges.emplace_back(std::move(p));
+                }
+                m_hedges.pop_front();
+            }
+            if(!m_hedges.empty()) {
+                next = std::min(next, m_hedges.front().first);
+            }
 
-        m_logger->debug("Accepted", to_string(ctx.m_id));
+            if(ready.empty() && hedges.empty()) {
+                if(next == std::chrono::steady_clock::time_point::max()) {
+                    m_batch_cv.wait(l);
+                } else {
+                    m_batch_cv.wait_until(l, next);
+                }
+                continue;
+            }
 
-        send_compact_tx(ctx, std::move(result_callback));
+            // Sending may fail and re-enter the batching logic, so release
+            // the lock first
+            l.unlock();
+            for(auto& [peer, batch] : ready) {
+                send_batch(peer, std::move(batch));
+            }
+            for(const auto& p : hedges) {
+                hedge(p);
+            }
+            l.lock();
+        }
     }
 
     void
@@ -11,16 +11,30 @@
 #include "uhs/sentinel/async_interface.hpp"
 #include "uhs/sentinel/client.hpp"
 #include "uhs/sentinel/format.hpp"
+#include "uhs/sentinel/validation_pool.hpp"
 #include "uhs/transaction/messages.hpp"
 #include "uhs/twophase/coordinator/client.hpp"
 #include "util/common/config.hpp"
 #include "util/common/hashmap.hpp"
 #include "util/network/connection_manager.hpp"
 
+#include <condition_variable>
+#include <deque>
 #include <random>
+#include <thread>
 
 namespace cbdc::sentinel_2pc {
-    /// Manages a sentinel server for the two-phase commit architecture.
+    /// \brief Manages a sentinel server for the two-phase commit architecture.
+    ///
+    /// Gathers the attestations a transaction needs from peer sentinels in
+    /// parallel. Asks enough randomly chosen peers to reach the attestation
+    /// threshold, plus any configured spares, at once. If the threshold
+    /// isn't reached within the hedge delay, or a peer rejects the
+    /// transaction, asks further peers. Requests to a peer with no batch
+    /// awaiting a response go out at once. Requests made while one is
+    /// outstanding are batched into the next RPC to that peer. Validation
+    /// and signing run on a pool of validation threads rather than the RPC
+    /// handler thread.
     class controller : public cbdc::sentinel::async_interface {
       public:
         controller() = delete;
@@ -37,7 +51,9 @@ namespace cbdc::sentinel_2pc {
                    const config::options& opts,
                    std::shared_ptr<logging::log> logger);
 
-        ~controller() override = default;
+        /// Destructor. Stops the RPC server, validation threads and batching
+        /// thread.
+        ~controller() override;
 
         /// Initializes the controller. Connects to the shard coordinator
         /// network and launches a server thread for external clients.
@@ -46,41 +62,74 @@ namespace cbdc::sentinel_2pc {
 
         /// Statically validates a transaction, submits it the shard
         /// coordinator network, and returns the result via a callback
-        /// function.
+        /// function. Blocks while the validation queue is full.
         /// \param tx transaction to submit.
         /// \param result_callback function to call with the execution result.
-        /// \return false if the sentinel was unable to forward the transaction
-        ///         to a coordinator.
+        /// \return false if the transaction could not be queued for
+        ///         validation.
         auto execute_transaction(transaction::full_tx tx,
                                  execute_result_callback_type result_callback)
             -> bool override;
 
         /// Statically validates a transaction and generates a sentinel
-        /// attestation if the transaction is valid.
+        /// attestation if the transaction is valid. Blocks while the
+        /// validation queue is full.
         /// \param tx transaction to validate.
         /// \param result_callback function to call with the attestation or
         ///                        std::nullopt if the transaction was invalid.
-        /// \return true.
+        /// \return false if the transaction could not be queued for
+        ///         validation.
         auto
         validate_transaction(transaction::full_tx tx,
                              validate_result_callback_type result_callback)
             -> bool override;
 
       private:
+        /// Transaction waiting for attestations from peer sentinels.
+        struct pending_attestations {
+            std::mutex m_mut;
+            transaction::full_tx m_tx;
+            transaction::compact_tx m_ctx;
+            execute_result_callback_type m_result_callback;
+            /// Peer sentinels not yet asked for an attestation, in the order
+            /// to ask them.
+            std::vector<size_t> m_unrequested;
+            /// Number of requests awaiting a response.
+            size_t m_outstanding{};
+            /// True once the transaction has been forwarded or rejected.
+            bool m_done{false};
+        };
+
+        using pending_ptr = std::shared_ptr<pending_attestations>;
+
+        /// Validation requests waiting to be sent to a peer sentinel.
+        struct peer_batch {
+            std::vector<transaction::full_tx> m_txs;
+            std::vector<pending_ptr> m_pending;
+            std::chrono::steady_clock::time_point m_deadline;
+        };
+
         static void result_handler(std::optional<bool> res,
                                    const execute_result_callback_type& res_cb);
 
-        void
-        validate_result_handler(validate_result v_res,
-                                const transaction::full_tx& tx,
-                                execute_result_callback_type result_callback,
-                                transaction::compact_tx ctx,
-                                std::unordered_set<size_t> requested);
-
         void gather_attestations(const transaction::full_tx& tx,
                                  execute_result_callback_type result_callback,
-                                 const transaction::compact_tx& ctx,
-                                 std::unordered_set<size_t> requested);
+                                 const transaction::compact_tx& ctx);
+
+        void request_attestation(const pending_ptr& pending);
+
+        void attestation_handler(const pending_ptr& pending,
+                                 validate_result v_res);
+
+        void hedge(const pending_ptr& pending);
+
+        void arm_hedge(const pending_ptr& pending);
+
+        void send_batch(size_t peer, peer_batch batch);
+
+        void batch_done(size_t peer);
+
+        void batch_sender();
 
         void send_compact_tx(const transaction::compact_tx& ctx,
                              execute_result_callback_type result_callback);
@@ -91,6 +140,8 @@ namespace cbdc::sentinel_2pc {
 
         std::unique_ptr<cbdc::sentinel::rpc::async_server> m_rpc_server;
 
+        std::unique_ptr<sentinel::validation_pool> m_validation_pool;
+
         std::unique_ptr<secp256k1_context,
                         decltype(&secp256k1_context_destroy)>
             m_secp{secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
@@ -101,9 +152,20 @@ namespace cbdc::sentinel_2pc {
         std::vector<std::unique_ptr<sentinel::rpc::client>>
             m_sentinel_clients{};
 
+        std::mutex m_rand_mut;
         std::random_device m_r{};
         std::default_random_engine m_rand{m_r()};
-        std::uniform_int_distribution<size_t> m_dist{};
+
+        std::mutex m_batch_mut;
+        std::condition_variable m_batch_cv;
+        std::vector<peer_batch> m_batches;
+        /// Number of batches sent to each peer awaiting a response.
+        std::vector<size_t> m_batches_in_flight;
+        std::deque<std::pair<std::chrono::steady_clock::time_point,
+                             std::weak_ptr<pending_attestations>>>
+            m_hedges;
+        bool m_running{true};
+        std::thread m_batch_thread;
 
         privkey_t m_privkey{};
     };
@@ -24,9 +24,57 @@ namespace cbdc::sentinel::rpc {
                                    return m_impl->validate_transaction(
                                        std::move(v_req),
                                        callback);
+                               },
+                               [&](validate_batch_request v_req) {
+                                   return validate_batch(std::move(v_req),
+                                                         callback);
                                }},
                     req);
                 return res;
             });
     }
+
+    auto async_server::validate_batch(
+        validate_batch_request req,
+        const async_interface::result_callback_type& callback) -> bool {
+        // Shared with the validation callbacks, which may complete on other
+        // threads
+        struct batch_state {
+            std::mutex m_mut;
+            validate_batch_response m_resp;
+            size_t m_pending{};
+            async_interface::result_callback_type m_callback;
+        };
+        auto state = std::make_shared<batch_state>();
+        state->m_resp.m_attestations.resize(req.m_txs.size());
+        state->m_pending = req.m_txs.size();
+        state->m_callback = callback;
+        if(req.m_txs.empty()) {
+            callback(std::move(state->m_resp));
+            return true;
+        }
+
+        auto complete = [state](size_t i,
+                                async_interface::validate_result res) {
+            auto done = [&]() {
+                std::lock_guard l(state->m_mut);
+                state->m_resp.m_attestations[i] = std::move(res);
+                return --state->m_pending == 0;
+            }();
+            if(done) {
+                state->m_callback(std::move(state->m_resp));
+            }
+        };
+        for(size_t i = 0; i < req.m_txs.size(); i++) {
+            auto started = m_impl->validate_transaction(
+                std::move(req.m_txs[i]),
+                [complete, i](async_interface::validate_result res) {
+                    complete(i, std::move(res));
+                });
+            if(!started) {
+                complete(i, std::nullopt);
+            }
+        }
+        return true;
+    }
 }
@@ -28,6 +28,11 @@ namespace cbdc::sentinel::rpc {
       private:
         async_interface* m_impl;
         std::unique_ptr<cbdc::rpc::async_server<request, response>> m_srv;
+
+        auto
+        validate_batch(validate_batch_request req,
+                       const async_interface::result_callback_type& callback)
+            -> bool;
     };
 }
 
@@ -77,6 +77,34 @@ namespace cbdc {
             }
         }
 
+        /// \brief Pops a batch of elements from the queue.
+        ///
+        /// Blocks if the queue is empty, then pops as many elements as are
+        /// ready, up to the given maximum. Unblocks on destruction or \ref
+        /// clear without returning an element.
+        /// \param items vector to append the popped elements to.
+        /// \param max_items maximum number of elements to pop.
+        /// \return number of elements popped. Zero if interrupted by \ref
+        ///         clear() or destruction.
+        [[nodiscard]] auto pop(std::vector<T>& items, size_t max_items)
+            -> size_t {
+            std::unique_lock<std::mutex> lck(m_mut);
+            if(m_buffer.empty()) {
+                m_cv.wait(lck, [&] {
+                    return m_wake;
+                });
+            }
+
+            size_t popped{0};
+            while(popped < max_items && !m_buffer.empty()) {
+                items.emplace_back(std::move(first_item<T, Q>()));
+                m_buffer.pop();
+                popped++;
+            }
+            m_wake = !m_buffer.empty();
+            return popped;
+        }
+
         /// Clears the queue and unblocks waiting consumers.
         void clear() {
             {
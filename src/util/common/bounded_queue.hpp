@@ -0,0 +1,446 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_BOUNDED_QUEUE_H_
+#define OPENCBDC_TX_SRC_COMMON_BOUNDED_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cbdc {
+    /// \brief Bounded lock-free FIFO queue.
+    ///
+    /// Ring buffer where each slot carries a sequence number recording
+    /// whether it is ready to be written or read on the current lap, so
+    /// producers and consumers only contend on claiming a position rather
+    /// than on a shared lock. Blocking operations spin for a while before
+    /// parking the calling thread, adapting how long they spin to whether
+    /// spinning has recently paid off. Producers block while the queue is
+    /// full.
+    /// \tparam T type of object stored in the queue. Must be default
+    ///           constructible and move assignable.
+    /// \tparam multi_consumer false if only one thread at a time pops from
+    ///                        the queue, which lets consumers claim slots
+    ///                        without atomic read-modify-write operations.
+    template<typename T, bool multi_consumer = true>
+    class bounded_queue {
+      public:
+        /// Constructor.
+        /// \param capacity minimum number of elements the queue can hold.
+        ///                 Rounded up to the next power of two.
+        explicit bounded_queue(size_t capacity)
+            : m_mask(round_capacity(capacity) - 1),
+              m_cells(m_mask + 1) {
+            for(size_t i = 0; i < m_cells.size(); i++) {
+                m_cells[i].m_seq.store(i, std::memory_order_relaxed);
+            }
+            // Spinning only pays off if another core can make progress
+            // meanwhile
+            if(std::thread::hardware_concurrency() <= 1) {
+                m_producers.m_spins.store(0, std::memory_order_relaxed);
+                m_consumers.m_spins.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        bounded_queue(const bounded_queue&) = delete;
+        auto operator=(const bounded_queue&) -> bounded_queue& = delete;
+
+        bounded_queue(bounded_queue&&) = delete;
+        auto operator=(bounded_queue&&) -> bounded_queue& = delete;
+
+        /// \brief Destructor.
+        ///
+        /// Clears the queue and unblocks any waiting producers and
+        /// consumers.
+        ~bounded_queue() {
+            clear();
+        }
+
+        /// Pushes an element onto the queue if there is space for it and
+        /// wakes at most one waiting consumer.
+        /// \param item object to push onto the queue.
+        /// \return true if the element was pushed, false if the queue was
+        ///         full or cleared.
+        [[nodiscard]] auto try_push(T item) -> bool {
+            if(m_closed.load(std::memory_order_acquire)
+               || !enqueue(std::move(item))) {
+                return false;
+            }
+            wake(m_consumers, false);
+            return true;
+        }
+
+        /// \brief Pushes an element onto the queue.
+        ///
+        /// Blocks while the queue is full. Unblocks on destruction or \ref
+        /// clear without pushing the element.
+        /// \param item object to push onto the queue.
+        /// \return true on success, false if the queue was cleared.
+        auto push(T item) -> bool {
+            if(!await(m_producers, [&]() {
+                   return enqueue(std::move(item));
+               })) {
+                return false;
+            }
+            wake(m_consumers, false);
+            return true;
+        }
+
+        /// \brief Pushes a range of elements onto the queue in order.
+        ///
+        /// Blocks while the queue is full and wakes consumers once for the
+        /// whole range rather than once per element. Elements are not
+        /// pushed atomically as a group, so consumers may pop some of them
+        /// before the rest are pushed.
+        /// \param first iterator to the first element to push.
+        /// \param last iterator past the last element to push.
+        /// \return number of elements pushed, which is less than the size of
+        ///         the range only if the queue was cleared.
+        template<typename It>
+        auto push(It first, It last) -> size_t {
+            if(m_closed.load(std::memory_order_acquire)) {
+                return 0;
+            }
+            size_t pushed{0};
+            size_t unwoken{0};
+            for(; first != last; ++first) {
+                if(!enqueue(*first)) {
+                    // Let consumers drain what has been pushed so far before
+                    // waiting for space
+                    wake_pushed(unwoken);
+                    unwoken = 0;
+                    if(!await(m_producers, [&]() {
+                           return enqueue(*first);
+                       })) {
+                        break;
+                    }
+                }
+                pushed++;
+                unwoken++;
+            }
+            wake_pushed(unwoken);
+            return pushed;
+        }
+
+        /// Pops an element from the queue if one is available.
+        /// \param item object into which to move the popped element.
+        /// \return true on success, false if the queue was empty or cleared.
+        [[nodiscard]] auto try_pop(T& item) -> bool {
+            if(m_closed.load(std::memory_order_acquire) || !dequeue(item)) {
+                return false;
+            }
+            wake_producers(false);
+            return true;
+        }
+
+        /// \brief Pops an element from the queue.
+        ///
+        /// Blocks if the queue is empty. Unblocks on destruction or \ref
+        /// clear without returning an element.
+        /// \param item object into which to move the popped element.
+        /// \return true on success, false if interrupted by \ref clear() or
+        ///         destruction.
+        [[nodiscard]] auto pop(T& item) -> bool {
+            if(!await(m_consumers, [&]() {
+                   return dequeue(item);
+               })) {
+                return false;
+            }
+            wake_producers(false);
+            return true;
+        }
+
+        /// \brief Pops up to the given number of elements from the queue.
+        ///
+        /// Blocks until at least one element is available, then pops as
+        /// many more as are ready without blocking again. Wakes producers
+        /// once for the whole batch.
+        /// \param items vector to append the popped elements to.
+        /// \param max_items maximum number of elements to pop.
+        /// \return number of elements popped. Zero if interrupted by \ref
+        ///         clear() or destruction.
+        auto pop(std::vector<T>& items, size_t max_items) -> size_t {
+            if(max_items == 0) {
+                return 0;
+            }
+            auto item = T();
+            if(!await(m_consumers, [&]() {
+                   return dequeue(item);
+               })) {
+                return 0;
+            }
+            size_t popped{0};
+            do {
+                items.push_back(std::move(item));
+                popped++;
+            } while(popped < max_items && dequeue(item));
+            wake_producers(popped > 1);
+            return popped;
+        }
+
+        /// Clears the queue and unblocks waiting producers and consumers.
+        /// Producers cannot push and consumers cannot pop until \ref reset()
+        /// is called. With a single consumer, only the consumer may remove
+        /// elements, so they stay in the queue until \ref reset() or
+        /// destruction.
+        void clear() {
+            m_closed.store(true, std::memory_order_release);
+            if constexpr(multi_consumer) {
+                auto item = T();
+                while(dequeue(item)) {}
+            }
+            signal(m_producers, true);
+            signal(m_consumers, true);
+        }
+
+        /// Discards elements remaining after \ref clear() and allows the
+        /// queue to be used again. All producers and consumers must have
+        /// returned before calling this method.
+        void reset() {
+            auto item = T();
+            while(dequeue(item)) {}
+            m_closed.store(false, std::memory_order_release);
+        }
+
+        /// Returns the number of elements the queue can hold.
+        /// \return queue capacity.
+        [[nodiscard]] auto capacity() const -> size_t {
+            return m_cells.size();
+        }
+
+      private:
+        /// Cache line size used to keep the producer and consumer positions
+        /// from sharing a line.
+        static constexpr size_t cache_line_size{64};
+        /// Number of times a thread retries before it first parks.
+        static constexpr uint32_t initial_spins{128};
+        static constexpr uint32_t min_spins{4};
+        static constexpr uint32_t max_spins{4096};
+
+        struct cell {
+            std::atomic<size_t> m_seq{};
+            T m_value{};
+        };
+
+        /// Threads waiting for the queue to become non-empty or non-full.
+        struct alignas(cache_line_size) wait_state {
+            /// Number of parked threads which have not been signalled.
+            std::atomic<uint32_t> m_sleepers{};
+            /// Number of attempts to spin before parking.
+            std::atomic<uint32_t> m_spins{initial_spins};
+            std::mutex m_mut;
+            std::condition_variable m_cv;
+            /// Signals issued to parked threads and not yet consumed.
+            uint32_t m_signals{};
+        };
+
+        alignas(cache_line_size) std::atomic<size_t> m_enqueue_pos{};
+        alignas(cache_line_size) std::atomic<size_t> m_dequeue_pos{};
+        alignas(cache_line_size) std::atomic<bool> m_closed{false};
+        wait_state m_producers;
+        wait_state m_consumers;
+        size_t m_mask;
+        std::vector<cell> m_cells;
+
+        static auto round_capacity(size_t capacity) -> size_t {
+            size_t res{2};
+            while(res < capacity) {
+                res <<= 1U;
+            }
+            return res;
+        }
+
+        static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#else
+            std::this_thread::yield();
+#endif
+        }
+
+        template<typename U>
+        auto enqueue(U&& item) -> bool {
+            auto pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            cell* c{};
+            for(;;) {
+                c = &m_cells[pos & m_mask];
+                auto seq = c->m_seq.load(std::memory_order_acquire);
+                if(seq == pos) {
+                    // The slot is free on this lap, try to claim it
+                    if(m_enqueue_pos.compare_exchange_weak(
+                           pos,
+                           pos + 1,
+                           std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if(seq < pos) {
+                    // The slot still holds the element from the previous
+                    // lap, so the queue is full
+                    return false;
+                } else {
+                    pos = m_enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+            c->m_value = std::forward<U>(item);
+            c->m_seq.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        auto dequeue(T& item) -> bool {
+            auto pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            cell* c{};
+            for(;;) {
+                c = &m_cells[pos & m_mask];
+                auto seq = c->m_seq.load(std::memory_order_acquire);
+                if(seq == pos + 1) {
+                    if constexpr(multi_consumer) {
+                        if(m_dequeue_pos.compare_exchange_weak(
+                               pos,
+                               pos + 1,
+                               std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else {
+                        m_dequeue_pos.store(pos + 1,
+                                            std::memory_order_relaxed);
+                        break;
+                    }
+                } else if(seq < pos + 1) {
+                    // The slot has not been written on this lap yet, so the
+                    // queue is empty
+                    return false;
+                } else {
+                    pos = m_dequeue_pos.load(std::memory_order_relaxed);
+                }
+            }
+            item = std::move(c->m_value);
+            c->m_value = T();
+            c->m_seq.store(pos + m_mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// Retries the given operation until it succeeds or the queue is
+        /// cleared. Spins before parking on the given wait state.
+        template<typename F>
+        auto await(wait_state& ws, F&& attempt) -> bool {
+            auto spins = ws.m_spins.load(std::memory_order_relaxed);
+            for(uint32_t i = 0; i < spins; i++) {
+                if(m_closed.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                if(attempt()) {
+                    if(i > 0 && spins < max_spins) {
+                        ws.m_spins.store(spins * 2,
+                                         std::memory_order_relaxed);
+                    }
+                    return true;
+                }
+                cpu_relax();
+            }
+            if(spins > min_spins) {
+                ws.m_spins.store(spins / 2, std::memory_order_relaxed);
+            }
+
+            for(;;) {
+                std::unique_lock l(ws.m_mut);
+                // Register as a sleeper before re-checking the queue. Pairs
+                // with the fence in wake() so either the waker sees this
+                // thread or the re-check sees the waker's change.
+                ws.m_sleepers.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if(m_closed.load(std::memory_order_acquire)) {
+                    ws.m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+                    return false;
+                }
+                if(attempt()) {
+                    ws.m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+                ws.m_cv.wait(l, [&]() {
+                    return ws.m_signals > 0;
+                });
+                ws.m_signals--;
+                l.unlock();
+                if(m_closed.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                if(attempt()) {
+                    return true;
+                }
+            }
+        }
+
+        /// Wakes threads parked on the given wait state. Signalled threads
+        /// stop counting as sleepers, so further changes made before they
+        /// run cost a fence rather than another wake-up.
+        void wake(wait_state& ws, bool all) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(ws.m_sleepers.load(std::memory_order_relaxed) == 0) {
+                return;
+            }
+            signal(ws, all);
+        }
+
+        /// Wakes parked producers once consumers have freed half the queue,
+        /// so producers refill it in bursts rather than trading places with
+        /// consumers on every slot.
+        void wake_producers(bool all) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(m_producers.m_sleepers.load(std::memory_order_relaxed) == 0) {
+                return;
+            }
+            // Read the dequeue position first so the difference cannot
+            // underflow
+            auto dequeue_pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            auto enqueue_pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            if(enqueue_pos - dequeue_pos > m_cells.size() / 2) {
+                return;
+            }
+            signal(m_producers, all);
+        }
+
+        void signal(wait_state& ws, bool all) {
+            {
+                std::unique_lock l(ws.m_mut);
+                auto sleepers = ws.m_sleepers.load(std::memory_order_relaxed);
+                auto n = all ? sleepers : std::min(sleepers, 1U);
+                if(n == 0) {
+                    return;
+                }
+                ws.m_sleepers.fetch_sub(n, std::memory_order_relaxed);
+                ws.m_signals += n;
+            }
+            if(all) {
+                ws.m_cv.notify_all();
+            } else {
+                ws.m_cv.notify_one();
+            }
+        }
+
+        void wake_pushed(size_t pushed) {
+            if(pushed > 0) {
+                wake(m_consumers, pushed > 1);
+            }
+        }
+    };
+
+    /// Bounded lock-free queue supporting multiple concurrent producers and
+    /// consumers.
+    template<typename T>
+    using mpmc_queue = bounded_queue<T, true>;
+
+    /// Bounded lock-free queue supporting multiple concurrent producers and
+    /// a single consumer.
+    template<typename T>
+    using mpsc_queue = bounded_queue<T, false>;
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_BOUNDED_QUEUE_H_
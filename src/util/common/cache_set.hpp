@@ -10,6 +10,7 @@
 #include <queue>
 #include <shared_mutex>
 #include <unordered_set>
+#include <vector>
 
 namespace cbdc {
     /// \brief Thread-safe set with a maximum size.
@@ -58,6 +59,20 @@ namespace cbdc {
             return m_vals.find(val) != m_vals.end();
         }
 
+        /// Determines whether each of the given values is present in the
+        /// cache set. Holds the lock once for all the values.
+        /// \param vals values to check.
+        /// \return flag for each value, true if it is present in the set.
+        [[nodiscard]] auto contains(const std::vector<K>& vals) const
+            -> std::vector<bool> {
+            auto ret = std::vector<bool>(vals.size());
+            std::shared_lock<std::shared_mutex> l(m_mut);
+            for(size_t i = 0; i < vals.size(); i++) {
+                ret[i] = m_vals.find(vals[i]) != m_vals.end();
+            }
+            return ret;
+        }
+
       private:
         std::unordered_set<K, H> m_vals;
         std::queue<std::reference_wrapper<const K>> m_eviction_queue;
@@ -340,6 +340,8 @@ namespace cbdc::config {
         opts.m_shard_completed_txs_cache_size
             = cfg.get_ulong(shard_completed_txs_cache_size)
                   .value_or(opts.m_shard_completed_txs_cache_size);
+        opts.m_shard_read_max_lag = cfg.get_ulong(shard_read_max_lag_key)
+                                        .value_or(opts.m_shard_read_max_lag);
 
         opts.m_seed_from = cfg.get_ulong(seed_from).value_or(opts.m_seed_from);
         opts.m_seed_to = cfg.get_ulong(seed_to).value_or(opts.m_seed_to);
@@ -402,6 +404,9 @@ namespace cbdc::config {
         opts.m_coordinator_max_threads
             = cfg.get_ulong(coordinator_max_threads)
                   .value_or(opts.m_coordinator_max_threads);
+        opts.m_coordinator_batch_latency_target
+            = cfg.get_ulong(coordinator_batch_latency_target_key)
+                  .value_or(opts.m_coordinator_batch_latency_target);
 
         return std::nullopt;
     }
@@ -412,6 +417,23 @@ namespace cbdc::config {
             = cfg.get_ulong(attestation_threshold_key)
                   .value_or(opts.m_attestation_threshold);
 
+        opts.m_sentinel_batch_size = cfg.get_ulong(sentinel_batch_size_key)
+                                         .value_or(opts.m_sentinel_batch_size);
+        opts.m_sentinel_batch_delay
+            = cfg.get_ulong(sentinel_batch_delay_key)
+                  .value_or(opts.m_sentinel_batch_delay);
+        opts.m_attestation_spares = cfg.get_ulong(attestation_spares_key)
+                                        .value_or(opts.m_attestation_spares);
+        opts.m_attestation_hedge_delay
+            = cfg.get_ulong(attestation_hedge_delay_key)
+                  .value_or(opts.m_attestation_hedge_delay);
+        opts.m_sentinel_validation_threads
+            = cfg.get_ulong(sentinel_validation_threads_key)
+                  .value_or(opts.m_sentinel_validation_threads);
+        opts.m_sentinel_validation_queue_size
+            = cfg.get_ulong(sentinel_validation_queue_size_key)
+                  .value_or(opts.m_sentinel_validation_queue_size);
+
         const auto sentinel_count
             = cfg.get_ulong(sentinel_count_key).value_or(0);
         for(size_t i{0}; i < sentinel_count; i++) {
@@ -488,6 +510,12 @@ namespace cbdc::config {
         opts.m_target_block_interval
             = cfg.get_ulong(target_block_interval_key)
                   .value_or(opts.m_target_block_interval);
+        opts.m_min_block_interval = cfg.get_ulong(min_block_interval_key)
+                                        .value_or(opts.m_min_block_interval);
+        opts.m_block_tx_target = cfg.get_ulong(block_tx_target_key)
+                                     .value_or(opts.m_block_tx_target);
+        opts.m_block_byte_budget = cfg.get_ulong(block_byte_budget_key)
+                                       .value_or(opts.m_block_byte_budget);
 
         opts.m_stxo_cache_depth
             = cfg.get_ulong(stxo_cache_key).value_or(opts.m_stxo_cache_depth);
@@ -523,6 +551,17 @@ namespace cbdc::config {
             opts.m_archiver_db_dirs.push_back(*archiver_db);
         }
 
+        opts.m_archiver_compression
+            = cfg.get_ulong(archiver_compression_key).value_or(0) != 0;
+        opts.m_archiver_attestations
+            = cfg.get_ulong(archiver_attestations_key).value_or(1) != 0;
+        opts.m_archiver_sync_interval
+            = cfg.get_ulong(archiver_sync_interval_key)
+                  .value_or(opts.m_archiver_sync_interval);
+        opts.m_archiver_range_limit
+            = cfg.get_ulong(archiver_range_limit_key)
+                  .value_or(opts.m_archiver_range_limit);
+
         return std::nullopt;
     }
 
@@ -614,6 +653,14 @@ namespace cbdc::config {
 
         opts.m_loadgen_count
             = cfg.get_ulong(loadgen_count_key).value_or(opts.m_loadgen_count);
+        opts.m_loadgen_threads = cfg.get_ulong(loadgen_threads_key)
+                                     .value_or(opts.m_loadgen_threads);
+        opts.m_loadgen_tx_rate = cfg.get_ulong(loadgen_tx_rate_key)
+                                     .value_or(opts.m_loadgen_tx_rate);
+        opts.m_loadgen_presign_depth
+            = cfg.get_ulong(loadgen_presign_depth_key)
+                  .value_or(opts.m_loadgen_presign_depth);
+        opts.m_loadgen_corpus = cfg.get_string(loadgen_corpus_key);
     }
 
     auto read_options(const std::string& config_file)
@@ -706,6 +753,11 @@ namespace cbdc::config {
                 return "Atomizer mode requires at least one configured "
                        "archiver";
             }
+            if(opts.m_archiver_sync_interval == 0
+               || opts.m_archiver_range_limit == 0) {
+                return "Archiver sync interval and range limit must be at "
+                       "least one";
+            }
             if(opts.m_shard_endpoints.empty()
                && !opts.m_sentinel_endpoints.empty()) {
                 return "Sentinels require at least one configured shard";
@@ -725,6 +777,19 @@ namespace cbdc::config {
             }
         }
 
+        if(opts.m_sentinel_batch_size == 0) {
+            return "Sentinel batch size must be at least one";
+        }
+
+        if(opts.m_sentinel_validation_queue_size == 0) {
+            return "Sentinel validation queue size must be at least one";
+        }
+
+        if(opts.m_loadgen_threads == 0 || opts.m_loadgen_presign_depth == 0) {
+            return "Load generator thread count and presign depth must be at "
+                   "least one";
+        }
+
         if(opts.m_sentinel_public_keys.size() < opts.m_attestation_threshold) {
             return "Not enough sentinel public keys to reach the attestation "
                    "threshold";
@@ -748,6 +813,13 @@ namespace cbdc::config {
         return {our_range_start, our_range_end};
     }
 
+    auto loadgen_corpus_file(const options& opts, size_t gen_id)
+        -> std::string {
+        assert(opts.m_loadgen_corpus.has_value());
+        return opts.m_loadgen_corpus.value() + config_separator
+             + std::to_string(gen_id);
+    }
+
     auto get_args(int argc, char** argv) -> std::vector<std::string> {
         auto args = std::vector<char*>(static_cast<size_t>(argc));
         std::memcpy(args.data(),
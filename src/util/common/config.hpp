@@ -48,6 +48,7 @@ namespace cbdc::config {
         static constexpr size_t stxo_cache_depth{1};
         static constexpr size_t window_size{10000};
         static constexpr size_t shard_completed_txs_cache_size{10000000};
+        static constexpr size_t shard_read_max_lag{1000};
         static constexpr size_t batch_size{2000};
         static constexpr size_t target_block_interval{250};
         static constexpr int32_t election_timeout_upper_bound{4000};
@@ -63,6 +64,14 @@ namespace cbdc::config {
         static constexpr size_t output_count{2};
         static constexpr double fixed_tx_rate{1.0};
         static constexpr size_t attestation_threshold{1};
+        static constexpr size_t sentinel_batch_size{100};
+        static constexpr size_t sentinel_batch_delay{500};
+        static constexpr size_t attestation_hedge_delay{100};
+        static constexpr size_t sentinel_validation_queue_size{10000};
+        static constexpr size_t archiver_sync_interval{1};
+        static constexpr size_t archiver_range_limit{100};
+        static constexpr size_t loadgen_threads{1};
+        static constexpr size_t loadgen_presign_depth{1000};
 
         static constexpr auto log_level = logging::log_level::warn;
     }
@@ -89,6 +98,9 @@ namespace cbdc::config {
     static constexpr auto batch_size_key = "batch_size";
     static constexpr auto window_size_key = "window_size";
     static constexpr auto target_block_interval_key = "target_block_interval";
+    static constexpr auto min_block_interval_key = "min_block_interval";
+    static constexpr auto block_tx_target_key = "block_tx_target";
+    static constexpr auto block_byte_budget_key = "block_byte_budget";
     static constexpr auto election_timeout_upper_key
         = "election_timeout_upper";
     static constexpr auto election_timeout_lower_key
@@ -101,6 +113,11 @@ namespace cbdc::config {
     static constexpr auto invalid_rate_key = "loadgen_invalid_tx_rate";
     static constexpr auto fixed_tx_rate_key = "loadgen_fixed_tx_rate";
     static constexpr auto archiver_count_key = "archiver_count";
+    static constexpr auto archiver_compression_key = "archiver_compression";
+    static constexpr auto archiver_attestations_key = "archiver_attestations";
+    static constexpr auto archiver_sync_interval_key
+        = "archiver_sync_interval";
+    static constexpr auto archiver_range_limit_key = "archiver_range_limit";
     static constexpr auto watchtower_count_key = "watchtower_count";
     static constexpr auto watchtower_prefix = "watchtower";
     static constexpr auto watchtower_client_ep_postfix = "client_endpoint";
@@ -115,15 +132,31 @@ namespace cbdc::config {
     static constexpr auto coordinator_prefix = "coordinator";
     static constexpr auto coordinator_count_key = "coordinator_count";
     static constexpr auto coordinator_max_threads = "coordinator_max_threads";
+    static constexpr auto coordinator_batch_latency_target_key
+        = "coordinator_batch_latency_target";
     static constexpr auto initial_mint_count_key = "initial_mint_count";
     static constexpr auto initial_mint_value_key = "initial_mint_value";
     static constexpr auto loadgen_count_key = "loadgen_count";
+    static constexpr auto loadgen_threads_key = "loadgen_threads";
+    static constexpr auto loadgen_tx_rate_key = "loadgen_tx_rate";
+    static constexpr auto loadgen_presign_depth_key = "loadgen_presign_depth";
+    static constexpr auto loadgen_corpus_key = "loadgen_corpus";
     static constexpr auto shard_completed_txs_cache_size
         = "shard_completed_txs_cache_size";
+    static constexpr auto shard_read_max_lag_key = "shard_read_max_lag";
     static constexpr auto wait_for_followers_key = "wait_for_followers";
     static constexpr auto private_key_postfix = "private_key";
     static constexpr auto public_key_postfix = "public_key";
     static constexpr auto attestation_threshold_key = "attestation_threshold";
+    static constexpr auto sentinel_batch_size_key = "sentinel_batch_size";
+    static constexpr auto sentinel_batch_delay_key = "sentinel_batch_delay";
+    static constexpr auto attestation_spares_key = "attestation_spares";
+    static constexpr auto attestation_hedge_delay_key
+        = "attestation_hedge_delay";
+    static constexpr auto sentinel_validation_threads_key
+        = "sentinel_validation_threads";
+    static constexpr auto sentinel_validation_queue_size_key
+        = "sentinel_validation_queue_size";
 
     /// [start, end] inclusive.
     using shard_range_t = std::pair<uint8_t, uint8_t>;
@@ -147,6 +180,11 @@ namespace cbdc::config {
         /// endpoint.
         size_t m_shard_completed_txs_cache_size{
             defaults::shard_completed_txs_cache_size};
+        /// Maximum number of committed log entries a locking shard (2PC)
+        /// replica may not yet have applied when serving queries through the
+        /// read-only endpoint. Clients also discard responses from replicas
+        /// this far behind the most recent replica they have heard from.
+        size_t m_shard_read_max_lag{defaults::shard_read_max_lag};
 
         /// List of atomizer endpoints, ordered by atomizer ID.
         std::vector<network::endpoint_t> m_atomizer_endpoints;
@@ -166,7 +204,19 @@ namespace cbdc::config {
         /// atomizer or one batch in the coordinator.
         size_t m_batch_size{defaults::batch_size};
         /// Target block creation interval in the atomizer in milliseconds.
+        /// The atomizer creates a block at least this often.
         size_t m_target_block_interval{defaults::target_block_interval};
+        /// Minimum interval between blocks created early because they
+        /// reached the transaction target or byte budget, in milliseconds.
+        size_t m_min_block_interval{0};
+        /// Number of transactions after which the atomizer creates a block
+        /// before the target block interval has elapsed. 0 disables the
+        /// transaction target.
+        size_t m_block_tx_target{0};
+        /// Serialized size of transaction notifications, in bytes, after
+        /// which the atomizer creates a block before the target block
+        /// interval has elapsed. 0 disables the byte budget.
+        size_t m_block_byte_budget{0};
         /// List of atomizer log levels by atomizer ID.
         std::vector<logging::log_level> m_atomizer_loglevels;
         /// Raft election timeout upper bound in milliseconds.
@@ -206,6 +256,17 @@ namespace cbdc::config {
         std::vector<logging::log_level> m_watchtower_loglevels;
         /// List of archiver DB paths by archiver ID.
         std::vector<std::string> m_archiver_db_dirs;
+        /// Flag set if archivers compress stored blocks.
+        bool m_archiver_compression{false};
+        /// Flag set if archivers keep the sentinel attestations of archived
+        /// transactions. Attestations are stored apart from the blocks and
+        /// only read when requested.
+        bool m_archiver_attestations{true};
+        /// Number of blocks archivers write between syncs to disk. Atomizers
+        /// are only asked to prune blocks which have been synced.
+        size_t m_archiver_sync_interval{defaults::archiver_sync_interval};
+        /// Maximum number of blocks archivers return for one range request.
+        size_t m_archiver_range_limit{defaults::archiver_range_limit};
         /// Flag set if m_input_count or m_output_count are greater than zero.
         /// Causes the atomizer-cli to send fixed-size transactions.
         bool m_fixed_tx_mode{false};
@@ -228,8 +289,14 @@ namespace cbdc::config {
         /// ID.
         std::vector<std::vector<network::endpoint_t>>
             m_coordinator_raft_endpoints;
-        /// Coordinator thread count limit.
+        /// Maximum number of distributed transactions a coordinator executes
+        /// at once.
         size_t m_coordinator_max_threads{defaults::coordinator_max_threads};
+        /// Target latency in milliseconds for a coordinator to complete a
+        /// batch. The coordinator shrinks its batches when they take longer
+        /// and grows them up to the batch size when full batches complete
+        /// sooner. 0 disables adaptive batch sizing.
+        size_t m_coordinator_batch_latency_target{0};
         /// List of coordinator log levels, ordered by coordinator ID.
         std::vector<logging::log_level> m_coordinator_loglevels;
 
@@ -250,6 +317,24 @@ namespace cbdc::config {
         /// Number of load generators over which to split pre-seeded UTXOs.
         size_t m_loadgen_count{0};
 
+        /// Number of threads each load generator uses to generate and sign
+        /// transactions. Each thread spends from its own share of the load
+        /// generator's UTXOs.
+        size_t m_loadgen_threads{defaults::loadgen_threads};
+
+        /// Target number of transactions per second sent by each load
+        /// generator. 0 sends transactions as fast as they are generated.
+        size_t m_loadgen_tx_rate{0};
+
+        /// Number of signed transactions each load generator thread prepares
+        /// ahead of send time.
+        size_t m_loadgen_presign_depth{defaults::loadgen_presign_depth};
+
+        /// Path prefix of pre-generated transaction corpus files. If set,
+        /// load generators replay their corpus rather than generating and
+        /// signing transactions.
+        std::optional<std::string> m_loadgen_corpus;
+
         /// Private keys for sentinels.
         std::unordered_map<size_t, privkey_t> m_sentinel_private_keys;
 
@@ -258,6 +343,36 @@ namespace cbdc::config {
 
         /// Number of sentinel attestations needed for a compact transaction.
         size_t m_attestation_threshold{defaults::attestation_threshold};
+
+        /// Maximum number of compact transactions an atomizer sentinel
+        /// batches into a single message to a shard, and of validation
+        /// requests a two-phase sentinel batches into a single request to a
+        /// peer sentinel.
+        size_t m_sentinel_batch_size{defaults::sentinel_batch_size};
+
+        /// Maximum time in microseconds a sentinel holds a compact
+        /// transaction or validation request before sending a partial batch.
+        /// A two-phase sentinel only holds validation requests while an
+        /// earlier batch to the same peer awaits a response.
+        size_t m_sentinel_batch_delay{defaults::sentinel_batch_delay};
+
+        /// Number of peer sentinels a two-phase sentinel asks for an
+        /// attestation beyond those needed to reach the attestation
+        /// threshold.
+        size_t m_attestation_spares{0};
+
+        /// Time in milliseconds a two-phase sentinel waits for attestations
+        /// before asking further peer sentinels. 0 disables hedging.
+        size_t m_attestation_hedge_delay{defaults::attestation_hedge_delay};
+
+        /// Number of threads a sentinel uses to validate and attest to
+        /// transactions. 0 uses one thread per hardware thread.
+        size_t m_sentinel_validation_threads{0};
+
+        /// Maximum number of transactions waiting for a sentinel validation
+        /// thread. Sentinels stop reading requests while the queue is full.
+        size_t m_sentinel_validation_queue_size{
+            defaults::sentinel_validation_queue_size};
     };
 
     /// Read options from the given config file without checking invariants.
@@ -297,6 +412,15 @@ namespace cbdc::config {
     auto loadgen_seed_range(const options& opts, size_t gen_id)
         -> std::pair<size_t, size_t>;
 
+    /// Returns the path of the transaction corpus file for a particular load
+    /// generator ID.
+    /// \param opts options struct from which to read the corpus path prefix.
+    ///             Must have a corpus path prefix set.
+    /// \param gen_id ID of load generator for which to return the path.
+    /// \return corpus file path.
+    auto loadgen_corpus_file(const options& opts, size_t gen_id)
+        -> std::string;
+
     /// Converts c-args from an executable's main function into a vector of
     /// strings.
     auto get_args(int argc, char** argv) -> std::vector<std::string>;
@@ -0,0 +1,197 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_COPY_ON_WRITE_H_
+#define OPENCBDC_TX_SRC_COMMON_COPY_ON_WRITE_H_
+
+#include <memory>
+#include <vector>
+
+namespace cbdc {
+    /// \brief Value which can be shared cheaply and is copied when modified.
+    ///
+    /// Sharing the value with \ref share returns a second instance backed
+    /// by the same storage. The storage is never modified again after it has
+    /// been shared: whichever instance calls \ref mut first makes a private
+    /// copy and modifies that instead. Instances which only read the value
+    /// may be used from other threads while the sharing instance continues
+    /// to modify its own copy.
+    /// \tparam T type of the value.
+    template<typename T>
+    class copy_on_write {
+      public:
+        /// Constructs a default-initialized value.
+        copy_on_write() : m_ptr(std::make_shared<T>()) {}
+
+        /// Constructs an instance holding the given value.
+        /// \param val value to hold.
+        explicit copy_on_write(T val)
+            : m_ptr(std::make_shared<T>(std::move(val))) {}
+
+        /// Instances may only share their value through \ref share, which
+        /// marks both instances as shared.
+        copy_on_write(const copy_on_write&) = delete;
+        auto operator=(const copy_on_write&) -> copy_on_write& = delete;
+
+        copy_on_write(copy_on_write&&) noexcept = default;
+        auto operator=(copy_on_write&&) noexcept -> copy_on_write& = default;
+
+        ~copy_on_write() = default;
+
+        /// Returns the value for reading.
+        /// \return const reference to the value.
+        [[nodiscard]] auto get() const -> const T& {
+            return *m_ptr;
+        }
+
+        /// Returns the value for modification, first copying it if it is
+        /// shared with another instance.
+        /// \return reference to the value.
+        auto mut() -> T& {
+            if(m_shared) {
+                m_ptr = std::make_shared<T>(*m_ptr);
+                m_shared = false;
+            }
+            return *m_ptr;
+        }
+
+        /// Returns an instance which shares this instance's value. Both
+        /// instances will copy the value before modifying it.
+        /// \return sharing instance.
+        auto share() -> copy_on_write {
+            m_shared = true;
+            return copy_on_write(m_ptr);
+        }
+
+      private:
+        explicit copy_on_write(std::shared_ptr<T> ptr)
+            : m_ptr(std::move(ptr)),
+              m_shared(true) {}
+
+        std::shared_ptr<T> m_ptr;
+        bool m_shared{false};
+    };
+
+    /// \brief Hash container split into buckets which are each copied on
+    ///        write.
+    ///
+    /// Behaves like a \ref copy_on_write holding the whole container, except
+    /// that elements are spread over a fixed number of buckets by the hash of
+    /// their key. After the container has been shared, modifying an element
+    /// only copies the bucket holding its key. The cost of copying the
+    /// container is therefore spread over the first writes to each bucket
+    /// rather than paid in full by the first write.
+    /// \tparam T unordered set or map type of each bucket.
+    template<typename T>
+    class bucketed_copy_on_write {
+      public:
+        /// Type of the container's keys.
+        using key_type = typename T::key_type;
+
+        /// Number of buckets the elements are spread over.
+        static constexpr size_t n_buckets = 64;
+
+        /// Constructs an empty container.
+        bucketed_copy_on_write() : m_buckets(n_buckets) {}
+
+        /// Constructs an instance holding the elements of the given
+        /// container.
+        /// \param val container whose elements to hold.
+        explicit bucketed_copy_on_write(T val) : bucketed_copy_on_write() {
+            while(!val.empty()) {
+                auto node = val.extract(val.begin());
+                auto& b = mut(node_key(node));
+                b.insert(std::move(node));
+            }
+        }
+
+        /// Returns the bucket which holds the given key, for reading.
+        /// \param key key to look up.
+        /// \return const reference to the bucket.
+        [[nodiscard]] auto get(const key_type& key) const -> const T& {
+            return m_buckets[index(key)].get();
+        }
+
+        /// Returns the bucket which holds the given key for modification,
+        /// first copying the bucket if it is shared with another instance.
+        /// Iterators into the returned bucket remain valid until the
+        /// container is shared again.
+        /// \param key key to look up.
+        /// \return reference to the bucket.
+        auto mut(const key_type& key) -> T& {
+            return m_buckets[index(key)].mut();
+        }
+
+        /// Returns the buckets, for iterating over every element.
+        /// \return buckets holding the elements.
+        [[nodiscard]] auto buckets() const
+            -> const std::vector<copy_on_write<T>>& {
+            return m_buckets;
+        }
+
+        /// Returns the number of elements in the container.
+        /// \return number of elements.
+        [[nodiscard]] auto size() const -> size_t {
+            size_t ret{0};
+            for(const auto& b : m_buckets) {
+                ret += b.get().size();
+            }
+            return ret;
+        }
+
+        /// Reserves space for the given number of elements, assuming they
+        /// are spread evenly over the buckets.
+        /// \param n number of elements.
+        void reserve(size_t n) {
+            for(auto& b : m_buckets) {
+                b.mut().reserve(n / n_buckets);
+            }
+        }
+
+        /// Returns an instance which shares this instance's buckets. Both
+        /// instances will copy a bucket before modifying it.
+        /// \return sharing instance.
+        auto share() -> bucketed_copy_on_write {
+            auto ret = bucketed_copy_on_write(std::vector<copy_on_write<T>>());
+            ret.m_buckets.reserve(n_buckets);
+            for(auto& b : m_buckets) {
+                ret.m_buckets.emplace_back(b.share());
+            }
+            return ret;
+        }
+
+        auto operator==(const bucketed_copy_on_write& other) const -> bool {
+            // Keys always hash to the same bucket, so equal containers hold
+            // equal buckets
+            for(size_t i = 0; i < n_buckets; i++) {
+                if(m_buckets[i].get() != other.m_buckets[i].get()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+      private:
+        explicit bucketed_copy_on_write(std::vector<copy_on_write<T>> buckets)
+            : m_buckets(std::move(buckets)) {}
+
+        [[nodiscard]] static auto index(const key_type& key) -> size_t {
+            return typename T::hasher()(key) % n_buckets;
+        }
+
+        [[nodiscard]] static auto node_key(typename T::node_type& node)
+            -> const key_type& {
+            if constexpr(requires { node.key(); }) {
+                return node.key();
+            } else {
+                return node.value();
+            }
+        }
+
+        std::vector<copy_on_write<T>> m_buckets;
+    };
+}
+
+#endif
@@ -0,0 +1,101 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "hdr_histogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+
+namespace cbdc {
+    hdr_histogram::hdr_histogram(uint64_t highest_trackable)
+        : m_highest_trackable(highest_trackable),
+          m_counts(index_for(highest_trackable) + 1) {}
+
+    void hdr_histogram::record(uint64_t value) {
+        value = std::min(value, m_highest_trackable);
+        m_counts[index_for(value)]++;
+        if(m_total == 0 || value < m_min) {
+            m_min = value;
+        }
+        m_max = std::max(m_max, value);
+        m_total++;
+    }
+
+    void hdr_histogram::merge(const hdr_histogram& other) {
+        assert(m_counts.size() == other.m_counts.size());
+        if(other.m_total == 0) {
+            return;
+        }
+        for(size_t i = 0; i < m_counts.size(); i++) {
+            m_counts[i] += other.m_counts[i];
+        }
+        if(m_total == 0 || other.m_min < m_min) {
+            m_min = other.m_min;
+        }
+        m_max = std::max(m_max, other.m_max);
+        m_total += other.m_total;
+    }
+
+    void hdr_histogram::reset() {
+        std::fill(m_counts.begin(), m_counts.end(), 0);
+        m_total = 0;
+        m_min = 0;
+        m_max = 0;
+    }
+
+    auto hdr_histogram::count() const -> uint64_t {
+        return m_total;
+    }
+
+    auto hdr_histogram::min() const -> uint64_t {
+        return m_min;
+    }
+
+    auto hdr_histogram::max() const -> uint64_t {
+        return m_max;
+    }
+
+    auto hdr_histogram::value_at_percentile(double percentile) const
+        -> uint64_t {
+        if(m_total == 0) {
+            return 0;
+        }
+        percentile = std::clamp(percentile, 0.0, 100.0);
+        auto target = static_cast<uint64_t>(
+            std::ceil(percentile / 100.0 * static_cast<double>(m_total)));
+        target = std::max(target, uint64_t{1});
+        uint64_t seen{};
+        for(size_t i = 0; i < m_counts.size(); i++) {
+            seen += m_counts[i];
+            if(seen >= target) {
+                return std::min(highest_equivalent(i), m_max);
+            }
+        }
+        return m_max;
+    }
+
+    auto hdr_histogram::index_for(uint64_t value) -> size_t {
+        // Values below sub_bucket_count map directly to their index. Each
+        // following power of two adds another half-bucket of indexes, with
+        // resolution halving each time.
+        auto bucket = static_cast<uint64_t>(
+                          std::bit_width(value | (sub_bucket_count - 1)))
+                    - sub_bucket_bits;
+        auto sub_bucket = value >> bucket;
+        return static_cast<size_t>(bucket * sub_bucket_half_count
+                                   + sub_bucket);
+    }
+
+    auto hdr_histogram::highest_equivalent(size_t index) -> uint64_t {
+        if(index < sub_bucket_count) {
+            return index;
+        }
+        auto bucket = index / sub_bucket_half_count - 1;
+        auto sub_bucket = index - bucket * sub_bucket_half_count;
+        return ((sub_bucket + 1) << bucket) - 1;
+    }
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_HDR_HISTOGRAM_H_
+#define OPENCBDC_TX_SRC_COMMON_HDR_HISTOGRAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cbdc {
+    /// \brief High dynamic range histogram of unsigned integer values.
+    ///
+    /// Values are grouped into buckets covering successive powers of two,
+    /// each divided into a fixed number of linear sub-buckets, so recorded
+    /// values are retained with three significant decimal digits of
+    /// precision across the whole trackable range using constant memory.
+    /// Recording is O(1). Not thread-safe.
+    class hdr_histogram {
+      public:
+        /// Default highest trackable value. One hour in nanoseconds.
+        static constexpr uint64_t default_highest_trackable
+            = 3600ULL * 1000 * 1000 * 1000;
+
+        /// Constructor.
+        /// \param highest_trackable largest value the histogram can record
+        ///                          precisely. Larger values are recorded
+        ///                          as this value.
+        explicit hdr_histogram(
+            uint64_t highest_trackable = default_highest_trackable);
+
+        /// Records a single occurrence of the given value.
+        /// \param value value to record.
+        void record(uint64_t value);
+
+        /// Adds the counts recorded by another histogram to this histogram.
+        /// \param other histogram to merge. Must have been constructed with
+        ///              the same highest trackable value.
+        void merge(const hdr_histogram& other);
+
+        /// Discards all recorded values.
+        void reset();
+
+        /// Returns the number of values recorded.
+        /// \return total count.
+        [[nodiscard]] auto count() const -> uint64_t;
+
+        /// Returns the smallest value recorded, or zero if empty.
+        /// \return minimum value.
+        [[nodiscard]] auto min() const -> uint64_t;
+
+        /// Returns the largest value recorded, or zero if empty.
+        /// \return maximum value.
+        [[nodiscard]] auto max() const -> uint64_t;
+
+        /// Returns the value at the given percentile. The result is the
+        /// highest value equivalent to the recorded values at that
+        /// percentile within the histogram's precision.
+        /// \param percentile percentile between 0 and 100.
+        /// \return value at the percentile, or zero if empty.
+        [[nodiscard]] auto value_at_percentile(double percentile) const
+            -> uint64_t;
+
+      private:
+        static constexpr uint64_t sub_bucket_bits = 11;
+        static constexpr uint64_t sub_bucket_count = 1ULL << sub_bucket_bits;
+        static constexpr uint64_t sub_bucket_half_count
+            = sub_bucket_count / 2;
+
+        uint64_t m_highest_trackable;
+        std::vector<uint64_t> m_counts;
+        uint64_t m_total{};
+        uint64_t m_min{};
+        uint64_t m_max{};
+
+        [[nodiscard]] static auto index_for(uint64_t value) -> size_t;
+
+        [[nodiscard]] static auto highest_equivalent(size_t index)
+            -> uint64_t;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_HDR_HISTOGRAM_H_
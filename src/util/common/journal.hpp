@@ -0,0 +1,134 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_JOURNAL_H_
+#define OPENCBDC_TX_SRC_COMMON_JOURNAL_H_
+
+#include "util/common/buffer.hpp"
+#include "util/serialization/buffer_serializer.hpp"
+#include "util/serialization/format.hpp"
+#include "util/serialization/istream_serializer.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace cbdc {
+    /// \brief Append-only file of serialized state changes.
+    ///
+    /// Persists incremental changes to state which is otherwise saved in
+    /// full, so that saving an operation costs time proportional to the
+    /// number of changes it made. Owners periodically save their full state
+    /// and \ref clear the journal. Entries should be idempotent so replaying
+    /// a journal over a newer full state is harmless.
+    ///
+    /// Each call to \ref append writes its entries and flushes the file.
+    /// \ref replay stops at the first incomplete entry and truncates the file
+    /// there, so an append torn by a crash is discarded.
+    /// \tparam T entry type. Must be default-constructible and serializable.
+    template<typename T>
+    class journal {
+      public:
+        /// Constructor. Does not open or create the journal file.
+        /// \param file path to the journal file.
+        explicit journal(std::string file) : m_file(std::move(file)) {}
+
+        /// Calls the given function with each complete entry in the journal
+        /// file, in the order they were appended.
+        /// \param fn function to call with each entry.
+        /// \return number of entries replayed.
+        template<typename F>
+        auto replay(F&& fn) -> size_t {
+            m_out.close();
+            m_size = 0;
+            auto in = std::ifstream(m_file, std::ios::binary | std::ios::in);
+            if(!in.good()) {
+                return m_size;
+            }
+
+            auto deser = istream_serializer(in);
+            auto good_pos = in.tellg();
+            while(true) {
+                auto entry = T();
+                if(!(deser >> entry)) {
+                    break;
+                }
+                fn(std::move(entry));
+                m_size++;
+                good_pos = in.tellg();
+            }
+            in.close();
+
+            auto ec = std::error_code();
+            const auto file_size = std::filesystem::file_size(m_file, ec);
+            if(!ec && good_pos >= 0
+               && file_size > static_cast<uintmax_t>(good_pos)) {
+                std::filesystem::resize_file(
+                    m_file,
+                    static_cast<uintmax_t>(good_pos),
+                    ec);
+            }
+            return m_size;
+        }
+
+        /// Appends the given entries to the journal file and flushes it.
+        /// \param entries entries to append.
+        /// \return true if the entries were written successfully.
+        auto append(const std::vector<T>& entries) -> bool {
+            if(entries.empty()) {
+                return true;
+            }
+            if(!m_out.is_open()) {
+                m_out.open(m_file,
+                           std::ios::binary | std::ios::app | std::ios::out);
+            }
+
+            auto buf = cbdc::buffer();
+            auto ser = buffer_serializer(buf);
+            for(const auto& entry : entries) {
+                ser << entry;
+            }
+            m_out.write(buf.c_str(), static_cast<std::streamsize>(buf.size()));
+            m_out.flush();
+            if(!m_out.good()) {
+                return false;
+            }
+            m_size += entries.size();
+            return true;
+        }
+
+        /// Removes all entries from the journal. Call after saving the full
+        /// state the entries apply to.
+        /// \return true if the journal file was truncated successfully.
+        auto clear() -> bool {
+            m_out.close();
+            m_out.open(m_file,
+                       std::ios::binary | std::ios::trunc | std::ios::out);
+            m_size = 0;
+            return m_out.good();
+        }
+
+        /// Returns the number of entries in the journal file.
+        /// \return number of entries replayed, appended, or since the last
+        ///         call to \ref clear.
+        [[nodiscard]] auto size() const -> size_t {
+            return m_size;
+        }
+
+        /// Returns the path to the journal file.
+        /// \return journal file path.
+        [[nodiscard]] auto file() const -> const std::string& {
+            return m_file;
+        }
+
+      private:
+        std::string m_file;
+        std::ofstream m_out;
+        size_t m_size{};
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_JOURNAL_H_
@@ -5,48 +5,203 @@
 
 #include "thread_pool.hpp"
 
+#include <algorithm>
+
 namespace cbdc {
+    namespace {
+        /// Pool whose worker is the calling thread, if any.
+        thread_local const thread_pool* current_pool{nullptr};
+        /// Index of the calling worker thread within current_pool.
+        thread_local size_t current_worker{};
+    }
+
+    thread_pool::thread_pool(size_t n_threads) {
+        if(n_threads == 0) {
+            n_threads = std::max(std::thread::hardware_concurrency(), 1U);
+        }
+        m_workers.reserve(n_threads);
+        for(size_t i = 0; i < n_threads; i++) {
+            m_workers.emplace_back(std::make_unique<worker_type>());
+        }
+        for(size_t i = 0; i < n_threads; i++) {
+            m_workers[i]->m_thread = std::thread([this, i]() {
+                thread_loop(i);
+            });
+        }
+    }
+
     thread_pool::~thread_pool() {
-        std::unique_lock l(m_mut);
-        for(auto& t : m_threads) {
-            t->m_queue.clear();
-            if(t->m_thread.joinable()) {
-                t->m_thread.join();
+        {
+            std::unique_lock l(m_sleep_mut);
+            m_running = false;
+        }
+        m_sleep_cv.notify_all();
+        for(auto& w : m_workers) {
+            if(w->m_thread.get_id() == std::this_thread::get_id()) {
+                // A task released the last reference to the pool. The worker
+                // returns without touching the pool once the task does.
+                w->m_thread.detach();
+                current_pool = nullptr;
+            } else if(w->m_thread.joinable()) {
+                w->m_thread.join();
             }
         }
     }
 
-    void thread_pool::push(const std::function<void()>& fn) {
-        std::unique_lock l(m_mut);
-        auto launched = false;
-        for(auto& thr : m_threads) {
-            if(thr->m_running) {
-                continue;
+    void thread_pool::enqueue(task t) {
+        auto& w = *m_workers[target_worker()];
+        {
+            std::unique_lock l(w.m_mut);
+            // Count the task before a worker can take it, so the worker's
+            // decrement never runs ahead of the increment
+            m_queued.fetch_add(1);
+            w.m_queue.emplace_back(std::move(t));
+        }
+        notify(1);
+    }
+
+    void thread_pool::push_batch(std::vector<task> tasks) {
+        if(tasks.empty()) {
+            return;
+        }
+        auto n = tasks.size();
+        auto& w = *m_workers[target_worker()];
+        {
+            std::unique_lock l(w.m_mut);
+            m_queued.fetch_add(n);
+            for(auto& t : tasks) {
+                w.m_queue.emplace_back(std::move(t));
             }
+        }
+        notify(n);
+    }
 
-            thr->m_running = true;
-            thr->m_queue.push(fn);
-            launched = true;
-            break;
+    auto thread_pool::size() const -> size_t {
+        return m_workers.size();
+    }
+
+    auto thread_pool::get_metrics() const -> metrics {
+        auto ret = metrics();
+        ret.m_threads = m_workers.size();
+        ret.m_queued = m_queued.load();
+        ret.m_queue_lengths.reserve(m_workers.size());
+        for(const auto& w : m_workers) {
+            {
+                std::unique_lock l(w->m_mut);
+                ret.m_queue_lengths.push_back(w->m_queue.size());
+            }
+            ret.m_executed += w->m_executed.load(std::memory_order_relaxed);
+            ret.m_steals += w->m_steals.load(std::memory_order_relaxed);
+            ret.m_stolen += w->m_stolen.load(std::memory_order_relaxed);
+        }
+        return ret;
+    }
+
+    auto thread_pool::target_worker() -> size_t {
+        // Tasks pushed by a worker stay on its queue for locality; other
+        // workers steal them if it falls behind
+        if(current_pool == this) {
+            return current_worker;
         }
-        if(launched) {
+        return m_next_worker.fetch_add(1, std::memory_order_relaxed)
+             % m_workers.size();
+    }
+
+    void thread_pool::notify(size_t n) {
+        // Sleeping workers re-check m_queued under m_sleep_mut before
+        // waiting, so taking the mutex here ensures a worker which missed the
+        // new tasks is already waiting and receives the notification
+        if(m_sleeping.load() == 0) {
             return;
         }
+        {
+            std::unique_lock l(m_sleep_mut);
+        }
+        if(n == 1) {
+            m_sleep_cv.notify_one();
+        } else {
+            m_sleep_cv.notify_all();
+        }
+    }
 
-        auto thr = std::make_shared<thread_type>();
-        m_threads.emplace_back(thr);
-        thr->m_running = true;
-        thr->m_thread = std::thread([thr]() {
-            thread_loop(thr);
-        });
-        thr->m_queue.push(fn);
+    void thread_pool::thread_loop(size_t idx) {
+        current_pool = this;
+        current_worker = idx;
+        auto& w = *m_workers[idx];
+        auto t = task();
+        while(m_running) {
+            if(pop_local(idx, t) || steal(idx, t)) {
+                m_queued.fetch_sub(1);
+                w.m_executed.fetch_add(1, std::memory_order_relaxed);
+                t();
+                t = task();
+                if(current_pool != this) {
+                    return;
+                }
+                continue;
+            }
+            wait_for_tasks();
+        }
+    }
+
+    auto thread_pool::pop_local(size_t idx, task& t) -> bool {
+        auto& w = *m_workers[idx];
+        std::unique_lock l(w.m_mut);
+        if(w.m_queue.empty()) {
+            return false;
+        }
+        t = std::move(w.m_queue.front());
+        w.m_queue.pop_front();
+        return true;
     }
 
-    void thread_pool::thread_loop(const std::shared_ptr<thread_type>& thr) {
-        auto f = std::function<void()>();
-        while(thr->m_queue.pop(f)) {
-            f();
-            thr->m_running = false;
+    auto thread_pool::steal(size_t idx, task& t) -> bool {
+        if(m_queued.load() == 0) {
+            return false;
         }
+        auto n = m_workers.size();
+        auto stolen = std::vector<task>();
+        for(size_t i = 1; i < n; i++) {
+            auto& victim = *m_workers[(idx + i) % n];
+            std::unique_lock l(victim.m_mut);
+            if(victim.m_queue.empty()) {
+                continue;
+            }
+            // Take the older half of the victim's queue so a burst of tasks
+            // behind a long-running one spreads across the idle workers
+            // without a steal per task
+            auto count = (victim.m_queue.size() + 1) / 2;
+            stolen.reserve(count);
+            for(size_t j = 0; j < count; j++) {
+                stolen.emplace_back(std::move(victim.m_queue.front()));
+                victim.m_queue.pop_front();
+            }
+            break;
+        }
+        if(stolen.empty()) {
+            return false;
+        }
+
+        auto& w = *m_workers[idx];
+        w.m_steals.fetch_add(1, std::memory_order_relaxed);
+        w.m_stolen.fetch_add(stolen.size(), std::memory_order_relaxed);
+        t = std::move(stolen.front());
+        if(stolen.size() > 1) {
+            std::unique_lock l(w.m_mut);
+            for(auto it = std::next(stolen.begin()); it != stolen.end();
+                it++) {
+                w.m_queue.emplace_back(std::move(*it));
+            }
+        }
+        return true;
+    }
+
+    void thread_pool::wait_for_tasks() {
+        std::unique_lock l(m_sleep_mut);
+        m_sleeping.fetch_add(1);
+        m_sleep_cv.wait(l, [&]() {
+            return !m_running || m_queued.load() > 0;
+        });
+        m_sleeping.fetch_sub(1);
     }
 }
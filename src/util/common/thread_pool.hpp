@@ -6,16 +6,180 @@
 #ifndef OPENCBDC_TX_SRC_COMMON_THREAD_POOL_H_
 #define OPENCBDC_TX_SRC_COMMON_THREAD_POOL_H_
 
-#include "blocking_queue.hpp"
-
+#include <array>
 #include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace cbdc {
+    /// \brief Fixed-size work-stealing thread pool.
+    ///
+    /// Each worker thread owns a queue of tasks. Tasks pushed from a worker
+    /// go to that worker's queue, and tasks pushed from any other thread are
+    /// spread across the workers round-robin. Workers run the tasks in their
+    /// own queue oldest first. A worker whose queue is empty steals half of
+    /// another worker's queued tasks in one go, so a long-running task only
+    /// delays the tasks behind it until an idle worker takes them. Workers
+    /// with nothing to run or steal sleep until more tasks are pushed.
+    ///
+    /// Tasks are stored in a move-only wrapper with inline storage for small
+    /// callables, so pushing a typical lambda does not allocate beyond the
+    /// queue itself. Queued tasks which have not started when the pool is
+    /// destroyed are discarded.
     class thread_pool {
       public:
-        thread_pool() = default;
+        /// Move-only callable with inline storage for small callables.
+        /// Callables which do not fit inline are stored on the heap.
+        class task {
+          public:
+            /// Size of the inline storage in bytes.
+            static constexpr size_t m_inline_size{64};
+
+            task() = default;
+
+            /// Constructor.
+            /// \param fn callable to wrap.
+            template<typename F,
+                     typename = std::enable_if_t<
+                         !std::is_same_v<std::decay_t<F>, task>>>
+            // NOLINTNEXTLINE(bugprone-forwarding-reference-overload)
+            explicit task(F&& fn) {
+                using fn_type = std::decay_t<F>;
+                if constexpr(fits_inline<fn_type>()) {
+                    new(m_buf.data()) fn_type(std::forward<F>(fn));
+                    m_ops = &inline_ops<fn_type>;
+                } else {
+                    auto* ptr = new fn_type(std::forward<F>(fn));
+                    new(m_buf.data()) fn_type*(ptr);
+                    m_ops = &heap_ops<fn_type>;
+                }
+            }
+
+            ~task() {
+                reset();
+            }
+
+            task(const task&) = delete;
+            auto operator=(const task&) -> task& = delete;
+
+            task(task&& other) noexcept {
+                take(other);
+            }
+
+            auto operator=(task&& other) noexcept -> task& {
+                if(this != &other) {
+                    reset();
+                    take(other);
+                }
+                return *this;
+            }
+
+            /// Calls the wrapped callable.
+            void operator()() {
+                m_ops->m_invoke(m_buf.data());
+            }
+
+            /// Returns true if the task wraps a callable.
+            explicit operator bool() const {
+                return m_ops != nullptr;
+            }
+
+          private:
+            struct ops_type {
+                void (*m_invoke)(void*);
+                void (*m_move)(void*, void*);
+                void (*m_destroy)(void*);
+            };
+
+            template<typename T>
+            static constexpr auto fits_inline() -> bool {
+                return sizeof(T) <= m_inline_size
+                    && alignof(T) <= alignof(std::max_align_t)
+                    && std::is_nothrow_move_constructible_v<T>;
+            }
+
+            template<typename T>
+            static auto get(void* buf) -> T* {
+                return std::launder(static_cast<T*>(buf));
+            }
+
+            template<typename T>
+            static constexpr ops_type inline_ops{
+                [](void* buf) {
+                    (*get<T>(buf))();
+                },
+                [](void* dst, void* src) {
+                    new(dst) T(std::move(*get<T>(src)));
+                    get<T>(src)->~T();
+                },
+                [](void* buf) {
+                    get<T>(buf)->~T();
+                }};
+
+            template<typename T>
+            static constexpr ops_type heap_ops{
+                [](void* buf) {
+                    (**get<T*>(buf))();
+                },
+                [](void* dst, void* src) {
+                    new(dst) T*(*get<T*>(src));
+                },
+                [](void* buf) {
+                    delete *get<T*>(buf);
+                }};
+
+            alignas(std::max_align_t) std::array<std::byte, m_inline_size>
+                m_buf{};
+            const ops_type* m_ops{nullptr};
+
+            void reset() {
+                if(m_ops != nullptr) {
+                    m_ops->m_destroy(m_buf.data());
+                    m_ops = nullptr;
+                }
+            }
+
+            void take(task& other) {
+                if(other.m_ops != nullptr) {
+                    other.m_ops->m_move(m_buf.data(), other.m_buf.data());
+                    m_ops = std::exchange(other.m_ops, nullptr);
+                }
+            }
+        };
+
+        /// Snapshot of the pool's counters.
+        struct metrics {
+            /// Number of worker threads.
+            size_t m_threads{};
+            /// Number of tasks queued and not yet started.
+            size_t m_queued{};
+            /// Number of tasks queued on each worker.
+            std::vector<size_t> m_queue_lengths;
+            /// Number of tasks started since the pool was created.
+            uint64_t m_executed{};
+            /// Number of successful steals since the pool was created.
+            uint64_t m_steals{};
+            /// Number of tasks moved between workers by steals.
+            uint64_t m_stolen{};
+        };
+
+        /// Constructor. Starts the worker threads.
+        /// \param n_threads number of worker threads. Zero uses one thread
+        ///                  per hardware thread.
+        explicit thread_pool(size_t n_threads = 0);
+
+        /// Destructor. Discards queued tasks, waits for running tasks to
+        /// return and joins the worker threads.
         ~thread_pool();
 
         thread_pool(const thread_pool&) = delete;
@@ -23,19 +187,54 @@ namespace cbdc {
         thread_pool(thread_pool&&) = delete;
         auto operator=(thread_pool&&) -> thread_pool& = delete;
 
-        void push(const std::function<void()>& fn);
+        /// Queues a callable to run on one of the worker threads.
+        /// \param fn callable to run.
+        template<typename F>
+        void push(F&& fn) {
+            enqueue(task(std::forward<F>(fn)));
+        }
+
+        /// Queues a batch of tasks on a single worker with one queue
+        /// operation. Idle workers steal from the batch, so the tasks still
+        /// run in parallel.
+        /// \param tasks tasks to run.
+        void push_batch(std::vector<task> tasks);
+
+        /// Returns the number of worker threads.
+        /// \return number of worker threads.
+        [[nodiscard]] auto size() const -> size_t;
+
+        /// Returns a snapshot of the pool's counters.
+        /// \return pool metrics.
+        [[nodiscard]] auto get_metrics() const -> metrics;
 
       private:
-        struct thread_type {
+        struct worker_type {
+            mutable std::mutex m_mut;
+            std::deque<task> m_queue;
+            std::atomic<uint64_t> m_executed{};
+            std::atomic<uint64_t> m_steals{};
+            std::atomic<uint64_t> m_stolen{};
             std::thread m_thread;
-            std::atomic_bool m_running{false};
-            blocking_queue<std::function<void()>> m_queue;
         };
 
-        std::mutex m_mut;
-        std::vector<std::shared_ptr<thread_type>> m_threads;
+        std::vector<std::unique_ptr<worker_type>> m_workers;
+        std::atomic<size_t> m_next_worker{};
+        std::atomic<size_t> m_queued{};
+
+        std::mutex m_sleep_mut;
+        std::condition_variable m_sleep_cv;
+        std::atomic<size_t> m_sleeping{};
+        std::atomic_bool m_running{true};
+
+        void enqueue(task t);
+        auto target_worker() -> size_t;
+        void notify(size_t n);
 
-        static void thread_loop(const std::shared_ptr<thread_type>& thr);
+        void thread_loop(size_t idx);
+        auto pop_local(size_t idx, task& t) -> bool;
+        auto steal(size_t idx, task& t) -> bool;
+        void wait_for_tasks();
     };
 }
 
@@ -46,6 +46,17 @@ namespace cbdc::network {
         }
     }
 
+    void connection_manager::broadcast(
+        const std::shared_ptr<buffer>& data,
+        const std::unordered_set<peer_id_t>& exclude) {
+        std::shared_lock<std::shared_mutex> l(m_peer_mutex);
+        for(const auto& peer : m_peers) {
+            if(exclude.find(peer.m_peer_id) == exclude.end()) {
+                peer.m_peer->send(data);
+            }
+        }
+    }
+
     auto connection_manager::handle_messages() -> std::vector<message_t> {
         std::vector<message_t> pkts;
 
@@ -99,9 +110,17 @@ namespace cbdc::network {
 
         {
             std::unique_lock<std::shared_mutex> l(m_peer_mutex);
+            auto disconnect_cb = peer::disconnect_callback_type();
+            if(m_disconnect_handler) {
+                disconnect_cb = [handler = m_disconnect_handler, peer_id]() {
+                    handler(peer_id);
+                };
+            }
             auto p = std::make_unique<peer>(std::move(sock),
                                             recv_cb,
-                                            attempt_reconnect);
+                                            attempt_reconnect,
+                                            m_handshake,
+                                            std::move(disconnect_cb));
             if(m_running) {
                 m_peers.emplace_back(std::move(p), peer_id);
             }
@@ -110,6 +129,17 @@ namespace cbdc::network {
         return peer_id;
     }
 
+    void connection_manager::set_handshake(std::shared_ptr<buffer> data) {
+        std::unique_lock<std::shared_mutex> l(m_peer_mutex);
+        m_handshake = std::move(data);
+    }
+
+    void connection_manager::set_disconnect_handler(
+        std::function<void(peer_id_t)> handler) {
+        std::unique_lock<std::shared_mutex> l(m_peer_mutex);
+        m_disconnect_handler = std::move(handler);
+    }
+
     auto connection_manager::cluster_connect(
         const std::vector<endpoint_t>& endpoints,
         bool error_fatal) -> bool {
@@ -198,8 +228,8 @@ namespace cbdc::network {
         m_async_recv_cv.notify_all();
     }
 
-    void connection_manager::send(const std::shared_ptr<buffer>& data,
-                                  peer_id_t peer_id) {
+    auto connection_manager::send(const std::shared_ptr<buffer>& data,
+                                  peer_id_t peer_id) -> bool {
         std::shared_ptr<peer> peer;
         {
             std::shared_lock<std::shared_mutex> l(m_peer_mutex);
@@ -211,9 +241,10 @@ namespace cbdc::network {
             }
         }
 
-        if(peer) {
-            peer->send(data);
+        if(!peer) {
+            return false;
         }
+        return peer->send(data);
     }
 
     auto connection_manager::peer_count() -> size_t {
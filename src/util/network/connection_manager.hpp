@@ -21,6 +21,7 @@
 #include <shared_mutex>
 #include <sys/socket.h>
 #include <thread>
+#include <unordered_set>
 
 namespace cbdc::network {
     /// Peer IDs within a \ref connection_manager.
@@ -80,6 +81,13 @@ namespace cbdc::network {
         /// \see connection_manager::add
         void broadcast(const std::shared_ptr<buffer>& data);
 
+        /// Sends the provided data to all added peers except those in the
+        /// given set.
+        /// \param data packet to send.
+        /// \param exclude IDs of peers to skip.
+        void broadcast(const std::shared_ptr<buffer>& data,
+                       const std::unordered_set<peer_id_t>& exclude);
+
         /// Serialize the data and broadcast it to all peers. Wraps
         /// connection_manager::broadcast.
         /// \param data data to serialize and send.
@@ -103,6 +111,19 @@ namespace cbdc::network {
         auto add(std::unique_ptr<tcp_socket> sock,
                  bool attempt_reconnect = true) -> peer_id_t;
 
+        /// Sets a packet to send to each peer added afterwards, before any
+        /// other packet, each time its connection is established. Lets
+        /// clients register per-connection state with a server, such as a
+        /// subscription, which survives reconnecting.
+        /// \param data packet to send.
+        void set_handshake(std::shared_ptr<buffer> data);
+
+        /// Sets a function to call with a peer's ID each time a peer added
+        /// afterwards loses its connection. Packets sent to the peer before
+        /// the call may not have been delivered.
+        /// \param handler function to call on disconnection.
+        void set_disconnect_handler(std::function<void(peer_id_t)> handler);
+
         /// Establishes connections to the provided list of endpoints.
         /// \param endpoints set of server endpoints to which to establish TCP socket connections.
         /// \param error_fatal true if this function should abort and return false after a single failed connection attempt.
@@ -152,14 +173,17 @@ namespace cbdc::network {
         /// Sends the provided data to the specified peer. Conducts an O(n)
         /// search for the target peer. \param data data packet to send.
         /// \param peer_id ID of the peer to whom to send data.
-        void send(const std::shared_ptr<buffer>& data, peer_id_t peer_id);
+        /// \return true if the packet was queued for a connected peer.
+        auto send(const std::shared_ptr<buffer>& data, peer_id_t peer_id)
+            -> bool;
 
         /// Serialize the data and transmit it in a packet to the remote host
         /// at the specified peer ID.
         /// \param data data to serialize and send.
         /// \param peer_id ID of the peer to whom to send data.
+        /// \return true if the packet was queued for a connected peer.
         template<typename Ta>
-        void send(const Ta& data, peer_id_t peer_id) {
+        auto send(const Ta& data, peer_id_t peer_id) -> bool {
             auto pkt = make_shared_buffer(data);
             return send(pkt, peer_id);
         }
@@ -224,6 +248,9 @@ namespace cbdc::network {
 
         std::atomic_bool m_running{true};
 
+        std::shared_ptr<buffer> m_handshake;
+        std::function<void(peer_id_t)> m_disconnect_handler;
+
         std::mutex m_async_recv_mut;
         std::condition_variable m_async_recv_cv;
         std::vector<std::queue<message_t>> m_async_recv_queues;
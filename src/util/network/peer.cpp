@@ -11,10 +11,17 @@
 namespace cbdc::network {
     peer::peer(std::unique_ptr<tcp_socket> sock,
                peer::callback_type cb,
-               bool attempt_reconnect)
+               bool attempt_reconnect,
+               std::shared_ptr<cbdc::buffer> handshake,
+               peer::disconnect_callback_type disconnect_cb)
         : m_sock(std::move(sock)),
           m_attempt_reconnect(attempt_reconnect),
-          m_recv_cb(std::move(cb)) {
+          m_handshake(std::move(handshake)),
+          m_recv_cb(std::move(cb)),
+          m_disconnect_cb(std::move(disconnect_cb)) {
+        if(m_handshake) {
+            m_send_queue.push(m_handshake);
+        }
         do_send();
         do_recv();
         do_reconnect();
@@ -24,10 +31,15 @@ namespace cbdc::network {
         shutdown();
     }
 
-    void peer::send(const std::shared_ptr<cbdc::buffer>& data) {
-        if(!m_shut_down) {
-            m_send_queue.push(data);
+    auto peer::send(const std::shared_ptr<cbdc::buffer>& data) -> bool {
+        if(m_shut_down) {
+            return false;
         }
+        m_send_queue.push(data);
+        // close() clears m_running before dropping the queue, so a packet
+        // queued while it was still set is covered by the disconnection
+        // callback
+        return connected();
     }
 
     void peer::shutdown() {
@@ -45,19 +57,19 @@ namespace cbdc::network {
 
     void peer::do_send() {
         m_send_thread = std::thread([&]() {
+            // Packets queued while the previous write was in progress go out
+            // together in one system call
+            auto pkts = std::vector<std::shared_ptr<cbdc::buffer>>();
             while(m_running) {
-                std::shared_ptr<cbdc::buffer> pkt;
-                if(!m_send_queue.pop(pkt)) {
+                pkts.clear();
+                if(m_send_queue.pop(pkts, m_max_send_batch) == 0) {
                     assert(!m_running);
                     break;
                 }
 
-                if(pkt) {
-                    const auto result = m_sock->send(*pkt);
-                    if(!result) {
-                        signal_reconnect();
-                        return;
-                    }
+                if(!m_sock->send(pkts)) {
+                    signal_reconnect();
+                    return;
                 }
             }
         });
@@ -92,6 +104,9 @@ namespace cbdc::network {
                 }
                 if(m_attempt_reconnect) {
                     close();
+                    if(m_disconnect_cb) {
+                        m_disconnect_cb();
+                    }
                     while(!m_shut_down && !m_sock->reconnect()) {
                         static constexpr auto retry_delay
                             = std::chrono::seconds(3);
@@ -102,6 +117,9 @@ namespace cbdc::network {
                     }
                     if(!m_shut_down) {
                         m_running = true;
+                        if(m_handshake) {
+                            m_send_queue.push(m_handshake);
+                        }
                         do_send();
                         do_recv();
                     }
@@ -109,6 +127,9 @@ namespace cbdc::network {
                     m_shut_down = true;
                     close();
                     m_send_queue.clear();
+                    if(m_disconnect_cb) {
+                        m_disconnect_cb();
+                    }
                     return;
                 }
             }
@@ -25,6 +25,9 @@ namespace cbdc::network {
         using callback_type
             = std::function<void(std::shared_ptr<cbdc::buffer>)>;
 
+        /// Type for the disconnection callback function.
+        using disconnect_callback_type = std::function<void()>;
+
         /// \brief Constructor. Starts socket management threads.
         ///
         /// Starts a thread to send queued packets via the
@@ -35,9 +38,17 @@ namespace cbdc::network {
         /// \param cb callback function to call with packets received by the socket.
         /// \param attempt_reconnect true if the instance should reconnect the TCP
         ///                          socket if it loses the connection.
+        /// \param handshake packet to send before any other packet each time
+        ///                  the socket connects, or nullptr to send nothing.
+        /// \param disconnect_cb function to call each time the socket loses
+        ///                      its connection, after any packets queued to
+        ///                      send have been dropped. Not called by
+        ///                      \ref shutdown(). May be nullptr.
         peer(std::unique_ptr<tcp_socket> sock,
              callback_type cb,
-             bool attempt_reconnect);
+             bool attempt_reconnect,
+             std::shared_ptr<cbdc::buffer> handshake = nullptr,
+             disconnect_callback_type disconnect_cb = nullptr);
 
         /// Destructor. Calls \ref shutdown().
         ~peer();
@@ -53,7 +64,10 @@ namespace cbdc::network {
         /// Queues a packet to send via the TCP socket. The recipient peer
         /// receives it as a discrete unit.
         /// \param data buffer to send.
-        void send(const std::shared_ptr<cbdc::buffer>& data);
+        /// \return true if the packet was queued while the socket was
+        ///         connected. If the connection is lost later, the
+        ///         disconnection callback is called.
+        auto send(const std::shared_ptr<cbdc::buffer>& data) -> bool;
 
         /// Clears any packets in the pending send queue. Stops the send,
         /// receive, and reconnect threads. Disconnects the TCP socket.
@@ -67,6 +81,7 @@ namespace cbdc::network {
         std::unique_ptr<tcp_socket> m_sock;
 
         blocking_queue<std::shared_ptr<cbdc::buffer>> m_send_queue;
+        static constexpr size_t m_max_send_batch{256};
 
         std::thread m_recv_thread;
         std::thread m_send_thread;
@@ -76,11 +91,13 @@ namespace cbdc::network {
         std::condition_variable m_reconnect_cv;
         bool m_reconnect{false};
         bool m_attempt_reconnect{};
+        std::shared_ptr<cbdc::buffer> m_handshake;
 
         std::atomic_bool m_running{true};
         std::atomic_bool m_shut_down{false};
 
         callback_type m_recv_cb;
+        disconnect_callback_type m_disconnect_cb;
 
         void do_send();
 
@@ -5,8 +5,12 @@
 
 #include "tcp_socket.hpp"
 
+#include <algorithm>
 #include <array>
+#include <climits>
 #include <cstring>
+#include <iterator>
+#include <sys/uio.h>
 #include <unistd.h>
 
 namespace cbdc::network {
@@ -87,6 +91,60 @@ namespace cbdc::network {
         return true;
     }
 
+    auto tcp_socket::send(const std::vector<std::shared_ptr<buffer>>& pkts)
+        const -> bool {
+        // Length prefixes for each packet, written natively as in the
+        // single-packet send()
+        auto sizes = std::vector<uint64_t>();
+        sizes.reserve(pkts.size());
+        for(const auto& pkt : pkts) {
+            if(pkt) {
+                sizes.push_back(static_cast<uint64_t>(pkt->size()));
+            }
+        }
+
+        auto iov = std::vector<iovec>();
+        iov.reserve(sizes.size() * 2);
+        size_t i{0};
+        for(const auto& pkt : pkts) {
+            if(!pkt) {
+                continue;
+            }
+            iov.push_back({&sizes[i], sizeof(uint64_t)});
+            iov.push_back({pkt->data(), pkt->size()});
+            i++;
+        }
+
+        size_t first{0};
+        while(first < iov.size()) {
+            auto count = std::min(iov.size() - first,
+                                  static_cast<size_t>(IOV_MAX));
+            auto n = writev(m_sock_fd, &iov[first], static_cast<int>(count));
+            if(n <= 0) {
+                return false;
+            }
+            // Skip the fully written buffers and advance into a partially
+            // written one
+            auto written = static_cast<size_t>(n);
+            while(written > 0) {
+                auto& v = iov[first];
+                if(written < v.iov_len) {
+                    v.iov_base = std::next(static_cast<std::byte*>(v.iov_base),
+                                           static_cast<ptrdiff_t>(written));
+                    v.iov_len -= written;
+                    break;
+                }
+                written -= v.iov_len;
+                first++;
+            }
+            while(first < iov.size() && iov[first].iov_len == 0) {
+                first++;
+            }
+        }
+
+        return true;
+    }
+
     auto tcp_socket::receive(buffer& pkt) const -> bool {
         uint64_t pkt_sz{};
         std::array<std::byte, sizeof(pkt_sz)> sz_buf{};
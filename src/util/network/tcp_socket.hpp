@@ -12,6 +12,8 @@
 #include "util/serialization/util.hpp"
 
 #include <atomic>
+#include <memory>
+#include <vector>
 
 namespace cbdc::network {
     /// \brief Wrapper for a TCP socket.
@@ -51,6 +53,14 @@ namespace cbdc::network {
         /// \return true if the packet was sent successfully.
         [[nodiscard]] auto send(const buffer& pkt) const -> bool;
 
+        /// Sends the given packets to the remote host with as few system
+        /// calls as possible. The remote host receives each packet as if it
+        /// had been sent with send(const buffer&). Null packets are skipped.
+        /// \param pkts the packets to send, in order.
+        /// \return true if every packet was sent successfully.
+        [[nodiscard]] auto
+        send(const std::vector<std::shared_ptr<buffer>>& pkts) const -> bool;
+
         /// Serialize the data and transmit it in a packet to the remote host.
         /// \param data data to serialize and send.
         /// \return true if the packet was sent successfully.
@@ -115,6 +115,14 @@ namespace cbdc::raft {
         return m_sm->last_commit_index();
     }
 
+    auto node::committed_log_idx() const -> uint64_t {
+        return m_raft_instance->get_committed_log_idx();
+    }
+
+    auto node::has_leader() const -> bool {
+        return m_raft_instance->get_leader() >= 0;
+    }
+
     auto node::get_sm() const -> nuraft::state_machine* {
         return m_sm.get();
     }
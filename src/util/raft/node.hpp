@@ -96,6 +96,17 @@ namespace cbdc::raft {
         /// \return log index.
         [[nodiscard]] auto last_log_idx() const -> uint64_t;
 
+        /// Returns the highest log index this node knows to be committed in
+        /// the cluster. Followers learn of commits from the leader so may
+        /// not have applied entries up to this index yet.
+        /// \return log index.
+        [[nodiscard]] auto committed_log_idx() const -> uint64_t;
+
+        /// Indicates whether this node currently knows of a raft leader,
+        /// which may be this node.
+        /// \return true if the cluster has a leader.
+        [[nodiscard]] auto has_leader() const -> bool;
+
         /// Returns a pointer to the state machine replicated by this raft
         /// node.
         /// \return pointer to the state machine.
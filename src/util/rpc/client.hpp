@@ -8,6 +8,7 @@
 
 #include "format.hpp"
 #include "messages.hpp"
+#include "util/serialization/format.hpp"
 #include "util/serialization/util.hpp"
 
 #include <atomic>
@@ -69,22 +70,48 @@ namespace cbdc::rpc {
         /// with call_raw(). Thread safe.
         /// \param request_payload payload for the RPC.
         /// \param response_callback function for the request handler to call
-        ///                          when the response is available.
+        ///                          when the response is available, or with
+        ///                          std::nullopt if the request failed after
+        ///                          it was sent.
         /// \return true if the request was sent successfully.
         auto call(Request request_payload,
                   response_callback_type response_callback) -> bool {
             auto [request_buf, request_id]
                 = make_request(std::move(request_payload));
-            auto ret = call_raw(std::move(request_buf),
-                                request_id,
-                                [resp_cb = std::move(response_callback)](
-                                    std::optional<response_type> resp) {
-                                    if(!resp.has_value()) {
-                                        return;
-                                    }
-                                    resp_cb(std::move(resp.value().m_payload));
-                                });
-            return ret;
+            return send(std::move(request_buf),
+                        request_id,
+                        std::move(response_callback));
+        }
+
+        /// Issues an asynchronous request for the given alternative of
+        /// Request, serializing the payload straight from a reference rather
+        /// than moving it into a Request. Lets callers which keep their
+        /// payload, such as a load generator reusing one transaction, send
+        /// it without making a copy. Thread safe.
+        /// \tparam Alternative Request alternative to send the payload as.
+        ///                     Must serialize to the same bytes as Payload.
+        /// \param payload payload for the RPC.
+        /// \param response_callback function for the request handler to call
+        ///                          when the response is available, or with
+        ///                          std::nullopt if the request failed after
+        ///                          it was sent.
+        /// \return true if the request was sent successfully.
+        template<typename Alternative, typename Payload>
+        auto call_as(const Payload& payload,
+                     response_callback_type response_callback) -> bool {
+            // Variant index a Request holding Alternative serializes with
+            static const auto index = static_cast<uint8_t>(
+                Request(std::in_place_type<Alternative>).index());
+            auto request_id = m_current_request_id++;
+            auto hdr = header{request_id};
+            auto request_buf = cbdc::buffer();
+            request_buf.extend(serialized_size(hdr) + serialized_size(index)
+                               + serialized_size(payload));
+            auto ser = cbdc::buffer_serializer(request_buf);
+            ser << hdr << index << payload;
+            return send(std::move(request_buf),
+                        request_id,
+                        std::move(response_callback));
         }
 
       protected:
@@ -122,6 +149,21 @@ namespace cbdc::rpc {
                               raw_callback_type response_callback) -> bool
             = 0;
 
+        auto send(cbdc::buffer request_buf,
+                  request_id_type request_id,
+                  response_callback_type response_callback) -> bool {
+            return call_raw(std::move(request_buf),
+                            request_id,
+                            [resp_cb = std::move(response_callback)](
+                                std::optional<response_type> resp) {
+                                if(!resp.has_value()) {
+                                    resp_cb(std::nullopt);
+                                    return;
+                                }
+                                resp_cb(std::move(resp.value().m_payload));
+                            });
+        }
+
         auto make_request(Request request_payload)
             -> std::pair<cbdc::buffer, request_id_type> {
             auto request_id = m_current_request_id++;
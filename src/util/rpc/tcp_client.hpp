@@ -10,12 +10,19 @@
 #include "util/common/variant_overloaded.hpp"
 #include "util/network/connection_manager.hpp"
 
+#include <condition_variable>
 #include <future>
+#include <limits>
 #include <unordered_map>
 
 namespace cbdc::rpc {
     /// Implements an RPC client over TCP sockets. Accepts multiple server
-    /// endpoints for failover purposes.
+    /// endpoints for failover and load balancing. Each request goes to the
+    /// connected endpoint with the fewest requests awaiting a response, so
+    /// requests to a replicated service spread across all of its replicas.
+    /// Any number of requests may be in flight at once and responses
+    /// complete in whatever order the servers send them. Requests awaiting
+    /// a response from a server whose connection drops fail.
     /// \see cbdc::rpc::tcp_server
     /// \tparam Request type for requests.
     /// \tparam Response type for responses.
@@ -24,8 +31,16 @@ namespace cbdc::rpc {
       public:
         /// Constructor.
         /// \param server_endpoints RPC server endpoints to which to connect.
-        explicit tcp_client(std::vector<network::endpoint_t> server_endpoints)
-            : m_server_endpoints(std::move(server_endpoints)) {}
+        /// \param max_in_flight maximum number of requests awaiting a
+        ///                      response. Further requests block until a
+        ///                      response arrives. Zero for no limit.
+        explicit tcp_client(std::vector<network::endpoint_t> server_endpoints,
+                            size_t max_in_flight = 0)
+            : m_server_endpoints(std::move(server_endpoints)),
+              m_peer_load(m_server_endpoints.size()),
+              m_max_in_flight(max_in_flight),
+              m_pending(pending_slots(max_in_flight)),
+              m_pending_mask(m_pending.size() - 1) {}
 
         tcp_client(tcp_client&&) = delete;
         auto operator=(tcp_client&&) -> tcp_client& = delete;
@@ -43,11 +58,26 @@ namespace cbdc::rpc {
                 m_handler_thread.join();
             }
             {
-                std::unique_lock<std::mutex> l(m_responses_mut);
-                for(auto& [request_id, action] : m_responses) {
-                    set_response_value(action, std::nullopt);
+                std::unique_lock<std::mutex> l(m_window_mut);
+                m_running = false;
+            }
+            m_window_cv.notify_all();
+            for(auto& slot : m_pending) {
+                auto tag = slot.m_tag.load();
+                if(tag == m_free_tag || tag == m_busy_tag) {
+                    continue;
+                }
+                auto action = take(tag - 1);
+                if(action.has_value()) {
+                    cancel(action.value());
+                }
+            }
+            {
+                std::unique_lock<std::mutex> l(m_overflow_mut);
+                for(auto& [request_id, entry] : m_overflow) {
+                    cancel(entry.m_action);
                 }
-                m_responses.clear();
+                m_overflow.clear();
             }
         }
 
@@ -73,6 +103,9 @@ namespace cbdc::rpc {
             if(!error_fatal) {
                 error_fatal = m_server_endpoints.size() <= 1;
             }
+            m_net.set_disconnect_handler([&](network::peer_id_t peer) {
+                fail_peer(peer);
+            });
             if(!m_net.cluster_connect(m_server_endpoints,
                                       error_fatal.value())) {
                 return false;
@@ -96,21 +129,240 @@ namespace cbdc::rpc {
 
         using promise_type = std::promise<std::optional<response_type>>;
         using response_action_type
-            = std::variant<promise_type, raw_callback_type>;
+            = std::variant<std::monostate, promise_type, raw_callback_type>;
+        using deadline_type
+            = std::optional<std::chrono::steady_clock::time_point>;
+
+        /// Request awaiting a response.
+        struct pending_entry {
+            /// Promise or callback to complete with the response.
+            response_action_type m_action;
+            /// Peer to which the request was sent.
+            network::peer_id_t m_peer{};
+        };
 
-        std::mutex m_responses_mut;
-        std::unordered_map<request_id_type, response_action_type> m_responses;
+        /// Slot in the pending request table. The tag is m_free_tag when
+        /// the slot is empty, m_busy_tag while a thread owns the entry, and
+        /// otherwise one more than the ID of the request in the entry.
+        struct pending_slot {
+            std::atomic<uint64_t> m_tag{m_free_tag};
+            /// Copy of the entry's peer which may be read without owning
+            /// the slot, once the tag names the request.
+            std::atomic<network::peer_id_t> m_peer{};
+            pending_entry m_entry;
+        };
+
+        static constexpr uint64_t m_free_tag{0};
+        static constexpr uint64_t m_busy_tag{
+            std::numeric_limits<uint64_t>::max()};
+        static constexpr size_t m_default_pending_slots{256};
+
+        /// Outstanding requests for each peer. cluster_connect() adds one
+        /// peer per endpoint in order, so peer IDs index this vector.
+        std::vector<std::atomic<size_t>> m_peer_load;
+        std::atomic<size_t> m_next_peer{};
+
+        size_t m_max_in_flight;
+        std::atomic<size_t> m_in_flight{};
+        std::atomic<size_t> m_window_waiters{};
+        std::mutex m_window_mut;
+        std::condition_variable m_window_cv;
+        bool m_running{true};
+
+        // Pending requests live in the slot indexed by their request ID, so
+        // registering and completing a request takes no lock. A request
+        // whose slot still holds an older request goes to the overflow map.
+        std::vector<pending_slot> m_pending;
+        size_t m_pending_mask;
+        std::mutex m_overflow_mut;
+        std::unordered_map<request_id_type, pending_entry> m_overflow;
+
+        static auto pending_slots(size_t max_in_flight) -> size_t {
+            auto n = m_default_pending_slots;
+            while(n < max_in_flight * 2) {
+                n *= 2;
+            }
+            return n;
+        }
 
         auto send_request(cbdc::buffer request_buf,
                           request_id_type request_id,
-                          response_action_type response_action) -> bool {
-            {
-                std::unique_lock<std::mutex> l(m_responses_mut);
-                assert(m_responses.find(request_id) == m_responses.end());
-                m_responses[request_id] = std::move(response_action);
+                          response_action_type response_action,
+                          deadline_type deadline) -> bool {
+            if(!acquire_window(deadline)) {
+                return false;
+            }
+            auto peer = pick_peer();
+            if(!peer.has_value()) {
+                release_window();
+                return false;
             }
+            m_peer_load[peer.value()]++;
+            insert(request_id, {std::move(response_action), peer.value()});
             auto pkt = std::make_shared<buffer>(std::move(request_buf));
-            return m_net.send_to_one(pkt);
+            if(!m_net.send(pkt, peer.value())) {
+                // The peer disconnected. If fail_peer() has not already
+                // completed the request, hand the failure to the caller.
+                if(take(request_id).has_value()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// Returns the connected peer with the fewest outstanding requests.
+        /// Ties go to the first such peer after a rotating offset so equally
+        /// loaded peers take turns.
+        auto pick_peer() -> std::optional<network::peer_id_t> {
+            auto n = m_peer_load.size();
+            auto offset = m_next_peer.fetch_add(1, std::memory_order_relaxed);
+            auto best = std::optional<network::peer_id_t>();
+            size_t best_load{};
+            for(size_t i = 0; i < n; i++) {
+                auto peer = (offset + i) % n;
+                if(!m_net.connected(peer)) {
+                    continue;
+                }
+                auto load = m_peer_load[peer].load(std::memory_order_relaxed);
+                if(!best.has_value() || load < best_load) {
+                    best = peer;
+                    best_load = load;
+                }
+            }
+            return best;
+        }
+
+        auto try_acquire_window() -> bool {
+            auto cur = m_in_flight.load();
+            while(cur < m_max_in_flight) {
+                if(m_in_flight.compare_exchange_weak(cur, cur + 1)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        auto acquire_window(deadline_type deadline) -> bool {
+            if(m_max_in_flight == 0 || try_acquire_window()) {
+                return true;
+            }
+            if(std::this_thread::get_id() == m_handler_thread.get_id()) {
+                // Requests issued from response callbacks are admitted
+                // regardless, as blocking the handler thread would stop the
+                // responses which free the window
+                m_in_flight++;
+                return true;
+            }
+            std::unique_lock<std::mutex> l(m_window_mut);
+            m_window_waiters++;
+            auto acquired = false;
+            auto pred = [&]() {
+                acquired = try_acquire_window();
+                return acquired || !m_running;
+            };
+            if(deadline.has_value()) {
+                m_window_cv.wait_until(l, deadline.value(), pred);
+            } else {
+                m_window_cv.wait(l, pred);
+            }
+            m_window_waiters--;
+            return acquired;
+        }
+
+        void release_window() {
+            if(m_max_in_flight == 0) {
+                return;
+            }
+            m_in_flight--;
+            // Waiters register before re-checking the window under the
+            // mutex, so one which missed this release is already waiting
+            if(m_window_waiters.load() > 0) {
+                {
+                    std::unique_lock<std::mutex> l(m_window_mut);
+                }
+                m_window_cv.notify_one();
+            }
+        }
+
+        void insert(request_id_type request_id, pending_entry entry) {
+            auto& slot = m_pending[request_id & m_pending_mask];
+            auto expected = m_free_tag;
+            if(slot.m_tag.compare_exchange_strong(expected,
+                                                  m_busy_tag,
+                                                  std::memory_order_acquire)) {
+                slot.m_peer.store(entry.m_peer, std::memory_order_relaxed);
+                slot.m_entry = std::move(entry);
+                // Sequentially consistent so that either fail_peer() sees
+                // the request or send_request() sees the peer disconnected
+                slot.m_tag.store(request_id + 1);
+                return;
+            }
+            std::unique_lock<std::mutex> l(m_overflow_mut);
+            assert(m_overflow.find(request_id) == m_overflow.end());
+            m_overflow.emplace(request_id, std::move(entry));
+        }
+
+        /// Removes the given request from the pending table and releases
+        /// its share of the window and peer load.
+        /// \return the request's promise or callback, or std::nullopt if
+        ///         the request was not pending.
+        auto take(request_id_type request_id)
+            -> std::optional<response_action_type> {
+            auto entry = [&]() -> std::optional<pending_entry> {
+                auto& slot = m_pending[request_id & m_pending_mask];
+                auto expected = request_id + 1;
+                if(slot.m_tag.compare_exchange_strong(
+                       expected,
+                       m_busy_tag,
+                       std::memory_order_acquire)) {
+                    auto ret = std::move(slot.m_entry);
+                    slot.m_entry.m_action = std::monostate();
+                    slot.m_tag.store(m_free_tag, std::memory_order_release);
+                    return ret;
+                }
+                std::unique_lock<std::mutex> l(m_overflow_mut);
+                auto node = m_overflow.extract(request_id);
+                if(node.empty()) {
+                    return std::nullopt;
+                }
+                return std::move(node.mapped());
+            }();
+            if(!entry.has_value()) {
+                return std::nullopt;
+            }
+            m_peer_load[entry->m_peer]--;
+            release_window();
+            return std::move(entry->m_action);
+        }
+
+        /// Fails every request awaiting a response from the given peer, as
+        /// requests and responses in flight are lost with the connection.
+        /// Called after the peer's queued packets have been dropped.
+        void fail_peer(network::peer_id_t peer) {
+            auto ids = std::vector<request_id_type>();
+            for(auto& slot : m_pending) {
+                auto tag = slot.m_tag.load();
+                if(tag == m_free_tag || tag == m_busy_tag) {
+                    continue;
+                }
+                if(slot.m_peer.load(std::memory_order_relaxed) == peer) {
+                    ids.push_back(tag - 1);
+                }
+            }
+            {
+                std::unique_lock<std::mutex> l(m_overflow_mut);
+                for(auto& [request_id, entry] : m_overflow) {
+                    if(entry.m_peer == peer) {
+                        ids.push_back(request_id);
+                    }
+                }
+            }
+            for(auto request_id : ids) {
+                auto action = take(request_id);
+                if(action.has_value()) {
+                    set_response_value(action.value(), std::nullopt);
+                }
+            }
         }
 
         void set_response_value(response_action_type& response_action,
@@ -120,28 +372,42 @@ namespace cbdc::rpc {
                                   },
                                   [&](raw_callback_type& cb) {
                                       cb(std::move(value));
-                                  }},
+                                  },
+                                  [](std::monostate& /* empty */) {}},
                        response_action);
         }
 
+        /// Fails a blocked call during destruction. Callbacks are dropped
+        /// instead, as the objects they refer to may already be destroyed.
+        void cancel(response_action_type& response_action) {
+            if(std::holds_alternative<promise_type>(response_action)) {
+                set_response_value(response_action, std::nullopt);
+            }
+        }
+
         auto call_raw(cbdc::buffer request_buf,
                       request_id_type request_id,
                       std::chrono::milliseconds timeout)
             -> std::optional<response_type> override {
+            auto deadline = deadline_type();
+            if(timeout != std::chrono::milliseconds::zero()) {
+                deadline = std::chrono::steady_clock::now() + timeout;
+            }
+
             auto response_promise = promise_type();
             auto response_future = response_promise.get_future();
 
             if(!send_request(std::move(request_buf),
                              request_id,
-                             std::move(response_promise))) {
-                set_response(request_id, std::nullopt);
+                             std::move(response_promise),
+                             deadline)) {
                 return std::nullopt;
             }
 
-            if(timeout != std::chrono::milliseconds::zero()) {
-                auto res = response_future.wait_for(timeout);
+            if(deadline.has_value()) {
+                auto res = response_future.wait_until(deadline.value());
                 if(res == std::future_status::timeout) {
-                    set_response(request_id, std::nullopt);
+                    take(request_id);
                     return std::nullopt;
                 }
             }
@@ -154,38 +420,22 @@ namespace cbdc::rpc {
             auto resp
                 = client<Request, Response>::deserialize_response(*msg.m_pkt);
             if(resp.has_value()) {
-                set_response(resp.value().m_header.m_request_id,
-                             std::move(resp.value()));
+                auto action = take(resp.value().m_header.m_request_id);
+                if(action.has_value()) {
+                    set_response_value(action.value(),
+                                       std::move(resp.value()));
+                }
             }
             return std::nullopt;
         }
 
-        void set_response(request_id_type request_id,
-                          std::optional<response_type> value) {
-            auto response_node = [&]() {
-                std::unique_lock<std::mutex> l(m_responses_mut);
-                return m_responses.extract(request_id);
-            }();
-
-            if(!response_node.empty()) {
-                set_response_value(response_node.mapped(), std::move(value));
-            }
-        }
-
         auto call_raw(cbdc::buffer request_buf,
                       request_id_type request_id,
                       raw_callback_type response_callback) -> bool override {
-            if(!send_request(std::move(request_buf),
-                             request_id,
-                             std::move(response_callback))) {
-                {
-                    std::unique_lock<std::mutex> l(m_responses_mut);
-                    m_responses.erase(request_id);
-                }
-                return false;
-            }
-
-            return true;
+            return send_request(std::move(request_buf),
+                                request_id,
+                                std::move(response_callback),
+                                std::nullopt);
         }
     };
 }
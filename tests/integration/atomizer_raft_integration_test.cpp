@@ -22,6 +22,7 @@ class atomizer_raft_integration_test : public ::testing::Test {
     void SetUp() override {
         cbdc::test::load_config(m_shard_cfg_path, m_opts);
         m_opts.m_attestation_threshold = 0;
+        configure();
         m_ctl = std::make_unique<cbdc::atomizer::controller>(0,
                                                              m_opts,
                                                              m_logger);
@@ -67,6 +68,9 @@ class atomizer_raft_integration_test : public ::testing::Test {
         std::filesystem::remove_all("atomizer_snps_0");
     }
 
+    /// Adjusts the atomizer options before the atomizer starts.
+    virtual void configure() {}
+
     void expect_block(const cbdc::atomizer::block& blk,
                       const std::chrono::seconds& timeout
                       = std::chrono::seconds(5)) {
@@ -157,3 +161,77 @@ TEST_F(atomizer_raft_integration_test, error_inputs_spent) {
         cbdc::test::simple_tx({'a'}, {{'B'}, {'c'}}, {{'d'}}));
     expect_block(want_block);
 }
+
+// Blocks are cut as soon as they reach the transaction target, well before
+// the maximum block interval.
+class atomizer_block_cadence_test : public atomizer_raft_integration_test {
+  protected:
+    void configure() override {
+        m_opts.m_target_block_interval = m_max_delay_ms;
+        m_opts.m_min_block_interval = m_min_delay_ms;
+        m_opts.m_block_tx_target = 2;
+    }
+
+    void send_tx(const cbdc::hash_t& id, const cbdc::hash_t& input) {
+        ASSERT_TRUE(m_conn.send(
+            cbdc::atomizer::request{cbdc::atomizer::tx_notify_request{
+                cbdc::test::simple_tx(id, {input}, {{{'z'}}}),
+                {0},
+                0}}));
+    }
+
+    auto received(uint64_t height) -> bool {
+        std::unique_lock lk{m_bm};
+        return m_received_blocks.find(height) != m_received_blocks.end();
+    }
+
+    static constexpr size_t m_max_delay_ms{60000};
+    static constexpr size_t m_min_delay_ms{100};
+};
+
+TEST_F(atomizer_block_cadence_test, full_block) {
+    send_tx({'a'}, {'b'});
+    send_tx({'c'}, {'d'});
+
+    cbdc::test::block want_block;
+    want_block.m_height = 1;
+    want_block.m_transactions.push_back(
+        cbdc::test::simple_tx({'a'}, {{'b'}}, {{'z'}}));
+    want_block.m_transactions.push_back(
+        cbdc::test::simple_tx({'c'}, {{'d'}}, {{'z'}}));
+    expect_block(want_block);
+}
+
+TEST_F(atomizer_block_cadence_test, partial_block_waits) {
+    // A block below the target waits for more transactions
+    send_tx({'a'}, {'b'});
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    ASSERT_FALSE(received(1));
+
+    send_tx({'c'}, {'d'});
+    cbdc::test::block want_block;
+    want_block.m_height = 1;
+    want_block.m_transactions.push_back(
+        cbdc::test::simple_tx({'a'}, {{'b'}}, {{'z'}}));
+    want_block.m_transactions.push_back(
+        cbdc::test::simple_tx({'c'}, {{'d'}}, {{'z'}}));
+    expect_block(want_block);
+}
+
+// The atomizer stops promptly while waiting out the minimum block interval.
+class atomizer_min_delay_test : public atomizer_raft_integration_test {
+  protected:
+    void configure() override {
+        m_opts.m_target_block_interval = m_delay_ms;
+        m_opts.m_min_block_interval = m_delay_ms;
+    }
+
+    static constexpr size_t m_delay_ms{60000};
+};
+
+TEST_F(atomizer_min_delay_test, stop) {
+    const auto start = std::chrono::steady_clock::now();
+    m_ctl.reset();
+    ASSERT_LT(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(m_delay_ms / 2));
+}
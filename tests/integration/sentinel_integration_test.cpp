@@ -55,7 +55,7 @@ TEST_F(sentinel_integration_test, valid_signed_tx) {
     auto tx = wallet.send_to(2, 2, wallet.generate_key(), true);
     ASSERT_TRUE(tx.has_value());
 
-    auto err = m_sys->expect<cbdc::transaction::compact_tx>(
+    auto err = m_sys->expect<std::vector<cbdc::transaction::compact_tx>>(
         cbdc::test::mock_system_module::shard);
 
     auto ctx = cbdc::transaction::compact_tx(tx.value());
@@ -57,7 +57,7 @@ TEST_F(shard_integration_test, error_non_existant_input) {
     auto tx = cbdc::test::simple_tx({'a'}, {{'b'}}, {{'c'}});
     cbdc::test::sign_tx(tx, m_opts.m_sentinel_private_keys[0]);
 
-    m_client.broadcast(tx);
+    m_client.broadcast(std::vector<cbdc::transaction::compact_tx>{tx});
 
     auto status = got_err.wait_for(std::chrono::seconds(1));
     ASSERT_EQ(status, std::future_status::ready);
@@ -74,7 +74,7 @@ TEST_F(shard_integration_test, error_initial_sync) {
     auto tx = cbdc::test::simple_tx({'a'}, {{'b'}}, {{'c'}});
     cbdc::test::sign_tx(tx, m_opts.m_sentinel_private_keys[0]);
 
-    m_client.broadcast(tx);
+    m_client.broadcast(std::vector<cbdc::transaction::compact_tx>{tx});
 
     auto status = got_err.wait_for(std::chrono::seconds(1));
     ASSERT_EQ(status, std::future_status::ready);
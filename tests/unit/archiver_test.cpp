@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "uhs/atomizer/archiver/controller.hpp"
+#include "uhs/atomizer/archiver/format.hpp"
 #include "uhs/atomizer/atomizer/format.hpp"
 #include "util/common/logging.hpp"
 #include "util/serialization/format.hpp"
@@ -234,7 +235,7 @@ TEST_F(ArchiverTest, server_handler) {
     m_archiver->digest_block(m_dummy_blocks[2]);
     auto pkt = std::make_shared<cbdc::buffer>();
     auto ser = cbdc::buffer_serializer(*pkt);
-    ser << static_cast<uint64_t>(1);
+    ser << cbdc::archiver::request{static_cast<uint64_t>(1)};
     auto msg = cbdc::network::message_t{pkt, 0};
     auto buf = m_archiver->server_handler(std::move(msg));
     ASSERT_TRUE(buf.has_value());
@@ -293,3 +294,98 @@ TEST_F(ArchiverTest, init) {
     ASSERT_TRUE(blk.has_value());
     ASSERT_EQ(m_archiver->best_block_height(), 1UL);
 }
+
+// Test that range reads return contiguous blocks in height order
+TEST_F(ArchiverTest, get_blocks) {
+    m_archiver->init_leveldb();
+    m_archiver->init_best_block();
+    for(const auto& blk : m_dummy_blocks) {
+        m_archiver->digest_block(blk);
+    }
+
+    auto blks = m_archiver->get_blocks({3, 4, false});
+    ASSERT_EQ(blks.size(), 4UL);
+    for(size_t i = 0; i < blks.size(); i++) {
+        ASSERT_EQ(blks[i].m_height, i + 3);
+        ASSERT_EQ(blks[i].m_transactions, m_dummy_blocks[i + 2].m_transactions);
+    }
+
+    blks = m_archiver->get_blocks({9, 5, false});
+    ASSERT_EQ(blks.size(), 2UL);
+    ASSERT_EQ(blks[1].m_height, 10UL);
+
+    blks = m_archiver->get_blocks({11, 5, false});
+    ASSERT_TRUE(blks.empty());
+
+    auto client
+        = cbdc::archiver::client(m_config_opts.m_archiver_endpoints[0], m_log);
+    ASSERT_TRUE(m_archiver->init_archiver_server());
+    ASSERT_TRUE(client.init());
+    auto client_blks = client.get_blocks(1, 10);
+    ASSERT_TRUE(client_blks.has_value());
+    ASSERT_EQ(client_blks->size(), 10UL);
+    ASSERT_EQ(client_blks->back().m_height, 10UL);
+}
+
+// Test that attestations are only returned when requested and stored
+TEST_F(ArchiverTest, attestations) {
+    auto& tx = m_dummy_blocks[0].m_transactions[0];
+    tx.m_attestations.emplace(cbdc::pubkey_t{1}, cbdc::signature_t{2});
+
+    m_archiver->init_leveldb();
+    m_archiver->init_best_block();
+    m_archiver->digest_block(m_dummy_blocks[0]);
+
+    auto blk = m_archiver->get_block(1);
+    ASSERT_TRUE(blk.has_value());
+    ASSERT_EQ(blk->m_transactions[0].m_attestations, tx.m_attestations);
+
+    auto blks = m_archiver->get_blocks({1, 1, false});
+    ASSERT_EQ(blks.size(), 1UL);
+    ASSERT_TRUE(blks[0].m_transactions[0].m_attestations.empty());
+
+    blks = m_archiver->get_blocks({1, 1, true});
+    ASSERT_EQ(blks.size(), 1UL);
+    ASSERT_EQ(blks[0].m_transactions[0].m_attestations, tx.m_attestations);
+
+    m_archiver.reset();
+    std::filesystem::remove_all("archiver0_db");
+    m_config_opts.m_archiver_attestations = false;
+    m_archiver = std::make_unique<cbdc::archiver::controller>(0,
+                                                              m_config_opts,
+                                                              m_log,
+                                                              0);
+    m_archiver->init_leveldb();
+    m_archiver->init_best_block();
+    m_archiver->digest_block(m_dummy_blocks[0]);
+    blk = m_archiver->get_block(1);
+    ASSERT_TRUE(blk.has_value());
+    ASSERT_TRUE(blk->m_transactions[0].m_attestations.empty());
+}
+
+// Test that blocks written between syncs are durable after shutdown
+TEST_F(ArchiverTest, sync_interval) {
+    m_config_opts.m_archiver_sync_interval = 4;
+    {
+        auto archiver0
+            = std::make_unique<cbdc::archiver::controller>(0,
+                                                           m_config_opts,
+                                                           m_log,
+                                                           0);
+        archiver0->init_leveldb();
+        archiver0->init_best_block();
+        for(size_t i = 0; i < 3; i++) {
+            archiver0->digest_block(m_dummy_blocks[i]);
+        }
+        ASSERT_EQ(archiver0->best_block_height(), 3UL);
+    }
+    auto archiver1
+        = std::make_unique<cbdc::archiver::controller>(0,
+                                                       m_config_opts,
+                                                       m_log,
+                                                       0);
+    archiver1->init_leveldb();
+    archiver1->init_best_block();
+    ASSERT_EQ(archiver1->best_block_height(), 3UL);
+    ASSERT_EQ(archiver1->get_blocks({1, 10, false}).size(), 3UL);
+}
@@ -0,0 +1,234 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/atomizer/atomizer/atomizer_raft.hpp"
+#include "uhs/atomizer/atomizer/format.hpp"
+#include "util/common/keys.hpp"
+#include "util/raft/util.hpp"
+#include "util/serialization/format.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <gtest/gtest.h>
+#include <secp256k1.h>
+
+class atomizer_raft_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        TearDown();
+
+        auto secp = std::unique_ptr<secp256k1_context,
+                                    decltype(&secp256k1_context_destroy)>{
+            secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
+            &secp256k1_context_destroy};
+        m_privkey.fill('k');
+        m_opts.m_sentinel_public_keys.insert(
+            cbdc::pubkey_from_privkey(m_privkey, secp.get()));
+        m_opts.m_attestation_threshold = 1;
+
+        m_raft = std::make_unique<cbdc::atomizer::atomizer_raft>(
+            0,
+            std::vector<cbdc::network::endpoint_t>{
+                {cbdc::network::localhost, m_raft_port}},
+            m_stxo_cache_depth,
+            m_logger,
+            m_opts,
+            nullptr);
+        auto params = nuraft::raft_params();
+        params.snapshot_distance_ = 0;
+        ASSERT_TRUE(m_raft->init(params));
+        for(size_t i = 0; i < 100 && !m_raft->is_leader(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        ASSERT_TRUE(m_raft->is_leader());
+    }
+
+    void TearDown() override {
+        if(m_raft) {
+            m_raft->stop();
+            m_raft.reset();
+        }
+        std::filesystem::remove_all("atomizer_raft_log_0");
+        std::filesystem::remove_all("atomizer_raft_config_0.dat");
+        std::filesystem::remove_all("atomizer_raft_state_0.dat");
+        std::filesystem::remove_all("atomizer_snps_0");
+    }
+
+    /// Returns a new transaction with two inputs, signed by the sentinel.
+    auto make_tx() -> cbdc::transaction::compact_tx {
+        auto tx = cbdc::transaction::compact_tx();
+        tx.m_id = next_hash();
+        tx.m_inputs.push_back(next_hash());
+        tx.m_inputs.push_back(next_hash());
+        tx.m_uhs_outputs.push_back(next_hash());
+        auto secp = std::unique_ptr<secp256k1_context,
+                                    decltype(&secp256k1_context_destroy)>{
+            secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
+            &secp256k1_context_destroy};
+        tx.m_attestations.insert(tx.sign(secp.get(), m_privkey));
+        return tx;
+    }
+
+    /// Returns a copy of the given transaction whose sentinel attestation
+    /// does not verify.
+    static auto forge(const cbdc::transaction::compact_tx& tx)
+        -> cbdc::transaction::compact_tx {
+        auto ret = tx;
+        for(auto& att : ret.m_attestations) {
+            att.second.fill(0);
+        }
+        return ret;
+    }
+
+    void notify(const cbdc::transaction::compact_tx& tx, uint64_t input) {
+        m_raft->tx_notify(
+            cbdc::atomizer::tx_notify_request{tx, {input}, m_height});
+    }
+
+    /// Replicates the complete transactions, if any, then makes a block and
+    /// returns its transactions.
+    auto next_block() -> std::vector<cbdc::transaction::compact_tx> {
+        if(m_raft->wait_for_complete_txs(std::chrono::milliseconds(100))) {
+            auto done = std::promise<void>();
+            EXPECT_TRUE(m_raft->send_complete_txs(
+                [&](cbdc::raft::result_type& /* r */,
+                    nuraft::ptr<std::exception>& err) {
+                    EXPECT_FALSE(err);
+                    done.set_value();
+                }));
+            done.get_future().wait();
+        }
+
+        m_raft->take_pending_block();
+        auto blk = std::promise<cbdc::atomizer::block>();
+        EXPECT_TRUE(m_raft->make_request(
+            cbdc::atomizer::make_block_request{},
+            [&](cbdc::raft::result_type& r, nuraft::ptr<std::exception>& err) {
+                EXPECT_FALSE(err);
+                auto res = cbdc::from_buffer<
+                    cbdc::atomizer::state_machine::response>(*r.get());
+                EXPECT_TRUE(res.has_value());
+                blk.set_value(
+                    std::get<cbdc::atomizer::make_block_response>(res.value())
+                        .m_blk);
+            }));
+        auto ret = blk.get_future().get();
+        m_height = ret.m_height;
+        return ret.m_transactions;
+    }
+
+    /// Returns true if a transaction completes within a short timeout.
+    auto completes() -> bool {
+        return m_raft->wait_for_complete_txs(std::chrono::milliseconds(200));
+    }
+
+    auto next_hash() -> cbdc::hash_t {
+        auto ret = cbdc::hash_t();
+        m_hash_counter++;
+        std::memcpy(ret.data(), &m_hash_counter, sizeof(m_hash_counter));
+        return ret;
+    }
+
+    static constexpr unsigned short m_raft_port{29830};
+    static constexpr size_t m_stxo_cache_depth{2};
+
+    std::shared_ptr<cbdc::logging::log> m_logger{
+        std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::warn)};
+    cbdc::config::options m_opts{};
+    cbdc::privkey_t m_privkey{};
+    std::unique_ptr<cbdc::atomizer::atomizer_raft> m_raft;
+    uint64_t m_height{0};
+    uint64_t m_hash_counter{0};
+};
+
+TEST_F(atomizer_raft_test, identical_notifications) {
+    auto tx = make_tx();
+    notify(tx, 0);
+    ASSERT_FALSE(completes());
+    notify(tx, 1);
+
+    auto blk = next_block();
+    ASSERT_EQ(blk.size(), 1UL);
+    ASSERT_EQ(blk[0], tx);
+    ASSERT_EQ(blk[0].m_attestations, tx.m_attestations);
+}
+
+TEST_F(atomizer_raft_test, concurrent_notifications) {
+    static constexpr size_t n_txs{50};
+
+    // Notifications for the same transaction race to verify it. Each
+    // transaction completes exactly once.
+    auto txs = std::vector<cbdc::transaction::compact_tx>();
+    for(size_t i = 0; i < n_txs; i++) {
+        txs.emplace_back(make_tx());
+    }
+    auto threads = std::vector<std::thread>();
+    for(uint64_t input = 0; input < 2; input++) {
+        threads.emplace_back([&, input]() {
+            for(const auto& tx : txs) {
+                notify(tx, input);
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+
+    auto blk = next_block();
+    ASSERT_EQ(blk.size(), n_txs);
+    for(const auto& tx : txs) {
+        ASSERT_EQ(std::count(blk.begin(), blk.end(), tx), 1);
+    }
+}
+
+TEST_F(atomizer_raft_test, invalid_before_valid) {
+    auto tx = make_tx();
+
+    // Attestations from a notification which fails verification do not
+    // count towards the transaction
+    notify(forge(tx), 0);
+    notify(tx, 1);
+    ASSERT_FALSE(completes());
+
+    notify(tx, 0);
+    auto blk = next_block();
+    ASSERT_EQ(blk.size(), 1UL);
+    ASSERT_EQ(blk[0].m_attestations, tx.m_attestations);
+}
+
+TEST_F(atomizer_raft_test, valid_before_invalid) {
+    auto tx = make_tx();
+    notify(tx, 0);
+    notify(forge(tx), 1);
+    ASSERT_FALSE(completes());
+
+    notify(tx, 1);
+    auto blk = next_block();
+    ASSERT_EQ(blk.size(), 1UL);
+    ASSERT_EQ(blk[0].m_attestations, tx.m_attestations);
+}
+
+TEST_F(atomizer_raft_test, late_notification) {
+    auto tx = make_tx();
+    notify(tx, 0);
+    notify(tx, 1);
+    ASSERT_EQ(next_block().size(), 1UL);
+
+    // Notifications for a completed transaction are ignored rather than
+    // starting a new pending entry
+    notify(tx, 0);
+    notify(tx, 1);
+    ASSERT_FALSE(completes());
+
+    // Completed transactions are forgotten after the STXO cache depth
+    for(size_t i = 0; i < m_stxo_cache_depth; i++) {
+        next_block();
+    }
+    notify(tx, 0);
+    notify(tx, 1);
+    ASSERT_TRUE(completes());
+}
@@ -0,0 +1,229 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/atomizer/atomizer/format.hpp"
+#include "uhs/atomizer/atomizer/state_machine.hpp"
+#include "util/raft/util.hpp"
+#include "util/serialization/format.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <gtest/gtest.h>
+
+namespace {
+    /// Atomizer state machine which holds its snapshot writer until the
+    /// test releases it.
+    class held_state_machine : public cbdc::atomizer::state_machine {
+      public:
+        using state_machine::state_machine;
+
+        void release() {
+            m_release.set_value();
+        }
+
+      protected:
+        void write_snapshot(const snapshot_view& snp) override {
+            m_released.wait();
+            state_machine::write_snapshot(snp);
+        }
+
+      private:
+        std::promise<void> m_release;
+        std::shared_future<void> m_released{m_release.get_future().share()};
+    };
+}
+
+class atomizer_state_machine_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        std::filesystem::remove_all(m_snapshot_dir);
+        m_sm = std::make_shared<cbdc::atomizer::state_machine>(
+            m_stxo_cache_depth,
+            m_snapshot_dir);
+    }
+
+    void TearDown() override {
+        m_sm.reset();
+        std::filesystem::remove_all(m_snapshot_dir);
+    }
+
+    auto commit(const cbdc::atomizer::state_machine::request& req)
+        -> std::optional<cbdc::atomizer::state_machine::response> {
+        auto buf = cbdc::make_buffer<cbdc::atomizer::state_machine::request,
+                                     nuraft::ptr<nuraft::buffer>>(req);
+        auto res = m_sm->commit(++m_log_idx, *buf);
+        if(!res) {
+            return std::nullopt;
+        }
+        return cbdc::from_buffer<cbdc::atomizer::state_machine::response>(
+            *res);
+    }
+
+    /// Commits a batch of transactions each spending one new input and
+    /// creating one new output, then commits a make block request.
+    void add_block(size_t n_txs) {
+        auto req = cbdc::atomizer::aggregate_tx_notify_request();
+        for(size_t i = 0; i < n_txs; i++) {
+            auto tx = cbdc::transaction::compact_tx();
+            tx.m_id = next_hash();
+            tx.m_inputs.push_back(next_hash());
+            tx.m_uhs_outputs.push_back(next_hash());
+            req.m_agg_txs.push_back({std::move(tx), m_height});
+        }
+        auto res = commit(req);
+        ASSERT_FALSE(res.has_value());
+        res = commit(cbdc::atomizer::make_block_request{});
+        ASSERT_TRUE(res.has_value());
+        m_height++;
+    }
+
+    auto next_hash() -> cbdc::hash_t {
+        auto ret = cbdc::hash_t();
+        m_hash_counter++;
+        std::memcpy(ret.data(), &m_hash_counter, sizeof(m_hash_counter));
+        return ret;
+    }
+
+    static constexpr auto m_snapshot_dir = "atomizer_state_machine_test";
+    static constexpr size_t m_stxo_cache_depth = 100;
+
+    std::shared_ptr<cbdc::atomizer::state_machine> m_sm;
+    uint64_t m_log_idx{0};
+    uint64_t m_height{0};
+    uint64_t m_hash_counter{0};
+};
+
+TEST_F(atomizer_state_machine_test, commit_during_snapshot) {
+    static constexpr size_t n_blocks = 50;
+    static constexpr size_t n_block_txs = 4000;
+    m_sm.reset();
+    auto sm = std::make_shared<held_state_machine>(m_stxo_cache_depth,
+                                                   m_snapshot_dir);
+    m_sm = sm;
+    for(size_t i = 0; i < n_blocks; i++) {
+        add_block(n_block_txs);
+    }
+
+    auto snp_idx = m_log_idx;
+    auto snp = nuraft::snapshot(snp_idx,
+                                1,
+                                nuraft::cs_new<nuraft::cluster_config>());
+    auto done = std::promise<void>();
+    auto done_fut = done.get_future();
+    nuraft::async_result<bool>::handler_type when_done
+        = [&](bool& res, nuraft::ptr<std::exception>& err) {
+              EXPECT_TRUE(res);
+              EXPECT_FALSE(err);
+              done.set_value();
+          };
+    m_sm->create_snapshot(snp, when_done);
+
+    // Commits complete while the snapshot writer is held, so none of them
+    // waits for the snapshot. Record the slowest, which includes copying
+    // state shared with the snapshot.
+    static constexpr size_t n_commits = 20;
+    static constexpr size_t n_commit_txs = 10;
+    auto worst = std::chrono::nanoseconds::zero();
+    for(size_t i = 0; i < n_commits; i++) {
+        auto commit_start = std::chrono::steady_clock::now();
+        add_block(n_commit_txs);
+        auto latency = std::chrono::steady_clock::now() - commit_start;
+        worst = std::max(worst, latency);
+    }
+    EXPECT_EQ(done_fut.wait_for(std::chrono::seconds(0)),
+              std::future_status::timeout);
+    sm->release();
+    ASSERT_EQ(done_fut.wait_for(std::chrono::seconds(60)),
+              std::future_status::ready);
+
+    RecordProperty(
+        "worst_commit_latency_us",
+        std::to_string(
+            std::chrono::duration_cast<std::chrono::microseconds>(worst)
+                .count()));
+
+    // The snapshot holds the state as of its log index, not the later commits
+    auto blk_res = commit(cbdc::atomizer::get_block_request{n_blocks});
+    ASSERT_TRUE(blk_res.has_value());
+    auto want = std::get<cbdc::atomizer::get_block_response>(blk_res.value());
+
+    m_sm.reset();
+    sm.reset();
+    m_log_idx = snp_idx;
+    m_sm = std::make_shared<cbdc::atomizer::state_machine>(m_stxo_cache_depth,
+                                                           m_snapshot_dir);
+    ASSERT_EQ(m_sm->last_commit_index(), snp_idx);
+
+    blk_res = commit(cbdc::atomizer::get_block_request{n_blocks});
+    ASSERT_TRUE(blk_res.has_value());
+    auto got = std::get<cbdc::atomizer::get_block_response>(blk_res.value());
+    ASSERT_EQ(got.m_blk, want.m_blk);
+    ASSERT_EQ(got.m_blk.m_transactions.size(), n_block_txs);
+
+    blk_res = commit(cbdc::atomizer::get_block_request{n_blocks + 1});
+    ASSERT_FALSE(blk_res.has_value());
+}
+
+TEST_F(atomizer_state_machine_test, snapshot_objects) {
+    // Enough transactions for the snapshot to span several chunks
+    static constexpr size_t n_blocks = 50;
+    static constexpr size_t n_block_txs = 4000;
+    for(size_t i = 0; i < n_blocks; i++) {
+        add_block(n_block_txs);
+    }
+
+    auto snp = nuraft::snapshot(m_log_idx,
+                                1,
+                                nuraft::cs_new<nuraft::cluster_config>());
+    auto done = std::promise<void>();
+    nuraft::async_result<bool>::handler_type when_done
+        = [&](bool& /* res */, nuraft::ptr<std::exception>& /* err */) {
+              done.set_value();
+          };
+    m_sm->create_snapshot(snp, when_done);
+    ASSERT_EQ(done.get_future().wait_for(std::chrono::seconds(60)),
+              std::future_status::ready);
+
+    auto path = std::filesystem::path(m_snapshot_dir)
+              / std::to_string(m_log_idx);
+    auto in = std::ifstream(path, std::ios::in | std::ios::binary);
+    auto file = std::vector<char>(std::istreambuf_iterator<char>(in), {});
+
+    // Reading the objects in turn yields the file's chunk records
+    void* ctx{nullptr};
+    auto objs = std::vector<nuraft::ptr<nuraft::buffer>>();
+    auto is_last = false;
+    while(!is_last) {
+        auto obj = nuraft::ptr<nuraft::buffer>();
+        ASSERT_EQ(
+            m_sm->read_logical_snp_obj(snp, ctx, objs.size(), obj, is_last),
+            0);
+        objs.push_back(obj);
+    }
+    ASSERT_GT(objs.size(), 1UL);
+    auto got = std::vector<char>();
+    for(const auto& obj : objs) {
+        const auto* data = reinterpret_cast<const char*>(obj->data_begin());
+        got.insert(got.end(), data, data + obj->size());
+    }
+    ASSERT_EQ(got, file);
+
+    // Objects may be requested again, and there are none past the end
+    auto obj = nuraft::ptr<nuraft::buffer>();
+    ASSERT_EQ(m_sm->read_logical_snp_obj(snp, ctx, 1, obj, is_last), 0);
+    ASSERT_FALSE(is_last);
+    ASSERT_EQ(obj->size(), objs[1]->size());
+    ASSERT_TRUE(std::equal(obj->data_begin(),
+                           obj->data_begin() + obj->size(),
+                           objs[1]->data_begin()));
+    ASSERT_NE(
+        m_sm->read_logical_snp_obj(snp, ctx, objs.size(), obj, is_last),
+        0);
+    m_sm->free_user_snp_ctx(ctx);
+    ASSERT_EQ(ctx, nullptr);
+}
@@ -150,3 +150,38 @@ TEST_F(atomizer_test, err_incomplete) {
 
     verify_serialization();
 }
+
+TEST_F(atomizer_test, snapshot_isolated) {
+    auto tx0 = cbdc::test::simple_tx({'a'}, {{'b'}}, {{'c'}});
+    auto err = m_atomizer->insert_complete(0, std::move(tx0));
+    ASSERT_FALSE(err.has_value());
+    auto tx_incomplete = cbdc::test::simple_tx({'d'}, {{'e'}, {'f'}}, {{'g'}});
+    err = m_atomizer->insert(0, tx_incomplete, {0});
+    ASSERT_FALSE(err.has_value());
+
+    auto snp = m_atomizer->snapshot();
+    ASSERT_EQ(*snp, *m_atomizer);
+    auto want = snp->serialize();
+
+    // Modifying the atomizer must not affect the snapshot
+    err = m_atomizer->insert(0, tx_incomplete, {1});
+    ASSERT_FALSE(err.has_value());
+    auto tx1 = cbdc::test::simple_tx({'h'}, {{'i'}}, {{'j'}});
+    err = m_atomizer->insert_complete(0, std::move(tx1));
+    ASSERT_FALSE(err.has_value());
+    auto [blk, errs] = m_atomizer->make_block();
+    ASSERT_EQ(blk.m_transactions.size(), 3UL);
+    ASSERT_TRUE(errs.empty());
+
+    ASSERT_EQ(snp->pending_transactions(), 1UL);
+    ASSERT_EQ(snp->height(), 0UL);
+    ASSERT_EQ(snp->serialize(), want);
+
+    // Nor the snapshot the atomizer
+    auto [snp_blk, snp_errs] = snp->make_block();
+    ASSERT_EQ(snp_blk.m_transactions.size(), 1UL);
+    ASSERT_EQ(m_atomizer->pending_transactions(), 0UL);
+    ASSERT_EQ(m_atomizer->height(), 1UL);
+
+    verify_serialization();
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/bounded_queue.hpp"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <numeric>
+
+TEST(bounded_queue_test, fifo) {
+    auto q = cbdc::mpmc_queue<int>(3);
+    ASSERT_EQ(q.capacity(), 4UL);
+    for(int i = 0; i < 4; i++) {
+        ASSERT_TRUE(q.try_push(i));
+    }
+    ASSERT_FALSE(q.try_push(4));
+
+    int item{};
+    for(int i = 0; i < 4; i++) {
+        ASSERT_TRUE(q.try_pop(item));
+        ASSERT_EQ(item, i);
+    }
+    ASSERT_FALSE(q.try_pop(item));
+}
+
+TEST(bounded_queue_test, batch) {
+    auto q = cbdc::mpsc_queue<int>(8);
+    auto in = std::vector<int>(6);
+    std::iota(in.begin(), in.end(), 0);
+    ASSERT_EQ(q.push(in.begin(), in.end()), in.size());
+
+    auto out = std::vector<int>();
+    ASSERT_EQ(q.pop(out, 4), 4UL);
+    ASSERT_EQ(q.pop(out, 4), 2UL);
+    ASSERT_EQ(out, in);
+}
+
+TEST(bounded_queue_test, releases_popped_elements) {
+    auto q = cbdc::mpmc_queue<std::shared_ptr<int>>(2);
+    auto ptr = std::make_shared<int>(1);
+    ASSERT_TRUE(q.push(ptr));
+    auto popped = std::shared_ptr<int>();
+    ASSERT_TRUE(q.pop(popped));
+    popped.reset();
+    ASSERT_EQ(ptr.use_count(), 1);
+}
+
+TEST(bounded_queue_test, clear_unblocks) {
+    auto empty = cbdc::mpsc_queue<int>(2);
+    auto consumer = std::thread([&]() {
+        int item{};
+        ASSERT_FALSE(empty.pop(item));
+    });
+
+    auto full = cbdc::mpmc_queue<int>(2);
+    ASSERT_TRUE(full.push(1));
+    ASSERT_TRUE(full.push(2));
+    auto producer = std::thread([&]() {
+        ASSERT_FALSE(full.push(3));
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    empty.clear();
+    full.clear();
+    producer.join();
+    consumer.join();
+
+    int item{};
+    ASSERT_FALSE(full.try_pop(item));
+    ASSERT_FALSE(full.try_push(4));
+    full.reset();
+    ASSERT_TRUE(full.try_push(5));
+    ASSERT_TRUE(full.try_pop(item));
+    ASSERT_EQ(item, 5);
+    ASSERT_FALSE(full.try_pop(item));
+}
+
+TEST(bounded_queue_test, contended) {
+    static constexpr size_t n_producers{4};
+    static constexpr size_t n_consumers{4};
+    static constexpr uint64_t n_items{100000};
+    auto q = cbdc::mpmc_queue<uint64_t>(64);
+
+    auto producers = std::vector<std::thread>();
+    for(size_t p = 0; p < n_producers; p++) {
+        producers.emplace_back([&, p]() {
+            for(uint64_t i = 0; i < n_items; i++) {
+                ASSERT_TRUE(q.push(p * n_items + i));
+            }
+        });
+    }
+
+    auto sums = std::vector<uint64_t>(n_consumers);
+    auto consumed = std::atomic<uint64_t>();
+    auto consumers = std::vector<std::thread>();
+    for(size_t c = 0; c < n_consumers; c++) {
+        consumers.emplace_back([&, c]() {
+            auto items = std::vector<uint64_t>();
+            while(q.pop(items, 16) > 0) {
+                for(auto item : items) {
+                    sums[c] += item;
+                }
+                consumed += items.size();
+                items.clear();
+            }
+        });
+    }
+
+    for(auto& t : producers) {
+        t.join();
+    }
+    static constexpr auto total = n_producers * n_items;
+    while(consumed != total) {
+        std::this_thread::yield();
+    }
+    q.clear();
+    for(auto& t : consumers) {
+        t.join();
+    }
+
+    ASSERT_EQ(std::accumulate(sums.begin(), sums.end(), uint64_t{}),
+              total * (total - 1) / 2);
+}
@@ -0,0 +1,60 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/hdr_histogram.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(hdr_histogram_test, empty) {
+    auto hist = cbdc::hdr_histogram();
+    EXPECT_EQ(hist.count(), 0UL);
+    EXPECT_EQ(hist.value_at_percentile(50.0), 0UL);
+    EXPECT_EQ(hist.max(), 0UL);
+}
+
+TEST(hdr_histogram_test, percentiles) {
+    auto hist = cbdc::hdr_histogram();
+    for(uint64_t i = 1; i <= 100000; i++) {
+        hist.record(i * 1000);
+    }
+    EXPECT_EQ(hist.count(), 100000UL);
+    EXPECT_EQ(hist.min(), 1000UL);
+    EXPECT_EQ(hist.max(), 100000000UL);
+
+    // Values are retained to three significant digits
+    auto expect_near = [](uint64_t actual, uint64_t expected) {
+        EXPECT_GE(actual, expected);
+        EXPECT_LE(actual, expected + expected / 1000);
+    };
+    expect_near(hist.value_at_percentile(50.0), 50000000);
+    expect_near(hist.value_at_percentile(99.0), 99000000);
+    expect_near(hist.value_at_percentile(99.9), 99900000);
+    EXPECT_EQ(hist.value_at_percentile(100.0), hist.max());
+}
+
+TEST(hdr_histogram_test, small_values_exact) {
+    auto hist = cbdc::hdr_histogram();
+    for(uint64_t i = 0; i < 1000; i++) {
+        hist.record(i);
+    }
+    EXPECT_EQ(hist.value_at_percentile(50.0), 499UL);
+    EXPECT_EQ(hist.value_at_percentile(0.0), 0UL);
+}
+
+TEST(hdr_histogram_test, clamp_and_merge) {
+    auto a = cbdc::hdr_histogram(1000000);
+    auto b = cbdc::hdr_histogram(1000000);
+    a.record(10);
+    b.record(5000000);
+    EXPECT_EQ(b.max(), 1000000UL);
+
+    a.merge(b);
+    EXPECT_EQ(a.count(), 2UL);
+    EXPECT_EQ(a.min(), 10UL);
+    EXPECT_EQ(a.max(), 1000000UL);
+
+    a.reset();
+    EXPECT_EQ(a.count(), 0UL);
+}
@@ -0,0 +1,145 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/thread_pool.hpp"
+
+#include <array>
+#include <future>
+#include <gtest/gtest.h>
+
+namespace {
+    /// Counts completed tasks and lets the test wait for a given count.
+    class counter {
+      public:
+        void increment() {
+            {
+                std::unique_lock l(m_mut);
+                m_count++;
+            }
+            m_cv.notify_all();
+        }
+
+        auto wait_for(size_t count) -> bool {
+            std::unique_lock l(m_mut);
+            return m_cv.wait_for(l, std::chrono::seconds(10), [&]() {
+                return m_count >= count;
+            });
+        }
+
+      private:
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        size_t m_count{};
+    };
+}
+
+TEST(thread_pool_test, runs_all_tasks) {
+    static constexpr size_t n_tasks{1000};
+    auto done = counter();
+    auto pool = cbdc::thread_pool(4);
+    ASSERT_EQ(pool.size(), 4UL);
+    for(size_t i = 0; i < n_tasks; i++) {
+        pool.push([&]() {
+            done.increment();
+        });
+    }
+    ASSERT_TRUE(done.wait_for(n_tasks));
+    ASSERT_EQ(pool.get_metrics().m_executed, n_tasks);
+}
+
+TEST(thread_pool_test, task_storage) {
+    auto done = counter();
+    auto pool = cbdc::thread_pool(2);
+
+    auto ptr = std::make_unique<int>(1);
+    pool.push([&done, p = std::move(ptr)]() {
+        ASSERT_EQ(*p, 1);
+        done.increment();
+    });
+
+    auto big = std::array<size_t, 32>();
+    big.back() = 2;
+    pool.push([&done, big]() {
+        ASSERT_EQ(big.back(), 2UL);
+        done.increment();
+    });
+
+    auto fn = std::function<void()>([&]() {
+        done.increment();
+    });
+    pool.push(fn);
+    ASSERT_TRUE(done.wait_for(3));
+
+    auto t = cbdc::thread_pool::task();
+    ASSERT_FALSE(t);
+    auto calls = 0;
+    t = cbdc::thread_pool::task([&]() {
+        calls++;
+    });
+    auto moved = std::move(t);
+    ASSERT_TRUE(moved);
+    moved();
+    ASSERT_EQ(calls, 1);
+}
+
+TEST(thread_pool_test, steals_behind_long_task) {
+    static constexpr size_t n_tasks{10};
+    auto done = counter();
+    auto release = std::promise<void>();
+    auto released = release.get_future().share();
+    auto pool = cbdc::thread_pool(2);
+
+    // Queue tasks behind a task which blocks its worker until they have
+    // all run, so they can only complete on the other worker
+    pool.push([&]() {
+        for(size_t i = 0; i < n_tasks; i++) {
+            pool.push([&]() {
+                done.increment();
+            });
+        }
+        released.wait();
+    });
+    ASSERT_TRUE(done.wait_for(n_tasks));
+    release.set_value();
+
+    auto metrics = pool.get_metrics();
+    ASSERT_GE(metrics.m_steals, 1UL);
+    ASSERT_GE(metrics.m_stolen, metrics.m_steals);
+}
+
+TEST(thread_pool_test, batch) {
+    static constexpr size_t n_tasks{100};
+    auto done = counter();
+    auto pool = cbdc::thread_pool(4);
+    auto tasks = std::vector<cbdc::thread_pool::task>();
+    for(size_t i = 0; i < n_tasks; i++) {
+        tasks.emplace_back([&]() {
+            done.increment();
+        });
+    }
+    pool.push_batch(std::move(tasks));
+    ASSERT_TRUE(done.wait_for(n_tasks));
+}
+
+TEST(thread_pool_test, destroyed_by_task) {
+    auto done = std::promise<void>();
+    auto finished = done.get_future();
+    auto pool = std::make_shared<cbdc::thread_pool>(2);
+    auto started = std::promise<void>();
+    auto release = std::promise<void>();
+    auto released = release.get_future();
+    pool->push([&, p = pool]() mutable {
+        started.set_value();
+        released.wait();
+        // Drop the last reference to the pool from its own worker
+        p.reset();
+        done.set_value();
+    });
+    started.get_future().wait();
+    pool.reset();
+    release.set_value();
+    ASSERT_EQ(finished.wait_for(std::chrono::seconds(10)),
+              std::future_status::ready);
+}
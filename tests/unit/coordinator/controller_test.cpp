@@ -57,3 +57,47 @@ TEST_F(coordinator_controller_test, out_of_range_node_id) {
                                                           m_logger);
     ASSERT_FALSE(m_ctl_coordinator->init());
 }
+
+TEST_F(coordinator_controller_test, batch_limit) {
+    static constexpr size_t max_limit{100};
+    static constexpr auto target = std::chrono::milliseconds(10);
+    static constexpr auto fast = std::chrono::milliseconds(5);
+    static constexpr auto slow = std::chrono::milliseconds(20);
+    auto next = [&](size_t limit,
+                    std::chrono::nanoseconds latency,
+                    size_t batch_size) {
+        return cbdc::coordinator::controller::next_batch_limit(limit,
+                                                               max_limit,
+                                                               latency,
+                                                               target,
+                                                               batch_size);
+    };
+
+    // Full batches within the target grow the limit additively, up to the
+    // maximum
+    ASSERT_EQ(next(50, fast, 50), 55UL);
+    ASSERT_EQ(next(55, fast, 55), 60UL);
+    ASSERT_EQ(next(98, fast, 98), max_limit);
+    ASSERT_EQ(next(max_limit, fast, max_limit), max_limit);
+
+    // Batches which were not full say nothing about a larger limit
+    ASSERT_EQ(next(50, fast, 10), 50UL);
+
+    // Batches over the target shrink the limit multiplicatively, full or
+    // not, but never to zero
+    ASSERT_EQ(next(max_limit, slow, max_limit), 90UL);
+    ASSERT_EQ(next(90, slow, 10), 81UL);
+    ASSERT_EQ(next(1, slow, 1), 1UL);
+
+    // Repeated overload backs off much faster than recovery grows the
+    // limit again
+    auto limit = max_limit;
+    for(size_t i = 0; i < 10; i++) {
+        limit = next(limit, slow, limit);
+    }
+    ASSERT_EQ(limit, 32UL);
+    for(size_t i = 0; i < 10; i++) {
+        limit = next(limit, fast, limit);
+    }
+    ASSERT_EQ(limit, 82UL);
+}
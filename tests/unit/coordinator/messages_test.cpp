@@ -85,6 +85,28 @@ TEST_F(coordinator_messages_test, get_command) {
     ASSERT_TRUE(m_deser.end_of_buffer());
 }
 
+TEST_F(coordinator_messages_test, batch_command) {
+    auto header = cbdc::coordinator::controller::sm_command_header{
+        cbdc::coordinator::state_machine::command::batch};
+    auto done = cbdc::coordinator::controller::sm_command{
+        {cbdc::coordinator::state_machine::command::done, cbdc::hash_t{'a'}}};
+    auto param = cbdc::coordinator::controller::command_batch{
+        cbdc::make_buffer(done),
+        cbdc::make_buffer(done)};
+    auto comm = cbdc::coordinator::controller::sm_command{header, param};
+
+    ASSERT_TRUE(m_ser << comm);
+
+    auto deser_header = cbdc::coordinator::controller::sm_command_header();
+    ASSERT_TRUE(m_deser >> deser_header);
+    ASSERT_EQ(header, deser_header);
+
+    auto deser_comm = cbdc::coordinator::controller::command_batch();
+    ASSERT_TRUE(m_deser >> deser_comm);
+    ASSERT_EQ(param, deser_comm);
+    ASSERT_TRUE(m_deser.end_of_buffer());
+}
+
 TEST_F(coordinator_messages_test, coordinator_state) {
     auto prep_param = cbdc::coordinator::controller::prepare_tx{m_tx, m_tx};
     auto prep = cbdc::coordinator::controller::prepare_txs{
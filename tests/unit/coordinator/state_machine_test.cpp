@@ -0,0 +1,80 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/twophase/coordinator/controller.hpp"
+#include "uhs/twophase/coordinator/format.hpp"
+#include "uhs/twophase/coordinator/state_machine.hpp"
+#include "util.hpp"
+#include "util/raft/util.hpp"
+#include "util/serialization/util.hpp"
+
+#include <gtest/gtest.h>
+
+class coordinator_state_machine_test : public ::testing::Test {
+  protected:
+    using controller = cbdc::coordinator::controller;
+    using command = cbdc::coordinator::state_machine::command;
+
+    /// Commits the given command as the next log entry.
+    auto commit(const controller::sm_command& comm)
+        -> nuraft::ptr<nuraft::buffer> {
+        auto buf = cbdc::make_buffer<controller::sm_command,
+                                     nuraft::ptr<nuraft::buffer>>(comm);
+        return m_sm.commit(++m_log_idx, *buf);
+    }
+
+    /// Returns the coordinator state held by the state machine.
+    auto get_state() -> controller::coordinator_state {
+        auto res = commit(controller::sm_command{{command::get}});
+        EXPECT_TRUE(res);
+        auto state = cbdc::from_buffer<controller::coordinator_state>(*res);
+        EXPECT_TRUE(state.has_value());
+        return state.value_or(controller::coordinator_state{});
+    }
+
+    cbdc::coordinator::state_machine m_sm{
+        std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::warn)};
+    uint64_t m_log_idx{0};
+
+    cbdc::test::compact_transaction m_tx{
+        cbdc::test::simple_tx({'a', 'b', 'c'},
+                              {{'d', 'e', 'f'}, {'g', 'h', 'i'}},
+                              {{'x', 'y', 'z'}, {'z', 'z', 'z'}})};
+};
+
+TEST_F(coordinator_state_machine_test, batch) {
+    auto prep = controller::prepare_tx{m_tx};
+    auto comm = controller::commit_tx{{true}, {{0}}};
+
+    // Each dtx only reaches a phase if the commands for the earlier phases
+    // in the same batch were applied first. Applying a phase change out of
+    // order is fatal.
+    auto cmds = std::vector<controller::sm_command>{
+        {{command::prepare, cbdc::hash_t{'a'}}, prep},
+        {{command::prepare, cbdc::hash_t{'b'}}, prep},
+        {{command::commit, cbdc::hash_t{'a'}}, comm},
+        {{command::prepare, cbdc::hash_t{'c'}}, prep},
+        {{command::commit, cbdc::hash_t{'b'}}, comm},
+        {{command::discard, cbdc::hash_t{'a'}}},
+        {{command::discard, cbdc::hash_t{'b'}}},
+        {{command::done, cbdc::hash_t{'a'}}}};
+    auto batch = controller::command_batch();
+    for(const auto& cmd : cmds) {
+        batch.emplace_back(cbdc::make_buffer(cmd));
+    }
+    ASSERT_FALSE(commit(controller::sm_command{{command::batch}, batch}));
+    ASSERT_EQ(m_sm.last_commit_index(), m_log_idx);
+
+    auto expected = controller::coordinator_state{
+        {{cbdc::hash_t{'c'}, prep}},
+        {},
+        {cbdc::hash_t{'b'}}};
+    ASSERT_EQ(get_state(), expected);
+
+    // Later log entries apply on top of the batch
+    commit(controller::sm_command{{command::done, cbdc::hash_t{'b'}}});
+    expected.m_discard_txs.clear();
+    ASSERT_EQ(get_state(), expected);
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/transaction/corpus.hpp"
+#include "uhs/transaction/wallet.hpp"
+
+#include <filesystem>
+#include <gtest/gtest.h>
+
+class CorpusTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        auto mint_tx = m_wallet.mint_new_coins(100, 10);
+        m_wallet.confirm_transaction(mint_tx);
+        for(size_t i = 0; i < 20; i++) {
+            auto tx = m_wallet.send_to(i % 3 + 1, 2, {'a'}, true);
+            ASSERT_TRUE(tx.has_value());
+            m_txs.push_back(std::move(tx.value()));
+        }
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(m_corpus_file);
+    }
+
+    void write_corpus() {
+        auto writer = cbdc::transaction::corpus_writer(m_corpus_file);
+        ASSERT_TRUE(writer.init());
+        ASSERT_TRUE(writer.append({m_txs.begin(), m_txs.begin() + 5}));
+        ASSERT_TRUE(writer.append({m_txs.begin() + 5, m_txs.end()}));
+        ASSERT_EQ(writer.size(), m_txs.size());
+        ASSERT_TRUE(writer.close());
+    }
+
+    cbdc::transaction::wallet m_wallet{};
+    std::vector<cbdc::transaction::full_tx> m_txs;
+    static constexpr auto m_corpus_file = "test_corpus.dat";
+};
+
+TEST_F(CorpusTest, replay) {
+    write_corpus();
+
+    auto reader = cbdc::transaction::corpus_reader(m_corpus_file);
+    ASSERT_TRUE(reader.init());
+    ASSERT_EQ(reader.size(), m_txs.size());
+
+    // Decode into the same transaction, whose shape changes between records
+    auto tx = cbdc::transaction::full_tx();
+    for(const auto& expected : m_txs) {
+        ASSERT_TRUE(reader.next(tx));
+        ASSERT_EQ(tx, expected);
+    }
+    ASSERT_FALSE(reader.next(tx));
+
+    reader.rewind();
+    ASSERT_TRUE(reader.next(tx));
+    ASSERT_EQ(tx, m_txs[0]);
+}
+
+TEST_F(CorpusTest, truncated) {
+    write_corpus();
+    std::filesystem::resize_file(m_corpus_file,
+                                 std::filesystem::file_size(m_corpus_file)
+                                     - 1);
+
+    auto reader = cbdc::transaction::corpus_reader(m_corpus_file);
+    ASSERT_TRUE(reader.init());
+    auto tx = cbdc::transaction::full_tx();
+    for(size_t i = 0; i + 1 < m_txs.size(); i++) {
+        ASSERT_TRUE(reader.next(tx));
+        ASSERT_EQ(tx, m_txs[i]);
+    }
+    ASSERT_FALSE(reader.next(tx));
+}
+
+TEST_F(CorpusTest, invalid_file) {
+    auto missing = cbdc::transaction::corpus_reader(m_corpus_file);
+    ASSERT_FALSE(missing.init());
+
+    auto out = std::ofstream(m_corpus_file, std::ios::binary);
+    out << "not a transaction corpus";
+    out.close();
+    auto reader = cbdc::transaction::corpus_reader(m_corpus_file);
+    ASSERT_FALSE(reader.init());
+}
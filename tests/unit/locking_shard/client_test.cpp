@@ -0,0 +1,205 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/twophase/locking_shard/client.hpp"
+#include "uhs/twophase/locking_shard/format.hpp"
+#include "util/rpc/format.hpp"
+#include "util/rpc/tcp_server.hpp"
+#include "util/serialization/format.hpp"
+
+#include <condition_variable>
+#include <gtest/gtest.h>
+
+namespace {
+    using request = cbdc::locking_shard::rpc::request;
+    using response = cbdc::locking_shard::rpc::response;
+
+    /// Locking shard RPC server which holds each request until the test
+    /// responds to it, and records when requests arrive.
+    class test_server {
+      public:
+        using callback_type = std::function<void(std::optional<response>)>;
+
+        explicit test_server(const cbdc::network::endpoint_t& ep)
+            : m_srv(ep) {}
+
+        auto init() -> bool {
+            m_srv.register_handler_callback(
+                [&](const request& /* req */, callback_type cb) {
+                    {
+                        std::unique_lock l(m_mut);
+                        m_requests.emplace_back(std::move(cb));
+                        m_times.emplace_back(std::chrono::steady_clock::now());
+                    }
+                    m_cv.notify_all();
+                    return true;
+                });
+            return m_srv.init();
+        }
+
+        /// Waits until the server has received the given number of requests
+        /// in total.
+        auto wait_for_requests(size_t n) -> bool {
+            std::unique_lock l(m_mut);
+            return m_cv.wait_for(l, std::chrono::seconds(10), [&]() {
+                return m_requests.size() >= n;
+            });
+        }
+
+        /// Responds to the request with the given arrival index.
+        void respond(size_t i, const response& resp) {
+            auto cb = callback_type();
+            {
+                std::unique_lock l(m_mut);
+                ASSERT_LT(i, m_requests.size());
+                cb = m_requests[i];
+            }
+            cb(resp);
+        }
+
+        /// Returns the arrival times of the requests received so far.
+        auto times() -> std::vector<std::chrono::steady_clock::time_point> {
+            std::unique_lock l(m_mut);
+            return m_times;
+        }
+
+      private:
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        std::vector<callback_type> m_requests;
+        std::vector<std::chrono::steady_clock::time_point> m_times;
+        cbdc::rpc::async_tcp_server<request, response> m_srv;
+    };
+
+    /// Records the results of asynchronous discard requests.
+    class results {
+      public:
+        auto callback()
+            -> cbdc::locking_shard::interface::result_callback_type {
+            return [&](bool res) {
+                {
+                    std::unique_lock l(m_mut);
+                    m_results.push_back(res);
+                }
+                m_cv.notify_all();
+            };
+        }
+
+        auto wait_for(size_t n) -> bool {
+            std::unique_lock l(m_mut);
+            return m_cv.wait_for(l, std::chrono::seconds(10), [&]() {
+                return m_results.size() >= n;
+            });
+        }
+
+        auto get() -> std::vector<bool> {
+            std::unique_lock l(m_mut);
+            return m_results;
+        }
+
+      private:
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        std::vector<bool> m_results;
+    };
+}
+
+class locking_shard_client_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        ASSERT_TRUE(m_server.init());
+        ASSERT_TRUE(m_client.init());
+    }
+
+    static constexpr unsigned short m_port{29920};
+    static constexpr auto m_initial_timeout = std::chrono::milliseconds(100);
+    static constexpr auto m_max_timeout = std::chrono::milliseconds(400);
+
+    cbdc::network::endpoint_t m_ep{cbdc::network::localhost, m_port};
+    cbdc::logging::log m_log{cbdc::logging::log_level::error};
+    results m_results;
+    test_server m_server{m_ep};
+    cbdc::locking_shard::rpc::client m_client{{m_ep},
+                                              {0, 255},
+                                              m_log,
+                                              m_initial_timeout,
+                                              m_max_timeout};
+};
+
+TEST_F(locking_shard_client_test, retry_doubling_timeout) {
+    static constexpr size_t n_sends{5};
+
+    // Unanswered requests are sent again once their timeout expires, and
+    // the timeout doubles up to the maximum with each retry
+    m_client.async_discard_dtx({'a'}, m_results.callback());
+    ASSERT_TRUE(m_server.wait_for_requests(n_sends));
+    m_server.respond(n_sends - 1,
+                     cbdc::locking_shard::rpc::discard_response());
+    ASSERT_TRUE(m_results.wait_for(1));
+    ASSERT_EQ(m_results.get(), std::vector<bool>{true});
+
+    // Allow for the requests taking different times to arrive
+    static constexpr auto slack = m_initial_timeout / 2;
+    auto times = m_server.times();
+    auto timeout = m_initial_timeout;
+    for(size_t i = 1; i < n_sends; i++) {
+        ASSERT_GE(times[i] - times[i - 1], timeout - slack);
+        timeout = std::min(m_max_timeout, timeout * 2);
+    }
+}
+
+TEST_F(locking_shard_client_test, complete_once) {
+    m_client.async_discard_dtx({'a'}, m_results.callback());
+    ASSERT_TRUE(m_server.wait_for_requests(2));
+
+    // Both the original request and its retry are answered
+    m_server.respond(0, cbdc::locking_shard::rpc::discard_response());
+    m_server.respond(1, cbdc::locking_shard::rpc::discard_response());
+    ASSERT_TRUE(m_results.wait_for(1));
+
+    // Responses arrive in order, so once a later request completes the
+    // duplicate response has been handled
+    m_client.async_discard_dtx({'b'}, m_results.callback());
+    ASSERT_TRUE(m_server.wait_for_requests(3));
+    m_server.respond(2, cbdc::locking_shard::rpc::discard_response());
+    ASSERT_TRUE(m_results.wait_for(2));
+    ASSERT_EQ(m_results.get(), (std::vector<bool>{true, true}));
+}
+
+TEST_F(locking_shard_client_test, stop) {
+    // Pending requests fail when the client stops
+    m_client.async_discard_dtx({'a'}, m_results.callback());
+    ASSERT_TRUE(m_server.wait_for_requests(1));
+    m_client.stop();
+    ASSERT_TRUE(m_results.wait_for(1));
+
+    // Requests made after stopping fail immediately
+    m_client.async_discard_dtx({'b'}, m_results.callback());
+    ASSERT_TRUE(m_results.wait_for(2));
+    ASSERT_EQ(m_results.get(), (std::vector<bool>{false, false}));
+    ASSERT_FALSE(m_client.lock_outputs({}, {'c'}).has_value());
+}
+
+TEST_F(locking_shard_client_test, stop_while_sending) {
+    static constexpr size_t n_senders{4};
+
+    // Stopping while other threads send completes every request exactly
+    // once
+    auto threads = std::vector<std::thread>();
+    for(size_t i = 0; i < n_senders; i++) {
+        threads.emplace_back([&]() {
+            for(size_t j = 0; j < 100; j++) {
+                m_client.async_discard_dtx({'a'}, m_results.callback());
+            }
+        });
+    }
+    ASSERT_TRUE(m_server.wait_for_requests(1));
+    m_client.stop();
+    for(auto& t : threads) {
+        t.join();
+    }
+    ASSERT_TRUE(m_results.wait_for(n_senders * 100));
+    ASSERT_EQ(m_results.get().size(), n_senders * 100);
+}
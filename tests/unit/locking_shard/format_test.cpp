@@ -4,7 +4,6 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "uhs/twophase/locking_shard/format.hpp"
-#include "util.hpp"
 
 #include <gtest/gtest.h>
 
@@ -14,10 +13,9 @@ class locking_shard_format_test : public ::testing::Test {
     cbdc::buffer_serializer m_ser{m_target_packet};
     cbdc::buffer_serializer m_deser{m_target_packet};
 
-    cbdc::locking_shard::tx m_tx{
-        cbdc::test::simple_tx({'a', 'b', 'c'},
-                              {{{'d', 'e', 'f'}}, {{'g', 'h', 'i'}}},
-                              {{{'x', 'y', 'z'}}, {{'z', 'z', 'z'}}})};
+    cbdc::locking_shard::tx m_tx{{'a', 'b', 'c'},
+                                 {{{'d', 'e', 'f'}}, {{'g', 'h', 'i'}}},
+                                 {{{'x', 'y', 'z'}}, {{'z', 'z', 'z'}}}};
 };
 
 TEST_F(locking_shard_format_test, tx) {
@@ -90,3 +88,56 @@ TEST_F(locking_shard_format_test, discard_response) {
     ASSERT_TRUE(m_deser >> deser_req);
     ASSERT_EQ(req, deser_req);
 }
+
+TEST_F(locking_shard_format_test, batch_status_request) {
+    auto req = cbdc::locking_shard::rpc::status_request();
+    req = cbdc::locking_shard::rpc::batch_status_request{{{'a'}, {'b'}},
+                                                         {{'c'}}};
+    ASSERT_TRUE(m_ser << req);
+
+    auto deser_req = cbdc::locking_shard::rpc::status_request();
+    ASSERT_TRUE(m_deser >> deser_req);
+    ASSERT_TRUE(std::holds_alternative<
+                cbdc::locking_shard::rpc::batch_status_request>(deser_req));
+    const auto& batch
+        = std::get<cbdc::locking_shard::rpc::batch_status_request>(deser_req);
+    ASSERT_EQ(batch.m_uhs_ids,
+              (std::vector<cbdc::hash_t>{{'a'}, {'b'}}));
+    ASSERT_EQ(batch.m_tx_ids, std::vector<cbdc::hash_t>{{'c'}});
+}
+
+TEST_F(locking_shard_format_test, batch_status_response) {
+    auto resp = cbdc::locking_shard::rpc::status_response();
+    resp = cbdc::locking_shard::rpc::batch_status_response{
+        5,
+        cbdc::locking_shard::batch_status{{true, false}, {false}}};
+    ASSERT_TRUE(m_ser << resp);
+
+    auto deser_resp = cbdc::locking_shard::rpc::status_response();
+    ASSERT_TRUE(m_deser >> deser_resp);
+    ASSERT_TRUE(std::holds_alternative<
+                cbdc::locking_shard::rpc::batch_status_response>(deser_resp));
+    const auto& batch
+        = std::get<cbdc::locking_shard::rpc::batch_status_response>(
+            deser_resp);
+    ASSERT_EQ(batch.m_applied_idx, 5UL);
+    ASSERT_TRUE(batch.m_status.has_value());
+    ASSERT_EQ(batch.m_status->m_unspent, (std::vector<bool>{true, false}));
+    ASSERT_EQ(batch.m_status->m_confirmed, std::vector<bool>{false});
+}
+
+TEST_F(locking_shard_format_test, stale_batch_status_response) {
+    auto resp = cbdc::locking_shard::rpc::status_response();
+    resp = cbdc::locking_shard::rpc::batch_status_response{3, std::nullopt};
+    ASSERT_TRUE(m_ser << resp);
+
+    auto deser_resp = cbdc::locking_shard::rpc::status_response();
+    ASSERT_TRUE(m_deser >> deser_resp);
+    ASSERT_TRUE(std::holds_alternative<
+                cbdc::locking_shard::rpc::batch_status_response>(deser_resp));
+    const auto& batch
+        = std::get<cbdc::locking_shard::rpc::batch_status_response>(
+            deser_resp);
+    ASSERT_EQ(batch.m_applied_idx, 3UL);
+    ASSERT_FALSE(batch.m_status.has_value());
+}
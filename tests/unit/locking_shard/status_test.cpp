@@ -0,0 +1,307 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/twophase/locking_shard/format.hpp"
+#include "uhs/twophase/locking_shard/status_client.hpp"
+#include "uhs/twophase/locking_shard/status_server.hpp"
+#include "util/rpc/format.hpp"
+#include "util/rpc/tcp_server.hpp"
+#include "util/serialization/format.hpp"
+
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace {
+    /// Shard state which reports UHS IDs with an even first byte as either
+    /// unspent or spent, and the others the opposite way. Counts the
+    /// queries it serves.
+    class test_status : public cbdc::locking_shard::status_interface {
+      public:
+        test_status(bool unspent, std::chrono::milliseconds delay)
+            : m_unspent(unspent),
+              m_delay(delay) {}
+
+        [[nodiscard]] auto check_unspent(const cbdc::hash_t& uhs_id)
+            -> std::optional<bool> override {
+            m_served++;
+            return unspent(uhs_id);
+        }
+
+        [[nodiscard]] auto check_tx_id(const cbdc::hash_t& /* tx_id */)
+            -> std::optional<bool> override {
+            m_served++;
+            return false;
+        }
+
+        [[nodiscard]] auto
+        check_status(const std::vector<cbdc::hash_t>& uhs_ids,
+                     const std::vector<cbdc::hash_t>& tx_ids)
+            -> std::optional<cbdc::locking_shard::batch_status> override {
+            m_served++;
+            std::this_thread::sleep_for(m_delay);
+            auto res = cbdc::locking_shard::batch_status();
+            for(const auto& id : uhs_ids) {
+                res.m_unspent.push_back(unspent(id));
+            }
+            res.m_confirmed.assign(tx_ids.size(), false);
+            return res;
+        }
+
+        [[nodiscard]] auto served() const -> size_t {
+            return m_served;
+        }
+
+      private:
+        bool m_unspent;
+        std::chrono::milliseconds m_delay;
+        std::atomic<size_t> m_served{};
+
+        [[nodiscard]] auto unspent(const cbdc::hash_t& id) const -> bool {
+            return m_unspent == (id[0] % 2 == 0);
+        }
+    };
+
+    /// Status server for one replica of a shard cluster, with an applied
+    /// log index the test can change. An empty index marks the replica as
+    /// too far behind, or without a leader, to serve requests.
+    class test_replica {
+      public:
+        test_replica(const cbdc::network::endpoint_t& ep,
+                     bool unspent,
+                     std::optional<uint64_t> applied_idx,
+                     std::chrono::milliseconds delay)
+            : m_ep(ep),
+              m_state(std::make_shared<test_status>(unspent, delay)),
+              m_applied_idx(applied_idx) {}
+
+        auto init() -> bool {
+            auto srv = std::make_unique<cbdc::rpc::blocking_tcp_server<
+                cbdc::locking_shard::rpc::status_request,
+                cbdc::locking_shard::rpc::status_response>>(m_ep);
+            if(!srv->init()) {
+                return false;
+            }
+            m_srv = std::make_unique<cbdc::locking_shard::rpc::status_server>(
+                m_state,
+                std::move(srv),
+                [&]() {
+                    std::unique_lock l(m_mut);
+                    return m_applied_idx;
+                });
+            return true;
+        }
+
+        void set_applied_idx(std::optional<uint64_t> idx) {
+            std::unique_lock l(m_mut);
+            m_applied_idx = idx;
+        }
+
+        [[nodiscard]] auto served() const -> size_t {
+            return m_state->served();
+        }
+
+      private:
+        cbdc::network::endpoint_t m_ep;
+        std::shared_ptr<test_status> m_state;
+        std::mutex m_mut;
+        std::optional<uint64_t> m_applied_idx;
+        std::unique_ptr<cbdc::locking_shard::rpc::status_server> m_srv;
+    };
+}
+
+class status_test : public ::testing::Test {
+  protected:
+    static constexpr uint16_t m_base_port = 55600;
+    static constexpr auto m_timeout = std::chrono::seconds(1);
+    static constexpr uint64_t m_max_lag = 5;
+
+    void add_replica(bool unspent,
+                     std::optional<uint64_t> applied_idx,
+                     std::chrono::milliseconds delay
+                     = std::chrono::milliseconds::zero()) {
+        auto ep = next_endpoint();
+        m_replicas.emplace_back(
+            std::make_unique<test_replica>(ep, unspent, applied_idx, delay));
+        ASSERT_TRUE(m_replicas.back()->init());
+    }
+
+    /// Adds an endpoint to the cluster with nothing listening on it.
+    void add_unreachable() {
+        next_endpoint();
+    }
+
+    void make_client() {
+        m_client = std::make_unique<cbdc::locking_shard::rpc::status_client>(
+            std::vector<std::vector<cbdc::network::endpoint_t>>{m_endpoints},
+            std::vector<cbdc::config::shard_range_t>{{0, 255}},
+            m_timeout,
+            m_max_lag);
+        ASSERT_TRUE(m_client->init());
+    }
+
+    std::vector<cbdc::network::endpoint_t> m_endpoints;
+    std::vector<std::unique_ptr<test_replica>> m_replicas;
+    std::unique_ptr<cbdc::locking_shard::rpc::status_client> m_client;
+
+  private:
+    auto next_endpoint() -> cbdc::network::endpoint_t {
+        auto ep = cbdc::network::endpoint_t{
+            cbdc::network::localhost,
+            static_cast<uint16_t>(m_base_port + m_endpoints.size())};
+        m_endpoints.push_back(ep);
+        return ep;
+    }
+};
+
+TEST_F(status_test, replica_refuses_when_behind) {
+    add_replica(true, std::nullopt);
+    auto client = cbdc::rpc::tcp_client<
+        cbdc::locking_shard::rpc::status_request,
+        cbdc::locking_shard::rpc::status_response>({m_endpoints[0]});
+    ASSERT_TRUE(client.init());
+
+    // A replica without a leader, or too far behind, answers batch
+    // requests without a status and doesn't answer single requests
+    auto res = client.call(cbdc::locking_shard::rpc::batch_status_request{
+                               {cbdc::hash_t{}},
+                               {}},
+                           m_timeout);
+    ASSERT_TRUE(res.has_value());
+    auto* batch = std::get_if<cbdc::locking_shard::rpc::batch_status_response>(
+        &res.value());
+    ASSERT_NE(batch, nullptr);
+    ASSERT_FALSE(batch->m_status.has_value());
+    res = client.call(cbdc::locking_shard::rpc::uhs_status_request{},
+                      m_timeout);
+    ASSERT_FALSE(res.has_value());
+    ASSERT_EQ(m_replicas[0]->served(), 0UL);
+
+    // Once caught up the replica serves requests and reports its index
+    m_replicas[0]->set_applied_idx(7);
+    res = client.call(cbdc::locking_shard::rpc::batch_status_request{
+                          {cbdc::hash_t{}},
+                          {}},
+                      m_timeout);
+    ASSERT_TRUE(res.has_value());
+    batch = std::get_if<cbdc::locking_shard::rpc::batch_status_response>(
+        &res.value());
+    ASSERT_NE(batch, nullptr);
+    ASSERT_EQ(batch->m_applied_idx, 7UL);
+    ASSERT_TRUE(batch->m_status.has_value());
+    ASSERT_EQ(batch->m_status->m_unspent, std::vector<bool>{true});
+    ASSERT_EQ(m_replicas[0]->served(), 1UL);
+
+    // The status client fails rather than accept the refusal as an answer
+    m_replicas[0]->set_applied_idx(std::nullopt);
+    make_client();
+    ASSERT_FALSE(m_client->check_unspent(cbdc::hash_t{}).has_value());
+    ASSERT_FALSE(
+        m_client->check_status({cbdc::hash_t{}}, {}).has_value());
+}
+
+TEST_F(status_test, rotate_replicas) {
+    static constexpr size_t n_replicas = 3;
+    static constexpr size_t n_rounds = 4;
+    for(size_t i = 0; i < n_replicas; i++) {
+        add_replica(true, 10);
+    }
+    make_client();
+
+    // Requests are spread evenly across the replicas
+    for(size_t i = 0; i < n_replicas * n_rounds; i++) {
+        auto res = m_client->check_unspent(cbdc::hash_t{});
+        ASSERT_TRUE(res.has_value());
+        ASSERT_TRUE(res.value());
+    }
+    for(auto& r : m_replicas) {
+        ASSERT_EQ(r->served(), n_rounds);
+    }
+}
+
+TEST_F(status_test, fail_over) {
+    static constexpr size_t n_requests = 6;
+    add_replica(false, std::nullopt);
+    add_unreachable();
+    add_replica(true, 10);
+    make_client();
+
+    // Every request reaches the one replica able to serve it, whichever
+    // replica it is sent to first
+    for(size_t i = 0; i < n_requests; i++) {
+        auto res = m_client->check_unspent(cbdc::hash_t{});
+        ASSERT_TRUE(res.has_value());
+        ASSERT_TRUE(res.value());
+        auto status = m_client->check_status({cbdc::hash_t{}}, {});
+        ASSERT_TRUE(status.has_value());
+        ASSERT_EQ(status->m_unspent, std::vector<bool>{true});
+    }
+    ASSERT_EQ(m_replicas[0]->served(), 0UL);
+    ASSERT_EQ(m_replicas[1]->served(), n_requests * 2);
+}
+
+TEST_F(status_test, discard_stale_responses) {
+    // The lagging replica answers spent, the up-to-date one unspent
+    add_replica(true, 100);
+    add_replica(false, 100 - m_max_lag - 1);
+    make_client();
+
+    // Once the client has heard from the up-to-date replica, answers from
+    // the lagging one are discarded and the request fails over
+    for(size_t i = 0; i < 4; i++) {
+        auto res = m_client->check_unspent(cbdc::hash_t{});
+        ASSERT_TRUE(res.has_value());
+        ASSERT_TRUE(res.value());
+    }
+    ASSERT_GT(m_replicas[1]->served(), 0UL);
+    for(size_t i = 0; i < 4; i++) {
+        auto res = m_client->check_tx_ids({cbdc::hash_t{}});
+        ASSERT_EQ(res.size(), 1UL);
+        ASSERT_TRUE(res[0].has_value());
+        auto status = m_client->check_status({cbdc::hash_t{}}, {});
+        ASSERT_TRUE(status.has_value());
+        ASSERT_EQ(status->m_unspent, std::vector<bool>{true});
+    }
+
+    // Answers within the allowed lag are accepted
+    m_replicas[1]->set_applied_idx(100 - m_max_lag);
+    auto seen_spent = false;
+    for(size_t i = 0; i < 4; i++) {
+        auto res = m_client->check_unspent(cbdc::hash_t{});
+        ASSERT_TRUE(res.has_value());
+        seen_spent = seen_spent || !res.value();
+    }
+    ASSERT_TRUE(seen_spent);
+}
+
+TEST_F(status_test, coalesce_concurrent_lookups) {
+    static constexpr size_t n_threads = 16;
+    static constexpr size_t n_lookups = 20;
+    add_replica(true, 10, std::chrono::milliseconds(2));
+    make_client();
+
+    // Threads looking up IDs on the same shard at once share batch
+    // requests, but each gets the answer for its own ID
+    auto failures = std::atomic<size_t>();
+    auto threads = std::vector<std::thread>();
+    for(size_t t = 0; t < n_threads; t++) {
+        threads.emplace_back([&, t]() {
+            for(size_t i = 0; i < n_lookups; i++) {
+                auto id = cbdc::hash_t{};
+                id[0] = static_cast<unsigned char>(t + i);
+                id[1] = static_cast<unsigned char>(t);
+                auto res = m_client->check_unspent(id);
+                if(!res.has_value() || res.value() != (id[0] % 2 == 0)) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(failures, 0UL);
+    ASSERT_GT(m_replicas[0]->served(), 0UL);
+    ASSERT_LT(m_replicas[0]->served(), n_threads * n_lookups);
+}
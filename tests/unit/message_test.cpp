@@ -400,6 +400,52 @@ TEST_F(PacketIOTest, SentinelResponsePendingTest) {
     ASSERT_EQ(resp, resp_deser);
 }
 
+TEST_F(PacketIOTest, sentinel_validate_batch_request) {
+    auto tx0 = cbdc::transaction::full_tx();
+    tx0.m_inputs.emplace_back().m_prevout = {{'a', 'b', 'c'}, 1};
+    tx0.m_outputs.push_back({{'d', 'e', 'f'}, 100});
+    tx0.m_witness.emplace_back(64, std::byte(1));
+    auto tx1 = tx0;
+    tx1.m_outputs.front().m_value = 50;
+
+    auto req = cbdc::sentinel::validate_batch_request{{tx0, tx1}};
+    m_ser << req;
+    auto req_deser = cbdc::sentinel::validate_batch_request{};
+    ASSERT_TRUE(m_deser >> req_deser);
+    ASSERT_EQ(req.m_txs, req_deser.m_txs);
+    ASSERT_TRUE(m_deser.end_of_buffer());
+}
+
+TEST_F(PacketIOTest, sentinel_validate_batch_response) {
+    // Invalid transactions leave a gap so each attestation stays at the
+    // same index as its transaction
+    auto att = cbdc::sentinel::validate_response{{'k', 'e', 'y'},
+                                                 {'s', 'i', 'g'}};
+    auto resp
+        = cbdc::sentinel::validate_batch_response{{att, std::nullopt, att}};
+    m_ser << resp;
+    auto resp_deser = cbdc::sentinel::validate_batch_response{};
+    ASSERT_TRUE(m_deser >> resp_deser);
+    ASSERT_EQ(resp.m_attestations, resp_deser.m_attestations);
+    ASSERT_TRUE(m_deser.end_of_buffer());
+
+    // A batch response survives the round trip as a sentinel RPC response
+    m_target_packet.clear();
+    m_ser.reset();
+    m_deser.reset();
+    auto var = cbdc::sentinel::response{resp};
+    m_ser << var;
+    auto var_deser = cbdc::sentinel::response{};
+    ASSERT_TRUE(m_deser >> var_deser);
+    ASSERT_TRUE(
+        std::holds_alternative<cbdc::sentinel::validate_batch_response>(
+            var_deser));
+    ASSERT_EQ(
+        std::get<cbdc::sentinel::validate_batch_response>(var_deser)
+            .m_attestations,
+        resp.m_attestations);
+}
+
 TEST_F(PacketIOTest, empty_optional_test) {
     auto opt = std::optional<cbdc::atomizer::block>();
     m_ser << opt;
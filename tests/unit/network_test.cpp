@@ -106,3 +106,54 @@ TEST_F(NetworkTest, reset_net) {
     m_blocking_net->close();
     listener.join();
 }
+
+TEST_F(NetworkTest, handshake_on_reconnect) {
+    static constexpr auto listen_port = 30001;
+    ASSERT_TRUE(m_blocking_net->listen(cbdc::network::localhost, listen_port));
+    auto listener = m_blocking_net->start_server_listener();
+
+    auto recv = [&](size_t n) {
+        auto ret = std::vector<cbdc::buffer>();
+        while(ret.size() < n) {
+            for(auto& p : m_blocking_net->handle_messages()) {
+                if(p.m_pkt) {
+                    ret.emplace_back(*p.m_pkt);
+                }
+            }
+        }
+        return ret;
+    };
+
+    auto handshake = std::make_shared<cbdc::buffer>();
+    handshake->append("hello", 5);
+    auto pkt = std::make_shared<cbdc::buffer>();
+    pkt->append("data", 4);
+
+    auto client_net = cbdc::network::connection_manager();
+    client_net.set_handshake(handshake);
+    ASSERT_TRUE(client_net.cluster_connect(
+        {{cbdc::network::localhost, listen_port}}));
+    client_net.broadcast(pkt);
+
+    // The handshake arrives before any other packet
+    auto pkts = recv(2);
+    ASSERT_EQ(pkts.size(), 2UL);
+    ASSERT_EQ(pkts[0], *handshake);
+    ASSERT_EQ(pkts[1], *pkt);
+
+    // Restart the server, dropping the connection. The client sends the
+    // handshake again once it reconnects.
+    m_blocking_net->close();
+    listener.join();
+    m_blocking_net->reset();
+    ASSERT_TRUE(m_blocking_net->listen(cbdc::network::localhost, listen_port));
+    listener = m_blocking_net->start_server_listener();
+
+    pkts = recv(1);
+    ASSERT_EQ(pkts.size(), 1UL);
+    ASSERT_EQ(pkts[0], *handshake);
+
+    m_blocking_net->close();
+    client_net.close();
+    listener.join();
+}
@@ -0,0 +1,391 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "../util.hpp"
+#include "parsec/agent/speculative_batch.hpp"
+#include "parsec/broker/impl.hpp"
+#include "parsec/directory/impl.hpp"
+#include "parsec/runtime_locking_shard/impl.hpp"
+#include "parsec/ticket_machine/impl.hpp"
+
+#include <condition_variable>
+#include <cstring>
+#include <future>
+#include <gtest/gtest.h>
+
+namespace {
+    auto make_key(const std::string& name) -> cbdc::buffer {
+        auto key = cbdc::buffer();
+        key.append(name.data(), name.size());
+        return key;
+    }
+
+    auto to_u64(const cbdc::buffer& buf) -> uint64_t {
+        uint64_t ret{};
+        if(buf.size() == sizeof(ret)) {
+            std::memcpy(&ret, buf.data(), sizeof(ret));
+        }
+        return ret;
+    }
+
+    auto from_u64(uint64_t val) -> cbdc::buffer {
+        auto buf = cbdc::buffer();
+        buf.append(&val, sizeof(val));
+        return buf;
+    }
+
+    /// Called by counter_runner after reading the counter and before
+    /// reporting its result, if set.
+    std::function<void()> after_read_hook;
+
+    /// Runner which increments a shared counter and records the value it
+    /// wrote under the key given as its parameter. Fails without writing
+    /// anything if the parameter is "fail".
+    class counter_runner : public cbdc::parsec::agent::runner::interface {
+      public:
+        counter_runner(
+            std::shared_ptr<cbdc::logging::log> logger,
+            const cbdc::parsec::config& cfg,
+            cbdc::parsec::runtime_locking_shard::value_type function,
+            cbdc::parsec::agent::parameter_type param,
+            bool is_readonly_run,
+            run_callback_type result_callback,
+            try_lock_callback_type try_lock_callback,
+            std::shared_ptr<secp256k1_context> secp,
+            std::shared_ptr<cbdc::thread_pool> t_pool,
+            ticket_number_type ticket_number)
+            : interface(std::move(logger),
+                        cfg,
+                        std::move(function),
+                        param,
+                        is_readonly_run,
+                        result_callback,
+                        try_lock_callback,
+                        std::move(secp),
+                        t_pool,
+                        ticket_number),
+              m_out_key(std::move(param)),
+              m_run_callback(std::move(result_callback)),
+              m_lock_callback(std::move(try_lock_callback)),
+              m_pool(std::move(t_pool)) {}
+
+        auto run() -> bool override {
+            m_pool->push([this]() {
+                auto res = m_lock_callback(
+                    counter_key(),
+                    cbdc::parsec::broker::lock_type::write,
+                    [this](const cbdc::parsec::broker::interface::
+                               try_lock_return_type& lock_res) {
+                        if(!std::holds_alternative<cbdc::buffer>(lock_res)) {
+                            m_run_callback(error_code::lock_error);
+                            return;
+                        }
+                        // Finish on another task so the hook doesn't block
+                        // the broker's callback
+                        m_pool->push([this,
+                                      value = std::get<cbdc::buffer>(
+                                          lock_res)]() {
+                            finish(value);
+                        });
+                    });
+                if(!res) {
+                    m_run_callback(error_code::lock_error);
+                }
+            });
+            return true;
+        }
+
+        static auto counter_key() -> cbdc::buffer {
+            return make_key("counter");
+        }
+
+      private:
+        void finish(const cbdc::buffer& counter) {
+            if(after_read_hook) {
+                after_read_hook();
+            }
+            if(m_out_key == make_key("fail")) {
+                m_run_callback(error_code::exec_error);
+                return;
+            }
+            auto next = to_u64(counter) + 1;
+            auto updates = cbdc::parsec::broker::state_update_type();
+            updates[counter_key()] = from_u64(next);
+            updates[m_out_key] = from_u64(next);
+            m_run_callback(std::move(updates));
+        }
+
+
+        cbdc::buffer m_out_key;
+        run_callback_type m_run_callback;
+        try_lock_callback_type m_lock_callback;
+        std::shared_ptr<cbdc::thread_pool> m_pool;
+    };
+}
+
+class speculative_batch_test : public ::testing::Test {
+  protected:
+    using results_type
+        = std::vector<cbdc::parsec::agent::interface::exec_return_type>;
+
+    /// Batch started by the test, with the results it reported.
+    struct batch_run {
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        bool m_done{false};
+        results_type m_results;
+        std::shared_ptr<cbdc::parsec::agent::speculative_batch> m_batch;
+
+        /// Waits for the batch to finish.
+        /// \return the results and number of executions of the batch.
+        auto wait() -> std::pair<results_type, size_t> {
+            std::unique_lock l(m_mut);
+            m_cv.wait(l, [&]() {
+                return m_done;
+            });
+            return {m_results, m_batch->execution_count()};
+        }
+    };
+
+    void SetUp() override {
+        cbdc::test::add_to_shard(m_broker, m_function, make_key("code"));
+        cbdc::test::add_to_shard(m_broker,
+                                 counter_runner::counter_key(),
+                                 from_u64(0));
+    }
+
+    void TearDown() override {
+        after_read_hook = nullptr;
+    }
+
+    /// Starts a batch of functions whose parameters are the given output
+    /// keys.
+    auto start_batch(const std::vector<std::string>& out_keys)
+        -> std::shared_ptr<batch_run> {
+        auto run = std::make_shared<batch_run>();
+        run->m_results = results_type(
+            out_keys.size(),
+            cbdc::parsec::agent::interface::error_code::retry);
+        auto txs = std::vector<
+            cbdc::parsec::agent::speculative_batch::tx_type>();
+        for(size_t i = 0; i < out_keys.size(); i++) {
+            txs.push_back(
+                {m_function,
+                 make_key(out_keys[i]),
+                 [run, i](
+                     cbdc::parsec::agent::interface::exec_return_type res) {
+                     std::unique_lock l(run->m_mut);
+                     run->m_results[i] = std::move(res);
+                 }});
+        }
+        run->m_batch
+            = std::make_shared<cbdc::parsec::agent::speculative_batch>(
+                m_log,
+                m_cfg,
+                &cbdc::parsec::agent::runner::factory<counter_runner>::create,
+                m_broker,
+                std::move(txs),
+                nullptr,
+                m_pool,
+                [run]() {
+                    {
+                        std::unique_lock l(run->m_mut);
+                        run->m_done = true;
+                    }
+                    run->m_cv.notify_all();
+                });
+        EXPECT_TRUE(run->m_batch->exec());
+        return run;
+    }
+
+    static auto out_keys(const std::string& prefix, size_t n)
+        -> std::vector<std::string> {
+        auto ret = std::vector<std::string>();
+        for(size_t i = 0; i < n; i++) {
+            ret.push_back(prefix + std::to_string(i));
+        }
+        return ret;
+    }
+
+    auto run_batch(size_t n_txs) -> std::pair<results_type, size_t> {
+        return start_batch(out_keys("out", n_txs))->wait();
+    }
+
+    /// Returns the value the function with the given result wrote under
+    /// the given output key, or std::nullopt if the function failed.
+    static auto output(
+        const cbdc::parsec::agent::interface::exec_return_type& res,
+        const std::string& out_key) -> std::optional<uint64_t> {
+        if(!std::holds_alternative<cbdc::parsec::agent::return_type>(res)) {
+            return std::nullopt;
+        }
+        auto updates = std::get<cbdc::parsec::agent::return_type>(res);
+        return to_u64(updates[make_key(out_key)]);
+    }
+
+    /// Returns the committed value of the counter.
+    auto counter() -> uint64_t {
+        auto [results, executions] = start_batch({"read"})->wait();
+        return output(results[0], "read").value() - 1;
+    }
+
+    std::shared_ptr<cbdc::logging::log> m_log{
+        std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::warn)};
+    cbdc::parsec::config m_cfg{};
+    std::shared_ptr<cbdc::parsec::runtime_locking_shard::impl> m_shard{
+        std::make_shared<cbdc::parsec::runtime_locking_shard::impl>(m_log)};
+    std::shared_ptr<cbdc::parsec::ticket_machine::impl> m_ticketer{
+        std::make_shared<cbdc::parsec::ticket_machine::impl>(m_log, 1)};
+    std::shared_ptr<cbdc::parsec::directory::impl> m_directory{
+        std::make_shared<cbdc::parsec::directory::impl>(1)};
+    std::shared_ptr<cbdc::parsec::broker::impl> m_broker{
+        std::make_shared<cbdc::parsec::broker::impl>(
+            0,
+            std::vector<std::shared_ptr<
+                cbdc::parsec::runtime_locking_shard::interface>>({m_shard}),
+            m_ticketer,
+            m_directory,
+            m_log)};
+    std::shared_ptr<cbdc::thread_pool> m_pool{
+        std::make_shared<cbdc::thread_pool>(4)};
+    cbdc::buffer m_function{make_key("function")};
+};
+
+TEST_F(speculative_batch_test, sequential_outcome_test) {
+    static constexpr size_t n_txs = 32;
+    auto [results, executions] = run_batch(n_txs);
+
+    // Every function conflicts on the counter, yet each observes the value
+    // it would have seen executing alone in batch order
+    for(size_t i = 0; i < n_txs; i++) {
+        ASSERT_TRUE(
+            std::holds_alternative<cbdc::parsec::agent::return_type>(
+                results[i]));
+        auto& updates
+            = std::get<cbdc::parsec::agent::return_type>(results[i]);
+        ASSERT_EQ(to_u64(updates[make_key("out" + std::to_string(i))]),
+                  i + 1);
+    }
+    ASSERT_GE(executions, n_txs);
+    ASSERT_LE(executions, n_txs * n_txs);
+
+    // The merged updates were committed
+    auto [next_results, next_executions] = run_batch(1);
+    ASSERT_EQ(next_executions, 1UL);
+    auto& updates
+        = std::get<cbdc::parsec::agent::return_type>(next_results[0]);
+    ASSERT_EQ(to_u64(updates[counter_runner::counter_key()]), n_txs + 1);
+}
+
+TEST_F(speculative_batch_test, failed_function_test) {
+    auto keys = std::vector<std::string>{"out0", "out1", "fail", "out3"};
+    auto [results, executions] = start_batch(keys)->wait();
+
+    // The failed function reports an error and writes nothing, so the
+    // functions after it see the counter as if it had not run
+    ASSERT_EQ(output(results[0], keys[0]), 1UL);
+    ASSERT_EQ(output(results[1], keys[1]), 2UL);
+    ASSERT_TRUE(std::holds_alternative<
+                cbdc::parsec::agent::interface::error_code>(results[2]));
+    ASSERT_EQ(std::get<cbdc::parsec::agent::interface::error_code>(results[2]),
+              cbdc::parsec::agent::interface::error_code::function_execution);
+    ASSERT_EQ(output(results[3], keys[3]), 3UL);
+    ASSERT_EQ(counter(), 3UL);
+}
+
+TEST_F(speculative_batch_test, concurrent_batches_test) {
+    static constexpr size_t n_txs = 8;
+    auto a_keys = out_keys("a", n_txs);
+    auto b_keys = out_keys("b", n_txs);
+    auto a = start_batch(a_keys);
+    auto b = start_batch(b_keys);
+    auto [a_results, a_executions] = a->wait();
+    auto [b_results, b_executions] = b->wait();
+
+    // The batches conflict on the counter under different tickets. The
+    // shards order them, so each batch sees all or none of the other's
+    // updates.
+    auto a_first = output(a_results[0], a_keys[0]);
+    auto b_first = output(b_results[0], b_keys[0]);
+    ASSERT_TRUE(a_first.has_value());
+    ASSERT_TRUE(b_first.has_value());
+    ASSERT_TRUE(a_first == 1UL || b_first == 1UL);
+    ASSERT_EQ(a_first.value() + b_first.value(), n_txs + 2);
+    for(size_t i = 0; i < n_txs; i++) {
+        ASSERT_EQ(output(a_results[i], a_keys[i]), a_first.value() + i);
+        ASSERT_EQ(output(b_results[i], b_keys[i]), b_first.value() + i);
+    }
+    ASSERT_EQ(counter(), n_txs * 2);
+}
+
+TEST_F(speculative_batch_test, wounded_batch_test) {
+    static constexpr size_t n_txs = 8;
+    static constexpr uint64_t other_value = 100;
+
+    // Begin a ticket before the batch so it is older than the batch's
+    // ticket and wounds it on conflict
+    auto begun = std::promise<
+        cbdc::parsec::broker::interface::ticketnum_or_errcode_type>();
+    ASSERT_TRUE(m_broker->begin([&](auto res) {
+        begun.set_value(res);
+    }));
+    using ticket_number_type
+        = cbdc::parsec::ticket_machine::ticket_number_type;
+    auto begin_res = begun.get_future().get();
+    ASSERT_TRUE(std::holds_alternative<ticket_number_type>(begin_res));
+    auto ticket_number = std::get<ticket_number_type>(begin_res);
+
+    // Hold the batch's first execution after it locks the counter
+    auto reached = std::promise<void>();
+    auto release = std::promise<void>();
+    auto released = release.get_future().share();
+    auto first = std::atomic_bool{true};
+    after_read_hook = [&]() {
+        if(first.exchange(false)) {
+            reached.set_value();
+            released.wait();
+        }
+    };
+    auto keys = out_keys("out", n_txs);
+    auto run = start_batch(keys);
+    reached.get_future().wait();
+
+    // The older ticket wounds the batch to take the counter and commits
+    // a new value while the batch's execution is held
+    auto locked = std::promise<
+        cbdc::parsec::broker::interface::try_lock_return_type>();
+    ASSERT_TRUE(m_broker->try_lock(ticket_number,
+                                   counter_runner::counter_key(),
+                                   cbdc::parsec::broker::lock_type::write,
+                                   [&](auto res) {
+                                       locked.set_value(res);
+                                   }));
+    ASSERT_TRUE(std::holds_alternative<cbdc::buffer>(
+        locked.get_future().get()));
+    auto updates = cbdc::parsec::broker::state_update_type();
+    updates[counter_runner::counter_key()] = from_u64(other_value);
+    auto committed
+        = std::promise<cbdc::parsec::broker::interface::commit_return_type>();
+    ASSERT_TRUE(m_broker->commit(ticket_number, updates, [&](auto res) {
+        committed.set_value(res);
+    }));
+    ASSERT_FALSE(committed.get_future().get().has_value());
+    auto finished
+        = std::promise<cbdc::parsec::broker::interface::finish_return_type>();
+    ASSERT_TRUE(m_broker->finish(ticket_number, [&](auto res) {
+        finished.set_value(res);
+    }));
+    ASSERT_FALSE(finished.get_future().get().has_value());
+    release.set_value();
+
+    // The batch rolls back and re-executes on top of the other ticket's
+    // update
+    auto [results, executions] = run->wait();
+    for(size_t i = 0; i < n_txs; i++) {
+        ASSERT_EQ(output(results[i], keys[i]), other_value + i + 1);
+    }
+    ASSERT_GT(executions, n_txs);
+    ASSERT_EQ(counter(), other_value + n_txs);
+}
@@ -44,3 +44,53 @@ TEST(broker_test, deploy_test) {
 
     cbdc::test::add_to_shard(broker, deploy_contract_key, deploy_contract);
 }
+
+TEST(broker_test, mapping_refresh_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    using shard_type = cbdc::parsec::runtime_locking_shard::impl;
+    auto shards = std::vector<std::shared_ptr<shard_type>>{
+        std::make_shared<shard_type>(log),
+        std::make_shared<shard_type>(log)};
+    auto ticketer
+        = std::make_shared<cbdc::parsec::ticket_machine::impl>(log, 1);
+    auto directory = std::make_shared<cbdc::parsec::directory::impl>(2);
+    auto broker = std::make_shared<cbdc::parsec::broker::impl>(
+        0,
+        std::vector<
+            std::shared_ptr<cbdc::parsec::runtime_locking_shard::interface>>(
+            shards.begin(),
+            shards.end()),
+        ticketer,
+        directory,
+        log);
+
+    auto key = cbdc::buffer::from_hex("aa").value();
+    auto hash = directory->key_hash(key);
+    auto range
+        = cbdc::parsec::directory::impl::hash_range_type{hash, hash};
+    auto src = directory->get_mapping()->shard_for(hash);
+    auto dst = (src + 1) % 2;
+
+    cbdc::test::add_to_shard(broker, key, cbdc::buffer::from_hex("01").value());
+
+    // Move the key once the broker has cached the mapping. The old shard
+    // turns away lock requests on the key, so the broker must notice the
+    // new mapping version to write the key again.
+    ASSERT_TRUE(directory->begin_migration(range, dst));
+    auto version = directory->run_migration(range,
+                                            shards,
+                                            std::chrono::seconds(1));
+    ASSERT_TRUE(version.has_value());
+    ASSERT_EQ(directory->mapping_version(), version.value());
+
+    auto value = cbdc::buffer::from_hex("02").value();
+    cbdc::test::add_to_shard(broker, key, value);
+
+    auto moved = shards[dst]->export_range(range);
+    ASSERT_TRUE(moved.has_value());
+    ASSERT_EQ(moved->at(key), value);
+    auto old = shards[src]->export_range(range);
+    ASSERT_TRUE(old.has_value());
+    ASSERT_TRUE(old->empty());
+}
@@ -0,0 +1,352 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parsec/directory/impl.hpp"
+
+#include <future>
+#include <gtest/gtest.h>
+#include <limits>
+
+namespace {
+    auto locate(cbdc::parsec::directory::impl& dir,
+                const cbdc::buffer& key) -> uint64_t {
+        auto ret = std::optional<uint64_t>();
+        auto res = dir.key_location(key, [&](uint64_t shard) {
+            ret = shard;
+        });
+        EXPECT_TRUE(res);
+        EXPECT_TRUE(ret.has_value());
+        return ret.value_or(0);
+    }
+
+    auto try_lock(cbdc::parsec::runtime_locking_shard::impl& shard,
+                  cbdc::parsec::runtime_locking_shard::ticket_number_type
+                      ticket_number,
+                  const cbdc::buffer& key,
+                  cbdc::parsec::runtime_locking_shard::lock_type locktype)
+        -> cbdc::parsec::runtime_locking_shard::interface::
+            try_lock_return_type {
+        auto ret = std::optional<cbdc::parsec::runtime_locking_shard::
+                                     interface::try_lock_return_type>();
+        auto res = shard.try_lock(ticket_number,
+                                  0,
+                                  key,
+                                  locktype,
+                                  true,
+                                  [&](auto r) {
+                                      ret = std::move(r);
+                                  });
+        EXPECT_TRUE(res);
+        EXPECT_TRUE(ret.has_value());
+        return ret.value();
+    }
+
+    auto is_wounded(const cbdc::parsec::runtime_locking_shard::interface::
+                        try_lock_return_type& res) -> bool {
+        return std::holds_alternative<
+                   cbdc::parsec::runtime_locking_shard::shard_error>(res)
+            && std::get<cbdc::parsec::runtime_locking_shard::shard_error>(res)
+                       .m_error_code
+                   == cbdc::parsec::runtime_locking_shard::error_code::wounded;
+    }
+
+    auto make_keys(size_t n) -> std::vector<cbdc::buffer> {
+        auto keys = std::vector<cbdc::buffer>();
+        for(size_t i = 0; i < n; i++) {
+            auto key = cbdc::buffer();
+            key.append(&i, sizeof(i));
+            keys.emplace_back(std::move(key));
+        }
+        return keys;
+    }
+}
+
+TEST(directory_test, distribution_test) {
+    static constexpr size_t n_shards = 4;
+    static constexpr size_t n_keys = 10000;
+    auto dir = cbdc::parsec::directory::impl(n_shards);
+    auto counts = std::vector<size_t>(n_shards);
+    for(auto& key : make_keys(n_keys)) {
+        auto shard = locate(dir, key);
+        ASSERT_LT(shard, n_shards);
+        counts[shard]++;
+    }
+    // Every shard should receive a reasonable share of the keys
+    for(auto count : counts) {
+        ASSERT_GT(count, n_keys / n_shards / 2);
+    }
+}
+
+TEST(directory_test, add_shard_test) {
+    static constexpr size_t n_shards = 4;
+    static constexpr size_t n_keys = 10000;
+    auto dir = cbdc::parsec::directory::impl(n_shards);
+    auto keys = make_keys(n_keys);
+    auto before = std::vector<uint64_t>();
+    for(auto& key : keys) {
+        before.push_back(locate(dir, key));
+    }
+
+    auto added = dir.add_shard();
+    ASSERT_TRUE(added.has_value());
+    auto [new_shard, migrations] = added.value();
+    ASSERT_EQ(new_shard, n_shards);
+    ASSERT_FALSE(migrations.empty());
+    ASSERT_EQ(dir.pending_migrations().size(), migrations.size());
+
+    // The mapping doesn't change until the migrations complete
+    for(size_t i = 0; i < keys.size(); i++) {
+        ASSERT_EQ(locate(dir, keys[i]), before[i]);
+    }
+
+    auto version = dir.get_mapping()->m_version;
+    for(auto& m : migrations) {
+        ASSERT_EQ(m.m_destination, new_shard);
+        auto new_version = dir.complete_migration(m.m_range);
+        ASSERT_TRUE(new_version.has_value());
+        ASSERT_GT(new_version.value(), version);
+        version = new_version.value();
+    }
+    ASSERT_TRUE(dir.pending_migrations().empty());
+
+    // Keys only ever move to the new shard, and only a fraction move
+    size_t moved{};
+    for(size_t i = 0; i < keys.size(); i++) {
+        auto shard = locate(dir, keys[i]);
+        if(shard != before[i]) {
+            ASSERT_EQ(shard, new_shard);
+            moved++;
+        }
+    }
+    ASSERT_GT(moved, 0UL);
+    ASSERT_LT(moved, n_keys / 2);
+}
+
+TEST(directory_test, migrate_key_test) {
+    auto dir = cbdc::parsec::directory::impl(2);
+    auto key = cbdc::buffer::from_hex("aa").value();
+    auto src = locate(dir, key);
+    auto dst = (src + 1) % 2;
+
+    auto hash = dir.key_hash(key);
+    auto range = cbdc::parsec::directory::impl::hash_range_type{hash, hash};
+    ASSERT_FALSE(dir.begin_migration(range, 2));
+    ASSERT_TRUE(dir.begin_migration(range, dst));
+    ASSERT_FALSE(dir.begin_migration({0, hash}, dst));
+    ASSERT_EQ(locate(dir, key), src);
+
+    auto snapshot = dir.get_mapping();
+    ASSERT_TRUE(dir.complete_migration(range).has_value());
+    ASSERT_EQ(locate(dir, key), dst);
+    ASSERT_FALSE(dir.complete_migration(range).has_value());
+
+    // Cached snapshots are unaffected by later changes
+    ASSERT_EQ(snapshot->shard_for(hash), src);
+    ASSERT_LT(snapshot->m_version, dir.get_mapping()->m_version);
+
+    // Neighbouring hashes keep their owners
+    if(hash > 0) {
+        ASSERT_EQ(dir.get_mapping()->shard_for(hash - 1),
+                  snapshot->shard_for(hash - 1));
+    }
+    if(hash < std::numeric_limits<uint64_t>::max()) {
+        ASSERT_EQ(dir.get_mapping()->shard_for(hash + 1),
+                  snapshot->shard_for(hash + 1));
+    }
+}
+
+TEST(directory_test, abort_migration_test) {
+    auto dir = cbdc::parsec::directory::impl(2);
+    auto range = cbdc::parsec::directory::impl::hash_range_type{
+        0,
+        std::numeric_limits<uint64_t>::max()};
+    ASSERT_TRUE(dir.begin_migration(range, 1));
+    ASSERT_TRUE(dir.abort_migration(range));
+    ASSERT_FALSE(dir.abort_migration(range));
+    ASSERT_FALSE(dir.complete_migration(range).has_value());
+    ASSERT_EQ(dir.get_mapping()->m_version, 0UL);
+
+    ASSERT_TRUE(dir.begin_migration(range, 1));
+    ASSERT_TRUE(dir.complete_migration(range).has_value());
+    ASSERT_EQ(dir.get_mapping()->m_ring.size(), 1UL);
+    for(auto& key : make_keys(100)) {
+        ASSERT_EQ(locate(dir, key), 1UL);
+    }
+}
+
+TEST(directory_test, add_shard_matches_ring_test) {
+    static constexpr size_t n_vnodes = 4;
+    static constexpr size_t max_shards = 16;
+    static constexpr auto max_hash = std::numeric_limits<uint64_t>::max();
+    auto keys = make_keys(1000);
+    auto wrapped = false;
+    for(auto compact : {false, true}) {
+        for(size_t n_shards = 1; n_shards < max_shards; n_shards++) {
+            // Adding a shard and completing its migrations gives the same
+            // mapping as building the ring with the extra shard from scratch
+            auto dir = cbdc::parsec::directory::impl(n_shards, n_vnodes);
+            if(compact) {
+                // Completing any migration merges adjacent arcs with the
+                // same owner, so the ring no longer holds every virtual node
+                auto owner = dir.get_mapping()->shard_for(0);
+                ASSERT_TRUE(dir.begin_migration({0, 0}, owner));
+                ASSERT_TRUE(dir.complete_migration({0, 0}).has_value());
+            }
+            auto added = dir.add_shard();
+            ASSERT_TRUE(added.has_value());
+            for(auto& m : added->second) {
+                ASSERT_TRUE(dir.complete_migration(m.m_range).has_value());
+            }
+            auto expected
+                = cbdc::parsec::directory::impl(n_shards + 1, n_vnodes);
+            auto mapping = dir.get_mapping();
+            auto expected_mapping = expected.get_mapping();
+            if(expected_mapping->m_ring.begin()->second == n_shards) {
+                wrapped = true;
+            }
+
+            ASSERT_EQ(mapping->shard_for(0), expected_mapping->shard_for(0));
+            ASSERT_EQ(mapping->shard_for(max_hash),
+                      expected_mapping->shard_for(max_hash));
+            for(const auto& [token, owner] : expected_mapping->m_ring) {
+                ASSERT_EQ(mapping->shard_for(token), owner);
+                if(token < max_hash) {
+                    ASSERT_EQ(mapping->shard_for(token + 1),
+                              expected_mapping->shard_for(token + 1));
+                }
+            }
+            for(auto& key : keys) {
+                ASSERT_EQ(locate(dir, key), locate(expected, key));
+            }
+        }
+    }
+    // At least one case gave the new shard the first token, and so the arc
+    // which wraps around the end of the ring
+    ASSERT_TRUE(wrapped);
+}
+
+TEST(directory_test, add_shard_overlap_test) {
+    auto dir = cbdc::parsec::directory::impl(2);
+    auto range = cbdc::parsec::directory::impl::hash_range_type{
+        0,
+        std::numeric_limits<uint64_t>::max()};
+    ASSERT_TRUE(dir.begin_migration(range, 1));
+
+    // The new shard's arcs overlap the pending migration, so the shard is
+    // not added
+    ASSERT_FALSE(dir.add_shard().has_value());
+    ASSERT_EQ(dir.pending_migrations().size(), 1UL);
+    ASSERT_FALSE(dir.begin_migration({0, 0}, 2));
+
+    ASSERT_TRUE(dir.abort_migration(range));
+    auto added = dir.add_shard();
+    ASSERT_TRUE(added.has_value());
+    ASSERT_EQ(added->first, 2UL);
+    ASSERT_EQ(dir.pending_migrations().size(), added->second.size());
+}
+
+TEST(directory_test, run_migration_test) {
+    using cbdc::parsec::runtime_locking_shard::lock_type;
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    using shard_type = cbdc::parsec::runtime_locking_shard::impl;
+    auto shards = std::vector<std::shared_ptr<shard_type>>{
+        std::make_shared<shard_type>(log),
+        std::make_shared<shard_type>(log)};
+    auto dir = cbdc::parsec::directory::impl(1, 4);
+    auto keys = make_keys(1000);
+    auto state = cbdc::parsec::runtime_locking_shard::replicated_shard::
+        state_type();
+    for(auto& key : keys) {
+        state.emplace(key, key);
+    }
+    ASSERT_TRUE(shards[0]->recover(state, {}));
+
+    // Find a range moving to the new shard with at least two of the keys
+    auto added = dir.add_shard();
+    ASSERT_TRUE(added.has_value());
+    auto range
+        = std::optional<cbdc::parsec::directory::impl::hash_range_type>();
+    auto in_range = std::vector<cbdc::buffer>();
+    for(auto& m : added->second) {
+        in_range.clear();
+        for(auto& key : keys) {
+            if(m.m_range.contains(dir.key_hash(key))) {
+                in_range.push_back(key);
+            }
+        }
+        if(in_range.size() >= 2) {
+            range = m.m_range;
+            break;
+        }
+    }
+    ASSERT_TRUE(range.has_value());
+    const auto& locked = in_range[0];
+    const auto& probe = in_range[1];
+
+    // An in-flight ticket holds a lock in the range, so the migration times
+    // out, is aborted and lifts the fence
+    ASSERT_FALSE(is_wounded(try_lock(*shards[0], 1, locked, lock_type::write)));
+    ASSERT_FALSE(dir.run_migration(range.value(),
+                                   shards,
+                                   std::chrono::milliseconds(10))
+                     .has_value());
+    ASSERT_EQ(dir.pending_migrations().size(), added->second.size() - 1);
+    ASSERT_FALSE(is_wounded(try_lock(*shards[0], 2, probe, lock_type::read)));
+    shards[0]->rollback(2, [](auto res) {
+        ASSERT_FALSE(res.has_value());
+    });
+
+    ASSERT_TRUE(dir.begin_migration(range.value(), 1));
+    auto fut = std::async(std::launch::async, [&]() {
+        return dir.run_migration(range.value(),
+                                 shards,
+                                 std::chrono::seconds(10));
+    });
+
+    // Wait for the range to be fenced. New lock requests in the range are
+    // turned away while the keys still route to the old shard.
+    for(cbdc::parsec::runtime_locking_shard::ticket_number_type t = 3;; t++) {
+        auto res = try_lock(*shards[0], t, probe, lock_type::read);
+        shards[0]->rollback(t, [](auto rb) {
+            ASSERT_FALSE(rb.has_value());
+        });
+        if(is_wounded(res)) {
+            break;
+        }
+    }
+    ASSERT_EQ(fut.wait_for(std::chrono::milliseconds(10)),
+              std::future_status::timeout);
+    ASSERT_EQ(dir.get_mapping()->shard_for(dir.key_hash(locked)), 0UL);
+
+    // Committing the in-flight ticket lets the migration finish, carrying
+    // its update to the new shard
+    auto value = cbdc::buffer::from_hex("ff").value();
+    shards[0]->prepare(1, 0, {{locked, value}}, [](auto res) {
+        ASSERT_FALSE(res.has_value());
+    });
+    shards[0]->commit(1, [](auto res) {
+        ASSERT_FALSE(res.has_value());
+    });
+    ASSERT_EQ(fut.wait_for(std::chrono::seconds(10)),
+              std::future_status::ready);
+    auto version = fut.get();
+    ASSERT_TRUE(version.has_value());
+    ASSERT_EQ(dir.mapping_version(), version.value());
+    ASSERT_EQ(dir.get_mapping()->shard_for(dir.key_hash(locked)), 1UL);
+
+    auto moved = try_lock(*shards[1], 1000, locked, lock_type::read);
+    ASSERT_TRUE(std::holds_alternative<cbdc::buffer>(moved));
+    ASSERT_EQ(std::get<cbdc::buffer>(moved), value);
+    moved = try_lock(*shards[1], 1001, probe, lock_type::read);
+    ASSERT_TRUE(std::holds_alternative<cbdc::buffer>(moved));
+    ASSERT_EQ(std::get<cbdc::buffer>(moved), probe);
+
+    // Brokers with an outdated mapping are turned away by the old shard
+    ASSERT_TRUE(is_wounded(try_lock(*shards[0], 1002, probe, lock_type::read)));
+    auto old = shards[0]->export_range(range.value());
+    ASSERT_TRUE(old.has_value());
+    ASSERT_TRUE(old->empty());
+}
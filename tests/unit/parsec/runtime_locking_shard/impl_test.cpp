@@ -5,6 +5,7 @@
 
 #include "parsec/runtime_locking_shard/impl.hpp"
 
+#include <cstring>
 #include <future>
 #include <gtest/gtest.h>
 
@@ -723,3 +724,189 @@ TEST(runtime_locking_shard_test, upgrade_lock_test) {
         });
     ASSERT_TRUE(maybe_success);
 }
+
+TEST(runtime_locking_shard_test, concurrent_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shard = cbdc::parsec::runtime_locking_shard::impl(log);
+
+    static constexpr size_t n_threads = 8;
+    static constexpr size_t n_txs = 100;
+    auto next_ticket = std::atomic<uint64_t>();
+    auto hot_key = cbdc::buffer::from_hex("ff").value();
+
+    using try_lock_return_type = cbdc::parsec::runtime_locking_shard::
+        interface::try_lock_return_type;
+    using shard_error = cbdc::parsec::runtime_locking_shard::shard_error;
+
+    auto read_counter = [](const try_lock_return_type& ret) {
+        auto& val = std::get<cbdc::parsec::runtime_locking_shard::value_type>(
+            ret);
+        uint64_t n{};
+        if(val.size() == sizeof(n)) {
+            std::memcpy(&n, val.data(), sizeof(n));
+        }
+        return n;
+    };
+    auto make_counter = [](uint64_t n) {
+        auto val = cbdc::buffer();
+        val.append(&n, sizeof(n));
+        return val;
+    };
+
+    auto lock = [&](uint64_t ticket_number,
+                    const cbdc::buffer& key,
+                    bool first_lock) {
+        auto p = std::promise<try_lock_return_type>();
+        auto f = p.get_future();
+        shard.try_lock(ticket_number,
+                       0,
+                       key,
+                       cbdc::parsec::runtime_locking_shard::lock_type::write,
+                       first_lock,
+                       [&](try_lock_return_type ret) {
+                           p.set_value(std::move(ret));
+                       });
+        return f.get();
+    };
+
+    auto worker = [&](size_t id) {
+        auto own_key = cbdc::buffer();
+        own_key.append(&id, sizeof(id));
+        for(size_t i = 0; i < n_txs; i++) {
+            while(true) {
+                auto ticket_number = next_ticket++;
+                auto hot = lock(ticket_number, hot_key, true);
+                auto own = std::holds_alternative<shard_error>(hot)
+                             ? hot
+                             : lock(ticket_number, own_key, false);
+                auto err = std::optional<shard_error>();
+                if(std::holds_alternative<shard_error>(own)) {
+                    err = std::get<shard_error>(own);
+                } else {
+                    shard.prepare(
+                        ticket_number,
+                        0,
+                        {{hot_key, make_counter(read_counter(hot) + 1)},
+                         {own_key, make_counter(read_counter(own) + 1)}},
+                        [&](std::optional<shard_error> ret) {
+                            err = ret;
+                        });
+                }
+                if(err.has_value()) {
+                    ASSERT_EQ(
+                        err->m_error_code,
+                        cbdc::parsec::runtime_locking_shard::error_code::
+                            wounded);
+                    shard.rollback(ticket_number,
+                                   [](std::optional<shard_error> ret) {
+                                       ASSERT_FALSE(ret.has_value());
+                                   });
+                    continue;
+                }
+                shard.commit(ticket_number,
+                             [](std::optional<shard_error> ret) {
+                                 ASSERT_FALSE(ret.has_value());
+                             });
+                shard.finish(ticket_number,
+                             [](std::optional<shard_error> ret) {
+                                 ASSERT_FALSE(ret.has_value());
+                             });
+                break;
+            }
+        }
+    };
+
+    auto threads = std::vector<std::thread>();
+    for(size_t i = 0; i < n_threads; i++) {
+        threads.emplace_back(worker, i);
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+
+    auto ticket_number = next_ticket++;
+    auto hot = lock(ticket_number, hot_key, true);
+    ASSERT_EQ(read_counter(hot), n_threads * n_txs);
+    for(size_t i = 0; i < n_threads; i++) {
+        auto own_key = cbdc::buffer();
+        own_key.append(&i, sizeof(i));
+        auto own = lock(ticket_number, own_key, false);
+        ASSERT_EQ(read_counter(own), n_txs);
+    }
+}
+
+TEST(runtime_locking_shard_test, finish_race_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::fatal);
+    auto shard = cbdc::parsec::runtime_locking_shard::impl(log);
+
+    static constexpr size_t n_rounds = 200;
+    auto key = cbdc::buffer::from_hex("aa").value();
+    auto other_key = cbdc::buffer::from_hex("bb").value();
+
+    using try_lock_return_type = cbdc::parsec::runtime_locking_shard::
+        interface::try_lock_return_type;
+    using shard_error = cbdc::parsec::runtime_locking_shard::shard_error;
+    using cbdc::parsec::runtime_locking_shard::error_code;
+
+    for(uint64_t ticket_number = 0; ticket_number < n_rounds;
+        ticket_number++) {
+        auto locked = std::promise<try_lock_return_type>();
+        shard.try_lock(ticket_number,
+                       0,
+                       key,
+                       cbdc::parsec::runtime_locking_shard::lock_type::write,
+                       true,
+                       [&](try_lock_return_type ret) {
+                           locked.set_value(std::move(ret));
+                       });
+        ASSERT_FALSE(
+            std::holds_alternative<shard_error>(locked.get_future().get()));
+        shard.prepare(ticket_number,
+                      0,
+                      {{key, cbdc::buffer()}},
+                      [](std::optional<shard_error> ret) {
+                          ASSERT_FALSE(ret.has_value());
+                      });
+        shard.commit(ticket_number, [](std::optional<shard_error> ret) {
+            ASSERT_FALSE(ret.has_value());
+        });
+
+        // Racing finishes and lock requests for the finished ticket are
+        // refused, and the finished ticket's slot is only recycled once
+        // none of them use it
+        auto finished = std::atomic<size_t>();
+        auto finish = [&]() {
+            shard.finish(ticket_number, [&](std::optional<shard_error> ret) {
+                if(!ret.has_value()) {
+                    finished++;
+                    return;
+                }
+                ASSERT_EQ(ret->m_error_code, error_code::unknown_ticket);
+            });
+        };
+        auto late_lock = [&]() {
+            shard.try_lock(
+                ticket_number,
+                0,
+                other_key,
+                cbdc::parsec::runtime_locking_shard::lock_type::write,
+                false,
+                [&](try_lock_return_type ret) {
+                    ASSERT_TRUE(std::holds_alternative<shard_error>(ret));
+                    auto err = std::get<shard_error>(ret).m_error_code;
+                    ASSERT_TRUE(err == error_code::committed
+                                || err == error_code::unknown_ticket);
+                });
+        };
+        auto threads = std::vector<std::thread>();
+        threads.emplace_back(finish);
+        threads.emplace_back(finish);
+        threads.emplace_back(late_lock);
+        for(auto& t : threads) {
+            t.join();
+        }
+        ASSERT_EQ(finished, 1UL);
+    }
+}
@@ -0,0 +1,227 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parsec/ticket_machine/client.hpp"
+#include "util/rpc/format.hpp"
+#include "util/rpc/tcp_server.hpp"
+#include "util/serialization/format.hpp"
+
+#include <condition_variable>
+#include <gtest/gtest.h>
+#include <queue>
+
+namespace {
+    using cbdc::parsec::ticket_machine::ticket_number_type;
+    using ticket_interface = cbdc::parsec::ticket_machine::interface;
+    using request = cbdc::parsec::ticket_machine::rpc::request;
+    using response = cbdc::parsec::ticket_machine::rpc::response;
+
+    /// Ticket machine RPC server which holds each request until the test
+    /// responds to it.
+    class test_server {
+      public:
+        explicit test_server(const cbdc::network::endpoint_t& ep)
+            : m_srv(ep) {}
+
+        auto init() -> bool {
+            m_srv.register_handler_callback(
+                [&](const request& /* req */, callback_type cb) {
+                    {
+                        std::unique_lock l(m_mut);
+                        m_pending.push(std::move(cb));
+                        m_requests++;
+                    }
+                    m_cv.notify_all();
+                    return true;
+                });
+            return m_srv.init();
+        }
+
+        /// Waits until the server has received the given number of requests
+        /// in total.
+        auto wait_for_requests(size_t n) -> bool {
+            std::unique_lock l(m_mut);
+            return m_cv.wait_for(l, std::chrono::seconds(10), [&]() {
+                return m_requests >= n;
+            });
+        }
+
+        auto requests() -> size_t {
+            std::unique_lock l(m_mut);
+            return m_requests;
+        }
+
+        /// Responds to the oldest outstanding request.
+        void respond(std::optional<response> resp) {
+            auto cb = callback_type();
+            {
+                std::unique_lock l(m_mut);
+                ASSERT_FALSE(m_pending.empty());
+                cb = std::move(m_pending.front());
+                m_pending.pop();
+            }
+            cb(std::move(resp));
+        }
+
+      private:
+        using callback_type = std::function<void(std::optional<response>)>;
+
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        std::queue<callback_type> m_pending;
+        size_t m_requests{};
+        cbdc::rpc::async_tcp_server<request, response> m_srv;
+    };
+
+    /// Records the results of ticket number requests in the order they
+    /// complete.
+    class results {
+      public:
+        using return_type = ticket_interface::get_ticket_number_return_type;
+
+        auto callback() -> ticket_interface::get_ticket_number_callback_type {
+            return [&](return_type res) {
+                {
+                    std::unique_lock l(m_mut);
+                    m_results.emplace_back(res);
+                }
+                m_cv.notify_all();
+            };
+        }
+
+        auto wait_for(size_t n) -> bool {
+            std::unique_lock l(m_mut);
+            return m_cv.wait_for(l, std::chrono::seconds(10), [&]() {
+                return m_results.size() >= n;
+            });
+        }
+
+        auto get() -> std::vector<return_type> {
+            std::unique_lock l(m_mut);
+            return m_results;
+        }
+
+      private:
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        std::vector<return_type> m_results;
+    };
+
+    /// Returns the single ticket number granted by the given result.
+    auto ticket(const ticket_interface::get_ticket_number_return_type& res)
+        -> std::optional<ticket_number_type> {
+        const auto* range
+            = std::get_if<ticket_interface::ticket_number_range_type>(&res);
+        if(range == nullptr || range->first != range->second) {
+            return std::nullopt;
+        }
+        return range->first;
+    }
+}
+
+class ticket_machine_client_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        ASSERT_TRUE(m_server.init());
+        ASSERT_TRUE(m_client.init());
+    }
+
+    static constexpr unsigned short m_port{29900};
+    cbdc::network::endpoint_t m_ep{cbdc::network::localhost, m_port};
+    results m_results;
+    test_server m_server{m_ep};
+    cbdc::parsec::ticket_machine::rpc::client m_client{{m_ep}};
+};
+
+TEST_F(ticket_machine_client_test, prefetch_refill) {
+    static constexpr ticket_number_type range_size{1000};
+
+    ASSERT_TRUE(m_client.get_ticket_number(m_results.callback()));
+    ASSERT_TRUE(m_server.wait_for_requests(1));
+    m_server.respond(
+        ticket_interface::ticket_number_range_type{0, range_size});
+    ASSERT_TRUE(m_results.wait_for(1));
+
+    // Tickets are served locally until the active range runs low
+    for(ticket_number_type i = 1; i < range_size / 2; i++) {
+        ASSERT_TRUE(m_client.get_ticket_number(m_results.callback()));
+    }
+    ASSERT_EQ(m_server.requests(), 1UL);
+
+    // Crossing the threshold prefetches the next range without waiting for
+    // the active one to run out
+    ASSERT_TRUE(m_client.get_ticket_number(m_results.callback()));
+    ASSERT_TRUE(m_server.wait_for_requests(2));
+    m_server.respond(
+        ticket_interface::ticket_number_range_type{range_size,
+                                                   range_size * 2});
+
+    // The rest of the active range is handed out, followed by the
+    // prefetched range, without any further fetches
+    for(ticket_number_type i = range_size / 2 + 1; i <= range_size; i++) {
+        ASSERT_TRUE(m_client.get_ticket_number(m_results.callback()));
+    }
+    ASSERT_TRUE(m_results.wait_for(range_size + 1));
+    ASSERT_EQ(m_server.requests(), 2UL);
+
+    auto res = m_results.get();
+    ASSERT_EQ(res.size(), range_size + 1);
+    for(ticket_number_type i = 0; i <= range_size; i++) {
+        ASSERT_EQ(ticket(res[i]), i);
+    }
+}
+
+TEST_F(ticket_machine_client_test, run_out_of_tickets) {
+    static constexpr size_t n_callers{5};
+
+    // Callers arriving with no leased tickets wait on a single fetch
+    for(size_t i = 0; i < n_callers; i++) {
+        ASSERT_TRUE(m_client.get_ticket_number(m_results.callback()));
+    }
+    ASSERT_TRUE(m_server.wait_for_requests(1));
+    ASSERT_EQ(m_server.requests(), 1UL);
+
+    // A range smaller than the number of waiting callers is spent on the
+    // oldest callers and the client fetches again for the rest
+    m_server.respond(ticket_interface::ticket_number_range_type{0, 3});
+    ASSERT_TRUE(m_results.wait_for(3));
+    ASSERT_TRUE(m_server.wait_for_requests(2));
+    m_server.respond(ticket_interface::ticket_number_range_type{3, 4});
+    ASSERT_TRUE(m_results.wait_for(4));
+    ASSERT_TRUE(m_server.wait_for_requests(3));
+    m_server.respond(ticket_interface::ticket_number_range_type{10, 1010});
+    ASSERT_TRUE(m_results.wait_for(n_callers));
+
+    // The remainder of the last range is used for later callers
+    ASSERT_TRUE(m_client.get_ticket_number(m_results.callback()));
+    ASSERT_TRUE(m_results.wait_for(n_callers + 1));
+
+    auto res = m_results.get();
+    auto expected = std::vector<ticket_number_type>{0, 1, 2, 3, 10, 11};
+    ASSERT_EQ(res.size(), expected.size());
+    for(size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(ticket(res[i]), expected[i]);
+    }
+}
+
+TEST_F(ticket_machine_client_test, fetch_error) {
+    ASSERT_TRUE(m_client.get_ticket_number(m_results.callback()));
+    ASSERT_TRUE(m_client.get_ticket_number(m_results.callback()));
+    ASSERT_TRUE(m_server.wait_for_requests(1));
+
+    // A failed fetch fails every waiting caller
+    m_server.respond(std::nullopt);
+    ASSERT_TRUE(m_results.wait_for(2));
+    for(const auto& res : m_results.get()) {
+        ASSERT_TRUE(std::holds_alternative<ticket_interface::error_code>(res));
+    }
+
+    // The next caller starts a new fetch
+    ASSERT_TRUE(m_client.get_ticket_number(m_results.callback()));
+    ASSERT_TRUE(m_server.wait_for_requests(2));
+    m_server.respond(ticket_interface::ticket_number_range_type{5, 10});
+    ASSERT_TRUE(m_results.wait_for(3));
+    ASSERT_EQ(ticket(m_results.get().back()), 5UL);
+}
@@ -0,0 +1,170 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parsec/ticket_machine/server.hpp"
+#include "parsec/ticket_machine/state_machine.hpp"
+#include "util/rpc/format.hpp"
+#include "util/serialization/format.hpp"
+
+#include <condition_variable>
+#include <filesystem>
+#include <future>
+#include <gtest/gtest.h>
+
+namespace {
+    using cbdc::parsec::ticket_machine::ticket_number_type;
+    using ticket_interface = cbdc::parsec::ticket_machine::interface;
+    using request = cbdc::parsec::ticket_machine::rpc::request;
+    using response = cbdc::parsec::ticket_machine::rpc::response;
+
+    /// RPC server which passes requests from the test straight to the
+    /// registered handler.
+    class local_server
+        : public cbdc::rpc::async_server<request, response> {
+      public:
+        /// Sends a ticket number request to the handler.
+        /// \param cb function to call with the response.
+        /// \return true if the handler accepted the request.
+        auto call(std::function<void(std::optional<response>)> cb) -> bool {
+            auto req = request_type{{m_next_id++}, std::monostate{}};
+            auto res = async_call(
+                cbdc::make_buffer(req),
+                [cb = std::move(cb)](cbdc::buffer resp_buf) {
+                    auto resp = cbdc::from_buffer<response_type>(resp_buf);
+                    if(!resp.has_value()) {
+                        cb(std::nullopt);
+                        return;
+                    }
+                    cb(resp->m_payload);
+                });
+            return !res.has_value();
+        }
+
+      private:
+        cbdc::rpc::request_id_type m_next_id{};
+    };
+
+    /// Ticket machine state machine which holds its first commit until the
+    /// test releases it, and counts the log entries it commits.
+    class held_state_machine
+        : public cbdc::parsec::ticket_machine::state_machine {
+      public:
+        using state_machine::state_machine;
+
+        auto commit(uint64_t log_idx, nuraft::buffer& data)
+            -> nuraft::ptr<nuraft::buffer> override {
+            if(m_commits++ == 0) {
+                m_released.wait();
+            }
+            return state_machine::commit(log_idx, data);
+        }
+
+        void release() {
+            m_release.set_value();
+        }
+
+        [[nodiscard]] auto commits() const -> size_t {
+            return m_commits;
+        }
+
+      private:
+        std::promise<void> m_release;
+        std::shared_future<void> m_released{m_release.get_future().share()};
+        std::atomic<size_t> m_commits{};
+    };
+}
+
+class ticket_machine_server_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        TearDown();
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all("ticket_machine_raft_log_0");
+        std::filesystem::remove_all("ticket_machine_raft_config_0.dat");
+        std::filesystem::remove_all("ticket_machine_raft_state_0.dat");
+    }
+};
+
+TEST_F(ticket_machine_server_test, batched_allocation) {
+    static constexpr ticket_number_type batch_size{100};
+    static constexpr size_t n_queued{3};
+    static constexpr unsigned short raft_port{29910};
+
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto sm = std::make_shared<held_state_machine>(log, batch_size);
+    auto node = std::make_shared<cbdc::raft::node>(
+        0,
+        std::vector<cbdc::network::endpoint_t>{
+            {cbdc::network::localhost, raft_port}},
+        "ticket_machine",
+        false,
+        sm,
+        0,
+        log,
+        nullptr);
+    auto params = nuraft::raft_params();
+    params.snapshot_distance_ = 0;
+    ASSERT_TRUE(node->init(params));
+    for(size_t i = 0; i < 100 && !node->is_leader(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    ASSERT_TRUE(node->is_leader());
+
+    auto srv = std::make_unique<local_server>();
+    auto* local = srv.get();
+    auto tm = cbdc::parsec::ticket_machine::rpc::server(log,
+                                                         node,
+                                                         std::move(srv));
+
+    auto mut = std::mutex();
+    auto cv = std::condition_variable();
+    auto results = std::vector<std::optional<response>>(n_queued + 1);
+    size_t n_results{};
+    auto callback = [&](size_t i) {
+        return [&, i](std::optional<response> res) {
+            {
+                std::unique_lock l(mut);
+                results[i] = res;
+                n_results++;
+            }
+            cv.notify_all();
+        };
+    };
+
+    // The first request is replicated on its own. Requests arriving while
+    // its log entry is held uncommitted are queued.
+    ASSERT_TRUE(local->call(callback(0)));
+    for(size_t i = 1; i <= n_queued; i++) {
+        ASSERT_TRUE(local->call(callback(i)));
+    }
+    sm->release();
+
+    {
+        std::unique_lock l(mut);
+        ASSERT_TRUE(cv.wait_for(l, std::chrono::seconds(10), [&]() {
+            return n_results == results.size();
+        }));
+    }
+
+    // The queued requests were granted by a single log entry, which is
+    // split evenly between them in arrival order
+    ASSERT_EQ(sm->commits(), 2UL);
+    auto start = ticket_number_type{};
+    for(const auto& res : results) {
+        ASSERT_TRUE(res.has_value());
+        const auto* range
+            = std::get_if<ticket_interface::ticket_number_range_type>(
+                &res.value());
+        ASSERT_NE(range, nullptr);
+        ASSERT_EQ(range->first, start);
+        ASSERT_EQ(range->second, start + batch_size);
+        start = range->second;
+    }
+
+    node->stop();
+}
@@ -10,6 +10,7 @@
 #include "util/serialization/format.hpp"
 
 #include <gtest/gtest.h>
+#include <numeric>
 #include <variant>
 
 TEST(tcp_rpc_test, echo_test) {
@@ -219,6 +220,44 @@ TEST(tcp_rpc_test, async_echo_test) {
     ASSERT_EQ(status, std::future_status::ready);
 }
 
+TEST(tcp_rpc_test, call_as_test) {
+    using payload = std::vector<uint64_t>;
+    using request = std::variant<bool, payload>;
+    using response = uint64_t;
+
+    auto ep = cbdc::network::endpoint_t{cbdc::network::localhost, 55555};
+    auto server = cbdc::rpc::blocking_tcp_server<request, response>(ep);
+    server.register_handler_callback(
+        [](request req) -> std::optional<response> {
+            if(!std::holds_alternative<payload>(req)) {
+                return std::nullopt;
+            }
+            auto& vals = std::get<payload>(req);
+            return std::accumulate(vals.begin(), vals.end(), uint64_t{});
+        });
+
+    ASSERT_TRUE(server.init());
+
+    auto client = cbdc::rpc::tcp_client<request, response>({ep});
+    ASSERT_TRUE(client.init());
+
+    // The payload is serialized from the reference as the second
+    // alternative, so the server decodes the same request as call() sends
+    const auto vals = payload{1, 2, 3};
+    auto done = std::promise<void>();
+    auto done_fut = done.get_future();
+    auto success = client.call_as<payload>(
+        vals,
+        [&](std::optional<response> resp) {
+            ASSERT_TRUE(resp.has_value());
+            ASSERT_EQ(resp.value(), 6UL);
+            done.set_value();
+        });
+    ASSERT_TRUE(success);
+    auto status = done_fut.wait_for(std::chrono::seconds(1));
+    ASSERT_EQ(status, std::future_status::ready);
+}
+
 TEST(tcp_rpc_test, async_error_test) {
     using request = bool;
     using response = bool;
@@ -263,3 +302,217 @@ TEST(tcp_rpc_test, async_error_test) {
     status = done_fut.wait_for(std::chrono::milliseconds(100));
     ASSERT_EQ(status, std::future_status::ready);
 }
+
+TEST(tcp_rpc_test, pipelined_out_of_order_test) {
+    using request = int64_t;
+    using response = int64_t;
+    static constexpr size_t n_requests{64};
+
+    using callback_type = std::function<void(std::optional<response>)>;
+
+    // Hold every request until all have arrived, then respond in reverse
+    auto mut = std::mutex();
+    auto held = std::vector<std::pair<request, callback_type>>();
+    auto ep = cbdc::network::endpoint_t{cbdc::network::localhost, 55555};
+    auto server = cbdc::rpc::async_tcp_server<request, response>(ep);
+    server.register_handler_callback(
+        [&](request req,
+            std::function<void(std::optional<response>)> cb) -> bool {
+            std::unique_lock l(mut);
+            held.emplace_back(req, std::move(cb));
+            if(held.size() == n_requests) {
+                for(auto it = held.rbegin(); it != held.rend(); it++) {
+                    it->second(it->first);
+                }
+                held.clear();
+            }
+            return true;
+        });
+    ASSERT_TRUE(server.init());
+
+    auto client = cbdc::rpc::tcp_client<request, response>({ep}, n_requests);
+    ASSERT_TRUE(client.init());
+
+    auto done = std::promise<void>();
+    auto done_fut = done.get_future();
+    auto remaining = std::atomic<size_t>(n_requests);
+    for(size_t i = 0; i < n_requests; i++) {
+        auto req = static_cast<request>(i);
+        auto success = client.call(req, [&, req](std::optional<response> resp) {
+            ASSERT_TRUE(resp.has_value());
+            ASSERT_EQ(resp.value(), req);
+            if(--remaining == 0) {
+                done.set_value();
+            }
+        });
+        ASSERT_TRUE(success);
+    }
+    auto status = done_fut.wait_for(std::chrono::seconds(5));
+    ASSERT_EQ(status, std::future_status::ready);
+}
+
+TEST(tcp_rpc_test, in_flight_window_test) {
+    using request = int64_t;
+    using response = int64_t;
+
+    auto mut = std::mutex();
+    auto held = std::vector<std::function<void(std::optional<response>)>>();
+    auto ep = cbdc::network::endpoint_t{cbdc::network::localhost, 55555};
+    auto server = cbdc::rpc::async_tcp_server<request, response>(ep);
+    server.register_handler_callback(
+        [&](request req,
+            std::function<void(std::optional<response>)> cb) -> bool {
+            if(req == 0) {
+                // Hold the request so it stays in flight
+                std::unique_lock l(mut);
+                held.emplace_back(std::move(cb));
+                return true;
+            }
+            cb(req);
+            return true;
+        });
+    ASSERT_TRUE(server.init());
+
+    auto client = cbdc::rpc::tcp_client<request, response>({ep}, 1);
+    ASSERT_TRUE(client.init());
+
+    auto done = std::promise<std::optional<response>>();
+    auto done_fut = done.get_future();
+    ASSERT_TRUE(client.call(request{0}, [&](std::optional<response> resp) {
+        done.set_value(resp);
+    }));
+
+    // The window is full so the request cannot be sent before the timeout
+    auto resp = client.call(request{1}, std::chrono::milliseconds(50));
+    ASSERT_FALSE(resp.has_value());
+
+    auto release = [&]() {
+        std::unique_lock l(mut);
+        if(held.empty()) {
+            return false;
+        }
+        held.front()(response{0});
+        held.clear();
+        return true;
+    };
+    while(!release()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(done_fut.wait_for(std::chrono::seconds(5)),
+              std::future_status::ready);
+    ASSERT_EQ(done_fut.get(), response{0});
+
+    resp = client.call(request{2}, std::chrono::seconds(5));
+    ASSERT_TRUE(resp.has_value());
+    ASSERT_EQ(resp.value(), response{2});
+}
+
+TEST(tcp_rpc_test, load_balance_test) {
+    using request = int64_t;
+    using response = int64_t;
+    static constexpr size_t n_requests{10};
+
+    auto ep0 = cbdc::network::endpoint_t{cbdc::network::localhost, 55555};
+    auto ep1 = cbdc::network::endpoint_t{cbdc::network::localhost, 55556};
+    auto count0 = std::atomic<size_t>();
+    auto count1 = std::atomic<size_t>();
+    auto server0 = cbdc::rpc::blocking_tcp_server<request, response>(ep0);
+    server0.register_handler_callback(
+        [&](request req) -> std::optional<response> {
+            count0++;
+            return req;
+        });
+    ASSERT_TRUE(server0.init());
+    auto server1 = cbdc::rpc::blocking_tcp_server<request, response>(ep1);
+    server1.register_handler_callback(
+        [&](request req) -> std::optional<response> {
+            count1++;
+            return req;
+        });
+    ASSERT_TRUE(server1.init());
+
+    auto client = cbdc::rpc::tcp_client<request, response>({ep0, ep1});
+    ASSERT_TRUE(client.init());
+
+    for(size_t i = 0; i < n_requests; i++) {
+        auto req = static_cast<request>(i);
+        auto resp = client.call(req);
+        ASSERT_TRUE(resp.has_value());
+        ASSERT_EQ(resp.value(), req);
+    }
+    ASSERT_EQ(count0, n_requests / 2);
+    ASSERT_EQ(count1, n_requests / 2);
+}
+
+TEST(tcp_rpc_test, disconnect_test) {
+    using request = int64_t;
+    using response = int64_t;
+    static constexpr size_t n_requests{2};
+
+    // Hold every request so they stay in flight
+    auto mut = std::mutex();
+    auto held = std::vector<std::function<void(std::optional<response>)>>();
+    auto handler = [&](request /* req */,
+                       std::function<void(std::optional<response>)> cb)
+        -> bool {
+        std::unique_lock l(mut);
+        held.emplace_back(std::move(cb));
+        return true;
+    };
+    auto ep = cbdc::network::endpoint_t{cbdc::network::localhost, 55555};
+    auto server
+        = std::make_unique<cbdc::rpc::async_tcp_server<request, response>>(ep);
+    server->register_handler_callback(handler);
+    ASSERT_TRUE(server->init());
+
+    auto client = cbdc::rpc::tcp_client<request, response>({ep}, n_requests);
+    ASSERT_TRUE(client.init());
+
+    auto failed = std::atomic<size_t>();
+    auto done = std::promise<void>();
+    auto done_fut = done.get_future();
+    for(size_t i = 0; i < n_requests; i++) {
+        ASSERT_TRUE(client.call(request{0}, [&](std::optional<response> resp) {
+            ASSERT_FALSE(resp.has_value());
+            if(++failed == n_requests) {
+                done.set_value();
+            }
+        }));
+    }
+    for(size_t i = 0; i < 100; i++) {
+        {
+            std::unique_lock l(mut);
+            if(held.size() == n_requests) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Requests in flight to a server which goes away fail rather than
+    // holding the window forever
+    server.reset();
+    held.clear();
+    ASSERT_EQ(done_fut.wait_for(std::chrono::seconds(5)),
+              std::future_status::ready);
+
+    // Once the client reconnects, the window has room again
+    server
+        = std::make_unique<cbdc::rpc::async_tcp_server<request, response>>(ep);
+    server->register_handler_callback(
+        [](request req, std::function<void(std::optional<response>)> cb)
+            -> bool {
+            cb(req);
+            return true;
+        });
+    ASSERT_TRUE(server->init());
+    auto resp = std::optional<response>();
+    for(size_t i = 0; i < 100 && !resp.has_value(); i++) {
+        resp = client.call(request{1}, std::chrono::milliseconds(100));
+        if(!resp.has_value()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    ASSERT_TRUE(resp.has_value());
+    ASSERT_EQ(resp.value(), response{1});
+}
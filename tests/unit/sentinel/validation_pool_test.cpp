@@ -0,0 +1,64 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/sentinel/validation_pool.hpp"
+
+#include <future>
+#include <gtest/gtest.h>
+#include <set>
+
+TEST(validation_pool_test, runs_tasks_with_thread_contexts) {
+    constexpr size_t n_threads = 4;
+    constexpr size_t n_tasks = 100;
+    auto pool = cbdc::sentinel::validation_pool(n_threads, n_tasks);
+    ASSERT_EQ(pool.size(), n_threads);
+
+    auto mut = std::mutex();
+    auto contexts = std::set<secp256k1_context*>();
+    auto done = std::promise<void>();
+    auto remaining = n_tasks;
+    for(size_t i = 0; i < n_tasks; i++) {
+        ASSERT_TRUE(pool.push([&](secp256k1_context* secp) {
+            std::unique_lock l(mut);
+            ASSERT_NE(secp, nullptr);
+            contexts.insert(secp);
+            if(--remaining == 0) {
+                done.set_value();
+            }
+        }));
+    }
+
+    auto fut = done.get_future();
+    ASSERT_EQ(fut.wait_for(std::chrono::seconds(5)),
+              std::future_status::ready);
+    std::unique_lock l(mut);
+    ASSERT_LE(contexts.size(), n_threads);
+}
+
+TEST(validation_pool_test, push_blocks_while_full) {
+    auto pool = cbdc::sentinel::validation_pool(1, 1);
+
+    // Occupy the only thread, then fill the queue
+    auto release = std::promise<void>();
+    auto release_fut = release.get_future().share();
+    auto started = std::promise<void>();
+    ASSERT_TRUE(pool.push([&, release_fut](secp256k1_context* /* secp */) {
+        started.set_value();
+        release_fut.wait();
+    }));
+    started.get_future().wait();
+    ASSERT_TRUE(pool.push([](secp256k1_context* /* secp */) {}));
+
+    auto pushed = std::async(std::launch::async, [&]() {
+        return pool.push([](secp256k1_context* /* secp */) {});
+    });
+    ASSERT_EQ(pushed.wait_for(std::chrono::milliseconds(100)),
+              std::future_status::timeout);
+
+    release.set_value();
+    ASSERT_EQ(pushed.wait_for(std::chrono::seconds(5)),
+              std::future_status::ready);
+    ASSERT_TRUE(pushed.get());
+}
@@ -4,14 +4,120 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "uhs/sentinel/client.hpp"
+#include "uhs/sentinel/format.hpp"
+#include "uhs/transaction/messages.hpp"
 #include "uhs/transaction/wallet.hpp"
 #include "uhs/twophase/coordinator/controller.hpp"
 #include "uhs/twophase/coordinator/format.hpp"
 #include "uhs/twophase/sentinel_2pc/controller.hpp"
+#include "util/rpc/format.hpp"
+#include "util/rpc/tcp_server.hpp"
 #include "util/serialization/util.hpp"
 
+#include <condition_variable>
+#include <future>
 #include <gtest/gtest.h>
 
+namespace {
+    /// How a peer sentinel answers a batch validation request.
+    enum class behaviour {
+        /// Attest to every transaction in the batch.
+        attest,
+        /// Reject every transaction in the batch.
+        reject,
+        /// Hold the request until the test releases it.
+        hold
+    };
+
+    /// Peer sentinel which answers batch validation requests as directed by
+    /// the test, and counts the requests it receives.
+    class test_sentinel {
+      public:
+        using policy_type = std::function<behaviour()>;
+
+        test_sentinel(const cbdc::network::endpoint_t& ep,
+                      const cbdc::privkey_t& key,
+                      policy_type policy)
+            : m_key(key),
+              m_policy(std::move(policy)),
+              m_srv(ep) {}
+
+        auto init() -> bool {
+            m_srv.register_handler_callback(
+                [&](const cbdc::sentinel::request& req, callback_type cb) {
+                    const auto* batch
+                        = std::get_if<cbdc::sentinel::validate_batch_request>(
+                            &req);
+                    if(batch == nullptr) {
+                        return false;
+                    }
+                    auto b = m_policy();
+                    {
+                        std::unique_lock l(m_mut);
+                        m_requests++;
+                        if(b == behaviour::hold) {
+                            m_held.emplace_back(std::move(cb), *batch);
+                            return true;
+                        }
+                    }
+                    cb(respond(*batch, b == behaviour::attest));
+                    return true;
+                });
+            return m_srv.init();
+        }
+
+        auto requests() -> size_t {
+            std::unique_lock l(m_mut);
+            return m_requests;
+        }
+
+        /// Attests to the transactions in the requests held so far.
+        void release() {
+            auto held = decltype(m_held)();
+            {
+                std::unique_lock l(m_mut);
+                held.swap(m_held);
+            }
+            for(auto& [cb, batch] : held) {
+                cb(respond(batch, true));
+            }
+        }
+
+      private:
+        using callback_type
+            = std::function<void(std::optional<cbdc::sentinel::response>)>;
+
+        auto respond(const cbdc::sentinel::validate_batch_request& req,
+                     bool attest) -> cbdc::sentinel::response {
+            auto resp = cbdc::sentinel::validate_batch_response();
+            for(const auto& tx : req.m_txs) {
+                if(!attest) {
+                    resp.m_attestations.emplace_back(std::nullopt);
+                    continue;
+                }
+                auto ctx = cbdc::transaction::compact_tx(tx);
+                resp.m_attestations.emplace_back(ctx.sign(m_secp.get(), m_key));
+            }
+            return resp;
+        }
+
+        std::unique_ptr<secp256k1_context,
+                        decltype(&secp256k1_context_destroy)>
+            m_secp{secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
+                   &secp256k1_context_destroy};
+        cbdc::privkey_t m_key;
+        policy_type m_policy;
+        std::mutex m_mut;
+        size_t m_requests{};
+        std::vector<
+            std::pair<callback_type, cbdc::sentinel::validate_batch_request>>
+            m_held;
+        cbdc::rpc::async_tcp_server<cbdc::sentinel::request,
+                                    cbdc::sentinel::response>
+            m_srv;
+    };
+}
+
 class sentinel_2pc_test : public ::testing::Test {
   protected:
     void SetUp() override {
@@ -82,6 +188,56 @@ class sentinel_2pc_test : public ::testing::Test {
         m_valid_tx = wallet1.send_to(20, wallet2.generate_key(), true).value();
     }
 
+    /// Adds peer sentinels and recreates the controller to use them.
+    /// \param n_live number of peers which answer requests.
+    /// \param n_down number of further peers which cannot be reached.
+    /// \param threshold number of attestations needed for a transaction.
+    void add_peers(size_t n_live, size_t n_down, size_t threshold) {
+        auto secp = std::unique_ptr<secp256k1_context,
+                                    decltype(&secp256k1_context_destroy)>{
+            secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
+            &secp256k1_context_destroy};
+        for(size_t i = 0; i < n_live + n_down; i++) {
+            const auto ep = std::make_pair(
+                cbdc::network::localhost,
+                static_cast<unsigned short>(m_sentinel_port + 1 + i));
+            m_opts.m_sentinel_endpoints.push_back(ep);
+            auto key = cbdc::privkey_t();
+            key[0] = static_cast<unsigned char>(i + 2);
+            m_opts.m_sentinel_public_keys.insert(
+                cbdc::pubkey_from_privkey(key, secp.get()));
+            if(i < n_live) {
+                m_peers.emplace_back(
+                    std::make_unique<test_sentinel>(ep, key, [&]() {
+                        return m_policy(m_arrivals++);
+                    }));
+                ASSERT_TRUE(m_peers.back()->init());
+            }
+        }
+        m_opts.m_attestation_threshold = threshold;
+        m_ctl = std::make_unique<cbdc::sentinel_2pc::controller>(0,
+                                                                 m_opts,
+                                                                 m_logger);
+        ASSERT_TRUE(m_ctl->init());
+    }
+
+    /// Executes the valid transaction and waits for the result.
+    auto execute() -> std::optional<cbdc::sentinel::execute_response> {
+        using result_type = std::optional<cbdc::sentinel::execute_response>;
+        auto res = std::make_shared<std::promise<result_type>>();
+        auto fut = res->get_future();
+        EXPECT_TRUE(m_ctl->execute_transaction(m_valid_tx,
+                                               [res](result_type r) {
+                                                   res->set_value(r);
+                                               }));
+        if(fut.wait_for(std::chrono::seconds(10))
+           != std::future_status::ready) {
+            ADD_FAILURE() << "Transaction did not complete";
+            return std::nullopt;
+        }
+        return fut.get();
+    }
+
     void TearDown() override {
         m_dummy_coordinator_net->close();
 
@@ -96,6 +252,13 @@ class sentinel_2pc_test : public ::testing::Test {
     std::unique_ptr<cbdc::network::connection_manager> m_dummy_coordinator_net;
     std::optional<std::thread> m_dummy_coordinator_thread;
     cbdc::config::options m_opts{};
+    /// Behaviour of the peer sentinels given the index of the request
+    /// across all peers.
+    std::function<behaviour(size_t)> m_policy{[](size_t /* i */) {
+        return behaviour::attest;
+    }};
+    std::atomic<size_t> m_arrivals{};
+    std::vector<std::unique_ptr<test_sentinel>> m_peers;
     std::unique_ptr<cbdc::sentinel_2pc::controller> m_ctl;
     cbdc::transaction::full_tx m_valid_tx{};
     std::shared_ptr<cbdc::logging::log> m_logger;
@@ -175,12 +338,17 @@ TEST_F(sentinel_2pc_test, tx_validation_test) {
         secp256k1_context_create(SECP256K1_CONTEXT_SIGN
                                  | SECP256K1_CONTEXT_VERIFY),
         &secp256k1_context_destroy};
+    auto done = std::promise<void>();
+    auto done_fut = done.get_future();
     auto res
         = m_ctl->validate_transaction(m_valid_tx, [&](auto validation_res) {
               ASSERT_TRUE(validation_res.has_value());
               ASSERT_TRUE(ctx.verify(secp.get(), validation_res.value()));
+              done.set_value();
           });
     ASSERT_TRUE(res);
+    auto r = done_fut.wait_for(std::chrono::milliseconds(500));
+    ASSERT_EQ(r, std::future_status::ready);
 }
 
 TEST_F(sentinel_2pc_test, bad_coordinator_endpoint) {
@@ -271,3 +439,66 @@ TEST_F(sentinel_2pc_test, no_sentinel_endpoints) {
     // are defined.
     ASSERT_FALSE(ctl->init());
 }
+
+TEST_F(sentinel_2pc_test, attestation_hedge) {
+    // The first peer asked holds its response, so the controller asks the
+    // other peer once the hedge delay passes
+    m_opts.m_attestation_hedge_delay = 50;
+    m_policy = [](size_t i) {
+        return i == 0 ? behaviour::hold : behaviour::attest;
+    };
+    add_peers(2, 0, 2);
+
+    auto res = execute();
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res->m_tx_status, cbdc::sentinel::tx_status::confirmed);
+    for(auto& peer : m_peers) {
+        ASSERT_EQ(peer->requests(), 1UL);
+        // The late attestation is ignored
+        peer->release();
+    }
+}
+
+TEST_F(sentinel_2pc_test, attestation_rejected_peer) {
+    // Without hedging, a peer rejecting the transaction is replaced by
+    // another peer
+    m_opts.m_attestation_hedge_delay = 0;
+    m_policy = [](size_t i) {
+        return i == 0 ? behaviour::reject : behaviour::attest;
+    };
+    add_peers(2, 0, 2);
+
+    auto res = execute();
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res->m_tx_status, cbdc::sentinel::tx_status::confirmed);
+    for(auto& peer : m_peers) {
+        ASSERT_EQ(peer->requests(), 1UL);
+    }
+}
+
+TEST_F(sentinel_2pc_test, attestation_unreachable_peer) {
+    // Requests to a peer which cannot be reached fail at once and the
+    // remaining peers are asked instead
+    m_opts.m_attestation_hedge_delay = 0;
+    add_peers(2, 1, 3);
+
+    auto res = execute();
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res->m_tx_status, cbdc::sentinel::tx_status::confirmed);
+    for(auto& peer : m_peers) {
+        ASSERT_EQ(peer->requests(), 1UL);
+    }
+}
+
+TEST_F(sentinel_2pc_test, attestation_not_enough_peers) {
+    // The transaction fails once too few peers remain to reach the
+    // threshold
+    m_opts.m_attestation_hedge_delay = 0;
+    m_policy = [](size_t /* i */) {
+        return behaviour::reject;
+    };
+    add_peers(2, 1, 3);
+
+    auto res = execute();
+    ASSERT_FALSE(res.has_value());
+}
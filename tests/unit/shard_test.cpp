@@ -149,3 +149,71 @@ TEST_F(shard_test, digest_block_valid) {
 
     ASSERT_EQ(invalid_got, invalid_want);
 }
+
+TEST_F(shard_test, digest_filtered_block) {
+    cbdc::atomizer::block b2;
+    b2.m_height = 2;
+    b2.m_transactions.push_back(
+        cbdc::test::simple_tx({'c'}, {{1}, {3}, {4}, {11}}, {{7}}));
+    b2.m_transactions.push_back(
+        cbdc::test::simple_tx({'d'}, {{2}, {5}, {6}, {22}}, {{8}}));
+
+    auto filtered = cbdc::atomizer::filter_block(b2, {3, 8});
+    ASSERT_EQ(filtered.m_height, b2.m_height);
+    ASSERT_EQ(filtered.m_transactions.size(), 1UL);
+    ASSERT_EQ(filtered.m_transactions[0].m_id, cbdc::hash_t{});
+    ASSERT_TRUE(filtered.m_transactions[0].m_attestations.empty());
+    auto want_spent = std::vector<cbdc::hash_t>{{3}, {4}, {5}, {6}};
+    auto want_created = std::vector<cbdc::hash_t>{{7}, {8}};
+    ASSERT_EQ(filtered.m_transactions[0].m_inputs, want_spent);
+    ASSERT_EQ(filtered.m_transactions[0].m_uhs_outputs, want_created);
+    ASSERT_TRUE(m_shard.digest_block(filtered));
+
+    cbdc::transaction::compact_tx ctx{};
+    ctx.m_id = {'a'};
+    ctx.m_inputs = {{0}, {7}, {100}, {8}};
+    ctx.m_uhs_outputs = {{'x'}, {'y'}};
+
+    auto res = m_shard.digest_transaction(ctx);
+    ASSERT_TRUE(std::holds_alternative<cbdc::atomizer::tx_notify_request>(res));
+    auto got = std::get<cbdc::atomizer::tx_notify_request>(res);
+    ASSERT_EQ(got.m_attestations, (std::unordered_set<uint64_t>{1, 3}));
+    ASSERT_EQ(got.m_block_height, 2UL);
+
+    ctx.m_inputs = {{3}};
+    res = m_shard.digest_transaction(ctx);
+    ASSERT_TRUE(std::holds_alternative<cbdc::watchtower::tx_error>(res));
+}
+
+TEST_F(shard_test, digest_tx_batch) {
+    auto txs = std::vector<cbdc::transaction::compact_tx>(3);
+    txs[0].m_id = {'a'};
+    txs[0].m_inputs = {{0}, {3}, {6}, {100}};
+    txs[1].m_id = {'b'};
+    txs[1].m_inputs = {{3}, {7}};
+    txs[2].m_id = {'c'};
+    txs[2].m_inputs = {};
+
+    auto res = m_shard.digest_transactions(txs);
+    ASSERT_EQ(res.size(), txs.size());
+
+    ASSERT_TRUE(
+        std::holds_alternative<cbdc::atomizer::tx_notify_request>(res[0]));
+    cbdc::atomizer::tx_notify_request want{};
+    want.m_tx = txs[0];
+    want.m_attestations = {1, 2};
+    want.m_block_height = 1;
+    ASSERT_EQ(std::get<cbdc::atomizer::tx_notify_request>(res[0]), want);
+
+    ASSERT_TRUE(std::holds_alternative<cbdc::watchtower::tx_error>(res[1]));
+    cbdc::watchtower::tx_error want_dne{
+        {'b'},
+        cbdc::watchtower::tx_error_inputs_dne{{{7}}}};
+    ASSERT_EQ(std::get<cbdc::watchtower::tx_error>(res[1]), want_dne);
+
+    ASSERT_TRUE(std::holds_alternative<cbdc::watchtower::tx_error>(res[2]));
+    cbdc::watchtower::tx_error want_empty{
+        {'c'},
+        cbdc::watchtower::tx_error_inputs_dne{{}}};
+    ASSERT_EQ(std::get<cbdc::watchtower::tx_error>(res[2]), want_empty);
+}
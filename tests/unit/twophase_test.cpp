@@ -34,7 +34,7 @@ TEST_F(TwoPhaseTest, test_one_shard) {
         auto tx = cbdc::locking_shard::tx();
         auto uhs_id = cbdc::hash_t();
         std::memcpy(uhs_id.data(), &i, sizeof(i));
-        tx.m_tx.m_uhs_outputs.push_back(uhs_id);
+        tx.m_uhs_outputs.push_back(uhs_id);
         txs.push_back(tx);
     }
 
@@ -115,8 +115,8 @@ TEST_F(TwoPhaseTest, test_one_shard_random) {
             const auto val = rnd(e);
             std::memcpy(&output1[j * 8], &val, sizeof(val));
         }
-        tx.m_tx.m_uhs_outputs.push_back(output0);
-        tx.m_tx.m_uhs_outputs.push_back(output1);
+        tx.m_uhs_outputs.push_back(output0);
+        tx.m_uhs_outputs.push_back(output1);
         outputs.push(output0);
         outputs.push(output1);
         txs.push_back(tx);
@@ -144,11 +144,11 @@ TEST_F(TwoPhaseTest, test_one_shard_random) {
             const auto val = rnd(e);
             std::memcpy(&output1[j * 8], &val, sizeof(val));
         }
-        tx.m_tx.m_uhs_outputs.push_back(output0);
-        tx.m_tx.m_uhs_outputs.push_back(output1);
-        tx.m_tx.m_inputs.push_back(outputs.front());
+        tx.m_uhs_outputs.push_back(output0);
+        tx.m_uhs_outputs.push_back(output1);
+        tx.m_inputs.push_back(outputs.front());
         outputs.pop();
-        tx.m_tx.m_inputs.push_back(outputs.front());
+        tx.m_inputs.push_back(outputs.front());
         outputs.pop();
         txs.push_back(tx);
     }
@@ -378,4 +378,62 @@ TEST_F(TwoPhaseTest, test_two_shards_conflicting) {
     for(size_t i{txs.size()}; i < 2 * txs.size(); i++) {
         ASSERT_FALSE((*res)[i]);
     }
+
+    // Batch status queries agree with the single queries
+    auto uhs_ids = std::vector<cbdc::hash_t>();
+    auto tx_ids = std::vector<cbdc::hash_t>();
+    for(const auto& tx : txs) {
+        uhs_ids.insert(uhs_ids.end(),
+                       tx.m_uhs_outputs.begin(),
+                       tx.m_uhs_outputs.end());
+        uhs_ids.insert(uhs_ids.end(), tx.m_inputs.begin(), tx.m_inputs.end());
+        tx_ids.push_back(tx.m_id);
+    }
+    for(const auto& shard : {shard0, shard1}) {
+        auto status = shard->check_status(uhs_ids, tx_ids);
+        ASSERT_TRUE(status.has_value());
+        ASSERT_EQ(status->m_unspent.size(), uhs_ids.size());
+        ASSERT_EQ(status->m_confirmed.size(), tx_ids.size());
+        for(size_t i{0}; i < uhs_ids.size(); i++) {
+            ASSERT_EQ(status->m_unspent[i], *shard->check_unspent(uhs_ids[i]));
+        }
+        for(size_t i{0}; i < tx_ids.size(); i++) {
+            ASSERT_EQ(status->m_confirmed[i], *shard->check_tx_id(tx_ids[i]));
+        }
+    }
+}
+
+TEST_F(TwoPhaseTest, test_project_tx) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::debug);
+    auto shard = cbdc::locking_shard::locking_shard(std::make_pair(0, 127),
+                                                    logger,
+                                                    10000000,
+                                                    "",
+                                                    m_opts);
+
+    auto in_range = cbdc::hash_t{1};
+    auto out_of_range = cbdc::hash_t{200};
+    auto ctx = cbdc::transaction::compact_tx();
+    ctx.m_id = out_of_range;
+    ctx.m_inputs = {in_range, out_of_range};
+    ctx.m_uhs_outputs = {out_of_range, in_range};
+    ctx.m_attestations.insert({{'a'}, {'b'}});
+
+    auto stx = shard.project_tx(ctx);
+    ASSERT_TRUE(stx.has_value());
+    ASSERT_EQ(stx->m_id, ctx.m_id);
+    ASSERT_EQ(stx->m_inputs, std::vector<cbdc::hash_t>{in_range});
+    ASSERT_EQ(stx->m_uhs_outputs, std::vector<cbdc::hash_t>{in_range});
+
+    // Transactions whose ID is in range are kept so the shard can record
+    // their completion
+    ctx.m_inputs = {out_of_range};
+    ctx.m_uhs_outputs = {out_of_range};
+    ASSERT_FALSE(shard.project_tx(ctx).has_value());
+    ctx.m_id = in_range;
+    stx = shard.project_tx(ctx);
+    ASSERT_TRUE(stx.has_value());
+    ASSERT_TRUE(stx->m_inputs.empty());
+    ASSERT_TRUE(stx->m_uhs_outputs.empty());
 }
@@ -18,6 +18,8 @@ class WalletTest : public ::testing::Test {
 
     void TearDown() override {
         std::filesystem::remove(m_wallet_file);
+        std::filesystem::remove(
+            cbdc::transaction::wallet::journal_file(m_wallet_file));
     }
 
     cbdc::transaction::wallet m_wallet{};
@@ -201,3 +203,139 @@ TEST_F(WalletTest, load_save) {
     ASSERT_EQ(m_wallet.balance(), new_wal.balance());
     ASSERT_EQ(m_wallet.count(), new_wal.count());
 }
+
+TEST_F(WalletTest, persist_journal) {
+    m_wallet.persist(m_wallet_file);
+    const auto journal_file
+        = cbdc::transaction::wallet::journal_file(m_wallet_file);
+    ASSERT_EQ(std::filesystem::file_size(journal_file), 0UL);
+    const auto wallet_size = std::filesystem::file_size(m_wallet_file);
+
+    auto mint_tx = m_wallet.mint_new_coins(2, 50);
+    m_wallet.confirm_transaction(mint_tx);
+    auto pubkey = m_wallet.generate_key();
+    auto send_tx = m_wallet.send_to(30, pubkey, true);
+    ASSERT_TRUE(send_tx.has_value());
+    m_wallet.confirm_transaction(send_tx.value());
+    m_wallet.persist(m_wallet_file);
+
+    // Changes are appended to the journal rather than rewriting the wallet
+    ASSERT_EQ(std::filesystem::file_size(m_wallet_file), wallet_size);
+    ASSERT_GT(std::filesystem::file_size(journal_file), 0UL);
+
+    auto new_wal = cbdc::transaction::wallet();
+    new_wal.load(m_wallet_file);
+    ASSERT_EQ(new_wal.balance(), m_wallet.balance());
+    ASSERT_EQ(new_wal.count(), m_wallet.count());
+
+    // The reloaded wallet can sign for keys added after the wallet file
+    auto tx = new_wal.send_to(new_wal.balance(), pubkey, true);
+    ASSERT_TRUE(tx.has_value());
+    ASSERT_FALSE(cbdc::transaction::validation::check_tx(tx.value()));
+}
+
+TEST_F(WalletTest, persist_after_load) {
+    auto mint_tx = m_wallet.mint_new_coins(2, 50);
+    m_wallet.confirm_transaction(mint_tx);
+    m_wallet.persist(m_wallet_file);
+    const auto wallet_size = std::filesystem::file_size(m_wallet_file);
+
+    // A reloaded wallet keeps appending to the journal it replayed rather
+    // than rewriting the wallet file
+    auto new_wal = cbdc::transaction::wallet();
+    new_wal.load(m_wallet_file);
+    auto mint_tx2 = new_wal.mint_new_coins(1, 50);
+    new_wal.confirm_transaction(mint_tx2);
+    new_wal.persist(m_wallet_file);
+    ASSERT_EQ(std::filesystem::file_size(m_wallet_file), wallet_size);
+    const auto journal_file
+        = cbdc::transaction::wallet::journal_file(m_wallet_file);
+    ASSERT_GT(std::filesystem::file_size(journal_file), 0UL);
+
+    auto reloaded = cbdc::transaction::wallet();
+    reloaded.load(m_wallet_file);
+    ASSERT_EQ(reloaded.balance(), new_wal.balance());
+    ASSERT_EQ(reloaded.count(), 4UL);
+}
+
+TEST_F(WalletTest, persist_torn_journal) {
+    m_wallet.persist(m_wallet_file);
+    auto mint_tx = m_wallet.mint_new_coins(1, 50);
+    m_wallet.confirm_transaction(mint_tx);
+    m_wallet.persist(m_wallet_file);
+    const auto balance = m_wallet.balance();
+
+    // Simulate a crash midway through appending the last change
+    auto mint_tx2 = m_wallet.mint_new_coins(1, 50);
+    m_wallet.confirm_transaction(mint_tx2);
+    m_wallet.persist(m_wallet_file);
+    const auto journal_file
+        = cbdc::transaction::wallet::journal_file(m_wallet_file);
+    const auto torn_size = std::filesystem::file_size(journal_file) - 1;
+    std::filesystem::resize_file(journal_file, torn_size);
+
+    auto new_wal = cbdc::transaction::wallet();
+    new_wal.load(m_wallet_file);
+    ASSERT_EQ(new_wal.balance(), balance);
+    ASSERT_LT(std::filesystem::file_size(journal_file), torn_size);
+}
+
+TEST_F(WalletTest, coin_selection) {
+    auto inputs = std::vector<cbdc::transaction::input>(3);
+    const auto values = std::array<uint64_t, 3>{10, 25, 40};
+    for(size_t i = 0; i < inputs.size(); i++) {
+        inputs[i].m_prevout.m_tx_id = {static_cast<unsigned char>('a' + i)};
+        inputs[i].m_prevout_data.m_value = values[i];
+    }
+    m_wallet.confirm_inputs(inputs);
+    auto pubkey = cbdc::pubkey_t{'z'};
+
+    m_wallet.set_coin_selection(
+        cbdc::transaction::wallet::coin_selection::exact_match);
+    auto tx = m_wallet.send_to(25, pubkey, false);
+    ASSERT_TRUE(tx.has_value());
+    ASSERT_EQ(tx->m_inputs, std::vector{inputs[1]});
+    ASSERT_EQ(tx->m_outputs.size(), 1UL);
+
+    m_wallet.set_coin_selection(
+        cbdc::transaction::wallet::coin_selection::fewest_inputs);
+    tx = m_wallet.send_to(30, pubkey, false);
+    ASSERT_TRUE(tx.has_value());
+    ASSERT_EQ(tx->m_inputs, std::vector{inputs[2]});
+
+    // No single UTXO covers the amount, so spend the largest first
+    tx = m_wallet.send_to(105, pubkey, false);
+    ASSERT_TRUE(tx.has_value());
+    ASSERT_EQ(tx->m_inputs.size(), 2UL);
+    ASSERT_EQ(tx->m_inputs[1], inputs[0]);
+    ASSERT_EQ(m_wallet.count(), 0UL);
+    ASSERT_EQ(m_wallet.balance(), 0UL);
+}
+
+TEST_F(WalletTest, spend_order_after_reclaim) {
+    static constexpr auto n_utxos = 3000;
+    auto inputs = std::vector<cbdc::transaction::input>(n_utxos);
+    for(size_t i = 0; i < inputs.size(); i++) {
+        inputs[i].m_prevout.m_tx_id = {'x'};
+        inputs[i].m_prevout.m_index = i;
+        inputs[i].m_prevout_data.m_value = 1;
+    }
+    m_wallet.confirm_inputs(inputs);
+    auto pubkey = cbdc::pubkey_t{'z'};
+
+    // Spend the minted UTXO and most of the others to reclaim their slots
+    auto tx = m_wallet.send_to(2500, pubkey, false);
+    ASSERT_TRUE(tx.has_value());
+    ASSERT_EQ(tx->m_inputs.size(), 2401UL);
+    ASSERT_EQ(m_wallet.count(), 600UL);
+    ASSERT_EQ(m_wallet.balance(), 600UL);
+
+    m_wallet.save(m_wallet_file);
+    auto new_wal = cbdc::transaction::wallet();
+    new_wal.load(m_wallet_file);
+    for(auto* wal : {&m_wallet, &new_wal}) {
+        tx = wal->send_to(1, 1, pubkey, false);
+        ASSERT_TRUE(tx.has_value());
+        ASSERT_EQ(tx->m_inputs[0], inputs[2400]);
+    }
+}
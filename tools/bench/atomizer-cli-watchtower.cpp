@@ -9,6 +9,7 @@
 #include "uhs/atomizer/watchtower/client.hpp"
 #include "uhs/atomizer/watchtower/watchtower.hpp"
 #include "uhs/sentinel/client.hpp"
+#include "uhs/transaction/corpus.hpp"
 #include "uhs/transaction/messages.hpp"
 #include "uhs/transaction/wallet.hpp"
 #include "util/common/config.hpp"
@@ -124,8 +125,22 @@ auto main(int argc, char** argv) -> int {
 
     cbdc::transaction::wallet wal;
 
+    // Optionally replay a pre-generated corpus rather than generating
+    // transactions
+    auto corpus = std::unique_ptr<cbdc::transaction::corpus_reader>();
+    if(cfg.m_loadgen_corpus.has_value()) {
+        auto corpus_file = cbdc::config::loadgen_corpus_file(cfg, cli_id);
+        corpus = std::make_unique<cbdc::transaction::corpus_reader>(
+            corpus_file);
+        if(!corpus->init()) {
+            log->error("Failed to open corpus file", corpus_file);
+            return -1;
+        }
+        log->info("Replaying", corpus->size(), "transactions");
+    }
+
     // Optionally Pre-seed wallet with deterministic UTXOs
-    if(cfg.m_seed_from != cfg.m_seed_to) {
+    if(!corpus && cfg.m_seed_from != cfg.m_seed_to) {
         auto [range_start, range_end]
             = cbdc::config::loadgen_seed_range(cfg, cli_id);
 
@@ -299,8 +314,8 @@ auto main(int argc, char** argv) -> int {
             block_cv.notify_all();
         });
 
-    // Only mint when not using pre-seeded wallets
-    if(cfg.m_seed_from == cfg.m_seed_to) {
+    // Only mint when not using pre-seeded wallets or a corpus
+    if(!corpus && cfg.m_seed_from == cfg.m_seed_to) {
         const auto& mint_tx = wal.mint_new_coins(cfg.m_initial_mint_count,
                                                  cfg.m_initial_mint_value);
 
@@ -373,8 +388,25 @@ auto main(int argc, char** argv) -> int {
     std::chrono::nanoseconds add_time{};
     std::chrono::nanoseconds send_time{};
     uint64_t gen_avg{};
+
+    // Send times follow a fixed schedule at the configured rate, if any
+    auto send_interval = std::chrono::nanoseconds::zero();
+    if(cfg.m_loadgen_tx_rate != 0) {
+        send_interval = std::chrono::nanoseconds(std::chrono::seconds(1))
+                      / static_cast<std::chrono::nanoseconds::rep>(
+                          cfg.m_loadgen_tx_rate);
+    }
+    auto next_send = std::chrono::steady_clock::now();
+    // Reused across iterations so a replayed corpus decodes into the
+    // buffers of the previous transaction
+    auto pay_tx = cbdc::transaction::full_tx();
     while(running) {
         static constexpr auto send_amount = 5;
+        if(send_interval != std::chrono::nanoseconds::zero()) {
+            std::this_thread::sleep_until(next_send);
+            next_send += send_interval;
+        }
+
         const auto start_time = std::chrono::high_resolution_clock::now();
 
         auto count_in_flight = [&]() {
@@ -383,8 +415,9 @@ auto main(int argc, char** argv) -> int {
         };
 
         while(running
-              && ((wal.balance() < send_amount && !cfg.m_fixed_tx_mode)
-                  || (cfg.m_fixed_tx_mode
+              && ((!corpus && wal.balance() < send_amount
+                   && !cfg.m_fixed_tx_mode)
+                  || (!corpus && cfg.m_fixed_tx_mode
                       && (wal.count() < cfg.m_input_count
                           || wal.balance() / cfg.m_output_count == 0))
                   || (count_in_flight() >= cfg.m_window_size
@@ -417,6 +450,8 @@ auto main(int argc, char** argv) -> int {
                     block_changed = false;
                 }
             }
+            // Don't burst to catch up with the schedule after waiting
+            next_send = std::max(next_send, std::chrono::steady_clock::now());
         }
 
         if(!running) {
@@ -433,7 +468,6 @@ auto main(int argc, char** argv) -> int {
             send_fixed = fixed_dist(engine);
         }
 
-        auto pay_tx = cbdc::transaction::full_tx();
         const auto gen_start_time = std::chrono::high_resolution_clock::now();
         if(send_invalid) {
             std::lock_guard<std::mutex> lg(txs_mut);
@@ -443,6 +477,11 @@ auto main(int argc, char** argv) -> int {
             }
             pay_tx = std::move(confirmed_txs.front());
             confirmed_txs.pop();
+        } else if(corpus) {
+            if(!corpus->next(pay_tx)) {
+                log->info("Replayed all transactions in corpus");
+                break;
+            }
         } else {
             auto gen_s = std::chrono::high_resolution_clock::now();
             if(send_fixed) {
@@ -499,8 +538,10 @@ auto main(int argc, char** argv) -> int {
         const auto add_end_time = std::chrono::high_resolution_clock::now();
 
         if(sign_txs) {
-            sentinel_client->execute_transaction(std::move(pay_tx),
-                                                 [](auto /* resp */) {});
+            // Send without moving out of pay_tx so its buffers are reused
+            // by the next transaction
+            sentinel_client->execute_transaction_ref(pay_tx,
+                                                     [](auto /* resp */) {});
         } else {
             auto send_pkt
                 = send_tx_to_atomizer(cbdc::transaction::compact_tx(pay_tx),
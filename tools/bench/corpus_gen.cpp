@@ -0,0 +1,141 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/transaction/corpus.hpp"
+#include "uhs/transaction/wallet.hpp"
+#include "util/common/config.hpp"
+#include "util/common/logging.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+auto main(int argc, char** argv) -> int {
+    auto args = cbdc::config::get_args(argc, argv);
+    if(args.size() < 3) {
+        std::cerr << "Usage: " << args[0]
+                  << " <config file> <gen ID> [<max TX count>]" << std::endl;
+        return -1;
+    }
+
+    auto cfg_or_err = cbdc::config::load_options(args[1]);
+    if(std::holds_alternative<std::string>(cfg_or_err)) {
+        std::cerr << "Error loading config file: "
+                  << std::get<std::string>(cfg_or_err) << std::endl;
+        return -1;
+    }
+    auto cfg = std::get<cbdc::config::options>(cfg_or_err);
+
+    auto gen_id = std::stoull(args[2]);
+    auto max_txs = std::numeric_limits<uint64_t>::max();
+    if(args.size() > 3) {
+        max_txs = std::stoull(args[3]);
+    }
+
+    auto logger
+        = std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::info);
+
+    if(cfg.m_seed_from == cfg.m_seed_to) {
+        logger->error("Generating a corpus requires a seed range");
+        return -1;
+    }
+    if(!cfg.m_loadgen_corpus.has_value()) {
+        logger->error("Generating a corpus requires a corpus path");
+        return -1;
+    }
+
+    auto corpus_file = cbdc::config::loadgen_corpus_file(cfg, gen_id);
+    auto writer = cbdc::transaction::corpus_writer(corpus_file);
+    if(!writer.init()) {
+        logger->error("Failed to create corpus file", corpus_file);
+        return -1;
+    }
+
+    // Each thread spends from its own share of the seeded UTXOs. Transactions
+    // only spend seeded outputs so they can be replayed in any order.
+    auto [range_start, range_end]
+        = cbdc::config::loadgen_seed_range(cfg, gen_id);
+    const auto n_workers = cfg.m_loadgen_threads;
+    const auto worker_range = (range_end - range_start) / n_workers;
+
+    auto writer_mut = std::mutex();
+    auto generated = std::atomic<uint64_t>();
+    auto failed = std::atomic_bool();
+    auto workers = std::vector<std::thread>();
+    for(size_t i = 0; i < n_workers; i++) {
+        workers.emplace_back([&, i]() {
+            auto wallet = cbdc::transaction::wallet();
+            auto begin = range_start + (i * worker_range);
+            auto end = i + 1 == n_workers ? range_end : begin + worker_range;
+            if(!wallet.seed(cfg.m_seed_privkey.value(),
+                            static_cast<uint32_t>(cfg.m_seed_value),
+                            begin,
+                            end)) {
+                logger->error("Initial seed failed");
+                failed = true;
+                return;
+            }
+
+            auto engine = std::default_random_engine(
+                static_cast<std::default_random_engine::result_type>(i));
+            auto fixed_dist = std::bernoulli_distribution(cfg.m_fixed_tx_rate);
+            constexpr auto send_amt = 5;
+            static constexpr size_t write_batch_size = 1000;
+            auto batch = std::vector<cbdc::transaction::full_tx>();
+            auto done = false;
+            while(!done && !failed) {
+                auto tx = std::optional<cbdc::transaction::full_tx>();
+                if(generated++ < max_txs) {
+                    if(cfg.m_fixed_tx_mode && cfg.m_fixed_tx_rate > 0.0) {
+                        if(fixed_dist(engine)) {
+                            tx = wallet.send_to(cfg.m_input_count,
+                                                cfg.m_output_count,
+                                                wallet.generate_key(),
+                                                true);
+                        } else {
+                            tx = wallet.send_to(2,
+                                                2,
+                                                wallet.generate_key(),
+                                                true);
+                        }
+                    } else {
+                        tx = wallet.send_to(send_amt,
+                                            wallet.generate_key(),
+                                            true);
+                    }
+                }
+
+                // Stop once the seeded outputs are spent or the corpus is
+                // full
+                done = !tx.has_value();
+                if(!done) {
+                    batch.push_back(std::move(tx.value()));
+                }
+                if(batch.size() == write_batch_size
+                   || (done && !batch.empty())) {
+                    std::lock_guard l(writer_mut);
+                    if(!writer.append(batch)) {
+                        logger->error("Failed to write to corpus file");
+                        failed = true;
+                    }
+                    batch.clear();
+                }
+            }
+        });
+    }
+
+    for(auto& worker : workers) {
+        worker.join();
+    }
+
+    if(failed || !writer.close()) {
+        logger->error("Failed to generate corpus", corpus_file);
+        return -1;
+    }
+
+    logger->info("Wrote", writer.size(), "transactions to", corpus_file);
+
+    return 0;
+}
@@ -20,7 +20,8 @@ evm_bench::evm_bench(size_t loadgen_id,
                      cbdc::parsec::config cfg,
                      std::shared_ptr<cbdc::logging::log> log,
                      std::shared_ptr<geth_client> client)
-    : m_loadgen_id(loadgen_id),
+    : m_loadgen(cfg),
+      m_loadgen_id(loadgen_id),
       m_cfg(std::move(cfg)),
       m_log(std::move(log)),
       m_client(std::move(client)) {
@@ -43,11 +44,13 @@ evm_bench::evm_bench(size_t loadgen_id,
     m_init_addr = acc.second;
     m_init_skey = acc.first;
 
-    m_contention_dist = decltype(m_contention_dist)(cfg.m_contention_rate);
-
-    m_samples_file
-        = std::ofstream("tx_samples_" + std::to_string(m_loadgen_id) + ".txt",
-                        std::ios::trunc);
+    // Per-transaction samples are only logged in closed-loop mode
+    if(!m_loadgen.open_loop()) {
+        m_samples_file = std::ofstream("tx_samples_"
+                                           + std::to_string(m_loadgen_id)
+                                           + ".txt",
+                                       std::ios::trunc);
+    }
 }
 
 auto evm_bench::gen_tx(evmc::uint256be nonce,
@@ -283,6 +286,17 @@ void evm_bench::deploy() {
 }
 
 void evm_bench::schedule_tx(size_t from, size_t to) {
+    if(m_loadgen.open_loop()) {
+        m_idle_pairs.emplace_back(from, to);
+        return;
+    }
+    send_tx(from, to, cbdc::parsec::load_generator::clock_type::now());
+}
+
+void evm_bench::send_tx(
+    size_t from,
+    size_t to,
+    cbdc::parsec::load_generator::clock_type::time_point start_time) {
     auto send_amt = evmc::uint256be(1);
     auto& tx_from_addr = m_accounts[from].second;
     auto original_to = to;
@@ -298,7 +312,7 @@ void evm_bench::schedule_tx(size_t from, size_t to) {
         to = from;
         from = 0;
         tx_from_addr = m_accounts[from].second;
-    } else if(m_contention_dist(m_engine)) {
+    } else if(m_loadgen.contended()) {
         // For m_contention_rate portion of transactions,
         // send to account 0
         to = 0;
@@ -314,7 +328,6 @@ void evm_bench::schedule_tx(size_t from, size_t to) {
             = send_erc20(m_erc20_addr, nonce, to_addr, acc_skey, send_amt);
     }
     nonce = nonce + evmc::uint256be(1);
-    auto start_time = std::chrono::high_resolution_clock::now();
     m_in_flight++;
     m_client->send_transaction(
         send_tx_hex,
@@ -347,11 +360,16 @@ void evm_bench::schedule_tx(size_t from, size_t to) {
             from_bal = from_bal - evmc::uint256be(send_amt);
             to_bal = to_bal + evmc::uint256be(send_amt);
 
-            auto end_time = std::chrono::high_resolution_clock::now();
-            auto latency = (end_time - start_time).count();
+            auto end_time = cbdc::parsec::load_generator::clock_type::now();
+            m_loadgen.record(start_time, end_time);
             m_in_flight--;
-            m_samples_file << end_time.time_since_epoch().count() << " "
-                           << latency << "\n";
+            if(!m_loadgen.open_loop()) {
+                auto latency = (end_time - start_time).count();
+                m_samples_file << std::chrono::high_resolution_clock::now()
+                                      .time_since_epoch()
+                                      .count()
+                               << " " << latency << "\n";
+            }
 
             if(m_running) {
                 if(to != original_to) {
@@ -375,7 +393,11 @@ auto evm_bench::pump() -> std::optional<bool> {
         m_done = false;
         return m_success;
     }
-    if(m_in_flight == 0) {
+    // Open-loop load keeps running between arrivals with nothing in flight
+    auto open_loop_active = m_loadgen.open_loop()
+                         && (!m_idle_pairs.empty()
+                             || m_next_arrival.has_value());
+    if(m_in_flight == 0 && (!open_loop_active || !m_running)) {
         return !m_error;
     }
     if(!m_running) {
@@ -387,6 +409,10 @@ auto evm_bench::pump() -> std::optional<bool> {
         return false;
     }
 
+    if(open_loop_active) {
+        dispatch();
+    }
+
     if(!m_start_time.has_value() && m_txs > 0) {
         m_start_time = std::chrono::high_resolution_clock::now();
     }
@@ -407,6 +433,31 @@ auto evm_bench::pump() -> std::optional<bool> {
     return std::nullopt;
 }
 
+void evm_bench::dispatch() {
+    auto now = cbdc::parsec::load_generator::clock_type::now();
+    if(!m_next_arrival.has_value()) {
+        m_next_arrival = m_loadgen.next_arrival();
+    }
+    while(m_next_arrival.value() <= now) {
+        m_backlog.push_back(m_next_arrival.value());
+        m_next_arrival = m_loadgen.next_arrival();
+    }
+
+    // Arrivals without a ready pair wait in the backlog, and the wait counts
+    // towards their latency
+    while(!m_backlog.empty() && !m_idle_pairs.empty()) {
+        auto [from, to] = m_idle_pairs.front();
+        m_idle_pairs.pop_front();
+        send_tx(from, to, m_backlog.front());
+        m_backlog.pop_front();
+    }
+}
+
 auto evm_bench::account_count() const -> size_t {
     return m_accounts.size();
 }
+
+auto evm_bench::write_summary() const -> bool {
+    return m_loadgen.write_summary("tx_latency_"
+                                   + std::to_string(m_loadgen_id) + ".txt");
+}
@@ -6,6 +6,7 @@
 #ifndef OPENCBDC_TX_TOOLS_BENCH_PARSEC_EVM_EVM_BENCH_H_
 #define OPENCBDC_TX_TOOLS_BENCH_PARSEC_EVM_EVM_BENCH_H_
 
+#include "load_generator.hpp"
 #include "parsec/util.hpp"
 #include "rpc_client.hpp"
 #include "util/common/config.hpp"
@@ -13,6 +14,7 @@
 #include "util/common/random_source.hpp"
 
 #include <atomic>
+#include <deque>
 #include <evmc/evmc.hpp>
 #include <memory>
 #include <random>
@@ -36,7 +38,10 @@ class evm_bench {
     void deploy();
 
     /// Schedule a value 1 transacton to be sent
-    /// from `from` to `to`.
+    /// from `from` to `to`. In closed-loop mode the transaction is sent
+    /// immediately and the pair keeps transacting back and forth. In
+    /// open-loop mode the pair is sent at the next arrival scheduled by the
+    /// load generator.
     /// \param from ID to send transaction from
     /// \param to ID to send transaction to
     void schedule_tx(size_t from, size_t to);
@@ -52,6 +57,11 @@ class evm_bench {
     /// Return the number of accounts.
     auto account_count() const -> size_t;
 
+    /// Write the transaction latency percentiles recorded during load
+    /// generation to tx_latency_<loadgen_id>.txt.
+    /// \return true if the summary was written successfully.
+    auto write_summary() const -> bool;
+
   private:
     static constexpr size_t m_coins_per_account = 50;
     const evmc::uint256be m_val_per_acc{m_coins_per_account};
@@ -62,8 +72,15 @@ class evm_bench {
         &secp256k1_context_destroy};
     cbdc::random_source m_rnd{cbdc::config::random_source};
 
-    std::default_random_engine m_engine;
-    std::bernoulli_distribution m_contention_dist;
+    cbdc::parsec::load_generator m_loadgen;
+
+    // Account pairs ready to send their next transaction, and arrivals
+    // waiting for a ready pair, in open-loop mode
+    std::deque<std::pair<size_t, size_t>> m_idle_pairs;
+    std::deque<cbdc::parsec::load_generator::clock_type::time_point>
+        m_backlog;
+    std::optional<cbdc::parsec::load_generator::clock_type::time_point>
+        m_next_arrival;
 
     size_t m_loadgen_id;
     cbdc::parsec::config m_cfg;
@@ -119,6 +136,13 @@ class evm_bench {
                   size_t depth);
 
     void mint_tree(size_t depth, cbdc::privkey_t acc_skey);
+
+    void
+    send_tx(size_t from,
+            size_t to,
+            cbdc::parsec::load_generator::clock_type::time_point start_time);
+
+    void dispatch();
 };
 
 #endif
@@ -74,6 +74,10 @@ auto main(int argc, char** argv) -> int {
         success = bench.pump();
     }
 
+    if(!bench.write_summary()) {
+        log->error("Unable to write latency summary");
+    }
+
     if(!success.value()) {
         log->error("Error during load generation");
         return 5;
@@ -0,0 +1,95 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "load_generator.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+namespace cbdc::parsec {
+    load_generator::load_generator(const config& cfg)
+        : m_target_tps(cfg.m_target_tps),
+          m_arrival_type(cfg.m_arrival_type),
+          m_engine(static_cast<std::default_random_engine::result_type>(
+              clock_type::now().time_since_epoch().count())),
+          m_contention_dist(cfg.m_contention_rate) {
+        if(open_loop()) {
+            m_interval_dist = decltype(m_interval_dist)(m_target_tps);
+        }
+    }
+
+    auto load_generator::open_loop() const -> bool {
+        return m_target_tps > 0.0;
+    }
+
+    auto load_generator::next_arrival() -> clock_type::time_point {
+        std::unique_lock l(m_mut);
+        if(!m_next_arrival.has_value()) {
+            m_next_arrival = clock_type::now();
+            return m_next_arrival.value();
+        }
+        auto interval_secs = 1.0 / m_target_tps;
+        if(m_arrival_type == arrival_type::poisson) {
+            interval_secs = m_interval_dist(m_engine);
+        }
+        auto interval
+            = std::chrono::duration_cast<clock_type::duration>(
+                std::chrono::duration<double>(interval_secs));
+        m_next_arrival.value() += interval;
+        return m_next_arrival.value();
+    }
+
+    auto load_generator::contended() -> bool {
+        std::unique_lock l(m_mut);
+        return m_contention_dist(m_engine);
+    }
+
+    void load_generator::record(clock_type::time_point start,
+                                clock_type::time_point end) {
+        auto latency = std::max(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start),
+            std::chrono::nanoseconds::zero());
+        std::unique_lock l(m_mut);
+        m_latencies.record(static_cast<uint64_t>(latency.count()));
+        if(!m_first_start.has_value() || start < m_first_start.value()) {
+            m_first_start = start;
+        }
+        if(!m_last_end.has_value() || end > m_last_end.value()) {
+            m_last_end = end;
+        }
+    }
+
+    auto load_generator::write_summary(const std::string& path) const
+        -> bool {
+        auto out = std::ofstream(path, std::ios::trunc);
+        if(!out.good()) {
+            return false;
+        }
+
+        std::unique_lock l(m_mut);
+        auto tps = 0.0;
+        if(m_first_start.has_value()) {
+            auto elapsed = std::chrono::duration<double>(m_last_end.value()
+                                                         - m_first_start.value())
+                               .count();
+            if(elapsed > 0.0) {
+                tps = static_cast<double>(m_latencies.count()) / elapsed;
+            }
+        }
+
+        constexpr auto p50 = 50.0;
+        constexpr auto p99 = 99.0;
+        constexpr auto p999 = 99.9;
+        out << "target_tps " << m_target_tps << "\n"
+            << "count " << m_latencies.count() << "\n"
+            << "tps " << tps << "\n"
+            << "min " << m_latencies.min() << "\n"
+            << "p50 " << m_latencies.value_at_percentile(p50) << "\n"
+            << "p99 " << m_latencies.value_at_percentile(p99) << "\n"
+            << "p99.9 " << m_latencies.value_at_percentile(p999) << "\n"
+            << "max " << m_latencies.max() << "\n";
+        return out.good();
+    }
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_TOOLS_BENCH_PARSEC_LOAD_GENERATOR_H_
+#define OPENCBDC_TX_TOOLS_BENCH_PARSEC_LOAD_GENERATOR_H_
+
+#include "parsec/util.hpp"
+#include "util/common/hdr_histogram.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <random>
+
+namespace cbdc::parsec {
+    /// Load generation harness shared by the PArSEC benchmark runners.
+    /// Schedules transaction arrivals at the configured target rate for
+    /// open-loop load generation, picks contended transactions at the
+    /// configured contention rate, and collects end-to-end latencies in an
+    /// HDR histogram. In open-loop mode latencies are measured from each
+    /// transaction's scheduled arrival time rather than when it was sent, so
+    /// queueing delay in the load generator is included. Thread-safe.
+    class load_generator {
+      public:
+        /// Clock used for arrival scheduling and latency measurement.
+        using clock_type = std::chrono::steady_clock;
+
+        /// Constructor.
+        /// \param cfg benchmark configuration. Uses the target TPS, arrival
+        ///            type and contention rate.
+        explicit load_generator(const config& cfg);
+
+        /// Returns whether the generator is configured for open-loop load.
+        /// \return true if a target TPS is set.
+        [[nodiscard]] auto open_loop() const -> bool;
+
+        /// Returns the next scheduled arrival time and advances the
+        /// schedule. The first call starts the schedule at the current time.
+        /// The schedule does not slip if the caller falls behind, so late
+        /// arrivals should be sent immediately.
+        /// \return scheduled arrival time of the next transaction.
+        auto next_arrival() -> clock_type::time_point;
+
+        /// Returns whether the next transaction should target the shared
+        /// contended account.
+        /// \return true with probability equal to the contention rate.
+        auto contended() -> bool;
+
+        /// Records the latency of a completed transaction.
+        /// \param start time the transaction was scheduled or sent.
+        /// \param end time the transaction completed.
+        void record(clock_type::time_point start, clock_type::time_point end);
+
+        /// Writes the number of completed transactions, achieved throughput
+        /// and latency percentiles in nanoseconds to the given file.
+        /// \param path file to write.
+        /// \return true if the file was written successfully.
+        auto write_summary(const std::string& path) const -> bool;
+
+      private:
+        double m_target_tps;
+        arrival_type m_arrival_type;
+
+        mutable std::mutex m_mut;
+        std::default_random_engine m_engine;
+        std::bernoulli_distribution m_contention_dist;
+        std::exponential_distribution<double> m_interval_dist;
+        std::optional<clock_type::time_point> m_next_arrival;
+
+        hdr_histogram m_latencies;
+        std::optional<clock_type::time_point> m_first_start;
+        std::optional<clock_type::time_point> m_last_end;
+    };
+}
+
+#endif
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "crypto/sha256.h"
+#include "load_generator.hpp"
 #include "parsec/agent/client.hpp"
 #include "parsec/broker/impl.hpp"
 #include "parsec/directory/impl.hpp"
@@ -178,12 +179,19 @@ auto main(int argc, char** argv) -> int {
 
     log->info("Added new accounts");
 
+    auto loadgen = cbdc::parsec::load_generator(cfg.value());
+
+    // Per-transaction samples are only logged in closed-loop mode. Open-loop
+    // runs report latency percentiles from the load generator instead.
     std::mutex samples_mut;
-    auto samples_file = std::ofstream(
-        "tx_samples_" + std::to_string(cfg->m_component_id) + ".txt");
-    if(!samples_file.good()) {
-        log->error("Unable to open samples file");
-        return 1;
+    auto samples_file = std::ofstream();
+    if(!loadgen.open_loop()) {
+        samples_file.open("tx_samples_" + std::to_string(cfg->m_component_id)
+                          + ".txt");
+        if(!samples_file.good()) {
+            log->error("Unable to open samples file");
+            return 1;
+        }
     }
 
     auto pay_queue = cbdc::blocking_queue<size_t>();
@@ -202,51 +210,86 @@ auto main(int argc, char** argv) -> int {
     auto running = std::atomic_bool(true);
     auto in_flight = std::atomic<size_t>();
 
-    auto thread_count = std::thread::hardware_concurrency();
+    // Pays from the given wallet to a random wallet, or to wallet zero for
+    // the configured share of contended transactions. Latency is measured
+    // from tx_start.
+    auto pay = [&](size_t from,
+                   cbdc::parsec::load_generator::clock_type::time_point
+                       tx_start) {
+        size_t to{};
+        if(from != 0 && loadgen.contended()) {
+            to = 0;
+        } else {
+            do {
+                to = dist(rng);
+            } while(from == to);
+        }
+        auto to_key = wallets[to].get_pubkey();
+        log->trace("Paying from", from, "to", to);
+        pay_times[from] = std::chrono::high_resolution_clock::now()
+                              .time_since_epoch()
+                              .count();
+        in_flight++;
+        auto res = wallets[from].pay(
+            to_key,
+            1,
+            [&, tx_start, from, to](bool ret) {
+                if(!ret) {
+                    log->fatal("Pay request error");
+                }
+                auto tx_end = cbdc::parsec::load_generator::clock_type::now();
+                loadgen.record(tx_start, tx_end);
+                if(!loadgen.open_loop()) {
+                    const auto tx_delay = tx_end - tx_start;
+                    auto out_buf = std::stringstream();
+                    out_buf << std::chrono::high_resolution_clock::now()
+                                   .time_since_epoch()
+                                   .count()
+                            << " " << tx_delay.count() << "\n";
+                    auto out_str = out_buf.str();
+                    {
+                        std::unique_lock l(samples_mut);
+                        samples_file << out_str;
+                    }
+                }
+                log->trace("Done paying from", from, "to", to);
+                if(running) {
+                    pay_queue.push(from);
+                }
+                in_flight--;
+            });
+        if(!res) {
+            log->fatal("Pay request failed");
+        }
+    };
+
     auto threads = std::vector<std::thread>();
-    for(size_t i = 0; i < thread_count; i++) {
-        auto t = std::thread([&]() {
-            size_t from{};
-            while(pay_queue.pop(from)) {
-                size_t to{};
-                do {
-                    to = dist(rng);
-                } while(from == to);
-                auto to_key = wallets[to].get_pubkey();
-                log->trace("Paying from", from, "to", to);
-                auto tx_start = std::chrono::high_resolution_clock::now();
-                pay_times[from] = tx_start.time_since_epoch().count();
-                in_flight++;
-                auto res = wallets[from].pay(
-                    to_key,
-                    1,
-                    [&, tx_start, from, to](bool ret) {
-                        if(!ret) {
-                            log->fatal("Pay request error");
-                        }
-                        auto tx_end
-                            = std::chrono::high_resolution_clock::now();
-                        const auto tx_delay = tx_end - tx_start;
-                        auto out_buf = std::stringstream();
-                        out_buf << tx_end.time_since_epoch().count() << " "
-                                << tx_delay.count() << "\n";
-                        auto out_str = out_buf.str();
-                        {
-                            std::unique_lock l(samples_mut);
-                            samples_file << out_str;
-                        }
-                        log->trace("Done paying from", from, "to", to);
-                        if(running) {
-                            pay_queue.push(from);
-                        }
-                        in_flight--;
-                    });
-                if(!res) {
-                    log->fatal("Pay request failed");
+    if(loadgen.open_loop()) {
+        // A single dispatcher sends transactions at their scheduled arrival
+        // times. When every wallet is busy the arrival waits for a wallet,
+        // and that queueing delay is counted in its latency.
+        threads.emplace_back([&]() {
+            while(running) {
+                auto arrival = loadgen.next_arrival();
+                std::this_thread::sleep_until(arrival);
+                size_t from{};
+                if(!pay_queue.pop(from)) {
+                    break;
                 }
+                pay(from, arrival);
             }
         });
-        threads.emplace_back(std::move(t));
+    } else {
+        auto thread_count = std::thread::hardware_concurrency();
+        for(size_t i = 0; i < thread_count; i++) {
+            threads.emplace_back([&]() {
+                size_t from{};
+                while(pay_queue.pop(from)) {
+                    pay(from,
+                        cbdc::parsec::load_generator::clock_type::now());
+                }
+            });
+        }
     }
 
     auto start_time = std::chrono::high_resolution_clock::now();
@@ -278,6 +321,12 @@ auto main(int argc, char** argv) -> int {
         t.join();
     }
 
+    if(!loadgen.write_summary("tx_latency_"
+                              + std::to_string(cfg->m_component_id)
+                              + ".txt")) {
+        log->error("Unable to write latency summary");
+    }
+
     log->trace("Checking balances");
 
     auto tot = std::atomic<uint64_t>{};
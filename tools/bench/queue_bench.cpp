@@ -0,0 +1,116 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/blocking_queue.hpp"
+#include "util/common/bounded_queue.hpp"
+#include "util/common/config.hpp"
+#include "util/common/logging.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace {
+    /// Passes the given number of items from each producer to the
+    /// consumers through the queue and returns the elapsed time.
+    template<typename Q>
+    auto run(Q& queue,
+             size_t n_producers,
+             size_t n_consumers,
+             uint64_t n_items) -> std::chrono::nanoseconds {
+        auto consumed = std::atomic<uint64_t>();
+        auto start = std::chrono::high_resolution_clock::now();
+
+        auto consumers = std::vector<std::thread>();
+        for(size_t i = 0; i < n_consumers; i++) {
+            consumers.emplace_back([&]() {
+                uint64_t item{};
+                while(queue.pop(item)) {
+                    consumed++;
+                }
+            });
+        }
+        auto producers = std::vector<std::thread>();
+        for(size_t i = 0; i < n_producers; i++) {
+            producers.emplace_back([&]() {
+                for(uint64_t j = 0; j < n_items; j++) {
+                    queue.push(j);
+                }
+            });
+        }
+
+        for(auto& t : producers) {
+            t.join();
+        }
+        while(consumed < n_producers * n_items) {
+            std::this_thread::yield();
+        }
+        auto elapsed = std::chrono::high_resolution_clock::now() - start;
+
+        queue.clear();
+        for(auto& t : consumers) {
+            t.join();
+        }
+        return elapsed;
+    }
+}
+
+auto main(int argc, char** argv) -> int {
+    auto args = cbdc::config::get_args(argc, argv);
+    if(args.size() < 3) {
+        std::cerr << "Usage: " << args[0]
+                  << " <producers> <consumers> [<items per producer>]"
+                  << " [<capacity>]" << std::endl;
+        return -1;
+    }
+
+    auto n_producers = std::stoull(args[1]);
+    auto n_consumers = std::stoull(args[2]);
+    static constexpr uint64_t default_items{1000000};
+    auto n_items = args.size() > 3 ? std::stoull(args[3]) : default_items;
+    static constexpr size_t default_capacity{65536};
+    auto capacity = args.size() > 4 ? std::stoull(args[4]) : default_capacity;
+    if(n_producers == 0 || n_consumers == 0) {
+        std::cerr << "Need at least one producer and consumer" << std::endl;
+        return -1;
+    }
+
+    auto logger
+        = std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::info);
+    auto report = [&](const std::string& name,
+                      std::chrono::nanoseconds elapsed) {
+        auto secs = std::chrono::duration<double>(elapsed).count();
+        logger->info(name,
+                     "moved",
+                     n_producers * n_items,
+                     "items in",
+                     secs,
+                     "s,",
+                     static_cast<double>(n_producers * n_items) / secs,
+                     "items/s");
+    };
+
+    logger->info("Running with",
+                 n_producers,
+                 "producers,",
+                 n_consumers,
+                 "consumers");
+    {
+        auto q = cbdc::blocking_queue<uint64_t>();
+        report("blocking_queue",
+               run(q, n_producers, n_consumers, n_items));
+    }
+    {
+        auto q = cbdc::mpmc_queue<uint64_t>(capacity);
+        report("mpmc_queue", run(q, n_producers, n_consumers, n_items));
+    }
+    if(n_consumers == 1) {
+        auto q = cbdc::mpsc_queue<uint64_t>(capacity);
+        report("mpsc_queue", run(q, n_producers, n_consumers, n_items));
+    }
+
+    return 0;
+}
@@ -5,6 +5,7 @@
 
 #include "uhs/sentinel/client.hpp"
 #include "uhs/sentinel/format.hpp"
+#include "uhs/transaction/corpus.hpp"
 #include "uhs/transaction/messages.hpp"
 #include "uhs/transaction/wallet.hpp"
 #include "uhs/twophase/coordinator/client.hpp"
@@ -14,9 +15,76 @@
 #include "util/network/connection_manager.hpp"
 #include "util/serialization/format.hpp"
 
+#include <algorithm>
 #include <csignal>
 #include <iostream>
 
+namespace {
+    /// Bounded single-producer, single-consumer ring of signed transactions
+    /// waiting to be sent.
+    class presign_ring {
+      public:
+        /// Constructor.
+        /// \param capacity maximum number of transactions in the ring.
+        explicit presign_ring(size_t capacity) : m_slots(capacity + 1) {}
+
+        /// Adds a transaction to the ring. Call from the producer thread
+        /// only.
+        /// \param tx transaction to add. Left unchanged if the ring is full.
+        /// \return true if the transaction was added, false if the ring is
+        ///         full.
+        auto try_push(cbdc::transaction::full_tx& tx) -> bool {
+            const auto tail = m_tail.load(std::memory_order_relaxed);
+            const auto next = (tail + 1) % m_slots.size();
+            if(next == m_head.load(std::memory_order_acquire)) {
+                return false;
+            }
+            m_slots[tail] = std::move(tx);
+            m_tail.store(next, std::memory_order_release);
+            return true;
+        }
+
+        /// Removes the oldest transaction from the ring. Call from the
+        /// consumer thread only.
+        /// \param tx transaction into which to move the removed transaction.
+        /// \return true if a transaction was removed, false if the ring is
+        ///         empty.
+        auto try_pop(cbdc::transaction::full_tx& tx) -> bool {
+            const auto head = m_head.load(std::memory_order_relaxed);
+            if(head == m_tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            tx = std::move(m_slots[head]);
+            m_head.store((head + 1) % m_slots.size(),
+                         std::memory_order_release);
+            return true;
+        }
+
+        /// Returns the number of transactions in the ring.
+        /// \return approximate number of transactions in the ring.
+        [[nodiscard]] auto size() const -> size_t {
+            const auto head = m_head.load(std::memory_order_relaxed);
+            const auto tail = m_tail.load(std::memory_order_relaxed);
+            return (tail + m_slots.size() - head) % m_slots.size();
+        }
+
+      private:
+        std::vector<cbdc::transaction::full_tx> m_slots;
+        std::atomic<size_t> m_head{0};
+        std::atomic<size_t> m_tail{0};
+    };
+
+    /// Generation thread state. Each worker spends from its own wallet so
+    /// workers never contend for UTXOs.
+    struct gen_worker {
+        explicit gen_worker(size_t presign_depth) : m_ring(presign_depth) {}
+
+        cbdc::transaction::wallet m_wallet;
+        presign_ring m_ring;
+        std::thread m_thread;
+    };
+}
+
 auto main(int argc, char** argv) -> int {
     auto args = cbdc::config::get_args(argc, argv);
     if(args.size() < 3) {
@@ -40,78 +108,114 @@ auto main(int argc, char** argv) -> int {
     auto sha2_impl = SHA256AutoDetect();
     logger->info("using sha2: ", sha2_impl);
 
-    auto engine = std::default_random_engine();
-    auto invalid_dist = std::bernoulli_distribution(cfg.m_invalid_rate);
-    auto fixed_dist = std::bernoulli_distribution(cfg.m_fixed_tx_rate);
+    // Optionally replay a pre-generated corpus rather than generating
+    // transactions
+    auto corpus = std::unique_ptr<cbdc::transaction::corpus_reader>();
+    if(cfg.m_loadgen_corpus.has_value()) {
+        auto corpus_file = cbdc::config::loadgen_corpus_file(cfg, gen_id);
+        corpus = std::make_unique<cbdc::transaction::corpus_reader>(
+            corpus_file);
+        if(!corpus->init()) {
+            logger->error("Failed to open corpus file", corpus_file);
+            return -1;
+        }
+        logger->info("Replaying", corpus->size(), "transactions");
+    }
 
-    auto wallet = cbdc::transaction::wallet();
+    // Only mint when not pre-seeding. Every minting worker needs at least
+    // one output to spend, so there are no more workers than mints.
+    const auto minting = !corpus && cfg.m_seed_from == cfg.m_seed_to;
+    auto n_workers = corpus ? 0 : cfg.m_loadgen_threads;
+    if(minting) {
+        n_workers = std::min(n_workers,
+                             std::max(cfg.m_initial_mint_count, size_t{1}));
+    }
+    auto workers = std::vector<std::unique_ptr<gen_worker>>();
+    for(size_t i = 0; i < n_workers; i++) {
+        workers.emplace_back(
+            std::make_unique<gen_worker>(cfg.m_loadgen_presign_depth));
+    }
 
-    // Optionally Pre-seed wallet with deterministic UTXOs
-    if(cfg.m_seed_from != cfg.m_seed_to) {
+    // Optionally Pre-seed wallets with deterministic UTXOs, splitting this
+    // generator's range between the workers
+    if(!corpus && cfg.m_seed_from != cfg.m_seed_to) {
         auto [range_start, range_end]
             = cbdc::config::loadgen_seed_range(cfg, gen_id);
 
-        bool ret = wallet.seed(cfg.m_seed_privkey.value(),
-                               cfg.m_seed_value,
-                               range_start,
-                               range_end);
-        if(!ret) {
-            logger->error("Initial seed failed");
-            return -1;
+        auto worker_range = (range_end - range_start) / n_workers;
+        for(size_t i = 0; i < n_workers; i++) {
+            auto begin = range_start + (i * worker_range);
+            auto end = i + 1 == n_workers ? range_end : begin + worker_range;
+            bool ret = workers[i]->m_wallet.seed(cfg.m_seed_privkey.value(),
+                                                 cfg.m_seed_value,
+                                                 begin,
+                                                 end);
+            if(!ret) {
+                logger->error("Initial seed failed");
+                return -1;
+            }
         }
-        logger->info("Using pre-seeded wallet with UTXOs",
+        logger->info("Using pre-seeded wallets with UTXOs",
                      range_start,
                      "-",
                      range_end);
     }
 
-    // Only mint when not pre-seeding
-    if(cfg.m_seed_from == cfg.m_seed_to) {
+    if(minting) {
         auto coordinator_client
             = cbdc::coordinator::rpc::client(cfg.m_coordinator_endpoints[0]);
         if(!coordinator_client.init()) {
             logger->warn("Failed to connect to coordinator");
         }
 
-        auto mint_tx = wallet.mint_new_coins(cfg.m_initial_mint_count,
-                                             cfg.m_initial_mint_value);
-
-        auto compact_mint_tx = cbdc::transaction::compact_tx(mint_tx);
         auto secp = std::unique_ptr<secp256k1_context,
                                     decltype(&secp256k1_context_destroy)>{
             secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
             &secp256k1_context_destroy};
-        for(size_t i = 0; i < cfg.m_attestation_threshold; i++) {
-            auto att = compact_mint_tx.sign(secp.get(),
-                                            cfg.m_sentinel_private_keys[i]);
-            compact_mint_tx.m_attestations.insert(att);
-        }
 
-        auto mint_successful = std::promise<bool>();
-        auto mint_successful_fut = mint_successful.get_future();
-        auto send_successful = coordinator_client.execute_transaction(
-            compact_mint_tx,
-            [&](std::optional<bool> resp) {
-                if(!resp.has_value()) {
-                    mint_successful.set_value(false);
-                    return;
-                }
-                mint_successful.set_value(resp.value());
-            });
+        // Spread the remainder over the first workers
+        const auto worker_mint_count = cfg.m_initial_mint_count / n_workers;
+        const auto extra_mints = cfg.m_initial_mint_count % n_workers;
+        for(size_t i = 0; i < n_workers; i++) {
+            auto& wallet = workers[i]->m_wallet;
+            auto mint_count = worker_mint_count + (i < extra_mints ? 1 : 0);
+            auto mint_tx
+                = wallet.mint_new_coins(mint_count, cfg.m_initial_mint_value);
+
+            auto compact_mint_tx = cbdc::transaction::compact_tx(mint_tx);
+            for(size_t j = 0; j < cfg.m_attestation_threshold; j++) {
+                auto att = compact_mint_tx.sign(
+                    secp.get(),
+                    cfg.m_sentinel_private_keys[j]);
+                compact_mint_tx.m_attestations.insert(att);
+            }
 
-        if(!send_successful) {
-            logger->error("Failed to send mint TX to coordinator");
-            return -1;
-        }
+            auto mint_successful = std::promise<bool>();
+            auto mint_successful_fut = mint_successful.get_future();
+            auto send_successful = coordinator_client.execute_transaction(
+                compact_mint_tx,
+                [&](std::optional<bool> resp) {
+                    if(!resp.has_value()) {
+                        mint_successful.set_value(false);
+                        return;
+                    }
+                    mint_successful.set_value(resp.value());
+                });
 
-        logger->info("Waiting for mint confirmation");
-        auto mint_result = mint_successful_fut.get();
-        if(!mint_result) {
-            logger->error("Mint TX failed");
-            return -1;
-        }
+            if(!send_successful) {
+                logger->error("Failed to send mint TX to coordinator");
+                return -1;
+            }
 
-        wallet.confirm_transaction(mint_tx);
+            logger->info("Waiting for mint confirmation");
+            auto mint_result = mint_successful_fut.get();
+            if(!mint_result) {
+                logger->error("Mint TX failed");
+                return -1;
+            }
+
+            wallet.confirm_transaction(mint_tx);
+        }
         logger->info("Mint confirmed");
     }
 
@@ -119,7 +223,8 @@ auto main(int argc, char** argv) -> int {
     auto status_client = cbdc::locking_shard::rpc::status_client(
         cfg.m_locking_shard_readonly_endpoints,
         cfg.m_shard_ranges,
-        lookup_timeout);
+        lookup_timeout,
+        cfg.m_shard_read_max_lag);
     if(!status_client.init()) {
         logger->warn("Failed to connect to shard read-only endpoints");
     }
@@ -130,71 +235,95 @@ auto main(int argc, char** argv) -> int {
         logger->warn("Failed to connect to sentinel");
     }
 
-    auto confirmed_txs = std::queue<cbdc::transaction::full_tx>();
+    using confirmed_tx = std::pair<cbdc::transaction::full_tx, gen_worker*>;
+    auto confirmed_txs = std::queue<confirmed_tx>();
     auto confirmed_txs_mut = std::mutex();
 
     std::ofstream latency_log("tx_samples_" + std::to_string(gen_id) + ".txt");
 
-    auto second_conf_queue = cbdc::blocking_queue<cbdc::hash_t>();
-    auto second_conf_thrs = std::vector<std::thread>();
-
     static std::atomic_bool running{true};
 
-    static constexpr auto n_second_conf_thrs = 100;
-    for(auto i = 0; i < n_second_conf_thrs; i++) {
-        second_conf_thrs.emplace_back([&]() {
-            while(running) {
-                auto tx_id = cbdc::hash_t();
-                auto res = second_conf_queue.pop(tx_id);
-                if(!res) {
-                    continue;
-                }
-                auto conf = status_client.check_tx_id(tx_id);
-                if(!conf) {
-                    logger->warn(cbdc::to_string(tx_id), "no response");
-                } else if(!*conf) {
-                    logger->warn(cbdc::to_string(tx_id), "wasn't confirmed");
+    // Transaction IDs awaiting a second confirmation from the shards,
+    // checked in batches by a single thread
+    auto second_conf_mut = std::mutex();
+    auto second_conf_cv = std::condition_variable();
+    auto second_conf_ids = std::vector<cbdc::hash_t>();
+    static constexpr size_t second_conf_batch_size = 1000;
+    static constexpr auto second_conf_interval
+        = std::chrono::milliseconds(100);
+
+    auto second_conf_thr = std::thread([&]() {
+        auto batch = std::vector<cbdc::hash_t>();
+        while(running) {
+            {
+                std::unique_lock l(second_conf_mut);
+                second_conf_cv.wait_for(l, second_conf_interval, [&]() {
+                    return !running
+                        || second_conf_ids.size() >= second_conf_batch_size;
+                });
+                std::swap(batch, second_conf_ids);
+            }
+            if(batch.empty()) {
+                continue;
+            }
+            auto confs = status_client.check_tx_ids(batch);
+            for(size_t i = 0; i < batch.size(); i++) {
+                if(!confs[i]) {
+                    logger->warn(cbdc::to_string(batch[i]), "no response");
+                } else if(!*confs[i]) {
+                    logger->warn(cbdc::to_string(batch[i]),
+                                 "wasn't confirmed");
                 }
             }
-        });
-    }
-
-    constexpr auto send_amt = 5;
+            batch.clear();
+        }
+    });
 
-    uint64_t gen_avg{};
-    auto gen_thread = std::thread([&]() {
-        while(running) {
-            // Determine if we should attempt to send a double-spending
-            // transaction
-            bool send_invalid{false};
-            if(cfg.m_invalid_rate > 0.0) {
-                send_invalid = invalid_dist(engine);
+    auto record_confirmed = [&](const cbdc::hash_t& tx_id,
+                                int64_t send_time) {
+        {
+            std::lock_guard l(second_conf_mut);
+            second_conf_ids.push_back(tx_id);
+            if(second_conf_ids.size() >= second_conf_batch_size) {
+                second_conf_cv.notify_one();
             }
+        }
+        auto now = std::chrono::high_resolution_clock::now()
+                       .time_since_epoch()
+                       .count();
+        const auto tx_delay = now - send_time;
+        latency_log << now << " " << tx_delay << "\n";
+    };
 
-            // Determine if we should attempt to send a fixed-size transaction
-            bool send_fixed{false};
-            if(cfg.m_fixed_tx_mode && cfg.m_fixed_tx_rate > 0.0) {
-                send_fixed = fixed_dist(engine);
-            }
+    constexpr auto send_amt = 5;
 
+    // Generate and sign transactions ahead of send time on each worker
+    for(size_t i = 0; i < n_workers; i++) {
+        auto* worker = workers[i].get();
+        worker->m_thread = std::thread([&, worker, i]() {
+            auto& wallet = worker->m_wallet;
+            auto engine = std::default_random_engine(
+                static_cast<std::default_random_engine::result_type>(i));
+            auto fixed_dist = std::bernoulli_distribution(cfg.m_fixed_tx_rate);
             auto tx = std::optional<cbdc::transaction::full_tx>();
-            // Try to send a double-spending transaction
-            if(send_invalid) {
-                std::lock_guard<std::mutex> l(confirmed_txs_mut);
-                // Attempt to pop a previously confirmed transaction to re-send
-                // (will now be a double-spend)
-                if(!confirmed_txs.empty()) {
-                    tx = std::move(confirmed_txs.front());
-                    confirmed_txs.pop();
+            static constexpr auto ring_full_delay
+                = std::chrono::microseconds(100);
+            while(running) {
+                if(tx.has_value()) {
+                    if(!worker->m_ring.try_push(tx.value())) {
+                        std::this_thread::sleep_for(ring_full_delay);
+                        continue;
+                    }
+                    tx.reset();
+                }
+
+                // Determine if we should attempt to send a fixed-size
+                // transaction
+                bool send_fixed{false};
+                if(cfg.m_fixed_tx_mode && cfg.m_fixed_tx_rate > 0.0) {
+                    send_fixed = fixed_dist(engine);
                 }
-            }
 
-            // tx is empty so there wasn't a double-spend available for us to
-            // send. Try to send a new (valid) transaction instead.
-            if(!tx) {
-                // If we're sending fixed-size transactions, attempt to
-                // generate a fixed-size transaction.
-                auto gen_s = std::chrono::high_resolution_clock::now();
                 if(send_fixed) {
                     tx = wallet.send_to(cfg.m_input_count,
                                         cfg.m_output_count,
@@ -213,37 +342,127 @@ auto main(int argc, char** argv) -> int {
                                             true);
                     }
                 }
-                auto gen_e = std::chrono::high_resolution_clock::now();
-                auto gen_t = gen_e - gen_s;
-                static constexpr auto average_factor = 0.1;
-                gen_avg = static_cast<uint64_t>(
-                    (static_cast<double>(gen_t.count()) * average_factor)
-                    + (static_cast<double>(gen_avg) * (1.0 - average_factor)));
-            } else {
-                std::this_thread::sleep_for(std::chrono::nanoseconds(gen_avg));
+
+                // We couldn't generate a valid transaction, emit a warning
+                // and wait for confirmations.
+                if(!tx) {
+                    logger->warn("Wallet out of outputs");
+                    static constexpr auto send_delay = std::chrono::seconds(1);
+                    std::this_thread::sleep_for(send_delay);
+                }
             }
+        });
+    }
 
-            // We couldn't send a double-spend or a newly generated valid
-            // transaction, emit a warning and wait for confirmations.
-            if(!tx) {
-                logger->warn("Wallet out of outputs");
-                // If we couldn't send any txs this loop because we're out of
-                // spendable outputs, sleep the send thread for some time in
-                // the hope of receiving confirmations. Note, this could also
-                // be a condition variable signalled by the confirmation thread
-                // instead.
-                static constexpr auto send_delay = std::chrono::seconds(1);
-                std::this_thread::sleep_for(send_delay);
+    // Send pre-signed or replayed transactions at the configured rate. Send
+    // times follow a fixed schedule so oversleeping before one send shortens
+    // the wait before the next rather than lowering the rate.
+    std::atomic<uint64_t> sent_count{0};
+    auto send_thread = std::thread([&]() {
+        auto invalid_dist = std::bernoulli_distribution(cfg.m_invalid_rate);
+        auto engine = std::default_random_engine();
+        auto send_interval = std::chrono::nanoseconds::zero();
+        if(cfg.m_loadgen_tx_rate != 0) {
+            send_interval = std::chrono::nanoseconds(std::chrono::seconds(1))
+                          / static_cast<std::chrono::nanoseconds::rep>(
+                              cfg.m_loadgen_tx_rate);
+        }
+        auto next_send = std::chrono::steady_clock::now();
+        size_t next_worker{0};
+        auto tx = cbdc::transaction::full_tx();
+        static constexpr auto empty_delay = std::chrono::microseconds(50);
+        while(running) {
+            gen_worker* owner{nullptr};
+
+            if(corpus) {
+                // Decode into the same transaction each time so replay
+                // doesn't allocate
+                if(!corpus->next(tx)) {
+                    logger->info("Replayed all transactions in corpus");
+                    running = false;
+                    break;
+                }
+                if(send_interval != std::chrono::nanoseconds::zero()) {
+                    std::this_thread::sleep_until(next_send);
+                    next_send += send_interval;
+                }
+
+                auto send_time = std::chrono::high_resolution_clock::now()
+                                     .time_since_epoch()
+                                     .count();
+                auto tx_id = cbdc::transaction::tx_id(tx);
+                auto replay_cb
+                    = [&, tx_id, send_time](
+                          cbdc::sentinel::rpc::client::execute_result_type
+                              res) {
+                          if(!res.has_value()) {
+                              logger->warn(
+                                  "Failure response from sentinel for",
+                                  cbdc::to_string(tx_id));
+                          } else if(res->m_tx_status
+                                    == cbdc::sentinel::tx_status::confirmed) {
+                              record_confirmed(tx_id, send_time);
+                          } else {
+                              logger->warn(cbdc::to_string(tx_id),
+                                           "had error");
+                          }
+                      };
+                // Serialize straight from the reused transaction rather
+                // than handing the client a copy
+                if(!sentinel_client.execute_transaction_ref(
+                       tx,
+                       std::move(replay_cb))) {
+                    logger->error("Failure sending transaction to sentinel");
+                }
+                sent_count++;
                 continue;
             }
 
+            // Determine if we should attempt to send a double-spending
+            // transaction
+            if(cfg.m_invalid_rate > 0.0 && invalid_dist(engine)) {
+                std::lock_guard<std::mutex> l(confirmed_txs_mut);
+                // Attempt to pop a previously confirmed transaction to
+                // re-send (will now be a double-spend)
+                if(!confirmed_txs.empty()) {
+                    tx = std::move(confirmed_txs.front().first);
+                    owner = confirmed_txs.front().second;
+                    confirmed_txs.pop();
+                }
+            }
+
+            // There wasn't a double-spend available for us to send. Take the
+            // next pre-signed transaction instead.
+            for(size_t i = 0; owner == nullptr && i < n_workers; i++) {
+                auto& worker = *workers[next_worker];
+                next_worker = (next_worker + 1) % n_workers;
+                if(worker.m_ring.try_pop(tx)) {
+                    owner = &worker;
+                }
+            }
+
+            if(owner == nullptr) {
+                // Generation is behind. Don't burst to catch up once it
+                // recovers.
+                std::this_thread::sleep_for(empty_delay);
+                next_send = std::max(next_send,
+                                     std::chrono::steady_clock::now());
+                continue;
+            }
+
+            if(send_interval != std::chrono::nanoseconds::zero()) {
+                std::this_thread::sleep_until(next_send);
+                next_send += send_interval;
+            }
+
             auto send_time = std::chrono::high_resolution_clock::now()
                                  .time_since_epoch()
                                  .count();
 
             auto res_cb
-                = [&, txn = tx.value(), send_time = send_time](
+                = [&, owner, txn = tx, send_time = send_time](
                       cbdc::sentinel::rpc::client::execute_result_type res) {
+                      auto& wallet = owner->m_wallet;
                       auto tx_id = cbdc::transaction::tx_id(txn);
                       if(!res.has_value()) {
                           logger->warn("Failure response from sentinel for",
@@ -255,17 +474,12 @@ auto main(int argc, char** argv) -> int {
                       if(sent_resp.m_tx_status
                          == cbdc::sentinel::tx_status::confirmed) {
                           wallet.confirm_transaction(txn);
-                          second_conf_queue.push(tx_id);
-                          auto now = std::chrono::high_resolution_clock::now()
-                                         .time_since_epoch()
-                                         .count();
-                          const auto tx_delay = now - send_time;
-                          latency_log << now << " " << tx_delay << "\n";
+                          record_confirmed(tx_id, send_time);
                           constexpr auto max_invalid = 100000;
                           if(cfg.m_invalid_rate > 0.0) {
                               std::lock_guard<std::mutex> l(confirmed_txs_mut);
                               if(confirmed_txs.size() < max_invalid) {
-                                  confirmed_txs.push(txn);
+                                  confirmed_txs.emplace(txn, owner);
                               }
                           }
                       } else {
@@ -275,11 +489,11 @@ auto main(int argc, char** argv) -> int {
                       }
                   };
 
-            if(!sentinel_client.execute_transaction(tx.value(),
-                                                    std::move(res_cb))) {
+            if(!sentinel_client.execute_transaction(tx, std::move(res_cb))) {
                 logger->error("Failure sending transaction to sentinel");
-                wallet.confirm_inputs(tx.value().m_inputs);
+                owner->m_wallet.confirm_inputs(tx.m_inputs);
             }
+            sent_count++;
         }
     });
 
@@ -287,15 +501,32 @@ auto main(int argc, char** argv) -> int {
         running = false;
     });
 
+    static constexpr auto rate_log_interval = 10;
+    auto seconds = 0;
+    uint64_t last_sent{0};
     while(running) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
+        if(++seconds % rate_log_interval == 0) {
+            auto sent = sent_count.load();
+            size_t presigned{0};
+            for(auto& worker : workers) {
+                presigned += worker->m_ring.size();
+            }
+            logger->info("Sent",
+                         (sent - last_sent) / rate_log_interval,
+                         "TX/s,",
+                         presigned,
+                         "pre-signed");
+            last_sent = sent;
+        }
     }
 
-    gen_thread.join();
-    second_conf_queue.clear();
-    for(auto& thr : second_conf_thrs) {
-        thr.join();
+    send_thread.join();
+    for(auto& worker : workers) {
+        worker->m_thread.join();
     }
+    second_conf_cv.notify_one();
+    second_conf_thr.join();
 
     return 0;
 }